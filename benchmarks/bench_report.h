@@ -0,0 +1,136 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+// The command line and the JSON report shared by the benchmark apps.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchConfig
+{
+    std::string Filter;
+    // Divides the amount of work, to check the benchmarks run.
+    size_t Scale = 1;
+    int Runs = 5;
+
+    ////////////
+    /// @brief Parses [--filter <name>] [--quick].
+    /// @return false on an unknown argument, the usage is printed.
+    ////////////
+    bool Parse(int argc, char* argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            {
+                Filter = argv[++i];
+            }
+            else if (strcmp(argv[i], "--quick") == 0)
+            {
+                Scale = 10;
+                Runs = 1;
+            }
+            else
+            {
+                std::cerr << "Usage: " << argv[0] << " [--filter <name>] [--quick]" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Selected(std::string const& name) const
+    {
+        return Filter.empty() || name.find(Filter) != std::string::npos;
+    }
+};
+
+////////////
+/// @brief One JSON object of the "results" array, the fields are written in insertion order.
+////////////
+class BenchResult
+{
+    std::vector<std::pair<std::string, std::string>> _Fields;
+
+public:
+    explicit BenchResult(std::string const& name)
+    {
+        Add("name", name);
+    }
+
+    BenchResult& Add(std::string const& key, std::string const& value)
+    {
+        _Fields.emplace_back(key, '"' + value + '"');
+        return *this;
+    }
+
+    BenchResult& Add(std::string const& key, double value)
+    {
+        std::ostringstream stream;
+        stream << std::setprecision(6) << value;
+        _Fields.emplace_back(key, stream.str());
+        return *this;
+    }
+
+    BenchResult& Add(std::string const& key, uint64_t value)
+    {
+        _Fields.emplace_back(key, std::to_string(value));
+        return *this;
+    }
+
+    std::string ToJson() const
+    {
+        std::string json = "{";
+        for (size_t i = 0; i < _Fields.size(); ++i)
+        {
+            if (i != 0)
+                json += ", ";
+
+            json += '"' + _Fields[i].first + "\": " + _Fields[i].second;
+        }
+        return json + '}';
+    }
+};
+
+inline double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// Nearest rank percentile of sorted values.
+inline double Percentile(std::vector<double> const& sorted_values, double percentile)
+{
+    size_t rank = static_cast<size_t>(percentile / 100.0 * sorted_values.size());
+    return sorted_values[std::min(rank, sorted_values.size() - 1)];
+}
+
+// Writes the results to stdout as a single JSON document.
+inline void PrintResults(const char* suite, std::vector<BenchResult> const& results)
+{
+    std::cout << "{\n  \"suite\": \"" << suite << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+        std::cout << "    " << results[i].ToJson() << (i + 1 == results.size() ? "\n" : ",\n");
+    std::cout << "  ]\n}" << std::endl;
+}
@@ -0,0 +1,287 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+// Microbenchmarks of the library hot paths: address parsing and formatting, address copies,
+// error and flag conversions, byte swapping, latency histogram recording.
+// The results are written to stdout as a single JSON document, the progress to stderr:
+//   microbench [--filter <name>] [--quick] > results.json
+// An operation is timed by batches big enough for the clock resolution, each batch gives one ns/op sample.
+// The report has the min (the best case, the least noisy), the median and the p99 of the samples.
+
+#include "bench_report.h"
+
+#include <NetworkLibrary/IPv4.h>
+#include <NetworkLibrary/IPv6.h>
+#include <NetworkLibrary/LatencyHistogram.h>
+// The conversions are internal, this app links the static library.
+#include "internals/internal_socket.h"
+
+#include <chrono>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+// Keeps the compiler from removing a computation whose result is unused.
+template<typename T>
+inline void DoNotOptimize(T const& value)
+{
+#if defined(_MSC_VER)
+    static const void* volatile sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+// Hides value from the compiler, so a computation on a constant isn't folded.
+template<typename T>
+inline T Opaque(T value)
+{
+#if defined(_MSC_VER)
+    volatile T copy = value;
+    return copy;
+#else
+    asm volatile("" : "+r"(value));
+    return value;
+#endif
+}
+
+class MicroBench
+{
+    BenchConfig const& _Config;
+    std::vector<BenchResult>& _Results;
+
+    template<typename Operation>
+    static double _TimeBatch(Operation& operation, size_t batch_size)
+    {
+        auto start = bench_clock::now();
+        for (size_t i = 0; i < batch_size; ++i)
+            operation(i);
+
+        return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+    }
+
+public:
+    MicroBench(BenchConfig const& config, std::vector<BenchResult>& results) :
+        _Config(config),
+        _Results(results)
+    {}
+
+    ////////////
+    /// @brief Times operation(i), i being the iteration index to vary the inputs.
+    /// @param[in] name      The benchmark name.
+    /// @param[in] operation The operation.
+    /// @return
+    ////////////
+    template<typename Operation>
+    void Run(std::string const& name, Operation operation)
+    {
+        // Batches of at least 20us, the steady clock can be as coarse as a microsecond.
+        const double min_batch_ns = 20000;
+        const size_t sample_count = 1000 / _Config.Scale;
+        size_t batch_size = 1;
+        std::vector<double> samples;
+
+        if (!_Config.Selected(name))
+            return;
+
+        std::cerr << "Running " << name << "..." << std::endl;
+        while (_TimeBatch(operation, batch_size) < min_batch_ns && batch_size < (size_t(1) << 24))
+            batch_size *= 2;
+
+        // Warms the caches and the branch predictors up.
+        for (int i = 0; i < 10; ++i)
+            _TimeBatch(operation, batch_size);
+
+        samples.reserve(sample_count);
+        for (size_t i = 0; i < sample_count; ++i)
+            samples.emplace_back(_TimeBatch(operation, batch_size) / batch_size);
+
+        std::sort(samples.begin(), samples.end());
+        _Results.emplace_back(BenchResult(name)
+            .Add("iterations", static_cast<uint64_t>(batch_size * sample_count))
+            .Add("samples", static_cast<uint64_t>(sample_count))
+            .Add("min_ns", samples.front())
+            .Add("median_ns", Percentile(samples, 50))
+            .Add("p99_ns", Percentile(samples, 99)));
+    }
+};
+
+static void BenchAddresses(MicroBench& bench)
+{
+    static const char ipv4_string[] = "192.168.100.200:65535";
+    static const char ipv6_string[] = "[2001:db8:85a3::8a2e:370:7334%3]:65535";
+    char buffer[NetworkLibrary::IPv6::IPv6Addr::MaxStringSize];
+    NetworkLibrary::IPv4::IPv4Addr ipv4_addr;
+    NetworkLibrary::IPv6::IPv6Addr ipv6_addr;
+
+    ipv4_addr.FromString(ipv4_string);
+    ipv6_addr.FromString(ipv6_string);
+
+    bench.Run("ipv4_from_string", [&](size_t)
+    {
+        ipv4_addr.FromString(Opaque(ipv4_string), sizeof(ipv4_string) - 1);
+        DoNotOptimize(ipv4_addr);
+    });
+    bench.Run("ipv4_from_std_string", [&](size_t)
+    {
+        std::string str(Opaque(ipv4_string));
+        ipv4_addr.FromString(str);
+        DoNotOptimize(ipv4_addr);
+    });
+    bench.Run("ipv4_to_string_buffer", [&](size_t)
+    {
+        DoNotOptimize(ipv4_addr.ToString(buffer, sizeof(buffer), true));
+        DoNotOptimize(buffer);
+    });
+    bench.Run("ipv4_to_std_string", [&](size_t)
+    {
+        DoNotOptimize(ipv4_addr.ToString(true));
+    });
+
+    bench.Run("ipv6_from_string", [&](size_t)
+    {
+        ipv6_addr.FromString(Opaque(ipv6_string), sizeof(ipv6_string) - 1);
+        DoNotOptimize(ipv6_addr);
+    });
+    bench.Run("ipv6_from_std_string", [&](size_t)
+    {
+        std::string str(Opaque(ipv6_string));
+        ipv6_addr.FromString(str);
+        DoNotOptimize(ipv6_addr);
+    });
+    bench.Run("ipv6_to_string_buffer", [&](size_t)
+    {
+        DoNotOptimize(ipv6_addr.ToString(buffer, sizeof(buffer), true));
+        DoNotOptimize(buffer);
+    });
+    bench.Run("ipv6_to_std_string", [&](size_t)
+    {
+        DoNotOptimize(ipv6_addr.ToString(true));
+    });
+
+    bench.Run("ipv4_addr_copy", [&](size_t)
+    {
+        DoNotOptimize(ipv4_addr);
+        NetworkLibrary::IPv4::IPv4Addr copy(ipv4_addr);
+        DoNotOptimize(copy);
+    });
+    bench.Run("ipv4_addr_move", [&](size_t)
+    {
+        NetworkLibrary::IPv4::IPv4Addr source(ipv4_addr);
+        DoNotOptimize(source);
+        NetworkLibrary::IPv4::IPv4Addr moved(std::move(source));
+        DoNotOptimize(moved);
+    });
+    bench.Run("ipv6_addr_copy", [&](size_t)
+    {
+        DoNotOptimize(ipv6_addr);
+        NetworkLibrary::IPv6::IPv6Addr copy(ipv6_addr);
+        DoNotOptimize(copy);
+    });
+    bench.Run("ipv6_addr_move", [&](size_t)
+    {
+        NetworkLibrary::IPv6::IPv6Addr source(ipv6_addr);
+        DoNotOptimize(source);
+        NetworkLibrary::IPv6::IPv6Addr moved(std::move(source));
+        DoNotOptimize(moved);
+    });
+}
+
+static void BenchErrors(MicroBench& bench)
+{
+#if defined(SOCKET_OS_WINDOWS)
+    static const int native_errors[] = { 0, WSAEWOULDBLOCK, WSAECONNRESET, WSAECONNREFUSED, WSAETIMEDOUT, WSAEINPROGRESS, WSAEADDRINUSE, WSAEINVAL };
+#else
+    static const int native_errors[] = { 0, EWOULDBLOCK, ECONNRESET, ECONNREFUSED, ETIMEDOUT, EINPROGRESS, EADDRINUSE, EINVAL };
+#endif
+    static const int socket_codes[] = {
+        NetworkLibrary::Error::NoError, NetworkLibrary::Error::WouldBlock, NetworkLibrary::Error::ConnectionReset, NetworkLibrary::Error::ConnectionRefused,
+        NetworkLibrary::Error::TimedOut, NetworkLibrary::Error::InProgress, NetworkLibrary::Error::AddrInUse, NetworkLibrary::Error::InVal,
+    };
+
+    bench.Run("make_error_from_native", [&](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::MakeErrorFromNative(native_errors[Opaque(i) & 7]));
+    });
+    bench.Run("make_error_from_socket_code", [&](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::MakeErrorFromSocketCode(socket_codes[Opaque(i) & 7]));
+    });
+}
+
+static void BenchPollFlags(MicroBench& bench)
+{
+    bench.Run("poll_flags_to_native", [](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::PollFlagsToNative(static_cast<int16_t>(Opaque(i) & 0x03ff)));
+    });
+    bench.Run("native_to_poll_flags", [](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::NativeToPollFlags(static_cast<int16_t>(Opaque(i) & 0x03ff)));
+    });
+}
+
+static void BenchNetSwap(MicroBench& bench)
+{
+    bench.Run("netswap_16", [](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::Endian::NetSwap(static_cast<uint16_t>(Opaque(i))));
+    });
+    bench.Run("netswap_32", [](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::Endian::NetSwap(static_cast<uint32_t>(Opaque(i))));
+    });
+    bench.Run("netswap_64", [](size_t i)
+    {
+        DoNotOptimize(NetworkLibrary::Internals::Endian::NetSwap(static_cast<uint64_t>(Opaque(i))));
+    });
+}
+
+static void BenchLatencyHistogram(MicroBench& bench)
+{
+    NetworkLibrary::LatencyHistogram histogram;
+
+    bench.Run("latency_histogram_record", [&](size_t i)
+    {
+        histogram.Record(std::chrono::nanoseconds(Opaque(i) & 0xfffff));
+    });
+    DoNotOptimize(histogram);
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+    std::vector<BenchResult> results;
+
+    if (!config.Parse(argc, argv))
+        return 1;
+
+    MicroBench bench(config, results);
+    BenchAddresses(bench);
+    BenchErrors(bench);
+    BenchPollFlags(bench);
+    BenchNetSwap(bench);
+    BenchLatencyHistogram(bench);
+
+    PrintResults("microbench", results);
+    return 0;
+}
@@ -0,0 +1,414 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+// Loopback benchmarks of the socket library.
+// The results are written to stdout as a single JSON document, the progress to stderr:
+//   socket_bench [--filter <name>] [--quick] > results.json
+// Each benchmark does a fixed amount of work, so two runs on the same machine are comparable,
+// and repeats it to report the median run.
+
+#include "bench_report.h"
+
+#include <NetworkLibrary/IPv4.h>
+#include <NetworkLibrary/Poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double Seconds(bench_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+static bool Check(NetworkLibrary::Error error, const char* what)
+{
+    if ((int)error == NetworkLibrary::Error::NoError)
+        return true;
+
+    std::cerr << what << " failed: " << error.ToString() << std::endl;
+    return false;
+}
+
+static bool MakeTcpPair(NetworkLibrary::IPv4::TCP& client, NetworkLibrary::IPv4::TCP& server)
+{
+    NetworkLibrary::IPv4::TCP listener;
+    NetworkLibrary::IPv4::IPv4Addr addr;
+
+    addr.SetLoopbackAddr();
+    return Check(listener.CreateSocket(), "Create listener") &&
+        Check(listener.Bind(addr), "Bind listener") &&
+        Check(listener.Listen(), "Listen") &&
+        Check(listener.GetSockName(addr), "GetSockName") &&
+        Check(client.CreateSocket(), "Create client") &&
+        Check(client.Connect(addr), "Connect") &&
+        Check(listener.Accept(server, addr), "Accept");
+}
+
+static bool SendAll(NetworkLibrary::ConnectedSocket& socket, const uint8_t* data, size_t size)
+{
+    while (size != 0)
+    {
+        NetworkLibrary::NetBuffer net_buffer{ const_cast<uint8_t*>(data), size };
+        if ((int)socket.Send(net_buffer) != NetworkLibrary::Error::NoError || net_buffer.BufferSize == 0)
+            return false;
+
+        data += net_buffer.BufferSize;
+        size -= net_buffer.BufferSize;
+    }
+    return true;
+}
+
+static bool ReceiveAll(NetworkLibrary::ConnectedSocket& socket, uint8_t* data, size_t size)
+{
+    while (size != 0)
+    {
+        NetworkLibrary::NetBuffer net_buffer{ data, size };
+        if ((int)socket.Receive(net_buffer) != NetworkLibrary::Error::NoError || net_buffer.BufferSize == 0)
+            return false;
+
+        data += net_buffer.BufferSize;
+        size -= net_buffer.BufferSize;
+    }
+    return true;
+}
+
+// One way bulk transfer, the time runs from the first send to the last byte received.
+static void BenchTcpThroughput(BenchConfig const& config, std::vector<BenchResult>& results)
+{
+    for (size_t message_size : { 64, 1024, 16384, 65536 })
+    {
+        const size_t message_count = std::min<size_t>(64 * 1024 * 1024 / message_size, 200000) / config.Scale;
+        const uint64_t total_bytes = static_cast<uint64_t>(message_count) * message_size;
+        std::vector<uint8_t> message(message_size, 0x5a);
+        std::vector<double> run_seconds;
+
+        for (int run = 0; run < config.Runs; ++run)
+        {
+            NetworkLibrary::IPv4::TCP client, server;
+            if (!MakeTcpPair(client, server))
+                return;
+
+            std::thread receiver([&server, total_bytes]()
+            {
+                std::vector<uint8_t> buffer(65536);
+                uint64_t received = 0;
+                while (received < total_bytes)
+                {
+                    NetworkLibrary::NetBuffer net_buffer{ buffer.data(), buffer.size() };
+                    if ((int)server.Receive(net_buffer) != NetworkLibrary::Error::NoError || net_buffer.BufferSize == 0)
+                        break;
+
+                    received += net_buffer.BufferSize;
+                }
+            });
+
+            bool sent = true;
+            auto start = bench_clock::now();
+            for (size_t i = 0; i < message_count && sent; ++i)
+                sent = SendAll(client, message.data(), message.size());
+
+            // On a failed send, the receiver would wait forever for the missing bytes: the close unblocks it.
+            client.Close();
+            receiver.join();
+            if (!sent)
+                return;
+
+            run_seconds.emplace_back(Seconds(bench_clock::now() - start));
+        }
+
+        double seconds = Median(run_seconds);
+        results.emplace_back(BenchResult("tcp_throughput")
+            .Add("message_size", static_cast<uint64_t>(message_size))
+            .Add("messages", static_cast<uint64_t>(message_count))
+            .Add("runs", static_cast<uint64_t>(config.Runs))
+            .Add("median_seconds", seconds)
+            .Add("mib_per_second", total_bytes / seconds / (1024 * 1024))
+            .Add("messages_per_second", message_count / seconds));
+    }
+}
+
+// Ping-pong of small messages with Nagle disabled, each round trip is timed.
+static void BenchTcpLatency(BenchConfig const& config, std::vector<BenchResult>& results)
+{
+    const size_t message_size = 64;
+    const size_t warmup = 1000 / config.Scale;
+    const size_t samples = 50000 / config.Scale;
+    NetworkLibrary::IPv4::TCP client, server;
+    std::vector<double> round_trips;
+
+    if (!MakeTcpPair(client, server) ||
+        !Check(client.SetOption<NetworkLibrary::Options::TcpNoDelay>(true), "TcpNoDelay") ||
+        !Check(server.SetOption<NetworkLibrary::Options::TcpNoDelay>(true), "TcpNoDelay"))
+        return;
+
+    std::thread echo([&server, message_size]()
+    {
+        uint8_t buffer[64];
+        while (ReceiveAll(server, buffer, message_size) && SendAll(server, buffer, message_size))
+        {
+        }
+    });
+
+    uint8_t message[64] = {};
+    round_trips.reserve(samples);
+    for (size_t i = 0; i < warmup + samples; ++i)
+    {
+        auto start = bench_clock::now();
+        if (!SendAll(client, message, message_size) || !ReceiveAll(client, message, message_size))
+            break;
+
+        if (i >= warmup)
+            round_trips.emplace_back(std::chrono::duration<double, std::micro>(bench_clock::now() - start).count());
+    }
+
+    client.Close();
+    echo.join();
+    if (round_trips.empty())
+        return;
+
+    std::sort(round_trips.begin(), round_trips.end());
+    results.emplace_back(BenchResult("tcp_latency")
+        .Add("message_size", static_cast<uint64_t>(message_size))
+        .Add("samples", static_cast<uint64_t>(round_trips.size()))
+        .Add("min_us", round_trips.front())
+        .Add("p50_us", Percentile(round_trips, 50))
+        .Add("p90_us", Percentile(round_trips, 90))
+        .Add("p99_us", Percentile(round_trips, 99))
+        .Add("p99_9_us", Percentile(round_trips, 99.9))
+        .Add("max_us", round_trips.back()));
+}
+
+// A sender floods a receiver with small datagrams, loopback drops what the receiver can't keep up with.
+static void BenchUdpPps(BenchConfig const& config, std::vector<BenchResult>& results)
+{
+    const size_t datagram_size = 64;
+    const size_t datagram_count = 500000 / config.Scale;
+    std::vector<double> sent_rates, received_rates, loss_ratios;
+
+    for (int run = 0; run < config.Runs; ++run)
+    {
+        NetworkLibrary::IPv4::UDP sender, receiver;
+        NetworkLibrary::IPv4::IPv4Addr addr;
+        std::atomic<bool> sending(true);
+        size_t received = 0;
+        bench_clock::time_point first_receive, last_receive;
+
+        addr.SetLoopbackAddr();
+        if (!Check(receiver.CreateSocket(), "Create receiver") ||
+            !Check(receiver.SetOption<NetworkLibrary::Options::ReceiveBuffer>(4 * 1024 * 1024), "ReceiveBuffer") ||
+            !Check(receiver.Bind(addr), "Bind receiver") ||
+            !Check(receiver.GetSockName(addr), "GetSockName") ||
+            !Check(receiver.SetNonBlocking(true), "SetNonBlocking") ||
+            !Check(sender.CreateSocket(), "Create sender"))
+            return;
+
+        std::thread receiving([&]()
+        {
+            NetworkLibrary::Poll poll;
+            uint8_t buffer[2048];
+            NetworkLibrary::IPv4::IPv4Addr from;
+
+            poll.AddSocket(receiver, NetworkLibrary::PollFlags::in);
+            // Stops once the sender is done and nothing came for 100ms.
+            while (poll.DoPoll(std::chrono::milliseconds(100)) > 0 || sending)
+            {
+                for (;;)
+                {
+                    NetworkLibrary::NetBuffer net_buffer{ buffer, sizeof(buffer) };
+                    if ((int)receiver.ReceiveFrom(from, net_buffer) != NetworkLibrary::Error::NoError)
+                        break;
+
+                    last_receive = bench_clock::now();
+                    if (received++ == 0)
+                        first_receive = last_receive;
+                }
+            }
+        });
+
+        uint8_t datagram[64] = {};
+        auto start = bench_clock::now();
+        for (size_t i = 0; i < datagram_count; ++i)
+        {
+            NetworkLibrary::NetBuffer net_buffer{ datagram, datagram_size };
+            sender.SendTo(addr, net_buffer);
+        }
+        double send_seconds = Seconds(bench_clock::now() - start);
+        sending = false;
+        receiving.join();
+
+        sent_rates.emplace_back(datagram_count / send_seconds);
+        received_rates.emplace_back(received < 2 ? 0.0 : received / Seconds(last_receive - first_receive));
+        loss_ratios.emplace_back(1.0 - static_cast<double>(received) / datagram_count);
+    }
+
+    results.emplace_back(BenchResult("udp_pps")
+        .Add("datagram_size", static_cast<uint64_t>(datagram_size))
+        .Add("datagrams", static_cast<uint64_t>(datagram_count))
+        .Add("runs", static_cast<uint64_t>(config.Runs))
+        .Add("sent_per_second", Median(sent_rates))
+        .Add("received_per_second", Median(received_rates))
+        .Add("loss_ratio", Median(loss_ratios)));
+}
+
+// Full TCP connection setup and teardown, connect on one thread and accept on another.
+static void BenchConnectAccept(BenchConfig const& config, std::vector<BenchResult>& results)
+{
+    const size_t connection_count = 2000 / config.Scale;
+    std::vector<double> rates;
+
+    for (int run = 0; run < config.Runs; ++run)
+    {
+        NetworkLibrary::IPv4::TCP listener;
+        NetworkLibrary::IPv4::IPv4Addr addr;
+
+        addr.SetLoopbackAddr();
+        if (!Check(listener.CreateSocket(), "Create listener") ||
+            !Check(listener.Bind(addr), "Bind listener") ||
+            !Check(listener.Listen(128), "Listen") ||
+            !Check(listener.GetSockName(addr), "GetSockName"))
+            return;
+
+        std::atomic<size_t> accepted(0);
+        std::thread acceptor([&listener, &accepted, connection_count]()
+        {
+            NetworkLibrary::IPv4::IPv4Addr client_addr;
+            for (size_t i = 0; i < connection_count; ++i)
+            {
+                NetworkLibrary::IPv4::TCP connection;
+                if ((int)listener.Accept(connection, client_addr) != NetworkLibrary::Error::NoError)
+                    break;
+
+                ++accepted;
+            }
+        });
+
+        size_t connected = 0;
+        auto start = bench_clock::now();
+        for (; connected < connection_count; ++connected)
+        {
+            // A full accept queue drops the SYNs and the retransmit takes a second, keep it from filling up.
+            while (connected - accepted >= 64)
+                std::this_thread::yield();
+
+            NetworkLibrary::IPv4::TCP client;
+            if ((int)client.CreateSocket() != NetworkLibrary::Error::NoError || (int)client.Connect(addr) != NetworkLibrary::Error::NoError)
+                break;
+        }
+        acceptor.join();
+        rates.emplace_back(connected / Seconds(bench_clock::now() - start));
+
+        if (connected != connection_count)
+        {
+            std::cerr << "Connect failed after " << connected << " connections." << std::endl;
+            return;
+        }
+    }
+
+    results.emplace_back(BenchResult("connect_accept")
+        .Add("connections", static_cast<uint64_t>(connection_count))
+        .Add("runs", static_cast<uint64_t>(config.Runs))
+        .Add("connections_per_second", Median(rates)));
+}
+
+// DoPoll without waiting on a growing set of sockets, one of them always readable.
+static void BenchPoll(BenchConfig const& config, std::vector<BenchResult>& results)
+{
+    for (size_t socket_count : { 1, 8, 64, 512 })
+    {
+        const size_t iterations = (200000 / socket_count + 1000) / config.Scale;
+        std::vector<NetworkLibrary::IPv4::UDP> sockets(socket_count);
+        NetworkLibrary::IPv4::IPv4Addr addr;
+        NetworkLibrary::Poll poll;
+        std::vector<double> call_ns;
+
+        for (auto& socket : sockets)
+        {
+            addr.SetLoopbackAddr();
+            addr.SetPort(0);
+            if (!Check(socket.CreateSocket(), "Create socket") || !Check(socket.Bind(addr), "Bind socket"))
+                return;
+
+            poll.AddSocket(socket, NetworkLibrary::PollFlags::in);
+        }
+
+        // The datagram is never read, the last socket stays readable.
+        uint8_t byte = 0;
+        NetworkLibrary::NetBuffer net_buffer{ &byte, 1 };
+        sockets.back().GetSockName(addr);
+        sockets.back().SendTo(addr, net_buffer);
+        if (poll.DoPoll(std::chrono::milliseconds(1000)) != 1)
+        {
+            std::cerr << "The poll socket isn't readable." << std::endl;
+            return;
+        }
+
+        for (int run = 0; run < config.Runs; ++run)
+        {
+            auto start = bench_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                poll.DoPoll(std::chrono::milliseconds(0));
+
+            call_ns.emplace_back(std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / iterations);
+        }
+
+        double median_ns = Median(call_ns);
+        results.emplace_back(BenchResult("poll")
+            .Add("sockets", static_cast<uint64_t>(socket_count))
+            .Add("iterations", static_cast<uint64_t>(iterations))
+            .Add("runs", static_cast<uint64_t>(config.Runs))
+            .Add("ns_per_call", median_ns)
+            .Add("ns_per_socket", median_ns / socket_count));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    struct Benchmark
+    {
+        const char* Name;
+        void (*Function)(BenchConfig const&, std::vector<BenchResult>&);
+    };
+
+    static const Benchmark benchmarks[] = {
+        { "tcp_throughput", BenchTcpThroughput },
+        { "tcp_latency"   , BenchTcpLatency },
+        { "udp_pps"       , BenchUdpPps },
+        { "connect_accept", BenchConnectAccept },
+        { "poll"          , BenchPoll },
+    };
+
+    BenchConfig config;
+    std::vector<BenchResult> results;
+
+    if (!config.Parse(argc, argv))
+        return 1;
+
+    for (auto const& benchmark : benchmarks)
+    {
+        if (!config.Selected(benchmark.Name))
+            continue;
+
+        std::cerr << "Running " << benchmark.Name << "..." << std::endl;
+        benchmark.Function(config, results);
+    }
+
+    PrintResults("socket_bench", results);
+    return 0;
+}
@@ -0,0 +1,125 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "IPv4.h"
+#include "IPv6.h"
+
+#include <type_traits>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief An address of any family, backed by a sockaddr_storage, for code that doesn't know the family in advance.
+    ///        ReceiveFrom/Accept fill it whatever the peer family, the family is then read with GetFamily().
+    ///        A dual-stack IPv6 socket (Options::Ipv6V6Only set to false) receives IPv4 peers as IPv4 mapped IPv6
+    ///        addresses (::ffff:a.b.c.d), Normalize() turns them back to IPv4.
+    ////////////
+    class AnyAddr :
+        public BasicAddr
+    {
+        // Inline storage for the native sockaddr_storage, addresses are copied without any allocation.
+        std::aligned_storage<128, 8>::type _Storage;
+
+        class AnyAddrImpl& _Impl();
+        class AnyAddrImpl const& _Impl() const;
+
+    public:
+        ////////////
+        /// @brief Builds an empty address (AF_UNSPEC).
+        ////////////
+        AnyAddr();
+        AnyAddr(AnyAddr const& other) = default;
+        AnyAddr(AnyAddr&& other) noexcept = default;
+        AnyAddr& operator=(AnyAddr const& other) = default;
+        AnyAddr& operator=(AnyAddr&& other) noexcept = default;
+        virtual ~AnyAddr();
+
+        ////////////
+        /// @brief Transforms the address to a human readable string, only IPv4, IPv6 and Unix addresses are supported.
+        /// @param[in] with_port Append the port
+        /// @return The string representation of the address
+        ////////////
+        virtual std::string ToString(bool with_port = false) const;
+        ////////////
+        /// @brief Get this Addr family type.
+        /// @return AF_UNSPEC if the address is empty.
+        ////////////
+        virtual int GetFamily() const;
+        ////////////
+        /// @brief Get this Addr sockaddr.
+        /// @return Reference
+        ////////////
+        virtual void* GetAddr();
+        ////////////
+        /// @brief Get this Addr sockaddr.
+        /// @return Const reference
+        ////////////
+        virtual const void* GetAddr() const;
+        ////////////
+        /// @brief Get this Addr length, the one of its family sockaddr.
+        /// @return Addr length
+        ////////////
+        virtual size_t GetLength() const;
+        ////////////
+        /// @brief Get the sockaddr_storage size, so any family can be received.
+        /// @return The storage size.
+        ////////////
+        virtual size_t GetStorageSize() const;
+
+        ////////////
+        /// @brief Copies any address in this one.
+        /// @param[in] addr The address.
+        /// @return Error, InVal if the address doesn't fit in a sockaddr_storage.
+        ////////////
+        NetworkLibrary::Error FromAddr(BasicAddr const& addr);
+        ////////////
+        /// @brief Get the IPv4 address, IPv4 mapped IPv6 addresses are converted.
+        /// @param[out] addr Receives the address.
+        /// @return Error, InVal if this isn't an IPv4 or IPv4 mapped address.
+        ////////////
+        NetworkLibrary::Error ToAddr(IPv4::IPv4Addr& addr) const;
+        ////////////
+        /// @brief Get the IPv6 address, IPv4 addresses are converted to IPv4 mapped addresses.
+        /// @param[out] addr Receives the address.
+        /// @return Error, InVal if this isn't an IPv4 or IPv6 address.
+        ////////////
+        NetworkLibrary::Error ToAddr(IPv6::IPv6Addr& addr) const;
+        ////////////
+        /// @brief Get if this is an IPv4 mapped IPv6 address (::ffff:a.b.c.d).
+        /// @return true if it is mapped.
+        ////////////
+        bool IsIPv4Mapped() const;
+        ////////////
+        /// @brief Turns an IPv4 mapped IPv6 address into its IPv4 address, the port is kept.
+        ///        The other addresses are left untouched.
+        /// @return true if the address was converted.
+        ////////////
+        bool Normalize();
+        ////////////
+        /// @brief Turns an IPv4 address into an IPv4 mapped IPv6 address, the port is kept.
+        ///        Needed to send to an IPv4 peer from a dual-stack socket on the systems that don't accept IPv4 addresses there.
+        /// @return true if the address was converted.
+        ////////////
+        bool MapToIPv6();
+        ////////////
+        /// @brief Get this address host ordered port.
+        /// @return Host ordered port, 0 if this isn't an IPv4 or IPv6 address.
+        ////////////
+        uint16_t GetPort() const;
+    };
+}
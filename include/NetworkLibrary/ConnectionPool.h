@@ -0,0 +1,113 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "IPv4.h"
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief Keeps outbound TCP connections open between requests, so the same backend doesn't pay for a handshake each time.
+    ///        Connections are pooled per endpoint (address and port). Acquire() hands out the most recently released
+    ///        healthy connection, or opens a new one. Once done, the connection must be given back with Release(),
+    ///        even if it is broken, so the endpoint connection count stays right.
+    ///        Idle connections are closed after the idle timeout, call EvictIdle() at least every GetNextEvictionTimeout().
+    ///        A ConnectionPool must be used by only one thread at a time.
+    ////////////
+    class ConnectionPool
+    {
+        class ConnectionPoolImpl* _Impl;
+
+    public:
+        ConnectionPool();
+        ConnectionPool(ConnectionPool const& other) = delete;
+        ConnectionPool(ConnectionPool&& other) noexcept;
+        ConnectionPool& operator=(ConnectionPool const& other) = delete;
+        ConnectionPool& operator=(ConnectionPool&& other) noexcept;
+        ~ConnectionPool();
+
+        ////////////
+        /// @brief Sets the per endpoint limits (4 idle and 16 total by default).
+        /// @param[in] max_idle  The max amount of idle connections kept open.
+        /// @param[in] max_total The max amount of connections, idle and acquired.
+        /// @return
+        ////////////
+        void SetLimits(size_t max_idle, size_t max_total);
+        ////////////
+        /// @brief Sets the time an idle connection is kept open (60s by default).
+        /// @param[in] timeout The idle time before closing.
+        /// @return
+        ////////////
+        void SetIdleTimeout(std::chrono::milliseconds timeout);
+        ////////////
+        /// @brief Opens connections to an endpoint in parallel and adds them to the idle connections.
+        ///        No more than the idle and total limits are opened.
+        /// @param[in]  addr         The endpoint.
+        /// @param[in]  count        The amount of connections wanted.
+        /// @param[in]  timeout      The max time to wait for the connections.
+        /// @param[out] opened_count The amount of connections opened.
+        /// @return Error, the first connection error if some connections failed.
+        ////////////
+        NetworkLibrary::Error WarmUp(IPv4::IPv4Addr const& addr, size_t count, std::chrono::milliseconds timeout, size_t& opened_count);
+        ////////////
+        /// @brief Takes a connection to an endpoint. Idle connections are checked without blocking,
+        ///        the ones closed by the peer or with unexpected pending data are dropped.
+        ///        If no idle connection is left, a new one is connected (blocking).
+        /// @param[in]  addr       The endpoint.
+        /// @param[out] connection Receives the connection.
+        /// @param[out] reused     True if the connection came from the idle connections.
+        /// @return Error, WouldBlock if the endpoint has reached its total limit.
+        ////////////
+        NetworkLibrary::Error Acquire(IPv4::IPv4Addr const& addr, IPv4::TCP& connection, bool& reused);
+        ////////////
+        /// @brief Gives back a connection taken with Acquire(). It is kept idle if it is reusable and the idle limit allows it,
+        ///        closed otherwise. connection is left closed.
+        /// @param[in] addr       The endpoint the connection was acquired for.
+        /// @param[in] connection The connection.
+        /// @param[in] reusable   False if the connection is broken or in an unknown protocol state.
+        /// @return
+        ////////////
+        void Release(IPv4::IPv4Addr const& addr, IPv4::TCP& connection, bool reusable = true);
+        ////////////
+        /// @brief Closes the connections that have been idle for longer than the idle timeout.
+        /// @return The number of connections closed.
+        ////////////
+        size_t EvictIdle();
+        ////////////
+        /// @brief Get the time until the next idle connection expires.
+        /// @return The time until EvictIdle() must be called, -1 if there is no idle connection.
+        ////////////
+        std::chrono::milliseconds GetNextEvictionTimeout() const;
+        ////////////
+        /// @brief Get the number of idle connections to an endpoint.
+        /// @param[in] addr The endpoint.
+        /// @return Number of idle connections
+        ////////////
+        size_t GetIdleCount(IPv4::IPv4Addr const& addr) const;
+        ////////////
+        /// @brief Get the number of connections to an endpoint, idle and acquired.
+        /// @param[in] addr The endpoint.
+        /// @return Number of connections
+        ////////////
+        size_t GetTotalCount(IPv4::IPv4Addr const& addr) const;
+        ////////////
+        /// @brief Closes all the idle connections, acquired connections are closed when released.
+        /// @return
+        ////////////
+        void Clear();
+    };
+}
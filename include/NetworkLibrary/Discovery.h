@@ -0,0 +1,163 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "IPv4.h"
+
+#include <functional>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief A peer found on the LAN.
+    ////////////
+    struct DiscoveryPeer
+    {
+        // Random id picked by the peer when it opened, a peer reachable from several interfaces is reported once.
+        uint64_t InstanceId;
+        // The address the first beacon came from, with the port the peer announces.
+        IPv4::IPv4Addr Addr;
+        // The application data the peer announces.
+        std::vector<uint8_t> Payload;
+    };
+
+    ////////////
+    /// @brief A peer table change.
+    ////////////
+    struct DiscoveryEvent
+    {
+        enum Type : uint8_t
+        {
+            PeerFound,
+            // The peer announces another port or payload.
+            PeerUpdated,
+            // The peer closed or expired.
+            PeerLost,
+        };
+
+        Type EventType;
+        DiscoveryPeer Peer;
+    };
+
+    ////////////
+    /// @brief Finds the peers of the LAN with UDP broadcast beacons.
+    ///        The beacons are sent to the directed broadcast address of every up IPv4 interface,
+    ///        so every segment the host is on is reached, whatever the default route.
+    ///        Open() asks the peers to answer right away: they reply after a random delay (SetReplyDelay)
+    ///        so the answers of a large LAN don't arrive all at once, and the peers are usually known in a few milliseconds.
+    ///        Then each peer announces itself every SetInterval() minus up to 25% of jitter, so peers started together don't stay in sync,
+    ///        and a peer not heard from for SetPeerTimeout() is lost. Beacon rounds are never closer than the reply delay,
+    ///        however many peers ask.
+    ///        Add GetPollSocket() to your Poll with PollFlags::in and call Process() when it's readable,
+    ///        or at least every GetNextTimeout().
+    ///        A DiscoveryService must be used by only one thread at a time.
+    ////////////
+    class DiscoveryService
+    {
+        class DiscoveryServiceImpl* _Impl;
+
+    public:
+        ////////////
+        /// @brief The max size of the announced payload, so a beacon always fits in a single datagram.
+        ////////////
+        static constexpr size_t MaxPayloadSize = 512;
+
+        ////////////
+        /// @brief Called from Process() for each change, the peer table is already updated.
+        ////////////
+        using Callback = std::function<void(DiscoveryEvent const& event)>;
+
+        DiscoveryService();
+        DiscoveryService(DiscoveryService const& other) = delete;
+        DiscoveryService(DiscoveryService&& other) noexcept;
+        DiscoveryService& operator=(DiscoveryService const& other) = delete;
+        DiscoveryService& operator=(DiscoveryService&& other) noexcept;
+        ~DiscoveryService();
+
+        ////////////
+        /// @brief Sets what this host announces, can be changed at any time, the next beacon carries it.
+        /// @param[in] service_port The port the peers should use to reach this host service.
+        /// @param[in] payload      The application data, like a service name, can be nullptr.
+        /// @param[in] payload_size The payload size.
+        /// @return Error, InVal if the payload is bigger than MaxPayloadSize.
+        ////////////
+        NetworkLibrary::Error SetAnnouncement(uint16_t service_port, const void* payload, size_t payload_size);
+        ////////////
+        /// @brief Sets the time between two announcements (5s by default).
+        /// @param[in] interval The time between two announcements.
+        /// @return
+        ////////////
+        void SetInterval(std::chrono::milliseconds interval);
+        ////////////
+        /// @brief Sets the time after which a silent peer is lost (16s by default), should be at least 3 intervals.
+        /// @param[in] timeout The time without beacon.
+        /// @return
+        ////////////
+        void SetPeerTimeout(std::chrono::milliseconds timeout);
+        ////////////
+        /// @brief Sets the max random delay before answering a query (50ms by default),
+        ///        it is also the min time between two beacon rounds.
+        /// @param[in] delay The max delay.
+        /// @return
+        ////////////
+        void SetReplyDelay(std::chrono::milliseconds delay);
+        ////////////
+        /// @brief Opens the discovery socket on port, reads the interfaces and queries the peers.
+        ///        All the hosts using the same port find each other, several services can share a host.
+        /// @param[in] port The discovery port.
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error Open(uint16_t port);
+        ////////////
+        /// @brief Sends a goodbye so the peers forget this host right away, then closes the socket.
+        ///        The peer table is cleared, without events.
+        /// @return
+        ////////////
+        void Close();
+        ////////////
+        /// @brief Reads the interfaces again and queries the peers, call it when the interfaces changed (see InterfaceMonitor).
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error RefreshInterfaces();
+        ////////////
+        /// @brief Sets the function called on each change.
+        /// @param[in] callback The function.
+        /// @return
+        ////////////
+        void SetCallback(Callback callback);
+        ////////////
+        /// @brief Reads the pending beacons, sends the beacons that are due and expires the silent peers, without blocking.
+        /// @return The number of changes.
+        ////////////
+        size_t Process();
+        ////////////
+        /// @brief Get the socket to poll for readability.
+        /// @return The socket
+        ////////////
+        BasicSocket const& GetPollSocket() const;
+        ////////////
+        /// @brief Get the time until the next beacon or peer expiry.
+        /// @return The time until Process() must be called, -1 if the service isn't opened.
+        ////////////
+        std::chrono::milliseconds GetNextTimeout() const;
+        ////////////
+        /// @brief Get the known peers.
+        /// @return The peers
+        ////////////
+        std::vector<DiscoveryPeer> GetPeers() const;
+    };
+}
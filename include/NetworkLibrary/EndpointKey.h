@@ -0,0 +1,125 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "IPv4.h"
+#include "IPv6.h"
+
+#include <cstring>
+#include <functional>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief A compact IPv4 or IPv6 endpoint (family, address, scope id, port), hashable and comparable.
+    ///        Meant to key per peer state, like the sessions of a UDP server looked up on each ReceiveFrom.
+    ///        All the bytes are always initialized, keys are compared and hashed as plain memory.
+    ////////////
+    struct EndpointKey
+    {
+        // IPv4 addresses are stored IPv4 mapped (::ffff:a.b.c.d), network ordered.
+        uint8_t Addr[16];
+        uint32_t ScopeId;
+        // Host ordered.
+        uint16_t Port;
+        // AF_INET, AF_INET6 or 0 for an empty key.
+        uint16_t Family;
+
+        ////////////
+        /// @brief Builds an empty key, it doesn't match any address.
+        ////////////
+        EndpointKey() noexcept :
+            Addr(),
+            ScopeId(0),
+            Port(0),
+            Family(0)
+        {}
+        ////////////
+        /// @brief Builds the key of an IPv4 endpoint.
+        /// @param[in] addr The address.
+        ////////////
+        explicit EndpointKey(IPv4::IPv4Addr const& addr) noexcept;
+        ////////////
+        /// @brief Builds the key of an IPv6 endpoint.
+        /// @param[in] addr The address.
+        ////////////
+        explicit EndpointKey(IPv6::IPv6Addr const& addr) noexcept;
+
+        ////////////
+        /// @brief Fills this key from any address, like the one filled by UnconnectedSocket::ReceiveFrom.
+        /// @param[in] addr The address.
+        /// @return Error, InVal if addr is neither IPv4 nor IPv6.
+        ////////////
+        NetworkLibrary::Error FromAddr(BasicAddr const& addr) noexcept;
+        ////////////
+        /// @brief Get back the IPv4 address.
+        /// @param[out] addr Receives the address.
+        /// @return Error, InVal if this isn't an IPv4 key.
+        ////////////
+        NetworkLibrary::Error ToAddr(IPv4::IPv4Addr& addr) const noexcept;
+        ////////////
+        /// @brief Get back the IPv6 address.
+        /// @param[out] addr Receives the address.
+        /// @return Error, InVal if this isn't an IPv6 key.
+        ////////////
+        NetworkLibrary::Error ToAddr(IPv6::IPv6Addr& addr) const noexcept;
+
+        ////////////
+        /// @brief Get this key hash, all the bits are mixed so any range of them can index a table.
+        /// @return The hash.
+        ////////////
+        uint64_t Hash() const noexcept
+        {
+            uint64_t words[3];
+            memcpy(words, this, sizeof(words));
+
+            uint64_t hash = (words[2] ^ 0x9E3779B97F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+            hash = (hash ^ (hash >> 31) ^ words[0]) * 0x94D049BB133111EBull;
+            hash = (hash ^ (hash >> 29) ^ words[1]) * 0xBF58476D1CE4E5B9ull;
+            return hash ^ (hash >> 32);
+        }
+
+        bool operator==(EndpointKey const& other) const noexcept
+        {
+            return memcmp(this, &other, sizeof(EndpointKey)) == 0;
+        }
+
+        bool operator!=(EndpointKey const& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+        // Memory order, only meant for sorted containers.
+        bool operator<(EndpointKey const& other) const noexcept
+        {
+            return memcmp(this, &other, sizeof(EndpointKey)) < 0;
+        }
+    };
+
+    static_assert(sizeof(EndpointKey) == 24, "EndpointKey must not have padding.");
+}
+
+namespace std {
+    template<>
+    struct hash<NetworkLibrary::EndpointKey>
+    {
+        size_t operator()(NetworkLibrary::EndpointKey const& key) const noexcept
+        {
+            return static_cast<size_t>(key.Hash());
+        }
+    };
+}
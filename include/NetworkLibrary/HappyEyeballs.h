@@ -0,0 +1,126 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "IPv4.h"
+#include "IPv6.h"
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief Races TCP connections to a list of IPv4/IPv6 candidates (RFC 8305, Happy Eyeballs v2).
+    ///        Candidates are interleaved by family, IPv6 first. A new attempt starts every attempt delay,
+    ///        or right away when the previous one fails. The first connection that succeeds wins, the others are closed.
+    ///        To drive the race from an event loop, call Start(), then add GetPollSockets() to your Poll with PollFlags::out
+    ///        and call Process() when one of them is writable, or at least every GetNextTimeout(). The attempts change
+    ///        after each Process(), get the sockets again. Connect() runs the whole race and blocks.
+    ///        A HappyEyeballs must be used by only one thread at a time.
+    ////////////
+    class HappyEyeballs
+    {
+        class HappyEyeballsImpl* _Impl;
+
+    public:
+        HappyEyeballs();
+        HappyEyeballs(HappyEyeballs const& other) = delete;
+        HappyEyeballs(HappyEyeballs&& other) noexcept;
+        HappyEyeballs& operator=(HappyEyeballs const& other) = delete;
+        HappyEyeballs& operator=(HappyEyeballs&& other) noexcept;
+        ~HappyEyeballs();
+
+        ////////////
+        /// @brief Adds an IPv4 candidate, candidates of the same family are tried in insertion order.
+        /// @param[in] addr The address to connect to.
+        /// @return
+        ////////////
+        void AddCandidate(IPv4::IPv4Addr const& addr);
+        ////////////
+        /// @brief Adds an IPv6 candidate, candidates of the same family are tried in insertion order.
+        /// @param[in] addr The address to connect to.
+        /// @return
+        ////////////
+        void AddCandidate(IPv6::IPv6Addr const& addr);
+        ////////////
+        /// @brief Removes all the candidates, cancels the running race.
+        /// @return
+        ////////////
+        void ClearCandidates();
+        ////////////
+        /// @brief Get the number of candidates.
+        /// @return Number of candidates
+        ////////////
+        size_t GetCandidateCount() const;
+        ////////////
+        /// @brief Sets the delay before starting the next attempt (RFC 8305 Connection Attempt Delay, 250ms by default).
+        /// @param[in] delay The delay, clamped to [10ms, 2s] as the RFC recommends.
+        /// @return
+        ////////////
+        void SetAttemptDelay(std::chrono::milliseconds delay);
+        ////////////
+        /// @brief Sets if the winning socket is left non-blocking (false by default).
+        /// @param[in] non_blocking Non-blocking value.
+        /// @return
+        ////////////
+        void SetNonBlocking(bool non_blocking);
+        ////////////
+        /// @brief Starts a race between the candidates, a running race is cancelled first. No attempt is made before Process().
+        /// @param[in] timeout The max time to wait for a connection.
+        /// @return Error, NotFound if there is no candidate.
+        ////////////
+        NetworkLibrary::Error Start(std::chrono::milliseconds timeout);
+        ////////////
+        /// @brief Checks the attempts and starts the next ones when it's their time, without blocking.
+        ///        On success, out_ipv4 or out_ipv6 (depending on the winner family) holds the connection and the other one is closed.
+        /// @param[out] out_ipv4      Receives the connection if an IPv4 candidate won.
+        /// @param[out] out_ipv6      Receives the connection if an IPv6 candidate won.
+        /// @param[out] out_candidate The index of the winning candidate, in insertion order.
+        /// @return Error code, InProgress while the race goes on, TimedOut if no candidate connected in time,
+        ///         the last attempt error if they all failed, InVal if no race is running.
+        ////////////
+        NetworkLibrary::Error Process(IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate);
+        ////////////
+        /// @brief Get the sockets of the running attempts, to poll for writability.
+        /// @return The sockets, valid until the next call to Process, Start, Cancel or ClearCandidates.
+        ////////////
+        std::vector<BasicSocket const*> GetPollSockets() const;
+        ////////////
+        /// @brief Get the time until the next attempt must start or the race times out.
+        /// @return The time until Process() must be called, -1 if no race is running.
+        ////////////
+        std::chrono::milliseconds GetNextTimeout() const;
+        ////////////
+        /// @brief Get if a race is running, it stops when Process() returns anything else than InProgress.
+        /// @return Running state
+        ////////////
+        bool IsRunning() const;
+        ////////////
+        /// @brief Stops the running race and closes its attempts.
+        /// @return
+        ////////////
+        void Cancel();
+        ////////////
+        /// @brief Races the candidates until one connects or the timeout expires, built on Start and Process.
+        ///        On success, out_ipv4 or out_ipv6 (depending on the winner family) holds the connection and the other one is closed.
+        /// @param[in]  timeout       The max time to wait for a connection.
+        /// @param[out] out_ipv4      Receives the connection if an IPv4 candidate won.
+        /// @param[out] out_ipv6      Receives the connection if an IPv6 candidate won.
+        /// @param[out] out_candidate The index of the winning candidate, in insertion order.
+        /// @return Error code, TimedOut if no candidate connected in time, or the last attempt error if they all failed.
+        ////////////
+        NetworkLibrary::Error Connect(std::chrono::milliseconds timeout, IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate);
+    };
+}
@@ -17,7 +17,9 @@
 
 #pragma once
 
-#include "details/Socket.h"
+#include "details/SocketTemplate.h"
+
+#include <type_traits>
 
 namespace NetworkLibrary {
 namespace IPv4 {
@@ -31,7 +33,11 @@ std::pair<NetworkLibrary::Error, std::vector<IfaceInfos>> GetIfacesAddresses();
 class IPv4Addr :
     public BasicAddr
 {
-    class IPv4AddrImpl* _Impl;
+    // Inline storage for the native sockaddr_in, addresses are copied without any allocation.
+    std::aligned_storage<16, 4>::type _Storage;
+
+    class IPv4AddrImpl& _Impl();
+    class IPv4AddrImpl const& _Impl() const;
 
     public:
     ////////////
@@ -41,19 +47,24 @@ class IPv4Addr :
     ////////////
     /// @brief 
     ////////////
-    IPv4Addr(IPv4Addr const& other);
+    IPv4Addr(IPv4Addr const& other) = default;
     ////////////
     /// @brief 
     ////////////
-    IPv4Addr(IPv4Addr && other) noexcept;
+    IPv4Addr(IPv4Addr && other) noexcept = default;
     ////////////
     /// @brief 
     ////////////
-    IPv4Addr& operator=(IPv4Addr const& other);
+    IPv4Addr& operator=(IPv4Addr const& other) = default;
     ////////////
     /// @brief 
     ////////////
-    IPv4Addr& operator=(IPv4Addr&& other) noexcept;
+    IPv4Addr& operator=(IPv4Addr&& other) noexcept = default;
+
+    ////////////
+    /// @brief The ToString max size, with the port and the terminating 0: "255.255.255.255:65535".
+    ////////////
+    static constexpr size_t MaxStringSize = 22;
 
     ////////////
     /// @brief 
@@ -66,6 +77,14 @@ class IPv4Addr :
     ////////////
     virtual std::string ToString(bool with_port = false) const;
     ////////////
+    /// @brief Transforms the address to a human readable string in buffer, without allocating.
+    /// @param[out] buffer      Receives the null terminated string
+    /// @param[in]  buffer_size The buffer size, MaxStringSize is always enough
+    /// @param[in]  with_port   Append the port
+    /// @return The string length, 0 if buffer is too small
+    ////////////
+    size_t ToString(char* buffer, size_t buffer_size, bool with_port = false) const;
+    ////////////
     /// @brief Get this Addr family type.
     /// @return 
     ////////////
@@ -91,7 +110,14 @@ class IPv4Addr :
     /// @param[in] str The string IPv4 representation.
     /// @return Error code.
     ////////////
-    NetworkLibrary::Error FromString(std::string str);
+    NetworkLibrary::Error FromString(std::string const& str);
+    ////////////
+    /// @brief Fill this IPv4Addr from string representation, like "1.2.3.4" or "1.2.3.4:80".
+    /// @param[in] str    The string, doesn't need to be null terminated.
+    /// @param[in] length The string length.
+    /// @return Error code.
+    ////////////
+    NetworkLibrary::Error FromString(const char* str, size_t length);
     ////////////
     /// @brief Set this IPv4Addr ip.
     /// @param[in] ip The host ordered IPv4 ip.
@@ -131,58 +157,74 @@ class IPv4Addr :
     void SetBroadcastAddr();
 };
 
-class TCP:
-    public ConnectedSocket
+struct TCPTraits
 {
-public:
-    TCP();
-    TCP(TCP const& other) = delete;
-    TCP(TCP&& other) noexcept;
-    TCP& operator=(TCP const& other) = delete;
-    TCP& operator=(TCP&& other) noexcept;
+    using base_type = ConnectedSocket;
+    using addr_type = IPv4Addr;
+    struct Native;
+};
 
+class TCP :
+    public SocketTemplate<TCPTraits>
+{
+public:
     ////////////
-    /// @brief Allocates resources to use network functions.
-    /// @return Error
-    ////////////
-    NetworkLibrary::Error CreateSocket();
-    ////////////
-    /// @brief Gets this socket addr (if any).
-    /// @param[out] out_addr Socket address
+    /// @brief Samples this connection TCP telemetry (RTT, cwnd, retransmits, ...), costs a single syscall.
+    /// @param[out] out_info TCP infos
     /// @return Error
     ////////////
-    NetworkLibrary::Error GetSockName(IPv4Addr& out_addr);
+    NetworkLibrary::Error GetTcpInfo(TcpInfo& out_info) const;
+};
 
-    virtual int GetFamily() const;
-    virtual int GetType  () const;
-    virtual int GetProto () const;
+struct UDPTraits
+{
+    using base_type = UnconnectedSocket;
+    using addr_type = IPv4Addr;
+    struct Native;
 };
 
-class UDP:
-    public UnconnectedSocket
+class UDP :
+    public SocketTemplate<UDPTraits>
 {
 public:
-    UDP();
-    UDP(UDP const& other) = delete;
-    UDP(UDP&& other) noexcept;
-    UDP& operator=(UDP const& other) = delete;
-    UDP& operator=(UDP&& other) noexcept;
-
     ////////////
-    /// @brief Allocates resources to use network functions.
+    /// @brief Joins a multicast group, its datagrams are received once the socket is bound on the group port.
+    ///        The TTL and the loopback of the datagrams sent are set with Options::IpMulticastTtl and Options::IpMulticastLoop.
+    /// @param[in] group       The group address, the port is ignored.
+    /// @param[in] iface_index The interface to join on (IfaceInfos::Index), 0 lets the system choose.
     /// @return Error
     ////////////
-    NetworkLibrary::Error CreateSocket();
+    NetworkLibrary::Error JoinGroup(IPv4Addr const& group, uint32_t iface_index = 0);
     ////////////
-    /// @brief Gets this socket addr (if any).
-    /// @param[out] out_addr Socket address
+    /// @brief Leaves a multicast group joined with JoinGroup.
+    /// @param[in] group       The group address.
+    /// @param[in] iface_index The interface it was joined on.
     /// @return Error
     ////////////
-    NetworkLibrary::Error GetSockName(IPv4Addr& out_addr);
-
-    virtual int GetFamily() const;
-    virtual int GetType  () const;
-    virtual int GetProto () const;
+    NetworkLibrary::Error LeaveGroup(IPv4Addr const& group, uint32_t iface_index = 0);
+    ////////////
+    /// @brief Joins a source-specific multicast group (232.0.0.0/8), only the datagrams sent by source are received.
+    ///        The same group can be joined for several sources.
+    /// @param[in] group       The group address, the port is ignored.
+    /// @param[in] source      The source address, the port is ignored.
+    /// @param[in] iface_index The interface to join on (IfaceInfos::Index), 0 lets the system choose.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error JoinSourceGroup(IPv4Addr const& group, IPv4Addr const& source, uint32_t iface_index = 0);
+    ////////////
+    /// @brief Leaves a source-specific multicast group joined with JoinSourceGroup.
+    /// @param[in] group       The group address.
+    /// @param[in] source      The source address.
+    /// @param[in] iface_index The interface it was joined on.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error LeaveSourceGroup(IPv4Addr const& group, IPv4Addr const& source, uint32_t iface_index = 0);
+    ////////////
+    /// @brief Sets the interface the multicast datagrams are sent from.
+    /// @param[in] iface_index The interface (IfaceInfos::Index), 0 lets the system choose.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error SetMulticastInterface(uint32_t iface_index);
 };
 
 }
@@ -17,7 +17,9 @@
 
 #pragma once
 
-#include "details/Socket.h"
+#include "details/SocketTemplate.h"
+
+#include <type_traits>
 
 namespace NetworkLibrary {
 namespace IPv6 {
@@ -36,7 +38,11 @@ struct InAddr6
 class IPv6Addr :
     public BasicAddr
 {
-    class IPv6AddrImpl* _Impl;
+    // Inline storage for the native sockaddr_in6, addresses are copied without any allocation.
+    std::aligned_storage<28, 4>::type _Storage;
+
+    class IPv6AddrImpl& _Impl();
+    class IPv6AddrImpl const& _Impl() const;
 
 public:
     ////////////
@@ -46,19 +52,24 @@ public:
     ////////////
     /// @brief 
     ////////////
-    IPv6Addr(IPv6Addr const& other);
+    IPv6Addr(IPv6Addr const& other) = default;
     ////////////
     /// @brief 
     ////////////
-    IPv6Addr(IPv6Addr&& other) noexcept;
+    IPv6Addr(IPv6Addr&& other) noexcept = default;
     ////////////
     /// @brief 
     ////////////
-    IPv6Addr& operator=(IPv6Addr const& other);
+    IPv6Addr& operator=(IPv6Addr const& other) = default;
     ////////////
     /// @brief 
     ////////////
-    IPv6Addr& operator=(IPv6Addr&& other) noexcept;
+    IPv6Addr& operator=(IPv6Addr&& other) noexcept = default;
+
+    ////////////
+    /// @brief The ToString max size, with the port and the terminating 0: "[ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255%4294967295]:65535".
+    ////////////
+    static constexpr size_t MaxStringSize = 65;
 
     ////////////
     /// @brief 
@@ -71,6 +82,14 @@ public:
     ////////////
     virtual std::string ToString(bool with_port = false) const;
     ////////////
+    /// @brief Transforms the address to a human readable string in buffer, without allocating.
+    /// @param[out] buffer      Receives the null terminated string
+    /// @param[in]  buffer_size The buffer size, MaxStringSize is always enough
+    /// @param[in]  with_port   Append the port
+    /// @return The string length, 0 if buffer is too small
+    ////////////
+    size_t ToString(char* buffer, size_t buffer_size, bool with_port = false) const;
+    ////////////
     /// @brief Get this Addr family type.
     /// @return 
     ////////////
@@ -96,7 +115,14 @@ public:
     /// @param[in] str The string IPv6 representation.
     /// @return Error code.
     ////////////
-    NetworkLibrary::Error FromString(std::string str);
+    NetworkLibrary::Error FromString(std::string const& str);
+    ////////////
+    /// @brief Fill this IPv6Addr from string representation, like "::1", "fe80::1%eth0" or "[::1]:80".
+    /// @param[in] str    The string, doesn't need to be null terminated.
+    /// @param[in] length The string length.
+    /// @return Error code.
+    ////////////
+    NetworkLibrary::Error FromString(const char* str, size_t length);
     ////////////
     /// @brief Set this IPv6Addr ip.
     /// @param[in] ip The IPv6 ip.
@@ -131,58 +157,74 @@ public:
     void SetLoopbackAddr();
 };
 
+struct TCPTraits
+{
+    using base_type = ConnectedSocket;
+    using addr_type = IPv6Addr;
+    struct Native;
+};
+
 class TCP :
-    public ConnectedSocket
+    public SocketTemplate<TCPTraits>
 {
 public:
-    TCP();
-    TCP(TCP const& other) = delete;
-    TCP(TCP&& other) noexcept;
-    TCP& operator=(TCP const& other) = delete;
-    TCP& operator=(TCP&& other) noexcept;
-
-    ////////////
-    /// @brief Allocates resources to use network functions.
-    /// @return Error
     ////////////
-    NetworkLibrary::Error CreateSocket();
-    ////////////
-    /// @brief Gets this socket addr (if any).
-    /// @param[out] out_addr Socket address
+    /// @brief Samples this connection TCP telemetry (RTT, cwnd, retransmits, ...), costs a single syscall.
+    /// @param[out] out_info TCP infos
     /// @return Error
     ////////////
-    NetworkLibrary::Error GetSockName(IPv6Addr& out_addr);
+    NetworkLibrary::Error GetTcpInfo(TcpInfo& out_info) const;
+};
 
-    virtual int GetFamily() const;
-    virtual int GetType() const;
-    virtual int GetProto() const;
+struct UDPTraits
+{
+    using base_type = UnconnectedSocket;
+    using addr_type = IPv6Addr;
+    struct Native;
 };
 
 class UDP :
-    public UnconnectedSocket
+    public SocketTemplate<UDPTraits>
 {
 public:
-    UDP();
-    UDP(UDP const& other) = delete;
-    UDP(UDP&& other) noexcept;
-    UDP& operator=(UDP const& other) = delete;
-    UDP& operator=(UDP&& other) noexcept;
-
     ////////////
-    /// @brief Allocates resources to use network functions.
+    /// @brief Joins a multicast group, its datagrams are received once the socket is bound on the group port.
+    ///        The TTL and the loopback of the datagrams sent are set with Options::Ipv6MulticastHops and Options::Ipv6MulticastLoop.
+    /// @param[in] group       The group address, the port is ignored.
+    /// @param[in] iface_index The interface to join on (IfaceInfos::Index), 0 lets the system choose.
     /// @return Error
     ////////////
-    NetworkLibrary::Error CreateSocket();
+    NetworkLibrary::Error JoinGroup(IPv6Addr const& group, uint32_t iface_index = 0);
     ////////////
-    /// @brief Gets this socket addr (if any).
-    /// @param[out] out_addr Socket address
+    /// @brief Leaves a multicast group joined with JoinGroup.
+    /// @param[in] group       The group address.
+    /// @param[in] iface_index The interface it was joined on.
     /// @return Error
     ////////////
-    NetworkLibrary::Error GetSockName(IPv6Addr& out_addr);
-
-    virtual int GetFamily() const;
-    virtual int GetType() const;
-    virtual int GetProto() const;
+    NetworkLibrary::Error LeaveGroup(IPv6Addr const& group, uint32_t iface_index = 0);
+    ////////////
+    /// @brief Joins a source-specific multicast group (ff3x::/32), only the datagrams sent by source are received.
+    ///        The same group can be joined for several sources.
+    /// @param[in] group       The group address, the port is ignored.
+    /// @param[in] source      The source address, the port is ignored.
+    /// @param[in] iface_index The interface to join on (IfaceInfos::Index), 0 lets the system choose.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error JoinSourceGroup(IPv6Addr const& group, IPv6Addr const& source, uint32_t iface_index = 0);
+    ////////////
+    /// @brief Leaves a source-specific multicast group joined with JoinSourceGroup.
+    /// @param[in] group       The group address.
+    /// @param[in] source      The source address.
+    /// @param[in] iface_index The interface it was joined on.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error LeaveSourceGroup(IPv6Addr const& group, IPv6Addr const& source, uint32_t iface_index = 0);
+    ////////////
+    /// @brief Sets the interface the multicast datagrams are sent from.
+    /// @param[in] iface_index The interface (IfaceInfos::Index), 0 lets the system choose.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error SetMulticastInterface(uint32_t iface_index);
 };
 
 }
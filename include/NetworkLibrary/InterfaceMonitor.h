@@ -0,0 +1,104 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "EndpointKey.h"
+
+#include <functional>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief An address assigned to a network interface.
+    ////////////
+    struct InterfaceAddress
+    {
+        // The address, Port is 0. IPv6 link-local addresses have the interface index as ScopeId.
+        EndpointKey Addr;
+        uint32_t IfaceIndex;
+        uint8_t PrefixLength;
+    };
+
+    ////////////
+    /// @brief An interface address change.
+    ////////////
+    struct InterfaceEvent
+    {
+        enum Type : uint8_t
+        {
+            AddressAdded,
+            AddressRemoved,
+        };
+
+        Type EventType;
+        InterfaceAddress Address;
+    };
+
+    ////////////
+    /// @brief Keeps the interface addresses up to date from the kernel notifications, instead of polling GetIfacesAddresses.
+    ///        Open() takes a snapshot of the IPv4 and IPv6 addresses, then the kernel pushes each change (netlink RTM_NEWADDR/RTM_DELADDR).
+    ///        Add GetPollSocket() to your Poll with PollFlags::in and call Process() when it's readable.
+    ///        Only Linux has netlink, Open() fails with NotSupported elsewhere.
+    ///        An InterfaceMonitor must be used by only one thread at a time.
+    ////////////
+    class InterfaceMonitor
+    {
+        class InterfaceMonitorImpl* _Impl;
+
+    public:
+        ////////////
+        /// @brief Called from Process() for each change, the snapshot is already updated.
+        ////////////
+        using Callback = std::function<void(InterfaceEvent const& event)>;
+
+        InterfaceMonitor();
+        InterfaceMonitor(InterfaceMonitor const& other) = delete;
+        InterfaceMonitor(InterfaceMonitor&& other) noexcept;
+        InterfaceMonitor& operator=(InterfaceMonitor const& other) = delete;
+        InterfaceMonitor& operator=(InterfaceMonitor&& other) noexcept;
+        ~InterfaceMonitor();
+
+        ////////////
+        /// @brief Subscribes to the address changes and takes the addresses snapshot, no event is reported for it.
+        /// @return Error, NotSupported if the system has no netlink.
+        ////////////
+        NetworkLibrary::Error Open();
+        ////////////
+        /// @brief Sets the function called on each change.
+        /// @param[in] callback The function.
+        /// @return
+        ////////////
+        void SetCallback(Callback callback);
+        ////////////
+        /// @brief Reads the pending notifications and updates the snapshot, without blocking.
+        ///        If the kernel dropped notifications (the socket buffer was full), the snapshot is taken again
+        ///        and the differences are reported.
+        /// @return The number of changes.
+        ////////////
+        size_t Process();
+        ////////////
+        /// @brief Get the socket to poll for readability.
+        /// @return The socket
+        ////////////
+        BasicSocket const& GetPollSocket() const;
+        ////////////
+        /// @brief Get the current addresses, updated by Process().
+        /// @return The addresses
+        ////////////
+        std::vector<InterfaceAddress> const& GetAddresses() const;
+    };
+}
@@ -0,0 +1,151 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "details/Socket.h"
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief The latencies the library records, see GetProcessLatencyHistogram.
+    ///        They are only recorded when the library is built with SOCKET_LATENCY_HISTOGRAMS.
+    ////////////
+    struct LatencyMetric
+    {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        static constexpr bool Enabled = true;
+#else
+        static constexpr bool Enabled = false;
+#endif
+        static constexpr int PollWait    = 0; // Time blocked in Poll::DoPoll and Poll::DoPollPrecise.
+        static constexpr int PollHandler = 1; // Time from a poll return to the next poll of the same thread: the time spent handling the events.
+        static constexpr int Send        = 2; // Send and SendTo syscalls.
+        static constexpr int Receive     = 3; // Receive and ReceiveFrom syscalls.
+
+        static constexpr int Count       = 4;
+    };
+
+    ////////////
+    /// @brief A log-linear (HDR style) histogram of durations, in nanoseconds.
+    ///        Durations under 2^SubBucketBits ns are exact, each power of two above is split in 2^SubBucketBits
+    ///        linear buckets: a bucket is at most 1/2^SubBucketBits (~3%) of its values wide, whatever the magnitude.
+    ///        The buckets are fixed, histograms merge by adding them.
+    ////////////
+    class LatencyHistogram
+    {
+    public:
+        static constexpr uint32_t SubBucketBits = 5;
+        // 2^40 ns is about 18 minutes, longer durations are counted in the last bucket.
+        static constexpr uint32_t MaxValueBits  = 40;
+        static constexpr size_t   BucketCount   = static_cast<size_t>(MaxValueBits - SubBucketBits + 1) << SubBucketBits;
+
+        struct Bucket
+        {
+            std::chrono::nanoseconds Lower; // Inclusive.
+            std::chrono::nanoseconds Upper; // Inclusive.
+            uint64_t                 Count;
+        };
+
+        LatencyHistogram();
+
+        ////////////
+        /// @brief Get the bucket a duration is counted in.
+        /// @param[in] nanoseconds The duration.
+        /// @return The bucket index, < BucketCount.
+        ////////////
+        static size_t BucketIndex(uint64_t nanoseconds) noexcept;
+        ////////////
+        /// @brief Get the smallest duration of a bucket.
+        /// @param[in] index The bucket index.
+        /// @return The duration, in nanoseconds.
+        ////////////
+        static uint64_t BucketLowerBound(size_t index) noexcept;
+        ////////////
+        /// @brief Get the largest duration of a bucket.
+        /// @param[in] index The bucket index.
+        /// @return The duration, in nanoseconds.
+        ////////////
+        static uint64_t BucketUpperBound(size_t index) noexcept;
+
+        ////////////
+        /// @brief Counts a duration, negative ones are counted as 0.
+        /// @param[in] duration The duration.
+        /// @return
+        ////////////
+        void Record(std::chrono::nanoseconds duration);
+        ////////////
+        /// @brief Adds the counts of another histogram to this one.
+        /// @param[in] other The histogram to add.
+        /// @return
+        ////////////
+        void Merge(LatencyHistogram const& other);
+        ////////////
+        /// @brief Removes all the counts.
+        /// @return
+        ////////////
+        void Reset();
+
+        uint64_t GetCount() const;
+        // 0 for an empty histogram.
+        std::chrono::nanoseconds GetMin() const;
+        std::chrono::nanoseconds GetMax() const;
+        std::chrono::nanoseconds GetMean() const;
+        ////////////
+        /// @brief Get the duration at a percentile, the upper bound of its bucket (never more than GetMax()).
+        /// @param[in] percentile The percentile, from 0 to 100, like 99.9.
+        /// @return The duration, 0 for an empty histogram.
+        ////////////
+        std::chrono::nanoseconds GetPercentile(double percentile) const;
+        ////////////
+        /// @brief Get the non-empty buckets, ordered by duration.
+        /// @return The buckets.
+        ////////////
+        std::vector<Bucket> GetBuckets() const;
+        ////////////
+        /// @brief Get the raw bucket counts, GetRawBuckets()[BucketIndex(ns)].
+        /// @return BucketCount counts.
+        ////////////
+        uint64_t const* GetRawBuckets() const;
+
+        ////////////
+        /// @brief Used to build a histogram from raw counts, like the library per-thread storage.
+        /// @return
+        ////////////
+        void AddRaw(uint64_t const* buckets, uint64_t count, uint64_t sum, uint64_t min, uint64_t max);
+
+    private:
+        std::vector<uint64_t> _Buckets;
+        uint64_t _Count;
+        uint64_t _Sum;
+        uint64_t _Min;
+        uint64_t _Max;
+    };
+
+    ////////////
+    /// @brief Get a latency histogram of all the threads of the process, exited ones included.
+    ///        Each thread records in its own storage without locking, this merges them: the result is a snapshot, not a transaction.
+    /// @param[in] metric A LatencyMetric.
+    /// @return The histogram, empty without SOCKET_LATENCY_HISTOGRAMS.
+    ////////////
+    LatencyHistogram GetProcessLatencyHistogram(int metric);
+    ////////////
+    /// @brief Get a latency histogram of the calling thread only, like the stalls of one event loop.
+    /// @param[in] metric A LatencyMetric.
+    /// @return The histogram, empty without SOCKET_LATENCY_HISTOGRAMS.
+    ////////////
+    LatencyHistogram GetThreadLatencyHistogram(int metric);
+}
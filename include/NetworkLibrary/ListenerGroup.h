@@ -0,0 +1,132 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "details/Socket.h"
+
+#include <type_traits>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief Attaches a classic BPF program to a SO_REUSEPORT group that steers each flow
+    ///        to the socket whose index matches the CPU that received it (cpu % group_size).
+    ///        Only supported on Linux.
+    /// @param[in] socket     Any socket of the group.
+    /// @param[in] group_size The amount of sockets in the group.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error AttachReusePortCpuSteering(BasicSocket const& socket, uint32_t group_size);
+
+    ////////////
+    /// @brief A group of sockets bound on the same address with SO_REUSEPORT, one per worker thread.
+    ///        The kernel load balances new connections (or datagrams) between the sockets, so each worker
+    ///        has its own accept queue. With CPU steering, socket i receives the flows handled by CPU i,
+    ///        worker i should then be pinned on CPU i.
+    ///        SocketType can be IPv4::TCP, IPv4::UDP, IPv6::TCP or IPv6::UDP.
+    ////////////
+    template<typename SocketType>
+    class ListenerGroup
+    {
+        std::vector<SocketType> _Sockets;
+
+        static NetworkLibrary::Error _Listen(SocketType& socket, int backlog, std::true_type /* connected */)
+        {
+            return socket.Listen(backlog);
+        }
+
+        static NetworkLibrary::Error _Listen(SocketType&, int, std::false_type /* connected */)
+        {
+            return NetworkLibrary::Error{ NetworkLibrary::Error::NoError, 0 };
+        }
+
+    public:
+        ListenerGroup() = default;
+        ListenerGroup(ListenerGroup const& other) = delete;
+        ListenerGroup(ListenerGroup&& other) noexcept = default;
+        ListenerGroup& operator=(ListenerGroup const& other) = delete;
+        ListenerGroup& operator=(ListenerGroup&& other) noexcept = default;
+
+        ////////////
+        /// @brief Opens group_size sockets on addr. If addr has no port, the port picked for the first socket is used for the others.
+        /// @param[in] addr         The address to bind on.
+        /// @param[in] group_size   The amount of sockets to open.
+        /// @param[in] cpu_steering Attach the CPU steering program to the group.
+        /// @param[in] backlog      The max amount of waiting connections per socket (connected sockets only).
+        /// @return Error
+        ////////////
+        template<typename AddrType>
+        NetworkLibrary::Error Open(AddrType const& addr, size_t group_size, bool cpu_steering = false, int backlog = 5)
+        {
+            NetworkLibrary::Error error{ NetworkLibrary::Error::NoError, 0 };
+            AddrType bound_addr(addr);
+
+            Close();
+            // One allocation for the whole group.
+            _Sockets.reserve(group_size);
+            for (size_t i = 0; i < group_size; ++i)
+            {
+                _Sockets.emplace_back();
+                SocketType& socket = _Sockets.back();
+
+                if ((error = socket.CreateSocket()).ErrorCode != NetworkLibrary::Error::NoError ||
+                    (error = socket.template SetOption<Options::ReusePort>(true)).ErrorCode != NetworkLibrary::Error::NoError ||
+                    (error = socket.Bind(bound_addr)).ErrorCode != NetworkLibrary::Error::NoError ||
+                    (error = _Listen(socket, backlog, std::is_base_of<ConnectedSocket, SocketType>{})).ErrorCode != NetworkLibrary::Error::NoError)
+                {
+                    Close();
+                    return error;
+                }
+
+                if (i == 0 && (error = socket.GetSockName(bound_addr)).ErrorCode != NetworkLibrary::Error::NoError)
+                {
+                    Close();
+                    return error;
+                }
+            }
+
+            if (cpu_steering && !_Sockets.empty())
+            {
+                error = AttachReusePortCpuSteering(_Sockets.front(), static_cast<uint32_t>(_Sockets.size()));
+                if (error.ErrorCode != NetworkLibrary::Error::NoError)
+                    Close();
+            }
+
+            return error;
+        }
+
+        ////////////
+        /// @brief Get the number of sockets in the group.
+        /// @return Number of sockets
+        ////////////
+        size_t GetSocketCount() const { return _Sockets.size(); }
+
+        ////////////
+        /// @brief Get a socket of the group, to be used by the worker number index.
+        /// @param[in] index The socket index.
+        /// @return The socket
+        ////////////
+        SocketType& GetSocket(size_t index) { return _Sockets[index]; }
+        SocketType const& GetSocket(size_t index) const { return _Sockets[index]; }
+
+        ////////////
+        /// @brief Closes all the sockets of the group.
+        /// @return
+        ////////////
+        void Close() { _Sockets.clear(); }
+    };
+}
@@ -0,0 +1,200 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "details/Socket.h"
+
+namespace NetworkLibrary {
+namespace Loopback {
+
+////////////
+/// @brief The in-process loopback address family. It doesn't match any OS address family.
+////////////
+static constexpr int AddressFamily = 0x4C42;
+
+class LoopbackAddr :
+    public BasicAddr
+{
+    class LoopbackAddrImpl* _Impl;
+
+public:
+    ////////////
+    /// @brief
+    ////////////
+    LoopbackAddr();
+    ////////////
+    /// @brief
+    ////////////
+    LoopbackAddr(LoopbackAddr const& other);
+    ////////////
+    /// @brief
+    ////////////
+    LoopbackAddr(LoopbackAddr&& other) noexcept;
+    ////////////
+    /// @brief
+    ////////////
+    LoopbackAddr& operator=(LoopbackAddr const& other);
+    ////////////
+    /// @brief
+    ////////////
+    LoopbackAddr& operator=(LoopbackAddr&& other) noexcept;
+
+    ////////////
+    /// @brief
+    ////////////
+    virtual ~LoopbackAddr();
+    ////////////
+    /// @brief Transforms the address to a human readable string
+    /// @param[in] with_port Append the port
+    /// @return The string representation of the address
+    ////////////
+    virtual std::string ToString(bool with_port = false) const;
+    ////////////
+    /// @brief Get this Addr family type.
+    /// @return
+    ////////////
+    virtual int GetFamily() const;
+    ////////////
+    /// @brief Get this Addr sockaddr.
+    /// @return Reference
+    ////////////
+    virtual void* GetAddr();
+    ////////////
+    /// @brief Get this Addr sockaddr.
+    /// @return Const reference
+    ////////////
+    virtual const void* GetAddr() const;
+    ////////////
+    /// @brief Get this Addr length.
+    /// @return Addr length
+    ////////////
+    virtual size_t GetLength() const;
+
+    ////////////
+    /// @brief Fill this LoopbackAddr from string representation ("loopback:1234" or "1234").
+    /// @param[in] str The string loopback representation.
+    /// @return Error code.
+    ////////////
+    NetworkLibrary::Error FromString(std::string str);
+    ////////////
+    /// @brief Set this LoopbackAddr port, 0 means any port.
+    /// @param[in] port The port.
+    /// @return
+    ////////////
+    void SetPort(uint32_t port);
+    ////////////
+    /// @brief Get this LoopbackAddr port.
+    /// @return The port.
+    ////////////
+    uint32_t GetPort() const;
+};
+
+////////////
+/// @brief A connected in-process socket. Datas go through a lock-free ring buffer per direction,
+///        the native fd is only a waitable handle to be used with Poll: readable when datas are waiting,
+///        writable unless a non-blocking Send found the peer ring full and the peer didn't read since.
+///        Each end must be used by only one thread at a time.
+////////////
+class LoopbackStream :
+    public ConnectedSocket
+{
+    class LoopbackStreamImpl* _LoopbackImpl;
+
+public:
+    LoopbackStream();
+    LoopbackStream(LoopbackStream const& other) = delete;
+    LoopbackStream(LoopbackStream&& other) noexcept;
+    LoopbackStream& operator=(LoopbackStream const& other) = delete;
+    LoopbackStream& operator=(LoopbackStream&& other) noexcept;
+    virtual ~LoopbackStream();
+
+    ////////////
+    /// @brief Allocates resources to use loopback functions.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error CreateSocket();
+    ////////////
+    /// @brief Gets this socket addr (if any).
+    /// @param[out] out_addr Socket address
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error GetSockName(LoopbackAddr& out_addr);
+
+    virtual int GetFamily() const;
+    virtual int GetType  () const;
+    virtual int GetProto () const;
+
+    virtual NetworkLibrary::Error SetNonBlocking(bool non_blocking);
+    virtual int32_t GetWaitingSize() const;
+    virtual void Close();
+
+    virtual NetworkLibrary::Error Bind(BasicAddr const& addr);
+    virtual NetworkLibrary::Error Listen(int backlog = 5);
+    virtual NetworkLibrary::Error Accept(ConnectedSocket& new_client, BasicAddr& client_addr);
+    virtual NetworkLibrary::Error AcceptBatch(ConnectedSocket* const* new_clients, BasicAddr* const* client_addrs, size_t max_count, size_t& accepted_count);
+    virtual NetworkLibrary::Error Connect(BasicAddr const& addr);
+    virtual NetworkLibrary::Error Send(NetBuffer& buffer, int32_t flags = SocketFlags::normal);
+    virtual NetworkLibrary::Error Receive(NetBuffer& buffer, int32_t flags = SocketFlags::normal);
+};
+
+////////////
+/// @brief An unconnected in-process socket. Datagrams go through a lock-free bounded queue per bound address,
+///        the native fd is only a waitable handle to be used with Poll: readable when datagrams are waiting,
+///        writable unless a non-blocking SendTo found a destination queue full and it wasn't read since.
+///        Each bound address must be read by only one thread at a time.
+////////////
+class LoopbackDgram :
+    public UnconnectedSocket
+{
+    class LoopbackDgramImpl* _LoopbackImpl;
+
+public:
+    LoopbackDgram();
+    LoopbackDgram(LoopbackDgram const& other) = delete;
+    LoopbackDgram(LoopbackDgram&& other) noexcept;
+    LoopbackDgram& operator=(LoopbackDgram const& other) = delete;
+    LoopbackDgram& operator=(LoopbackDgram&& other) noexcept;
+    virtual ~LoopbackDgram();
+
+    ////////////
+    /// @brief Allocates resources to use loopback functions.
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error CreateSocket();
+    ////////////
+    /// @brief Gets this socket addr (if any).
+    /// @param[out] out_addr Socket address
+    /// @return Error
+    ////////////
+    NetworkLibrary::Error GetSockName(LoopbackAddr& out_addr);
+
+    virtual int GetFamily() const;
+    virtual int GetType  () const;
+    virtual int GetProto () const;
+
+    virtual NetworkLibrary::Error SetNonBlocking(bool non_blocking);
+    virtual int32_t GetWaitingSize() const;
+    virtual void Close();
+
+    virtual NetworkLibrary::Error Bind(BasicAddr const& addr);
+    virtual NetworkLibrary::Error SendTo(BasicAddr const& addr, NetBuffer& buffer, int32_t flags = SocketFlags::normal);
+    virtual NetworkLibrary::Error ReceiveFrom(BasicAddr& addr, NetBuffer& buffer, int32_t flags = SocketFlags::normal);
+};
+
+}
+}
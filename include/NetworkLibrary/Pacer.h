@@ -0,0 +1,92 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "details/Socket.h"
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief Paces the traffic of one socket with a token bucket: the bucket fills at the rate, up to the burst size,
+    ///        and sending takes the sent size from it.
+    ///        TCP sockets are paced by the kernel when SO_MAX_PACING_RATE is available (Linux), the pacer then lets everything through.
+    ///        Otherwise Send/SendTo return WouldBlock until the bucket has enough tokens,
+    ///        wait GetDelay() (Poll::DoPollPrecise) before sending again.
+    ///        A Pacer must be used by only one thread at a time.
+    ////////////
+    class Pacer
+    {
+        class PacerImpl* _Impl;
+
+    public:
+        Pacer();
+        Pacer(Pacer const& other) = delete;
+        Pacer(Pacer&& other) noexcept;
+        Pacer& operator=(Pacer const& other) = delete;
+        Pacer& operator=(Pacer&& other) noexcept;
+        ~Pacer();
+
+        ////////////
+        /// @brief Sets the pacing rate, the bucket starts full.
+        /// @param[in] bytes_per_second The rate, 0 disables pacing.
+        /// @param[in] burst_size       The bucket size, the max amount of bytes sent back to back.
+        /// @return
+        ////////////
+        void SetRate(uint64_t bytes_per_second, size_t burst_size);
+        ////////////
+        /// @brief Applies the rate to a socket, using the kernel pacing if the socket supports it.
+        ///        Must be called again after SetRate.
+        /// @param[in] socket The paced socket.
+        /// @return Error, only if the kernel pacing should have been available but failed.
+        ////////////
+        NetworkLibrary::Error Attach(BasicSocket& socket);
+        ////////////
+        /// @brief Get if the attached socket is paced by the kernel.
+        /// @return true if the kernel paces the socket.
+        ////////////
+        bool IsKernelPaced() const;
+        ////////////
+        /// @brief Get the time to wait before size bytes can be sent.
+        /// @param[in] size The size to send.
+        /// @return The delay, 0 if it can be sent now.
+        ////////////
+        std::chrono::microseconds GetDelay(size_t size);
+        ////////////
+        /// @brief Takes size bytes from the bucket if they are available.
+        /// @param[in] size The size to send.
+        /// @return true if the bytes can be sent.
+        ////////////
+        bool TryConsume(size_t size);
+        ////////////
+        /// @brief Sends to a connected socket, streams are cut to the available tokens.
+        /// @param[in] socket The socket.
+        /// @param[in,out] buffer The buffer, BufferSize receives the sent size.
+        /// @param[in] flags The send flags.
+        /// @return Error, WouldBlock if the pacing delay isn't over.
+        ////////////
+        NetworkLibrary::Error Send(ConnectedSocket& socket, NetBuffer& buffer, int32_t flags = SocketFlags::normal);
+        ////////////
+        /// @brief Sends a datagram, it is sent whole or not at all.
+        /// @param[in] socket The socket.
+        /// @param[in] addr The destination address.
+        /// @param[in,out] buffer The buffer, BufferSize receives the sent size.
+        /// @param[in] flags The send flags.
+        /// @return Error, WouldBlock if the pacing delay isn't over.
+        ////////////
+        NetworkLibrary::Error SendTo(UnconnectedSocket& socket, BasicAddr const& addr, NetBuffer& buffer, int32_t flags = SocketFlags::normal);
+    };
+}
@@ -74,6 +74,18 @@ namespace NetworkLibrary {
         ////////////
         NetworkLibrary::Error SetEvents(size_t index, /* PollFlags */ int16_t flags);
         ////////////
+        /// @brief Get the poll events requested for the socket
+        /// @param[in] sock The socket to get the flags from
+        /// @return The poll events flags, returns also none is sock is not in the poll
+        ////////////
+        /* PollFlags */ int16_t GetEvents(BasicSocket const& sock);
+        ////////////
+        /// @brief Get the poll events requested for the socket
+        /// @param[in] index The socket to get the flags from
+        /// @return The poll events flags, returns also none is sock is not in the poll
+        ////////////
+        /* PollFlags */ int16_t GetEvents(size_t index);
+        ////////////
         /// @brief Get a poll revents for the socket
         /// @param[in] sock The socket to get the flags from
         /// @return The poll revents flags, returns also none is sock is not in the poll
@@ -86,12 +98,25 @@ namespace NetworkLibrary {
         ////////////
         /* PollFlags */ int16_t GetRevents(size_t index);
         ////////////
+        /// @brief Get the poll revents of the sockets at once, in the poll order. Cheaper than GetRevents per socket.
+        /// @param[out] out_revents Receives the revents flags
+        /// @param[in] count The out_revents size
+        /// @return The number of revents written: the socket count, at most count
+        ////////////
+        size_t GetAllRevents(/* PollFlags */ int16_t* out_revents, size_t count);
+        ////////////
         /// @brief Start the socket poll
         /// @param[in] timeout <0 = block, 0 = returns now, >0 = The time in milliseconds to wait.
         /// @return The number of sockets that have revents
         ////////////
         int32_t DoPoll(std::chrono::milliseconds timeout);
         ////////////
+        /// @brief Start the socket poll with a microsecond timeout (ppoll on Linux, rounded up to the millisecond elsewhere)
+        /// @param[in] timeout <0 = block, 0 = returns now, >0 = The time in microseconds to wait.
+        /// @return The number of sockets that have revents
+        ////////////
+        int32_t DoPollPrecise(std::chrono::microseconds timeout);
+        ////////////
         /// @brief Clear the poll of its sockets
         /// @return 
         ////////////
@@ -0,0 +1,124 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "IPv4.h"
+#include "IPv6.h"
+
+#include <functional>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief The addresses a hostname resolved to, ports are left to 0.
+    ////////////
+    struct ResolveResult
+    {
+        std::vector<IPv4::IPv4Addr> IPv4Addrs;
+        std::vector<IPv6::IPv6Addr> IPv6Addrs;
+    };
+
+    ////////////
+    /// @brief A non-blocking hostname resolver, to be driven by an event loop.
+    ///        Queries are sent to the name server over UDP (A and AAAA), if there is no name server,
+    ///        if it doesn't answer or the answer is truncated, the system getaddrinfo is run on a worker thread.
+    ///        Answers are cached up to their TTL, concurrent queries for the same name share the same request.
+    ///        Add GetPollSocket() to your Poll with PollFlags::in and call Process() when it's readable,
+    ///        or at least every GetNextTimeout().
+    ///        A Resolver must be used by only one thread at a time.
+    ////////////
+    class Resolver
+    {
+        class ResolverImpl* _Impl;
+
+    public:
+        ////////////
+        /// @brief Called with the resolve outcome: NoError, NotFound if the name doesn't exist, TimedOut...
+        ////////////
+        using Callback = std::function<void(std::string const& name, NetworkLibrary::Error error, ResolveResult const& result)>;
+
+        Resolver();
+        Resolver(Resolver const& other) = delete;
+        Resolver(Resolver&& other) noexcept;
+        Resolver& operator=(Resolver const& other) = delete;
+        Resolver& operator=(Resolver&& other) noexcept;
+        ~Resolver();
+
+        ////////////
+        /// @brief Opens the resolver socket, must be called before anything else.
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error Open();
+        ////////////
+        /// @brief Sets the name server queried over UDP (port 53 if the address has no port).
+        /// @param[in] server The name server address.
+        /// @return
+        ////////////
+        void SetNameServer(IPv4::IPv4Addr const& server);
+        ////////////
+        /// @brief Sets the name server from the system configuration (/etc/resolv.conf).
+        /// @return Error, NotFound if no IPv4 name server is configured.
+        ////////////
+        NetworkLibrary::Error LoadSystemNameServer();
+        ////////////
+        /// @brief Sets the time to wait for a name server answer before retrying (1s by default).
+        ///        After 2 retries, the name is resolved by the system instead.
+        /// @param[in] timeout The time to wait.
+        /// @return
+        ////////////
+        void SetQueryTimeout(std::chrono::milliseconds timeout);
+        ////////////
+        /// @brief Sets the max amount of names kept in the cache (1024 by default), the least recently used go first.
+        /// @param[in] capacity Cache capacity, 0 disables the cache.
+        /// @return
+        ////////////
+        void SetCacheCapacity(size_t capacity);
+        ////////////
+        /// @brief Removes all the cached names.
+        /// @return
+        ////////////
+        void ClearCache();
+        ////////////
+        /// @brief Starts resolving a name. Literal addresses and cached names complete right away,
+        ///        callback is then called before Resolve returns, otherwise it is called from Process().
+        /// @param[in] name     The hostname.
+        /// @param[in] callback Called once with the result.
+        /// @return Error, InVal if the name isn't a valid hostname.
+        ////////////
+        NetworkLibrary::Error Resolve(std::string const& name, Callback callback);
+        ////////////
+        /// @brief Reads the name server answers, handles the timeouts and the system resolutions, without blocking.
+        /// @return The number of names completed.
+        ////////////
+        size_t Process();
+        ////////////
+        /// @brief Get the socket to poll for readability, it is also woken up by the system resolutions.
+        /// @return The socket
+        ////////////
+        BasicSocket const& GetPollSocket() const;
+        ////////////
+        /// @brief Get the time until the next query timeout.
+        /// @return The time until Process() must be called, -1 if no query is pending.
+        ////////////
+        std::chrono::milliseconds GetNextTimeout() const;
+        ////////////
+        /// @brief Get the number of names being resolved.
+        /// @return Number of pending names
+        ////////////
+        size_t GetPendingCount() const;
+    };
+}
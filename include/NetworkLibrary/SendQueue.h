@@ -0,0 +1,117 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "Poll.h"
+
+#include <functional>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief The output queue of a non-blocking connected socket.
+    ///        What the socket can't take right away is queued and sent when the socket becomes writable:
+    ///        PollFlags::out is added to the socket poll events while the queue isn't empty, and removed once it is.
+    ///        The high watermark callback fires when the queued size reaches the high watermark,
+    ///        the low watermark callback fires once it drops back to the low watermark, so producers can pause meanwhile.
+    ///        A SendQueue must be used by only one thread at a time.
+    ////////////
+    class SendQueue
+    {
+        class SendQueueImpl* _Impl;
+
+    public:
+        ////////////
+        /// @brief Called once a buffer queued by reference has been sent (true), or dropped by Clear() or a socket error (false).
+        ////////////
+        using Completion = std::function<void(bool sent)>;
+        ////////////
+        /// @brief Called when the queued size crosses a watermark.
+        ////////////
+        using WatermarkCallback = std::function<void(size_t queued_size)>;
+
+        SendQueue();
+        SendQueue(SendQueue const& other) = delete;
+        SendQueue(SendQueue&& other) noexcept;
+        SendQueue& operator=(SendQueue const& other) = delete;
+        SendQueue& operator=(SendQueue&& other) noexcept;
+        ~SendQueue();
+
+        ////////////
+        /// @brief Sets the socket to send to, and the poll it is registered in (can be null).
+        ///        Both must outlive the queue, or be detached by calling Attach again.
+        /// @param[in] socket The non-blocking connected socket.
+        /// @param[in] poll   The poll the socket was added to.
+        /// @return
+        ////////////
+        void Attach(ConnectedSocket& socket, Poll* poll);
+        ////////////
+        /// @brief Sets the watermarks (low 64KiB, high 1MiB by default).
+        /// @param[in] low  The queued size under which the low watermark callback fires.
+        /// @param[in] high The queued size from which the high watermark callback fires.
+        /// @return
+        ////////////
+        void SetWatermarks(size_t low, size_t high);
+        ////////////
+        /// @brief Sets the watermark callbacks.
+        /// @param[in] on_high Called when the queued size reaches the high watermark.
+        /// @param[in] on_low  Called when the queued size drops back to the low watermark.
+        /// @return
+        ////////////
+        void SetWatermarkCallbacks(WatermarkCallback on_high, WatermarkCallback on_low);
+        ////////////
+        /// @brief Sends a buffer without copying it. It is sent right away if the queue is empty,
+        ///        what's left is queued: the buffer must stay valid until on_sent is called (maybe before Send returns).
+        /// @param[in] buffer  The data to send.
+        /// @param[in] on_sent Called once the buffer is not used anymore.
+        /// @return Error, WouldBlock is not an error: the data is queued.
+        ////////////
+        NetworkLibrary::Error Send(NetBuffer const& buffer, Completion on_sent);
+        ////////////
+        /// @brief Sends a buffer, what can't be sent right away is copied in the queue.
+        /// @param[in] buffer The data to send.
+        /// @return Error, WouldBlock is not an error: the data is queued.
+        ////////////
+        NetworkLibrary::Error SendCopy(NetBuffer const& buffer);
+        ////////////
+        /// @brief Sends as much queued data as the socket takes, to be called when the socket poll has PollFlags::out.
+        /// @return Error, NoError if the socket is full or the queue is empty.
+        ////////////
+        NetworkLibrary::Error Flush();
+        ////////////
+        /// @brief Handles the socket poll revents, flushes the queue if the socket is writable.
+        /// @param[in] revents The socket poll revents.
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error OnPollEvents(/* PollFlags */ int16_t revents);
+        ////////////
+        /// @brief Get the amount of bytes waiting to be sent.
+        /// @return Queued size
+        ////////////
+        size_t GetQueuedSize() const;
+        ////////////
+        /// @brief Get the number of buffers waiting to be sent.
+        /// @return Queued buffer count
+        ////////////
+        size_t GetQueuedCount() const;
+        ////////////
+        /// @brief Drops the queued data, the completions are called with false.
+        /// @return
+        ////////////
+        void Clear();
+    };
+}
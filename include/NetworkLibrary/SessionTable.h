@@ -0,0 +1,323 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "EndpointKey.h"
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief Maps endpoints to sessions, built for the per datagram lookup of UDP servers.
+    ///        Open addressing with linear probing in one flat array: a lookup hashes the key once and
+    ///        usually reads a single tag byte and a single slot, without any allocation.
+    ///        A tag byte per slot holds 7 hash bits, so most mismatching slots are skipped without comparing the keys.
+    ///        Erasing shifts the following slots back instead of leaving tombstones, the lookups never slow down over time.
+    ///        Pointers to values are invalidated by Insert and Erase.
+    ///        A SessionTable must be used by only one thread at a time.
+    ////////////
+    template<typename T>
+    class SessionTable
+    {
+        struct Slot
+        {
+            EndpointKey Key;
+            T Value;
+        };
+
+        using slot_storage_t = typename std::aligned_storage<sizeof(Slot), alignof(Slot)>::type;
+
+        // 0 is an empty slot, the others are 0x80 | 7 hash bits.
+        std::unique_ptr<uint8_t[]> _Tags;
+        std::unique_ptr<slot_storage_t[]> _Slots;
+        size_t _Mask;
+        size_t _Size;
+
+        static uint8_t _Tag(uint64_t hash)
+        {
+            return static_cast<uint8_t>(0x80 | (hash >> 57));
+        }
+
+        Slot& _SlotAt(size_t index)
+        {
+            return *reinterpret_cast<Slot*>(&_Slots[index]);
+        }
+
+        Slot const& _SlotAt(size_t index) const
+        {
+            return *reinterpret_cast<Slot const*>(&_Slots[index]);
+        }
+
+        size_t _Capacity() const
+        {
+            return _Tags == nullptr ? 0 : _Mask + 1;
+        }
+
+        // Returns the slot holding key, or the empty slot where it would go.
+        size_t _Probe(EndpointKey const& key, uint64_t hash) const
+        {
+            const uint8_t tag = _Tag(hash);
+            size_t index = static_cast<size_t>(hash) & _Mask;
+
+            while (_Tags[index] != 0 && (_Tags[index] != tag || _SlotAt(index).Key != key))
+                index = (index + 1) & _Mask;
+
+            return index;
+        }
+
+        void _Rehash(size_t capacity)
+        {
+            std::unique_ptr<uint8_t[]> tags(new uint8_t[capacity]());
+            std::unique_ptr<slot_storage_t[]> slots(new slot_storage_t[capacity]);
+            const size_t old_capacity = _Capacity();
+
+            tags.swap(_Tags);
+            slots.swap(_Slots);
+            _Mask = capacity - 1;
+
+            for (size_t i = 0; i < old_capacity; ++i)
+            {
+                if (tags[i] == 0)
+                    continue;
+
+                Slot& slot = *reinterpret_cast<Slot*>(&slots[i]);
+                const uint64_t hash = slot.Key.Hash();
+                const size_t index = _Probe(slot.Key, hash);
+
+                _Tags[index] = _Tag(hash);
+                new (&_Slots[index]) Slot(std::move(slot));
+                slot.~Slot();
+            }
+        }
+
+        // Keeps the load factor under 3/4.
+        void _ReserveOneMore()
+        {
+            if ((_Size + 1) * 4 > _Capacity() * 3)
+                _Rehash(_Capacity() == 0 ? 16 : _Capacity() * 2);
+        }
+
+        // Empties index, then moves back the following slots that can't be found past the hole anymore.
+        void _EraseAt(size_t index)
+        {
+            size_t hole = index;
+
+            _SlotAt(hole).~Slot();
+            _Tags[hole] = 0;
+            --_Size;
+
+            for (size_t next = (hole + 1) & _Mask; _Tags[next] != 0; next = (next + 1) & _Mask)
+            {
+                const size_t home = static_cast<size_t>(_SlotAt(next).Key.Hash()) & _Mask;
+                // The slot can move to the hole only if its home isn't cyclically in ]hole, next].
+                if (((next - home) & _Mask) < ((next - hole) & _Mask))
+                    continue;
+
+                new (&_Slots[hole]) Slot(std::move(_SlotAt(next)));
+                _SlotAt(next).~Slot();
+                _Tags[hole] = _Tags[next];
+                _Tags[next] = 0;
+                hole = next;
+            }
+        }
+
+    public:
+        ////////////
+        /// @brief Builds an empty table, the first Insert allocates.
+        ////////////
+        SessionTable() noexcept :
+            _Mask(0),
+            _Size(0)
+        {}
+        SessionTable(SessionTable const& other) = delete;
+        SessionTable(SessionTable&& other) noexcept :
+            _Tags(std::move(other._Tags)),
+            _Slots(std::move(other._Slots)),
+            _Mask(other._Mask),
+            _Size(other._Size)
+        {
+            other._Mask = 0;
+            other._Size = 0;
+        }
+        SessionTable& operator=(SessionTable const& other) = delete;
+        SessionTable& operator=(SessionTable&& other) noexcept
+        {
+            std::swap(_Tags, other._Tags);
+            std::swap(_Slots, other._Slots);
+            std::swap(_Mask, other._Mask);
+            std::swap(_Size, other._Size);
+            return *this;
+        }
+        ~SessionTable()
+        {
+            Clear();
+        }
+
+        ////////////
+        /// @brief Allocates room for count sessions, so inserting them doesn't rehash.
+        /// @param[in] count The expected amount of sessions.
+        /// @return
+        ////////////
+        void Reserve(size_t count)
+        {
+            size_t capacity = 16;
+            while (capacity * 3 < count * 4)
+                capacity *= 2;
+
+            if (capacity > _Capacity())
+                _Rehash(capacity);
+        }
+        ////////////
+        /// @brief Get the number of sessions.
+        /// @return Number of sessions
+        ////////////
+        size_t GetSize() const
+        {
+            return _Size;
+        }
+        ////////////
+        /// @brief Finds the session of an endpoint.
+        /// @param[in] key The endpoint.
+        /// @return The session, nullptr if there is none.
+        ////////////
+        T* Find(EndpointKey const& key)
+        {
+            if (_Size == 0)
+                return nullptr;
+
+            const size_t index = _Probe(key, key.Hash());
+            return _Tags[index] == 0 ? nullptr : &_SlotAt(index).Value;
+        }
+        T const* Find(EndpointKey const& key) const
+        {
+            return const_cast<SessionTable*>(this)->Find(key);
+        }
+        ////////////
+        /// @brief Adds a session if the endpoint has none, the value is built from args.
+        /// @param[in] key  The endpoint.
+        /// @param[in] args The value constructor parameters, unused if the session exists.
+        /// @return The session and true if it was inserted, false if it already existed.
+        ////////////
+        template<typename... Args>
+        std::pair<T*, bool> Insert(EndpointKey const& key, Args&&... args)
+        {
+            const uint64_t hash = key.Hash();
+            size_t index;
+
+            if (_Size != 0)
+            {
+                index = _Probe(key, hash);
+                if (_Tags[index] != 0)
+                    return std::make_pair(&_SlotAt(index).Value, false);
+            }
+
+            _ReserveOneMore();
+            index = _Probe(key, hash);
+            new (&_Slots[index]) Slot{ key, T(std::forward<Args>(args)...) };
+            _Tags[index] = _Tag(hash);
+            ++_Size;
+            return std::make_pair(&_SlotAt(index).Value, true);
+        }
+        ////////////
+        /// @brief Removes the session of an endpoint.
+        /// @param[in] key The endpoint.
+        /// @return true if a session was removed.
+        ////////////
+        bool Erase(EndpointKey const& key)
+        {
+            if (_Size == 0)
+                return false;
+
+            const size_t index = _Probe(key, key.Hash());
+            if (_Tags[index] == 0)
+                return false;
+
+            _EraseAt(index);
+            return true;
+        }
+        ////////////
+        /// @brief Removes the sessions matching a predicate, like the expired ones.
+        ///        Each session is visited once.
+        /// @param[in] predicate Called as predicate(EndpointKey const&, T&), returns true to remove the session.
+        /// @return The number of sessions removed.
+        ////////////
+        template<typename Predicate>
+        size_t EraseIf(Predicate&& predicate)
+        {
+            const size_t capacity = _Capacity();
+            size_t start = 0;
+            size_t erased = 0;
+
+            if (_Size == 0)
+                return 0;
+
+            // Start after an empty slot: the slots moved back by _EraseAt never cross it, so none is visited twice.
+            while (_Tags[start] != 0)
+                ++start;
+
+            for (size_t i = 1; i < capacity;)
+            {
+                const size_t index = (start + i) & _Mask;
+                Slot& slot = _SlotAt(index);
+                if (_Tags[index] != 0 && predicate(static_cast<EndpointKey const&>(slot.Key), slot.Value))
+                {// The next slot may have moved into index, look at it again.
+                    _EraseAt(index);
+                    ++erased;
+                    continue;
+                }
+
+                ++i;
+            }
+
+            return erased;
+        }
+        ////////////
+        /// @brief Calls function on each session, the table must not be modified meanwhile.
+        /// @param[in] function Called as function(EndpointKey const&, T&).
+        /// @return
+        ////////////
+        template<typename Function>
+        void ForEach(Function&& function)
+        {
+            for (size_t i = 0; i < _Capacity(); ++i)
+            {
+                if (_Tags[i] != 0)
+                    function(static_cast<EndpointKey const&>(_SlotAt(i).Key), _SlotAt(i).Value);
+            }
+        }
+        ////////////
+        /// @brief Removes all the sessions, the memory is kept.
+        /// @return
+        ////////////
+        void Clear()
+        {
+            for (size_t i = 0; i < _Capacity() && _Size != 0; ++i)
+            {
+                if (_Tags[i] != 0)
+                {
+                    _SlotAt(i).~Slot();
+                    _Tags[i] = 0;
+                    --_Size;
+                }
+            }
+        }
+    };
+}
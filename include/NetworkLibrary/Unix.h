@@ -17,7 +17,9 @@
 
 #pragma once
 
-#include "details/Socket.h"
+#include "details/SocketTemplate.h"
+
+#include <type_traits>
 
 namespace NetworkLibrary {
 namespace Unix {
@@ -25,7 +27,11 @@ namespace Unix {
 class UnixAddr :
     public BasicAddr
 {
-    class UnixAddrImpl* _Impl;
+    // Inline storage for the native sockaddr_un, addresses are copied without any allocation.
+    std::aligned_storage<112, 4>::type _Storage;
+
+    class UnixAddrImpl& _Impl();
+    class UnixAddrImpl const& _Impl() const;
 
 public:
     ////////////
@@ -35,19 +41,19 @@ public:
     ////////////
     /// @brief 
     ////////////
-    UnixAddr(UnixAddr const& other);
+    UnixAddr(UnixAddr const& other) = default;
     ////////////
     /// @brief 
     ////////////
-    UnixAddr(UnixAddr&& other) noexcept;
+    UnixAddr(UnixAddr&& other) noexcept = default;
     ////////////
     /// @brief 
     ////////////
-    UnixAddr& operator=(UnixAddr const& other);
+    UnixAddr& operator=(UnixAddr const& other) = default;
     ////////////
     /// @brief 
     ////////////
-    UnixAddr& operator=(UnixAddr&& other) noexcept;
+    UnixAddr& operator=(UnixAddr&& other) noexcept = default;
 
     ////////////
     /// @brief 
@@ -60,6 +66,14 @@ public:
     ////////////
     virtual std::string ToString(bool with_port = false) const;
     ////////////
+    /// @brief Copies the path in buffer, without allocating.
+    /// @param[out] buffer      Receives the null terminated path
+    /// @param[in]  buffer_size The buffer size
+    /// @param[in]  with_port   Unused
+    /// @return The path length, 0 if buffer is too small
+    ////////////
+    size_t ToString(char* buffer, size_t buffer_size, bool with_port = false) const;
+    ////////////
     /// @brief Get this Addr family type.
     /// @return 
     ////////////
@@ -85,15 +99,35 @@ public:
     /// @param[in] str The string path representation.
     /// @return Error code.
     ////////////
-    NetworkLibrary::Error FromString(std::string str);
+    NetworkLibrary::Error FromString(std::string const& str);
+    ////////////
+    /// @brief Fill this UnixAddr from string representation, like the socket path.
+    /// @param[in] str    The string, doesn't need to be null terminated.
+    /// @param[in] length The string length.
+    /// @return Error code.
+    ////////////
+    NetworkLibrary::Error FromString(const char* str, size_t length);
 };
 
-class UnixDgram:
-    public UnconnectedSocket
+struct UnixDgramTraits
 {
+    using base_type = UnconnectedSocket;
+    using addr_type = UnixAddr;
+    struct Native;
+};
+
+////////////
+/// @brief The socket file of a successful Bind is removed on destructor or CreateSocket.
+////////////
+class UnixDgram :
+    public SocketTemplate<UnixDgramTraits>
+{
+    friend struct UnixDgramTraits::Native;
+
     std::string* _BoundAddress; // Used for filesystem cleanup.
 
     void UnixCleanup();
+    void UnixBound(BasicAddr const& addr);
 
 public:
     UnixDgram();
@@ -105,34 +139,31 @@ public:
 
     ////////////
     /// @brief Allocates resources to use network functions.
+    ///        Removes the socket file of a previous Bind.
     /// @return Error
     ////////////
     NetworkLibrary::Error CreateSocket();
-    ////////////
-    /// @brief Gets this socket addr (if any).
-    /// @param[out] out_addr Socket address
-    /// @return Error
-    ////////////
-    NetworkLibrary::Error GetSockName(UnixAddr& out_addr);
-
-    virtual int GetFamily() const;
-    virtual int GetType  () const;
-    virtual int GetProto () const;
+};
 
-    ////////////
-    /// @brief Bind the socket on an Unix Address. It will try to remove the socket file on destructor or CreateSocket.
-    /// @param[in] addr The address to bind on.
-    /// @return Error code
-    ////////////
-    virtual NetworkLibrary::Error Bind(BasicAddr const& addr);
+struct UnixStreamTraits
+{
+    using base_type = ConnectedSocket;
+    using addr_type = UnixAddr;
+    struct Native;
 };
 
+////////////
+/// @brief The socket file of a successful Bind is removed on destructor or CreateSocket.
+////////////
 class UnixStream :
-    public ConnectedSocket
+    public SocketTemplate<UnixStreamTraits>
 {
+    friend struct UnixStreamTraits::Native;
+
     std::string* _BoundAddress; // Used for filesystem cleanup.
 
     void UnixCleanup();
+    void UnixBound(BasicAddr const& addr);
 
 public:
     UnixStream();
@@ -144,26 +175,10 @@ public:
 
     ////////////
     /// @brief Allocates resources to use network functions.
+    ///        Removes the socket file of a previous Bind.
     /// @return Error
     ////////////
     NetworkLibrary::Error CreateSocket();
-    ////////////
-    /// @brief Gets this socket addr (if any).
-    /// @param[out] out_addr Socket address
-    /// @return Error
-    ////////////
-    NetworkLibrary::Error GetSockName(UnixAddr& out_addr);
-
-    virtual int GetFamily() const;
-    virtual int GetType() const;
-    virtual int GetProto() const;
-
-    ////////////
-    /// @brief Bind the socket on an Unix Address. It will try to remove the socket file on destructor or CreateSocket.
-    /// @param[in] addr The address to bind on.
-    /// @return Error code
-    ////////////
-    virtual NetworkLibrary::Error Bind(BasicAddr const& addr);
 };
 
 }
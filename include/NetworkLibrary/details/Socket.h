@@ -21,6 +21,8 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <type_traits>
+#include <system_error>
 
 namespace NetworkLibrary
 {
@@ -75,8 +77,103 @@ namespace NetworkLibrary
         static constexpr int32_t so_rcvtimeo  = 13;
         static constexpr int32_t so_error     = 14;
         static constexpr int32_t so_type      = 15;
+        static constexpr int32_t so_reuseport = 16;
+        static constexpr int32_t so_max_pacing_rate = 24;
+
+        static constexpr int32_t tcp_nodelay       = 17;
+        static constexpr int32_t tcp_quickack      = 18;
+        static constexpr int32_t tcp_notsent_lowat = 19;
+        static constexpr int32_t tcp_user_timeout  = 20;
+        static constexpr int32_t tcp_defer_accept  = 21;
+
+        static constexpr int32_t ip_tos            = 22;
+        static constexpr int32_t ip_multicast_ttl  = 25;
+        static constexpr int32_t ip_multicast_loop = 26;
+
+        static constexpr int32_t ipv6_v6only         = 23;
+        static constexpr int32_t ipv6_multicast_hops = 27;
+        static constexpr int32_t ipv6_multicast_loop = 28;
     };
 
+    ////////////
+    /// @brief Socket option levels.
+    ////////////
+    namespace OptionLevel
+    {
+        static constexpr int32_t sol_socket = 1;
+        static constexpr int32_t tcp        = 2;
+        static constexpr int32_t ip         = 3;
+        static constexpr int32_t ipv6       = 4;
+    };
+
+    ////////////
+    /// @brief Typed socket options, to be used with BasicSocket::SetOption and BasicSocket::GetOption.
+    ///        Each option describes its level, name, value type and the native type the OS expects.
+    ////////////
+    namespace Options
+    {
+        template<int32_t Level, int32_t Name, typename ValueType, typename NativeType = int32_t, bool Settable = true>
+        struct OptionTraits
+        {
+            using value_type  = ValueType;
+            using native_type = NativeType;
+
+            static constexpr int32_t level    = Level;
+            static constexpr int32_t name     = Name;
+            static constexpr bool    settable = Settable;
+
+            static native_type ToNative(value_type value) { return static_cast<native_type>(value); }
+            static value_type FromNative(native_type value) { return static_cast<value_type>(value); }
+        };
+
+        template<int32_t Level, int32_t Name, typename Duration, typename NativeType = int32_t>
+        struct DurationOptionTraits
+        {
+            using value_type  = Duration;
+            using native_type = NativeType;
+
+            static constexpr int32_t level    = Level;
+            static constexpr int32_t name     = Name;
+            static constexpr bool    settable = true;
+
+            static native_type ToNative(value_type value) { return static_cast<native_type>(value.count()); }
+            static value_type FromNative(native_type value) { return value_type(value); }
+        };
+
+        struct ReuseAddr       : OptionTraits<OptionLevel::sol_socket, OptionName::so_reuseaddr, bool> {};
+        struct ReusePort       : OptionTraits<OptionLevel::sol_socket, OptionName::so_reuseport, bool> {};
+        struct KeepAlive       : OptionTraits<OptionLevel::sol_socket, OptionName::so_keepalive, bool> {};
+        struct Broadcast       : OptionTraits<OptionLevel::sol_socket, OptionName::so_broadcast, bool> {};
+        struct SendBuffer      : OptionTraits<OptionLevel::sol_socket, OptionName::so_sndbuf   , int32_t> {};
+        struct ReceiveBuffer   : OptionTraits<OptionLevel::sol_socket, OptionName::so_rcvbuf   , int32_t> {};
+        struct SocketError     : OptionTraits<OptionLevel::sol_socket, OptionName::so_error    , int32_t, int32_t, false> {};
+        // Caps the socket send rate in bytes per second, paced by the kernel (Linux only, needs the fq qdisc for non TCP sockets).
+        struct MaxPacingRate   : OptionTraits<OptionLevel::sol_socket, OptionName::so_max_pacing_rate, uint32_t, uint32_t> {};
+
+        // Disables Nagle's algorithm, small writes are sent right away.
+        struct TcpNoDelay      : OptionTraits<OptionLevel::tcp, OptionName::tcp_nodelay      , bool> {};
+        // Sends ACKs right away instead of delaying them (Linux only, the kernel may turn it back off).
+        struct TcpQuickAck     : OptionTraits<OptionLevel::tcp, OptionName::tcp_quickack     , bool> {};
+        // Limits the unsent bytes in the socket buffer, the socket is writable only under this limit.
+        struct TcpNotSentLowat : OptionTraits<OptionLevel::tcp, OptionName::tcp_notsent_lowat, uint32_t, uint32_t> {};
+        // Time unacknowledged datas may stay in flight before the connection is dropped (Linux only).
+        struct TcpUserTimeout  : DurationOptionTraits<OptionLevel::tcp, OptionName::tcp_user_timeout, std::chrono::milliseconds, uint32_t> {};
+        // Wakes the listener only once datas arrived on the new connection (Linux only).
+        struct TcpDeferAccept  : DurationOptionTraits<OptionLevel::tcp, OptionName::tcp_defer_accept, std::chrono::seconds> {};
+
+        struct IpTos           : OptionTraits<OptionLevel::ip, OptionName::ip_tos, uint8_t> {};
+        // TTL of the multicast datagrams sent, 1 (the default) keeps them on the local network.
+        struct IpMulticastTtl  : OptionTraits<OptionLevel::ip, OptionName::ip_multicast_ttl , uint8_t> {};
+        // Delivers the multicast datagrams sent to the local members too (the default).
+        struct IpMulticastLoop : OptionTraits<OptionLevel::ip, OptionName::ip_multicast_loop, bool> {};
+
+        struct Ipv6V6Only        : OptionTraits<OptionLevel::ipv6, OptionName::ipv6_v6only, bool> {};
+        // Hop limit of the multicast datagrams sent, 1 (the default) keeps them on the local network.
+        struct Ipv6MulticastHops : OptionTraits<OptionLevel::ipv6, OptionName::ipv6_multicast_hops, uint8_t> {};
+        // Delivers the multicast datagrams sent to the local members too (the default).
+        struct Ipv6MulticastLoop : OptionTraits<OptionLevel::ipv6, OptionName::ipv6_multicast_loop, bool, uint32_t> {};
+    }
+
 	////////////
     /// @brief NetworkLibrary error codes, use Error::NativeCode to get the OS native error code.
     ////////////
@@ -105,6 +202,8 @@ namespace NetworkLibrary
         static constexpr int TimedOut             =  19;
         static constexpr int HostDown             =  20;
         static constexpr int HostUnreachable      =  21;
+        static constexpr int TooManyOpenFiles     =  22;
+        static constexpr int NotSupported         =  23;
 
         // Windows Only
         static constexpr int WsaNotInitialised      = 10000;
@@ -117,10 +216,96 @@ namespace NetworkLibrary
         int NativeCode;
 
         std::string ToString();
+        ////////////
+        /// @brief Get the error message, from a static table: nothing is allocated.
+        /// @return The message, "Unknown error." if ErrorCode has none.
+        ////////////
+        const char* Message() const noexcept;
+        ////////////
+        /// @brief Converts to a std::error_code of ErrorCategory(), it compares equal to the matching std::errc.
+        /// @return The error code
+        ////////////
+        std::error_code ToErrorCode() const noexcept;
 
         explicit operator int() const { return ErrorCode; }
     };
 
+    ////////////
+    /// @brief The std::error_category of the Error codes.
+    /// @return The category
+    ////////////
+    std::error_category const& ErrorCategory() noexcept;
+
+    ////////////
+    /// @brief A syscall result, only the native error code (0 on success). It fits in a register
+    ///        and the success path never maps it, Error and std::error_code are built on demand.
+    ////////////
+    class Result
+    {
+        int _NativeCode;
+
+        NetworkLibrary::Error _MakeError() const noexcept;
+
+    public:
+        constexpr Result() noexcept : _NativeCode(0) {}
+        constexpr explicit Result(int native_code) noexcept : _NativeCode(native_code) {}
+
+        constexpr bool IsOk() const noexcept { return _NativeCode == 0; }
+        constexpr explicit operator bool() const noexcept { return _NativeCode == 0; }
+        constexpr int GetNativeCode() const noexcept { return _NativeCode; }
+
+        NetworkLibrary::Error ToError() const noexcept { return _NativeCode == 0 ? NetworkLibrary::Error{ NetworkLibrary::Error::NoError, 0 } : _MakeError(); }
+        std::error_code ToErrorCode() const noexcept { return ToError().ToErrorCode(); }
+    };
+
+    ////////////
+    /// @brief TCP connection telemetry, see TCP::GetTcpInfo. Values the OS doesn't report are 0.
+    ////////////
+    struct TcpInfo
+    {
+        std::chrono::microseconds Rtt;          // Smoothed round trip time.
+        std::chrono::microseconds RttVar;       // Round trip time variance.
+        uint32_t                  SendCwnd;     // Congestion window, in segments.
+        uint32_t                  SendMss;      // Send maximum segment size, in bytes.
+        uint32_t                  Retransmits;  // Total retransmitted segments.
+        uint32_t                  Unacked;      // Sent segments not acknowledged yet.
+        uint32_t                  BytesInFlight;// Estimated bytes in flight.
+        uint64_t                  DeliveryRate; // Recent delivery rate, in bytes per second.
+        uint64_t                  BytesSent;    // Total bytes sent, retransmissions included (Linux 4.19+, macOS).
+        uint64_t                  BytesAcked;   // Total bytes acknowledged by the peer (Linux).
+        bool                      Established;  // The connection is in the established state.
+    };
+
+    ////////////
+    /// @brief Socket I/O counters, see BasicSocket::GetIoCounters and GetProcessIoCounters.
+    ///        They are only maintained when the library is built with SOCKET_IO_COUNTERS, otherwise they are all 0.
+    ////////////
+    struct IoCounters
+    {
+#if defined(SOCKET_IO_COUNTERS)
+        static constexpr bool Enabled = true;
+#else
+        static constexpr bool Enabled = false;
+#endif
+        // Errors[ErrorCode] for the codes up to Error::NotSupported, Errors[0] counts the other codes.
+        static constexpr size_t ErrorSlots = Error::NotSupported + 1;
+
+        uint64_t BytesSent;
+        uint64_t BytesReceived;
+        uint64_t SendCalls;           // Send and SendTo calls, failed ones included.
+        uint64_t ReceiveCalls;        // Receive and ReceiveFrom calls, failed ones included.
+        uint64_t WouldBlock;          // Calls that failed with Error::WouldBlock, they are not counted in Errors.
+        uint64_t ShortWrites;         // Sends that wrote less than the requested size.
+        uint64_t Errors[ErrorSlots];
+    };
+
+    ////////////
+    /// @brief Gets the I/O counters of all the sockets of the process, closed ones included.
+    ///        Each thread counts in its own storage, this sums them: the values are a snapshot, not a transaction.
+    /// @return The counters
+    ////////////
+    IoCounters GetProcessIoCounters();
+
     struct NetBuffer
     {
         void* Buffer;
@@ -166,6 +351,11 @@ namespace NetworkLibrary
         /// @return Addr length
         ////////////
         virtual size_t GetLength() const = 0;
+        ////////////
+        /// @brief Get the size GetAddr() can receive, used when the system fills the address (ReceiveFrom, Accept, ...).
+        /// @return The storage size, GetLength() by default.
+        ////////////
+        virtual size_t GetStorageSize() const;
     };
 
     struct IfaceAddr
@@ -179,6 +369,8 @@ namespace NetworkLibrary
         std::string Name;
         std::string FriendlyName;
         std::string Description;
+        // The interface index, to choose the multicast interface.
+        uint32_t Index;
         bool IsUp;
         std::vector<IfaceAddr> Addresses;
     };
@@ -189,14 +381,26 @@ namespace NetworkLibrary
     class BasicSocket
     {
     protected:
-        class Internals::NativeSocket* _Impl;
+        // Inline storage for the native handle (Internals::NativeSocket), sockets never allocate.
+        // With SOCKET_IO_COUNTERS it also holds the socket counters pointer, allocated when the socket is created.
+        std::aligned_storage<(IoCounters::Enabled ? 2 : 1) * sizeof(void*), alignof(void*)>::type _Storage;
+
+        Internals::NativeSocket& _Impl() { return *reinterpret_cast<Internals::NativeSocket*>(&_Storage); }
+        Internals::NativeSocket const& _Impl() const { return *reinterpret_cast<Internals::NativeSocket const*>(&_Storage); }
+
+        ////////////
+        /// @brief Takes other native handle, other is left closed.
+        ////////////
+        BasicSocket(BasicSocket&& other) noexcept;
+        ////////////
+        /// @brief Swaps the native handles, the previous one is closed with other.
+        ////////////
+        BasicSocket& operator=(BasicSocket&& other) noexcept;
 
     public:
         BasicSocket();
         BasicSocket(BasicSocket const& other) = delete;
-        BasicSocket(BasicSocket&& other) noexcept = delete;
         BasicSocket& operator=(BasicSocket const& other) = delete;
-        BasicSocket& operator=(BasicSocket && other) noexcept = delete;
         virtual ~BasicSocket();
 
         virtual int GetFamily() const = 0;
@@ -225,7 +429,7 @@ namespace NetworkLibrary
 		/// @param[in] non_blocking Non-blocking value.
         /// @return Error
         ////////////
-        NetworkLibrary::Error SetNonBlocking(bool non_blocking);
+        virtual NetworkLibrary::Error SetNonBlocking(bool non_blocking);
         ////////////
         /// @brief Sets the socket option.
         /// @param[in] option_name Option name.
@@ -235,16 +439,74 @@ namespace NetworkLibrary
         ////////////
         NetworkLibrary::Error SetSockOption(int32_t option_name, const void* value, int optlen);
         ////////////
+        /// @brief Sets the socket option at the given level.
+        /// @param[in] level       Option level.
+        /// @param[in] option_name Option name.
+        /// @param[in] value       Option value.
+        /// @param[in] optlen      Option size.
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error SetSockOption(int32_t level, int32_t option_name, const void* value, int optlen);
+        ////////////
+        /// @brief Gets the socket option at the given level.
+        /// @param[in]     level       Option level.
+        /// @param[in]     option_name Option name.
+        /// @param[out]    value       Option value.
+        /// @param[in,out] optlen      Option buffer size, filled with the option size.
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error GetSockOption(int32_t level, int32_t option_name, void* value, int& optlen) const;
+        ////////////
+        /// @brief Sets a typed socket option, see NetworkLibrary::Options.
+        /// @param[in] value Option value.
+        /// @return Error
+        ////////////
+        template<typename Option>
+        NetworkLibrary::Error SetOption(typename Option::value_type value)
+        {
+            static_assert(Option::settable, "This socket option is read-only.");
+            typename Option::native_type native_value = Option::ToNative(value);
+            return SetSockOption(Option::level, Option::name, &native_value, static_cast<int>(sizeof(native_value)));
+        }
+        ////////////
+        /// @brief Gets a typed socket option, see NetworkLibrary::Options.
+        /// @param[out] value Option value.
+        /// @return Error
+        ////////////
+        template<typename Option>
+        NetworkLibrary::Error GetOption(typename Option::value_type& value) const
+        {
+            typename Option::native_type native_value{};
+            int optlen = static_cast<int>(sizeof(native_value));
+            NetworkLibrary::Error error = GetSockOption(Option::level, Option::name, &native_value, optlen);
+            if (error.ErrorCode == NetworkLibrary::Error::NoError)
+                value = Option::FromNative(native_value);
+
+            return error;
+        }
+        ////////////
+        /// @brief Gets and clears the socket pending error (SO_ERROR), like the result of a non-blocking Connect.
+        /// @return The pending error, NoError if there is none.
+        ////////////
+        NetworkLibrary::Error GetPendingError() const;
+        ////////////
+        /// @brief Gets this socket I/O counters, since it was created or accepted. They can be read from any thread.
+        ///        Each counter is exact when several threads use the socket, but they are read one by one:
+        ///        a snapshot taken during I/O can hold the Calls of a call and not its Bytes yet.
+        /// @return The counters, all 0 without SOCKET_IO_COUNTERS.
+        ////////////
+        IoCounters GetIoCounters() const;
+        ////////////
         /// @brief Gets the bytes count ready to be read on the socket.
         /// @return Waiting size.
         ////////////
-        int32_t GetWaitingSize() const;
+        virtual int32_t GetWaitingSize() const;
 
         ////////////
         /// @brief Closes this socket.
         /// @return
         ////////////
-        void Close();
+        virtual void Close();
     };
 
     ////////////
@@ -274,6 +536,18 @@ namespace NetworkLibrary
         ////////////
         virtual NetworkLibrary::Error Accept(ConnectedSocket& new_client, BasicAddr& client_addr);
         ////////////
+        /// @brief Accepts up to max_count waiting connections in one go, the new clients are non-blocking.
+        ///        If the process runs out of file descriptors before accepting anything, the waiting connections
+        ///        are accepted and closed so the listener doesn't stay readable, and Error::TooManyOpenFiles is returned.
+        ///        An error that happens after some connections were accepted is left for the next call.
+        /// @param[in]  new_clients    max_count sockets that will receive the new clients.
+        /// @param[in]  client_addrs   max_count addresses that will receive the new clients address, can be nullptr.
+        /// @param[in]  max_count      The max amount of connections to accept.
+        /// @param[out] accepted_count The amount of accepted connections.
+        /// @return Error code, NoError if at least one connection was accepted.
+        ////////////
+        virtual NetworkLibrary::Error AcceptBatch(ConnectedSocket* const* new_clients, BasicAddr* const* client_addrs, size_t max_count, size_t& accepted_count);
+        ////////////
         /// @brief Try to connect to the remote address.
         /// @param[in] addr The address to bind on.
         /// @return Error code
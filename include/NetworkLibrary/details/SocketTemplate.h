@@ -0,0 +1,90 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "Socket.h"
+
+namespace NetworkLibrary {
+    ////////////
+    /// @brief The I/O calls of the socket base type, final: a call made through a concrete socket class
+    ///        binds statically to the library syscall wrapper instead of going through the vtable.
+    ///        Calls made through a ConnectedSocket or UnconnectedSocket reference stay virtual.
+    ////////////
+    template<typename Traits, typename Base = typename Traits::base_type>
+    class SocketTemplateIO;
+
+    template<typename Traits>
+    class SocketTemplateIO<Traits, ConnectedSocket> :
+        public ConnectedSocket
+    {
+    public:
+        virtual NetworkLibrary::Error Send(NetBuffer& buffer, int32_t flags = SocketFlags::normal) final;
+        virtual NetworkLibrary::Error Receive(NetBuffer& buffer, int32_t flags = SocketFlags::normal) final;
+    };
+
+    template<typename Traits>
+    class SocketTemplateIO<Traits, UnconnectedSocket> :
+        public UnconnectedSocket
+    {
+    public:
+        virtual NetworkLibrary::Error SendTo(BasicAddr const& addr, NetBuffer& buffer, int32_t flags = SocketFlags::normal) final;
+        virtual NetworkLibrary::Error ReceiveFrom(BasicAddr& addr, NetBuffer& buffer, int32_t flags = SocketFlags::normal) final;
+    };
+
+    ////////////
+    /// @brief The common part of the concrete socket classes, Traits describes the socket:
+    ///        - base_type: ConnectedSocket or UnconnectedSocket.
+    ///        - addr_type: The address class of the socket family.
+    ///        - Native:    Only declared, the library defines it with the constexpr native Family, Type and Proto.
+    ///        Bind, GetFamily, GetType, GetProto and the SocketTemplateIO calls are final: calls made through a concrete
+    ///        socket class are resolved at compile time instead of going through the vtable. They are still calls
+    ///        into the library, the syscall wrappers are not inlined in the caller.
+    ////////////
+    template<typename Traits>
+    class SocketTemplate :
+        public SocketTemplateIO<Traits>
+    {
+    public:
+        using traits_type = Traits;
+        using addr_type = typename Traits::addr_type;
+
+        SocketTemplate() = default;
+        SocketTemplate(SocketTemplate const& other) = delete;
+        SocketTemplate(SocketTemplate&& other) noexcept = default;
+        SocketTemplate& operator=(SocketTemplate const& other) = delete;
+        SocketTemplate& operator=(SocketTemplate&& other) noexcept = default;
+
+        ////////////
+        /// @brief Allocates resources to use network functions.
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error CreateSocket();
+        ////////////
+        /// @brief Gets this socket addr (if any).
+        /// @param[out] out_addr Socket address
+        /// @return Error
+        ////////////
+        NetworkLibrary::Error GetSockName(addr_type& out_addr);
+
+        virtual NetworkLibrary::Error Bind(BasicAddr const& addr) final;
+
+        virtual int GetFamily() const final;
+        virtual int GetType  () const final;
+        virtual int GetProto () const final;
+    };
+}
@@ -0,0 +1,288 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/AnyAddr.h>
+#include "internals/internal_socket.h"
+
+namespace NetworkLibrary {
+
+    static constexpr uint8_t _IPv4MappedPrefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+    SOCKET_HIDE_CLASS(class) AnyAddrImpl
+    {
+        sockaddr_storage _SockAddr;
+
+        sockaddr_in& _IPv4()
+        {
+            return *reinterpret_cast<sockaddr_in*>(&_SockAddr);
+        }
+
+        sockaddr_in const& _IPv4() const
+        {
+            return *reinterpret_cast<sockaddr_in const*>(&_SockAddr);
+        }
+
+        sockaddr_in6& _IPv6()
+        {
+            return *reinterpret_cast<sockaddr_in6*>(&_SockAddr);
+        }
+
+        sockaddr_in6 const& _IPv6() const
+        {
+            return *reinterpret_cast<sockaddr_in6 const*>(&_SockAddr);
+        }
+
+    public:
+        AnyAddrImpl() :
+            _SockAddr()
+        {
+            _SockAddr.ss_family = AF_UNSPEC;
+        }
+
+        int GetFamily() const
+        {
+            return _SockAddr.ss_family;
+        }
+
+        void* GetAddr()
+        {
+            return &_SockAddr;
+        }
+
+        const void* GetAddr() const
+        {
+            return &_SockAddr;
+        }
+
+        size_t GetLength() const
+        {
+            switch (_SockAddr.ss_family)
+            {
+                case AF_INET : return sizeof(sockaddr_in);
+                case AF_INET6: return sizeof(sockaddr_in6);
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+                case AF_UNIX : return sizeof(sockaddr_un);
+#endif
+                default: return sizeof(sockaddr_storage);
+            }
+        }
+
+        size_t GetStorageSize() const
+        {
+            return sizeof(sockaddr_storage);
+        }
+
+        NetworkLibrary::Error FromAddr(BasicAddr const& addr)
+        {
+            if (addr.GetLength() > sizeof(sockaddr_storage))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            _SockAddr = sockaddr_storage();
+            memcpy(&_SockAddr, addr.GetAddr(), addr.GetLength());
+            return Internals::MakeNoError();
+        }
+
+        bool IsIPv4Mapped() const
+        {
+            return _SockAddr.ss_family == AF_INET6 && memcmp(&_IPv6().sin6_addr, _IPv4MappedPrefix, sizeof(_IPv4MappedPrefix)) == 0;
+        }
+
+        bool Normalize()
+        {
+            if (!IsIPv4Mapped())
+                return false;
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = _IPv6().sin6_port;
+            memcpy(&addr.sin_addr, reinterpret_cast<uint8_t const*>(&_IPv6().sin6_addr) + 12, 4);
+
+            _SockAddr = sockaddr_storage();
+            _IPv4() = addr;
+            return true;
+        }
+
+        bool MapToIPv6()
+        {
+            if (_SockAddr.ss_family != AF_INET)
+                return false;
+
+            sockaddr_in6 addr{};
+            addr.sin6_family = AF_INET6;
+            addr.sin6_port = _IPv4().sin_port;
+            memcpy(&addr.sin6_addr, _IPv4MappedPrefix, sizeof(_IPv4MappedPrefix));
+            memcpy(reinterpret_cast<uint8_t*>(&addr.sin6_addr) + 12, &_IPv4().sin_addr, 4);
+
+            _SockAddr = sockaddr_storage();
+            _IPv6() = addr;
+            return true;
+        }
+
+        NetworkLibrary::Error ToAddr(IPv4::IPv4Addr& addr) const
+        {
+            AnyAddrImpl normalized(*this);
+            normalized.Normalize();
+            if (normalized._SockAddr.ss_family != AF_INET)
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            memcpy(addr.GetAddr(), &normalized._SockAddr, sizeof(sockaddr_in));
+            return Internals::MakeNoError();
+        }
+
+        NetworkLibrary::Error ToAddr(IPv6::IPv6Addr& addr) const
+        {
+            AnyAddrImpl mapped(*this);
+            mapped.MapToIPv6();
+            if (mapped._SockAddr.ss_family != AF_INET6)
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            memcpy(addr.GetAddr(), &mapped._SockAddr, sizeof(sockaddr_in6));
+            return Internals::MakeNoError();
+        }
+
+        uint16_t GetPort() const
+        {
+            switch (_SockAddr.ss_family)
+            {
+                case AF_INET : return Internals::Endian::NetSwap(_IPv4().sin_port);
+                case AF_INET6: return Internals::Endian::NetSwap(_IPv6().sin6_port);
+                default: return 0;
+            }
+        }
+
+        std::string ToString(bool with_port) const
+        {
+            switch (_SockAddr.ss_family)
+            {
+                case AF_INET:
+                {
+                    IPv4::IPv4Addr addr;
+                    ToAddr(addr);
+                    return addr.ToString(with_port);
+                }
+
+                case AF_INET6:
+                {
+                    IPv6::IPv6Addr addr;
+                    ToAddr(addr);
+                    return addr.ToString(with_port);
+                }
+
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+                case AF_UNIX:
+                {
+                    sockaddr_un const& addr = *reinterpret_cast<sockaddr_un const*>(&_SockAddr);
+                    const char* path_end = reinterpret_cast<const char*>(memchr(addr.sun_path, 0, sizeof(addr.sun_path)));
+                    return std::string(addr.sun_path, path_end == nullptr ? sizeof(addr.sun_path) : static_cast<size_t>(path_end - addr.sun_path));
+                }
+#endif
+
+                default: return std::string();
+            }
+        }
+    };
+
+    static_assert(sizeof(AnyAddrImpl) <= sizeof(std::aligned_storage<128, 8>::type) && alignof(AnyAddrImpl) <= 8, "AnyAddr storage is too small.");
+    static_assert(std::is_trivially_copyable<AnyAddrImpl>::value, "AnyAddrImpl must be trivially copyable.");
+
+    /****
+     * AnyAddr implementation
+     ****/
+
+    AnyAddrImpl& AnyAddr::_Impl()
+    {
+        return *reinterpret_cast<AnyAddrImpl*>(&_Storage);
+    }
+
+    AnyAddrImpl const& AnyAddr::_Impl() const
+    {
+        return *reinterpret_cast<AnyAddrImpl const*>(&_Storage);
+    }
+
+    AnyAddr::AnyAddr()
+    {
+        new (&_Storage) AnyAddrImpl;
+    }
+
+    AnyAddr::~AnyAddr()
+    {}
+
+    std::string AnyAddr::ToString(bool with_port) const
+    {
+        return _Impl().ToString(with_port);
+    }
+
+    int AnyAddr::GetFamily() const
+    {
+        return _Impl().GetFamily();
+    }
+
+    void* AnyAddr::GetAddr()
+    {
+        return _Impl().GetAddr();
+    }
+
+    const void* AnyAddr::GetAddr() const
+    {
+        return _Impl().GetAddr();
+    }
+
+    size_t AnyAddr::GetLength() const
+    {
+        return _Impl().GetLength();
+    }
+
+    size_t AnyAddr::GetStorageSize() const
+    {
+        return _Impl().GetStorageSize();
+    }
+
+    NetworkLibrary::Error AnyAddr::FromAddr(BasicAddr const& addr)
+    {
+        return _Impl().FromAddr(addr);
+    }
+
+    NetworkLibrary::Error AnyAddr::ToAddr(IPv4::IPv4Addr& addr) const
+    {
+        return _Impl().ToAddr(addr);
+    }
+
+    NetworkLibrary::Error AnyAddr::ToAddr(IPv6::IPv6Addr& addr) const
+    {
+        return _Impl().ToAddr(addr);
+    }
+
+    bool AnyAddr::IsIPv4Mapped() const
+    {
+        return _Impl().IsIPv4Mapped();
+    }
+
+    bool AnyAddr::Normalize()
+    {
+        return _Impl().Normalize();
+    }
+
+    bool AnyAddr::MapToIPv6()
+    {
+        return _Impl().MapToIPv6();
+    }
+
+    uint16_t AnyAddr::GetPort() const
+    {
+        return _Impl().GetPort();
+    }
+}
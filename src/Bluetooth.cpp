@@ -598,25 +598,19 @@ namespace Bluetooth {
     RFCOMM::RFCOMM()
     {}
     
-    RFCOMM::RFCOMM(RFCOMM&& other) noexcept
-    {
-        _Impl = other._Impl;
-    
-        other._Impl = nullptr;
-    }
+    RFCOMM::RFCOMM(RFCOMM&& other) noexcept :
+        ConnectedSocket(std::move(other))
+    {}
     
     RFCOMM& RFCOMM::operator=(RFCOMM&& other) noexcept
     {
-        auto tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-    
+        ConnectedSocket::operator=(std::move(other));
         return *this;
     }
     
     NetworkLibrary::Error RFCOMM::CreateSocket()
     {
-        return _Impl->CreateSocket(
+        return _Impl().CreateSocket(
             (Internals::AddressFamily)_AddressFamily,
             (Internals::SocketTypes)_TypeRFCOMM,
             (Internals::SocketProtocols)_ProtoRFCOMM);
@@ -624,7 +618,7 @@ namespace Bluetooth {
 
     NetworkLibrary::Error RFCOMM::GetSockName(BluetoothAddr& out_addr)
     {
-        return Internals::getsockname(*_Impl, out_addr);
+        return Internals::getsockname(_Impl(), out_addr);
     }
     
     int RFCOMM::GetFamily() const { return _AddressFamily; }
@@ -0,0 +1,401 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/ConnectionPool.h>
+#include "internals/internal_socket.h"
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+
+namespace NetworkLibrary {
+
+    SOCKET_HIDE_CLASS(class) ConnectionPoolImpl
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct IdleConnection
+        {
+            IPv4::TCP Socket;
+            clock::time_point ReleaseTime;
+        };
+
+        struct Endpoint
+        {
+            // Most recently released first, the oldest connections are at the back.
+            std::list<IdleConnection> Idle;
+            size_t Total = 0;
+        };
+
+        std::unordered_map<uint64_t, Endpoint> _Endpoints;
+
+        static uint64_t _MakeKey(IPv4::IPv4Addr const& addr)
+        {
+            return (static_cast<uint64_t>(addr.GetIPv4()) << 16) | addr.GetPort();
+        }
+
+        Endpoint* _FindEndpoint(IPv4::IPv4Addr const& addr)
+        {
+            auto it = _Endpoints.find(_MakeKey(addr));
+            return it == _Endpoints.end() ? nullptr : &it->second;
+        }
+
+        Endpoint const* _FindEndpoint(IPv4::IPv4Addr const& addr) const
+        {
+            auto it = _Endpoints.find(_MakeKey(addr));
+            return it == _Endpoints.end() ? nullptr : &it->second;
+        }
+
+        void _ForgetEndpointIfUnused(IPv4::IPv4Addr const& addr)
+        {
+            auto it = _Endpoints.find(_MakeKey(addr));
+            if (it != _Endpoints.end() && it->second.Total == 0)
+                _Endpoints.erase(it);
+        }
+
+        // An idle connection must have nothing to read: readability means the peer closed it,
+        // reset it or sent something we didn't ask for. poll with a 0 timeout never blocks,
+        // whatever the blocking mode the caller left on the socket.
+        static bool _IsHealthy(IPv4::TCP& socket)
+        {
+            pollfd fd{ static_cast<Internals::NativeSocket::socket_t>(socket.GetNativeFd()), POLLIN, 0 };
+            int result = Internals::poll(&fd, 1, 0);
+            if (result == 0)
+                return true;
+
+            if (result < 0 || !(fd.revents & POLLIN) || (fd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+                return false;
+
+            // Readable: 0 bytes is an orderly shutdown and data is a reply we didn't ask for, both make the connection
+            // unusable. WouldBlock means the readiness went away before the peek, nothing is waiting.
+            uint8_t byte;
+            NetBuffer buffer{ &byte, 1 };
+            return socket.Receive(buffer, SocketFlags::peek).ErrorCode == Error::WouldBlock;
+        }
+
+    public:
+        size_t MaxIdle;
+        size_t MaxTotal;
+        std::chrono::milliseconds IdleTimeout;
+
+        ConnectionPoolImpl() :
+            MaxIdle(4),
+            MaxTotal(16),
+            IdleTimeout(60000)
+        {}
+
+        NetworkLibrary::Error WarmUp(IPv4::IPv4Addr const& addr, size_t count, std::chrono::milliseconds timeout, size_t& opened_count)
+        {
+            const clock::time_point deadline = clock::now() + timeout;
+            Endpoint& endpoint = _Endpoints[_MakeKey(addr)];
+            NetworkLibrary::Error first_error = Internals::MakeErrorFromSocketCode(Error::NoError);
+            std::vector<pollfd> poll_fds;
+            std::vector<size_t> pending;
+
+            opened_count = 0;
+            if (endpoint.Idle.size() < MaxIdle && endpoint.Total < MaxTotal)
+                count = std::min(count, std::min(MaxIdle - endpoint.Idle.size(), MaxTotal - endpoint.Total));
+            else
+                count = 0;
+
+            std::vector<IPv4::TCP> sockets(count);
+            poll_fds.reserve(count);
+            pending.reserve(count);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                NetworkLibrary::Error error;
+
+                if ((error = sockets[i].CreateSocket()).ErrorCode == Error::NoError &&
+                    (error = sockets[i].SetNonBlocking(true)).ErrorCode == Error::NoError)
+                {
+                    error = sockets[i].Connect(addr);
+                }
+
+                if (error.ErrorCode == Error::NoError || error.ErrorCode == Error::InProgress || error.ErrorCode == Error::WouldBlock)
+                {
+                    pending.emplace_back(i);
+                    poll_fds.emplace_back(pollfd{ static_cast<Internals::NativeSocket::socket_t>(sockets[i].GetNativeFd()), POLLOUT, 0 });
+                }
+                else
+                {
+                    sockets[i].Close();
+                    if (first_error.ErrorCode == Error::NoError)
+                        first_error = error;
+                }
+            }
+
+            while (!pending.empty())
+            {
+                clock::time_point now = clock::now();
+                if (now >= deadline)
+                {
+                    if (first_error.ErrorCode == Error::NoError)
+                        first_error = Internals::MakeErrorFromSocketCode(Error::TimedOut);
+                    break;
+                }
+
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1);
+                if (Internals::poll(poll_fds.data(), poll_fds.size(), static_cast<int>(wait.count())) <= 0)
+                    continue;
+
+                for (size_t i = 0; i < poll_fds.size();)
+                {
+                    if (poll_fds[i].revents == 0)
+                    {
+                        ++i;
+                        continue;
+                    }
+
+                    IPv4::TCP& socket = sockets[pending[i]];
+                    NetworkLibrary::Error error = socket.GetPendingError();
+                    if (error.ErrorCode == Error::NoError)
+                        error = socket.SetNonBlocking(false);
+
+                    if (error.ErrorCode == Error::NoError)
+                    {
+                        endpoint.Idle.emplace_front();
+                        endpoint.Idle.front().Socket = std::move(socket);
+                        endpoint.Idle.front().ReleaseTime = clock::now();
+                        ++endpoint.Total;
+                        ++opened_count;
+                    }
+                    else if (first_error.ErrorCode == Error::NoError)
+                    {
+                        first_error = error;
+                    }
+
+                    pending.erase(pending.begin() + i);
+                    poll_fds.erase(poll_fds.begin() + i);
+                }
+            }
+
+            _ForgetEndpointIfUnused(addr);
+            return first_error;
+        }
+
+        NetworkLibrary::Error Acquire(IPv4::IPv4Addr const& addr, IPv4::TCP& connection, bool& reused)
+        {
+            Endpoint& endpoint = _Endpoints[_MakeKey(addr)];
+            const clock::time_point now = clock::now();
+            NetworkLibrary::Error error;
+
+            connection.Close();
+            reused = false;
+            while (!endpoint.Idle.empty())
+            {
+                IdleConnection& idle = endpoint.Idle.front();
+                if (now - idle.ReleaseTime < IdleTimeout && _IsHealthy(idle.Socket))
+                {
+                    connection = std::move(idle.Socket);
+                    endpoint.Idle.pop_front();
+                    reused = true;
+                    return Internals::MakeErrorFromSocketCode(Error::NoError);
+                }
+
+                endpoint.Idle.pop_front();
+                --endpoint.Total;
+            }
+
+            if (endpoint.Total >= MaxTotal)
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+
+            if ((error = connection.CreateSocket()).ErrorCode != Error::NoError ||
+                (error = connection.Connect(addr)).ErrorCode != Error::NoError)
+            {
+                connection.Close();
+                _ForgetEndpointIfUnused(addr);
+                return error;
+            }
+
+            ++endpoint.Total;
+            return error;
+        }
+
+        void Release(IPv4::IPv4Addr const& addr, IPv4::TCP& connection, bool reusable)
+        {
+            Endpoint* endpoint = _FindEndpoint(addr);
+            if (endpoint == nullptr || endpoint->Total == 0)
+            {// Not acquired from this pool.
+                connection.Close();
+                return;
+            }
+
+            if (reusable && endpoint->Idle.size() < MaxIdle && _IsHealthy(connection))
+            {
+                endpoint->Idle.emplace_front();
+                endpoint->Idle.front().Socket = std::move(connection);
+                endpoint->Idle.front().ReleaseTime = clock::now();
+                // connection now holds the idle entry default socket.
+                connection.Close();
+                return;
+            }
+
+            connection.Close();
+            --endpoint->Total;
+            _ForgetEndpointIfUnused(addr);
+        }
+
+        size_t EvictIdle()
+        {
+            const clock::time_point now = clock::now();
+            size_t evicted = 0;
+
+            for (auto it = _Endpoints.begin(); it != _Endpoints.end();)
+            {
+                Endpoint& endpoint = it->second;
+                while (!endpoint.Idle.empty() && now - endpoint.Idle.back().ReleaseTime >= IdleTimeout)
+                {
+                    endpoint.Idle.pop_back();
+                    --endpoint.Total;
+                    ++evicted;
+                }
+
+                if (endpoint.Total == 0)
+                    it = _Endpoints.erase(it);
+                else
+                    ++it;
+            }
+
+            return evicted;
+        }
+
+        std::chrono::milliseconds GetNextEvictionTimeout() const
+        {
+            clock::time_point now = clock::now();
+            clock::time_point next = clock::time_point::max();
+
+            for (auto const& item : _Endpoints)
+            {
+                if (!item.second.Idle.empty())
+                    next = std::min(next, item.second.Idle.back().ReleaseTime + IdleTimeout);
+            }
+
+            if (next == clock::time_point::max())
+                return std::chrono::milliseconds(-1);
+
+            if (next <= now)
+                return std::chrono::milliseconds(0);
+
+            return std::chrono::duration_cast<std::chrono::milliseconds>(next - now) + std::chrono::milliseconds(1);
+        }
+
+        size_t GetIdleCount(IPv4::IPv4Addr const& addr) const
+        {
+            Endpoint const* endpoint = _FindEndpoint(addr);
+            return endpoint == nullptr ? 0 : endpoint->Idle.size();
+        }
+
+        size_t GetTotalCount(IPv4::IPv4Addr const& addr) const
+        {
+            Endpoint const* endpoint = _FindEndpoint(addr);
+            return endpoint == nullptr ? 0 : endpoint->Total;
+        }
+
+        void Clear()
+        {
+            for (auto it = _Endpoints.begin(); it != _Endpoints.end();)
+            {
+                it->second.Total -= it->second.Idle.size();
+                it->second.Idle.clear();
+
+                if (it->second.Total == 0)
+                    it = _Endpoints.erase(it);
+                else
+                    ++it;
+            }
+        }
+    };
+
+    /****
+     * ConnectionPool implementation
+     ****/
+
+    ConnectionPool::ConnectionPool() :
+        _Impl(new ConnectionPoolImpl)
+    {}
+
+    ConnectionPool::ConnectionPool(ConnectionPool&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    ConnectionPool& ConnectionPool::operator=(ConnectionPool&& other) noexcept
+    {
+        ConnectionPoolImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    ConnectionPool::~ConnectionPool()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    void ConnectionPool::SetLimits(size_t max_idle, size_t max_total)
+    {
+        _Impl->MaxTotal = std::max<size_t>(max_total, 1);
+        _Impl->MaxIdle = std::min(max_idle, _Impl->MaxTotal);
+    }
+
+    void ConnectionPool::SetIdleTimeout(std::chrono::milliseconds timeout)
+    {
+        _Impl->IdleTimeout = timeout;
+    }
+
+    NetworkLibrary::Error ConnectionPool::WarmUp(IPv4::IPv4Addr const& addr, size_t count, std::chrono::milliseconds timeout, size_t& opened_count)
+    {
+        return _Impl->WarmUp(addr, count, timeout, opened_count);
+    }
+
+    NetworkLibrary::Error ConnectionPool::Acquire(IPv4::IPv4Addr const& addr, IPv4::TCP& connection, bool& reused)
+    {
+        return _Impl->Acquire(addr, connection, reused);
+    }
+
+    void ConnectionPool::Release(IPv4::IPv4Addr const& addr, IPv4::TCP& connection, bool reusable)
+    {
+        _Impl->Release(addr, connection, reusable);
+    }
+
+    size_t ConnectionPool::EvictIdle()
+    {
+        return _Impl->EvictIdle();
+    }
+
+    std::chrono::milliseconds ConnectionPool::GetNextEvictionTimeout() const
+    {
+        return _Impl->GetNextEvictionTimeout();
+    }
+
+    size_t ConnectionPool::GetIdleCount(IPv4::IPv4Addr const& addr) const
+    {
+        return _Impl->GetIdleCount(addr);
+    }
+
+    size_t ConnectionPool::GetTotalCount(IPv4::IPv4Addr const& addr) const
+    {
+        return _Impl->GetTotalCount(addr);
+    }
+
+    void ConnectionPool::Clear()
+    {
+        _Impl->Clear();
+    }
+}
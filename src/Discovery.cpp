@@ -0,0 +1,500 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/Discovery.h>
+#include "internals/internal_socket.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+namespace NetworkLibrary {
+
+    namespace Beacon {
+        // "NLDB", version, flags, service port, instance id, payload size, then the payload. Big endian.
+        static constexpr uint8_t Magic[4] = { 'N', 'L', 'D', 'B' };
+        static constexpr uint8_t Version = 1;
+        static constexpr size_t HeaderSize = 18;
+        static constexpr size_t FlagsOffset = 5;
+
+        static constexpr uint8_t FlagQuery = 0x01;
+        static constexpr uint8_t FlagGoodbye = 0x02;
+
+        // Open() and RefreshInterfaces() query twice, in case the first one is lost.
+        static constexpr int QueryCount = 2;
+        static constexpr std::chrono::milliseconds QueryRetryDelay(250);
+
+        static void Write16(uint8_t* buffer, uint16_t value)
+        {
+            buffer[0] = static_cast<uint8_t>(value >> 8);
+            buffer[1] = static_cast<uint8_t>(value);
+        }
+
+        static uint16_t Read16(uint8_t const* buffer)
+        {
+            return static_cast<uint16_t>((buffer[0] << 8) | buffer[1]);
+        }
+
+        static void Write64(uint8_t* buffer, uint64_t value)
+        {
+            for (int i = 7; i >= 0; --i, value >>= 8)
+                buffer[i] = static_cast<uint8_t>(value);
+        }
+
+        static uint64_t Read64(uint8_t const* buffer)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < 8; ++i)
+                value = (value << 8) | buffer[i];
+
+            return value;
+        }
+    }
+
+    SOCKET_HIDE_CLASS(class) DiscoveryServiceImpl
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct Peer
+        {
+            DiscoveryPeer Infos;
+            clock::time_point LastSeen;
+        };
+
+        IPv4::UDP _Socket;
+        uint16_t _Port;
+        // The directed broadcast address of each interface, with the discovery port.
+        std::vector<IPv4::IPv4Addr> _Destinations;
+        std::unordered_map<uint64_t, Peer> _Peers;
+        // The beacon is built once, only its flags change between the rounds.
+        std::vector<uint8_t> _Beacon;
+        uint64_t _InstanceId;
+        DiscoveryService::Callback _Callback;
+        std::mt19937_64 _Random;
+
+        std::chrono::milliseconds _Interval;
+        std::chrono::milliseconds _PeerTimeout;
+        std::chrono::milliseconds _ReplyDelay;
+        clock::time_point _NextRound;
+        clock::time_point _LastRound;
+        int _QueriesLeft;
+
+        clock::duration _Jitter(clock::duration max)
+        {
+            if (max <= clock::duration::zero())
+                return clock::duration::zero();
+
+            return clock::duration(std::uniform_int_distribution<clock::rep>(0, max.count())(_Random));
+        }
+
+        // Moves the next round sooner, but never closer than the reply delay to the last one.
+        void _Schedule(clock::time_point at)
+        {
+            _NextRound = std::min(_NextRound, std::max(at, _LastRound + _ReplyDelay));
+        }
+
+        void _SendRound(uint8_t flags, clock::time_point now)
+        {
+            _Beacon[Beacon::FlagsOffset] = flags;
+            for (auto const& destination : _Destinations)
+            {
+                NetBuffer net_buffer{ _Beacon.data(), _Beacon.size() };
+                _Socket.SendTo(destination, net_buffer);
+            }
+
+            _LastRound = now;
+        }
+
+        void _OnBeacon(uint8_t const* buffer, size_t size, IPv4::IPv4Addr const& from, clock::time_point now, std::vector<DiscoveryEvent>& events)
+        {
+            if (size < Beacon::HeaderSize || memcmp(buffer, Beacon::Magic, sizeof(Beacon::Magic)) != 0 || buffer[4] != Beacon::Version)
+                return;
+
+            const uint8_t flags = buffer[Beacon::FlagsOffset];
+            const uint16_t service_port = Beacon::Read16(buffer + 6);
+            const uint64_t instance_id = Beacon::Read64(buffer + 8);
+            const size_t payload_size = Beacon::Read16(buffer + 16);
+
+            // Our own beacons come back from the broadcasts.
+            if (instance_id == _InstanceId || payload_size > DiscoveryService::MaxPayloadSize || Beacon::HeaderSize + payload_size != size)
+                return;
+
+            auto it = _Peers.find(instance_id);
+            if (flags & Beacon::FlagGoodbye)
+            {
+                if (it != _Peers.end())
+                {
+                    events.emplace_back(DiscoveryEvent{ DiscoveryEvent::PeerLost, std::move(it->second.Infos) });
+                    _Peers.erase(it);
+                }
+                return;
+            }
+
+            uint8_t const* payload = buffer + Beacon::HeaderSize;
+            if (it == _Peers.end())
+            {
+                Peer& peer = _Peers[instance_id];
+                peer.Infos.InstanceId = instance_id;
+                peer.Infos.Addr = from;
+                peer.Infos.Addr.SetPort(service_port);
+                peer.Infos.Payload.assign(payload, payload + payload_size);
+                peer.LastSeen = now;
+                events.emplace_back(DiscoveryEvent{ DiscoveryEvent::PeerFound, peer.Infos });
+            }
+            else
+            {
+                // The same peer heard from another interface keeps its first address.
+                Peer& peer = it->second;
+                peer.LastSeen = now;
+                if (peer.Infos.Addr.GetPort() != service_port || peer.Infos.Payload.size() != payload_size || !std::equal(payload, payload + payload_size, peer.Infos.Payload.begin()))
+                {
+                    peer.Infos.Addr.SetPort(service_port);
+                    peer.Infos.Payload.assign(payload, payload + payload_size);
+                    events.emplace_back(DiscoveryEvent{ DiscoveryEvent::PeerUpdated, peer.Infos });
+                }
+            }
+
+            if (flags & Beacon::FlagQuery)
+                _Schedule(now + _Jitter(_ReplyDelay));
+        }
+
+    public:
+        DiscoveryServiceImpl() :
+            _Port(0),
+            _Beacon(Beacon::HeaderSize),
+            _InstanceId(0),
+            _Random(std::random_device{}()),
+            _Interval(5000),
+            _PeerTimeout(16000),
+            _ReplyDelay(50),
+            _QueriesLeft(0)
+        {
+            memcpy(_Beacon.data(), Beacon::Magic, sizeof(Beacon::Magic));
+            _Beacon[4] = Beacon::Version;
+        }
+
+        NetworkLibrary::Error SetAnnouncement(uint16_t service_port, const void* payload, size_t payload_size)
+        {
+            if (payload_size > DiscoveryService::MaxPayloadSize || (payload == nullptr && payload_size != 0))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            _Beacon.resize(Beacon::HeaderSize + payload_size);
+            Beacon::Write16(&_Beacon[6], service_port);
+            Beacon::Write16(&_Beacon[16], static_cast<uint16_t>(payload_size));
+            if (payload_size != 0)
+                memcpy(&_Beacon[Beacon::HeaderSize], payload, payload_size);
+
+            return Internals::MakeNoError();
+        }
+
+        void SetInterval(std::chrono::milliseconds interval)
+        {
+            _Interval = interval;
+        }
+
+        void SetPeerTimeout(std::chrono::milliseconds timeout)
+        {
+            _PeerTimeout = timeout;
+        }
+
+        void SetReplyDelay(std::chrono::milliseconds delay)
+        {
+            _ReplyDelay = delay;
+        }
+
+        NetworkLibrary::Error Open(uint16_t port)
+        {
+            IPv4::IPv4Addr any_addr;
+            NetworkLibrary::Error error;
+
+            Close();
+
+            any_addr.SetAnyAddr();
+            any_addr.SetPort(port);
+            if ((error = _Socket.CreateSocket()).ErrorCode != Error::NoError ||
+                // Every socket bound on the port receives the broadcasts, Apple needs SO_REUSEPORT for it.
+                (error = _Socket.SetOption<Options::ReuseAddr>(true)).ErrorCode != Error::NoError ||
+#if defined(SOCKET_OS_APPLE)
+                (error = _Socket.SetOption<Options::ReusePort>(true)).ErrorCode != Error::NoError ||
+#endif
+                (error = _Socket.SetOption<Options::Broadcast>(true)).ErrorCode != Error::NoError ||
+                (error = _Socket.Bind(any_addr)).ErrorCode != Error::NoError ||
+                (error = _Socket.SetNonBlocking(true)).ErrorCode != Error::NoError)
+            {
+                _Socket.Close();
+                return error;
+            }
+
+            _Port = port;
+            do
+            {
+                _InstanceId = _Random();
+            } while (_InstanceId == 0);
+            Beacon::Write64(&_Beacon[8], _InstanceId);
+
+            _LastRound = clock::time_point();
+            _NextRound = clock::time_point::max();
+            if ((error = RefreshInterfaces()).ErrorCode != Error::NoError)
+            {
+                _Socket.Close();
+                return error;
+            }
+
+            // The first query goes out right away, the jitter is on the replies.
+            _QueriesLeft = Beacon::QueryCount - 1;
+            _SendRound(Beacon::FlagQuery, clock::now());
+            _NextRound = _LastRound + Beacon::QueryRetryDelay;
+            return error;
+        }
+
+        void Close()
+        {
+            if (_Socket.IsOpen())
+                _SendRound(Beacon::FlagGoodbye, clock::now());
+
+            _Socket.Close();
+            _Destinations.clear();
+            _Peers.clear();
+            _QueriesLeft = 0;
+        }
+
+        NetworkLibrary::Error RefreshInterfaces()
+        {
+            auto ifaces = IPv4::GetIfacesAddresses();
+            if (ifaces.first.ErrorCode != Error::NoError)
+                return ifaces.first;
+
+            _Destinations.clear();
+            for (auto const& iface : ifaces.second)
+            {
+                if (!iface.IsUp)
+                    continue;
+
+                for (auto const& iface_addr : iface.Addresses)
+                {
+                    IPv4::IPv4Addr addr;
+                    // /31 and /32 have no broadcast address.
+                    if (iface_addr.MaskCIDR > 30 || addr.FromString(iface_addr.Addr).ErrorCode != Error::NoError)
+                        continue;
+
+                    addr.SetIPv4(addr.GetIPv4() | (iface_addr.MaskCIDR == 0 ? 0xffffffff : (0xffffffff >> iface_addr.MaskCIDR)));
+                    addr.SetPort(_Port);
+                    _Destinations.emplace_back(addr);
+                }
+            }
+
+            // Several addresses of the same subnet share their broadcast address.
+            std::sort(_Destinations.begin(), _Destinations.end(), [](IPv4::IPv4Addr const& a, IPv4::IPv4Addr const& b) { return a.GetIPv4() < b.GetIPv4(); });
+            _Destinations.erase(std::unique(_Destinations.begin(), _Destinations.end(), [](IPv4::IPv4Addr const& a, IPv4::IPv4Addr const& b) { return a.GetIPv4() == b.GetIPv4(); }), _Destinations.end());
+
+            if (_Destinations.empty())
+            {
+                IPv4::IPv4Addr addr;
+                addr.SetBroadcastAddr();
+                addr.SetPort(_Port);
+                _Destinations.emplace_back(addr);
+            }
+
+            if (_Socket.IsOpen())
+            {
+                _QueriesLeft = Beacon::QueryCount;
+                _Schedule(clock::now());
+            }
+
+            return Internals::MakeNoError();
+        }
+
+        void SetCallback(DiscoveryService::Callback callback)
+        {
+            _Callback = std::move(callback);
+        }
+
+        size_t Process()
+        {
+            std::vector<DiscoveryEvent> events;
+            uint8_t buffer[2048];
+            IPv4::IPv4Addr from;
+            clock::time_point now = clock::now();
+
+            if (!_Socket.IsOpen())
+                return 0;
+
+            for (;;)
+            {
+                NetBuffer net_buffer{ buffer, sizeof(buffer) };
+                if (_Socket.ReceiveFrom(from, net_buffer).ErrorCode != Error::NoError)
+                    break;
+
+                _OnBeacon(buffer, net_buffer.BufferSize, from, now, events);
+            }
+
+            for (auto it = _Peers.begin(); it != _Peers.end();)
+            {
+                if (now - it->second.LastSeen < _PeerTimeout)
+                {
+                    ++it;
+                    continue;
+                }
+
+                events.emplace_back(DiscoveryEvent{ DiscoveryEvent::PeerLost, std::move(it->second.Infos) });
+                it = _Peers.erase(it);
+            }
+
+            if (_NextRound <= now)
+            {
+                if (_QueriesLeft > 0)
+                {
+                    --_QueriesLeft;
+                    _SendRound(Beacon::FlagQuery, now);
+                    _NextRound = now + Beacon::QueryRetryDelay;
+                }
+                else
+                {
+                    _SendRound(0, now);
+                    _NextRound = now + _Interval - _Jitter(_Interval / 4);
+                }
+            }
+
+            if (_Callback)
+            {
+                for (auto const& event : events)
+                    _Callback(event);
+            }
+
+            return events.size();
+        }
+
+        BasicSocket const& GetPollSocket() const
+        {
+            return _Socket;
+        }
+
+        std::chrono::milliseconds GetNextTimeout() const
+        {
+            clock::time_point now = clock::now();
+            clock::time_point next = _NextRound;
+
+            if (!_Socket.IsOpen())
+                return std::chrono::milliseconds(-1);
+
+            for (auto const& item : _Peers)
+                next = std::min(next, item.second.LastSeen + _PeerTimeout);
+
+            if (next <= now)
+                return std::chrono::milliseconds(0);
+
+            return std::chrono::duration_cast<std::chrono::milliseconds>(next - now) + std::chrono::milliseconds(1);
+        }
+
+        std::vector<DiscoveryPeer> GetPeers() const
+        {
+            std::vector<DiscoveryPeer> peers;
+            peers.reserve(_Peers.size());
+            for (auto const& item : _Peers)
+                peers.emplace_back(item.second.Infos);
+
+            return peers;
+        }
+    };
+
+    /****
+     * DiscoveryService implementation
+     ****/
+
+    DiscoveryService::DiscoveryService() :
+        _Impl(new DiscoveryServiceImpl)
+    {}
+
+    DiscoveryService::DiscoveryService(DiscoveryService&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    DiscoveryService& DiscoveryService::operator=(DiscoveryService&& other) noexcept
+    {
+        DiscoveryServiceImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    DiscoveryService::~DiscoveryService()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    NetworkLibrary::Error DiscoveryService::SetAnnouncement(uint16_t service_port, const void* payload, size_t payload_size)
+    {
+        return _Impl->SetAnnouncement(service_port, payload, payload_size);
+    }
+
+    void DiscoveryService::SetInterval(std::chrono::milliseconds interval)
+    {
+        _Impl->SetInterval(interval);
+    }
+
+    void DiscoveryService::SetPeerTimeout(std::chrono::milliseconds timeout)
+    {
+        _Impl->SetPeerTimeout(timeout);
+    }
+
+    void DiscoveryService::SetReplyDelay(std::chrono::milliseconds delay)
+    {
+        _Impl->SetReplyDelay(delay);
+    }
+
+    NetworkLibrary::Error DiscoveryService::Open(uint16_t port)
+    {
+        return _Impl->Open(port);
+    }
+
+    void DiscoveryService::Close()
+    {
+        _Impl->Close();
+    }
+
+    NetworkLibrary::Error DiscoveryService::RefreshInterfaces()
+    {
+        return _Impl->RefreshInterfaces();
+    }
+
+    void DiscoveryService::SetCallback(Callback callback)
+    {
+        _Impl->SetCallback(std::move(callback));
+    }
+
+    size_t DiscoveryService::Process()
+    {
+        return _Impl->Process();
+    }
+
+    BasicSocket const& DiscoveryService::GetPollSocket() const
+    {
+        return _Impl->GetPollSocket();
+    }
+
+    std::chrono::milliseconds DiscoveryService::GetNextTimeout() const
+    {
+        return _Impl->GetNextTimeout();
+    }
+
+    std::vector<DiscoveryPeer> DiscoveryService::GetPeers() const
+    {
+        return _Impl->GetPeers();
+    }
+}
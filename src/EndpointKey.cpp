@@ -0,0 +1,93 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/EndpointKey.h>
+#include "internals/internal_socket.h"
+
+namespace NetworkLibrary {
+
+    static void _SetIPv4Key(EndpointKey& key, sockaddr_in const& addr)
+    {
+        memset(key.Addr, 0, 10);
+        key.Addr[10] = 0xff;
+        key.Addr[11] = 0xff;
+        memcpy(&key.Addr[12], &addr.sin_addr, 4);
+        key.ScopeId = 0;
+        key.Port = Internals::Endian::NetSwap(addr.sin_port);
+        key.Family = AF_INET;
+    }
+
+    static void _SetIPv6Key(EndpointKey& key, sockaddr_in6 const& addr)
+    {
+        memcpy(key.Addr, &addr.sin6_addr, 16);
+        key.ScopeId = addr.sin6_scope_id;
+        key.Port = Internals::Endian::NetSwap(addr.sin6_port);
+        key.Family = AF_INET6;
+    }
+
+    /****
+     * EndpointKey implementation
+     ****/
+
+    // The qualified GetAddr() calls skip the virtual dispatch, the key is built on each received datagram.
+    EndpointKey::EndpointKey(IPv4::IPv4Addr const& addr) noexcept
+    {
+        _SetIPv4Key(*this, *reinterpret_cast<sockaddr_in const*>(addr.IPv4::IPv4Addr::GetAddr()));
+    }
+
+    EndpointKey::EndpointKey(IPv6::IPv6Addr const& addr) noexcept
+    {
+        _SetIPv6Key(*this, *reinterpret_cast<sockaddr_in6 const*>(addr.IPv6::IPv6Addr::GetAddr()));
+    }
+
+    NetworkLibrary::Error EndpointKey::FromAddr(BasicAddr const& addr) noexcept
+    {
+        switch (addr.GetFamily())
+        {
+            case AF_INET : _SetIPv4Key(*this, *reinterpret_cast<sockaddr_in const*>(addr.GetAddr())); break;
+            case AF_INET6: _SetIPv6Key(*this, *reinterpret_cast<sockaddr_in6 const*>(addr.GetAddr())); break;
+            default: return Internals::MakeErrorFromSocketCode(Error::InVal);
+        }
+
+        return Internals::MakeNoError();
+    }
+
+    NetworkLibrary::Error EndpointKey::ToAddr(IPv4::IPv4Addr& addr) const noexcept
+    {
+        sockaddr_in* native = reinterpret_cast<sockaddr_in*>(addr.IPv4::IPv4Addr::GetAddr());
+
+        if (Family != AF_INET)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        memcpy(&native->sin_addr, &Addr[12], 4);
+        native->sin_port = Internals::Endian::NetSwap(Port);
+        return Internals::MakeNoError();
+    }
+
+    NetworkLibrary::Error EndpointKey::ToAddr(IPv6::IPv6Addr& addr) const noexcept
+    {
+        sockaddr_in6* native = reinterpret_cast<sockaddr_in6*>(addr.IPv6::IPv6Addr::GetAddr());
+
+        if (Family != AF_INET6)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        memcpy(&native->sin6_addr, Addr, 16);
+        native->sin6_scope_id = ScopeId;
+        native->sin6_port = Internals::Endian::NetSwap(Port);
+        return Internals::MakeNoError();
+    }
+}
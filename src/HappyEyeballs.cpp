@@ -0,0 +1,410 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/HappyEyeballs.h>
+#include "internals/internal_socket.h"
+
+#include <algorithm>
+
+namespace NetworkLibrary {
+
+    SOCKET_HIDE_CLASS(class) HappyEyeballsImpl
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct Candidate
+        {
+            bool IsIPv6;
+            size_t Index; // Index in the family address list.
+        };
+
+        struct Attempt
+        {
+            size_t Candidate;
+            ConnectedSocket* Socket;
+        };
+
+        std::vector<IPv4::IPv4Addr> _IPv4Addrs;
+        std::vector<IPv6::IPv6Addr> _IPv6Addrs;
+        std::vector<Candidate> _Candidates;
+        std::vector<size_t> _Order;
+        // Attempts point in these vectors, they are allocated by Start and not resized until the race ends.
+        std::vector<IPv4::TCP> _IPv4Sockets;
+        std::vector<IPv6::TCP> _IPv6Sockets;
+        std::vector<Attempt> _Attempts;
+        std::vector<pollfd> _PollFds;
+        NetworkLibrary::Error _LastError;
+        clock::time_point _NextAttempt;
+        clock::time_point _Deadline;
+        size_t _NextCandidate;
+        bool _Running;
+
+        // Returns NoError if the candidate connected right away, InProgress if it is now an attempt, the error if it failed.
+        NetworkLibrary::Error _StartAttempt(size_t candidate_index, clock::time_point now)
+        {
+            Candidate const& candidate = _Candidates[candidate_index];
+            ConnectedSocket* socket;
+            NetworkLibrary::Error error;
+
+            if (candidate.IsIPv6)
+            {
+                socket = &_IPv6Sockets[candidate.Index];
+                error = _IPv6Sockets[candidate.Index].CreateSocket();
+            }
+            else
+            {
+                socket = &_IPv4Sockets[candidate.Index];
+                error = _IPv4Sockets[candidate.Index].CreateSocket();
+            }
+
+            if (error.ErrorCode == Error::NoError)
+                error = socket->SetNonBlocking(true);
+
+            if (error.ErrorCode == Error::NoError)
+            {
+                if (candidate.IsIPv6)
+                    error = socket->Connect(_IPv6Addrs[candidate.Index]);
+                else
+                    error = socket->Connect(_IPv4Addrs[candidate.Index]);
+            }
+
+            _NextAttempt = now + AttemptDelay;
+            if (error.ErrorCode == Error::NoError)
+                return error;
+
+            if (error.ErrorCode == Error::InProgress || error.ErrorCode == Error::WouldBlock)
+            {
+                _Attempts.emplace_back(Attempt{ candidate_index, socket });
+                _PollFds.emplace_back(pollfd{ static_cast<Internals::NativeSocket::socket_t>(socket->GetNativeFd()), POLLOUT, 0 });
+                return Internals::MakeErrorFromSocketCode(Error::InProgress);
+            }
+
+            // Failed right away, try the next candidate now.
+            socket->Close();
+            _LastError = error;
+            _NextAttempt = now;
+            return error;
+        }
+
+        NetworkLibrary::Error _Win(size_t candidate_index, IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate)
+        {
+            Candidate const& candidate = _Candidates[candidate_index];
+
+            out_ipv4.Close();
+            out_ipv6.Close();
+            if (candidate.IsIPv6)
+            {
+                out_ipv6 = std::move(_IPv6Sockets[candidate.Index]);
+                if (!NonBlocking)
+                    out_ipv6.SetNonBlocking(false);
+            }
+            else
+            {
+                out_ipv4 = std::move(_IPv4Sockets[candidate.Index]);
+                if (!NonBlocking)
+                    out_ipv4.SetNonBlocking(false);
+            }
+
+            Cancel();
+            out_candidate = candidate_index;
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+    public:
+        std::chrono::milliseconds AttemptDelay;
+        bool NonBlocking;
+
+        HappyEyeballsImpl() :
+            _NextCandidate(0),
+            _Running(false),
+            AttemptDelay(250),
+            NonBlocking(false)
+        {}
+
+        void AddCandidate(IPv4::IPv4Addr const& addr)
+        {
+            _Candidates.emplace_back(Candidate{ false, _IPv4Addrs.size() });
+            _IPv4Addrs.emplace_back(addr);
+        }
+
+        void AddCandidate(IPv6::IPv6Addr const& addr)
+        {
+            _Candidates.emplace_back(Candidate{ true, _IPv6Addrs.size() });
+            _IPv6Addrs.emplace_back(addr);
+        }
+
+        void ClearCandidates()
+        {
+            Cancel();
+            _IPv4Addrs.clear();
+            _IPv6Addrs.clear();
+            _Candidates.clear();
+        }
+
+        size_t GetCandidateCount() const
+        {
+            return _Candidates.size();
+        }
+
+        // RFC 8305 section 4: interleave the address families, starting with the preferred one (IPv6).
+        std::vector<size_t> SortCandidates() const
+        {
+            std::vector<size_t> ipv4, ipv6, sorted;
+
+            for (size_t i = 0; i < _Candidates.size(); ++i)
+                (_Candidates[i].IsIPv6 ? ipv6 : ipv4).emplace_back(i);
+
+            sorted.reserve(_Candidates.size());
+            for (size_t i = 0; i < std::max(ipv4.size(), ipv6.size()); ++i)
+            {
+                if (i < ipv6.size())
+                    sorted.emplace_back(ipv6[i]);
+
+                if (i < ipv4.size())
+                    sorted.emplace_back(ipv4[i]);
+            }
+
+            return sorted;
+        }
+
+        NetworkLibrary::Error Start(std::chrono::milliseconds timeout)
+        {
+            Cancel();
+            if (_Candidates.empty())
+                return Internals::MakeErrorFromSocketCode(Error::NotFound);
+
+            _Order = SortCandidates();
+            _IPv4Sockets.resize(_IPv4Addrs.size());
+            _IPv6Sockets.resize(_IPv6Addrs.size());
+            _Attempts.reserve(_Order.size());
+            _PollFds.reserve(_Order.size());
+            _LastError = Internals::MakeErrorFromSocketCode(Error::NotFound);
+            _NextCandidate = 0;
+            _NextAttempt = clock::now();
+            _Deadline = _NextAttempt + timeout;
+            _Running = true;
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        void Cancel()
+        {
+            _Attempts.clear();
+            _PollFds.clear();
+            // Closes the attempts that didn't win.
+            _IPv4Sockets.clear();
+            _IPv6Sockets.clear();
+            _Running = false;
+        }
+
+        NetworkLibrary::Error Process(IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate)
+        {
+            if (!_Running)
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            if (!_PollFds.empty() && Internals::poll(_PollFds.data(), _PollFds.size(), 0) > 0)
+            {
+                for (size_t i = 0; i < _PollFds.size();)
+                {
+                    if (_PollFds[i].revents == 0)
+                    {
+                        ++i;
+                        continue;
+                    }
+
+                    NetworkLibrary::Error error = _Attempts[i].Socket->GetPendingError();
+                    if (error.ErrorCode == Error::NoError)
+                        return _Win(_Attempts[i].Candidate, out_ipv4, out_ipv6, out_candidate);
+
+                    // This attempt failed, start the next one without waiting for the delay.
+                    _Attempts[i].Socket->Close();
+                    _Attempts.erase(_Attempts.begin() + i);
+                    _PollFds.erase(_PollFds.begin() + i);
+                    _LastError = error;
+                    _NextAttempt = clock::now();
+                }
+            }
+
+            clock::time_point now = clock::now();
+            if (now >= _Deadline)
+            {
+                Cancel();
+                return Internals::MakeErrorFromSocketCode(Error::TimedOut);
+            }
+
+            while (_NextCandidate < _Order.size() && (_Attempts.empty() || now >= _NextAttempt))
+            {
+                size_t candidate_index = _Order[_NextCandidate++];
+                NetworkLibrary::Error error = _StartAttempt(candidate_index, now);
+                if (error.ErrorCode == Error::NoError)
+                    return _Win(candidate_index, out_ipv4, out_ipv6, out_candidate);
+            }
+
+            if (_Attempts.empty())
+            {
+                Cancel();
+                return _LastError;
+            }
+
+            return Internals::MakeErrorFromSocketCode(Error::InProgress);
+        }
+
+        std::vector<BasicSocket const*> GetPollSockets() const
+        {
+            std::vector<BasicSocket const*> sockets;
+
+            sockets.reserve(_Attempts.size());
+            for (auto const& attempt : _Attempts)
+                sockets.emplace_back(attempt.Socket);
+
+            return sockets;
+        }
+
+        std::chrono::milliseconds GetNextTimeout() const
+        {
+            if (!_Running)
+                return std::chrono::milliseconds(-1);
+
+            clock::time_point now = clock::now();
+            clock::time_point wake_up = _Deadline;
+            if (_NextCandidate < _Order.size())
+                wake_up = std::min(wake_up, _NextAttempt);
+
+            if (wake_up <= now)
+                return std::chrono::milliseconds(0);
+
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(wake_up - now);
+            // Round up, don't spin on sub-millisecond waits.
+            if (wake_up - now > wait)
+                wait += std::chrono::milliseconds(1);
+
+            return wait;
+        }
+
+        bool IsRunning() const
+        {
+            return _Running;
+        }
+
+        NetworkLibrary::Error Connect(std::chrono::milliseconds timeout, IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate)
+        {
+            NetworkLibrary::Error error = Start(timeout);
+
+            out_ipv4.Close();
+            out_ipv6.Close();
+            if (error.ErrorCode != Error::NoError)
+                return error;
+
+            while ((error = Process(out_ipv4, out_ipv6, out_candidate)).ErrorCode == Error::InProgress)
+                Internals::poll(_PollFds.data(), _PollFds.size(), static_cast<int>(GetNextTimeout().count()));
+
+            return error;
+        }
+
+    };
+
+    /****
+     * HappyEyeballs implementation
+     ****/
+
+    HappyEyeballs::HappyEyeballs() :
+        _Impl(new HappyEyeballsImpl)
+    {}
+
+    HappyEyeballs::HappyEyeballs(HappyEyeballs&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    HappyEyeballs& HappyEyeballs::operator=(HappyEyeballs&& other) noexcept
+    {
+        HappyEyeballsImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    HappyEyeballs::~HappyEyeballs()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    void HappyEyeballs::AddCandidate(IPv4::IPv4Addr const& addr)
+    {
+        _Impl->AddCandidate(addr);
+    }
+
+    void HappyEyeballs::AddCandidate(IPv6::IPv6Addr const& addr)
+    {
+        _Impl->AddCandidate(addr);
+    }
+
+    void HappyEyeballs::ClearCandidates()
+    {
+        _Impl->ClearCandidates();
+    }
+
+    size_t HappyEyeballs::GetCandidateCount() const
+    {
+        return _Impl->GetCandidateCount();
+    }
+
+    void HappyEyeballs::SetAttemptDelay(std::chrono::milliseconds delay)
+    {
+        _Impl->AttemptDelay = std::min(std::max(delay, std::chrono::milliseconds(10)), std::chrono::milliseconds(2000));
+    }
+
+    void HappyEyeballs::SetNonBlocking(bool non_blocking)
+    {
+        _Impl->NonBlocking = non_blocking;
+    }
+
+    NetworkLibrary::Error HappyEyeballs::Start(std::chrono::milliseconds timeout)
+    {
+        return _Impl->Start(timeout);
+    }
+
+    NetworkLibrary::Error HappyEyeballs::Process(IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate)
+    {
+        return _Impl->Process(out_ipv4, out_ipv6, out_candidate);
+    }
+
+    std::vector<BasicSocket const*> HappyEyeballs::GetPollSockets() const
+    {
+        return _Impl->GetPollSockets();
+    }
+
+    std::chrono::milliseconds HappyEyeballs::GetNextTimeout() const
+    {
+        return _Impl->GetNextTimeout();
+    }
+
+    bool HappyEyeballs::IsRunning() const
+    {
+        return _Impl->IsRunning();
+    }
+
+    void HappyEyeballs::Cancel()
+    {
+        _Impl->Cancel();
+    }
+
+    NetworkLibrary::Error HappyEyeballs::Connect(std::chrono::milliseconds timeout, IPv4::TCP& out_ipv4, IPv6::TCP& out_ipv6, size_t& out_candidate)
+    {
+        return _Impl->Connect(timeout, out_ipv4, out_ipv6, out_candidate);
+    }
+}
@@ -17,6 +17,8 @@
 
 #include <NetworkLibrary/IPv4.h>
 #include "internals/internal_socket.h"
+#include "internals/socket_template.h"
+#include "internals/internal_address.h"
 
 namespace NetworkLibrary {
 namespace IPv4 {
@@ -76,6 +78,7 @@ namespace IPv4 {
                 {
                     IfaceInfos infos;
                     infos.IsUp = pAdapterAddress->OperStatus == IfOperStatusUp;
+                    infos.Index = pAdapterAddress->IfIndex;
                     infos.Name = pAdapterAddress->AdapterName;
                     infos.FriendlyName = Internals::WCharToString(pAdapterAddress->FriendlyName);
                     infos.Description = Internals::WCharToString(pAdapterAddress->Description);
@@ -130,10 +133,12 @@ namespace IPv4 {
 
         for (pIface = ifaces_list; pIface != nullptr; pIface = pIface->ifa_next)
         {
-            if (pIface->ifa_addr->sa_family == _AddressFamily)
+            // Interfaces without an address (like tunnels that are down) have a null ifa_addr.
+            if (pIface->ifa_addr != nullptr && pIface->ifa_addr->sa_family == _AddressFamily)
             {
                 IfaceInfos infos;
                 infos.IsUp = (pIface->ifa_flags & IFF_UP) == IFF_UP;
+                infos.Index = if_nametoindex(pIface->ifa_name);
                 infos.Name = pIface->ifa_name;
                 infos.FriendlyName = pIface->ifa_name;
                 //infos.Description = ;
@@ -187,35 +192,25 @@ namespace IPv4 {
             _SockAddr.sin_family = _AddressFamily;
         }
 
-        IPv4AddrImpl(IPv4AddrImpl const& other) :
-            _SockAddr()
-        {
-            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
-        }
-
-        IPv4AddrImpl& operator=(IPv4AddrImpl const& other)
+        size_t ToString(char* buffer, size_t buffer_size, bool with_port) const
         {
-            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
-            return *this;
-        }
-
-        IPv4AddrImpl(IPv4AddrImpl&& other) noexcept = delete;
-        IPv4AddrImpl& operator=(IPv4AddrImpl&& other) noexcept = delete;
-
-        std::string ToString(bool with_port) const
-        {
-            std::string res;
-            NetworkLibrary::Internals::inet_ntop(reinterpret_cast<const sockaddr*>(&_SockAddr), res);
+            char text[IPv4Addr::MaxStringSize];
+            size_t length = Internals::FormatIPv4(GetIPv4(), text);
             if (with_port)
             {
-                res.push_back(':');
-                res += std::to_string(Internals::Endian::NetSwap(_SockAddr.sin_port));
+                text[length++] = ':';
+                length += Internals::FormatPort(GetPort(), text + length);
             }
 
-            return res;
+            if (buffer == nullptr || buffer_size <= length)
+                return 0;
+
+            memcpy(buffer, text, length);
+            buffer[length] = 0;
+            return length;
         }
 
-        int GetFamily()
+        int GetFamily() const
         {
             return _AddressFamily;
         }
@@ -235,34 +230,27 @@ namespace IPv4 {
             return sizeof(my_sockaddr_t);
         }
 
-        NetworkLibrary::Error FromString(std::string str)
+        NetworkLibrary::Error FromString(const char* str, size_t length)
         {
-            if (str.empty())
-                return Internals::MakeErrorFromSocketCode(Error::InVal);
+            const char* port_str = str == nullptr ? nullptr : reinterpret_cast<const char*>(memchr(str, ':', length));
+            size_t ip_length = port_str == nullptr ? length : static_cast<size_t>(port_str - str);
+            uint16_t port = 0;
+            uint32_t ip;
 
-            size_t pos = str.find(':');
-            uint32_t port;
+            if (str == nullptr || length == 0)
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
 
-            if (pos != std::string::npos)
-            {
-                str[pos] = 0;
-                port = static_cast<uint32_t>(strtoul(&str[pos + 1], nullptr, 10));
-                if (port == 0 || port > 65535u)
-                {
-                    return Internals::MakeErrorFromSocketCode(Error::InVal);
-                }
-            }
+            if (port_str != nullptr && !Internals::ParsePort(port_str + 1, length - ip_length - 1, port))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
 
-            NetworkLibrary::Error error = NetworkLibrary::Internals::inet_pton(&str[0], reinterpret_cast<sockaddr*>(&_SockAddr));
-            if (error.ErrorCode != NetworkLibrary::Error::NoError)
-                return error;
+            if (!Internals::ParseIPv4(str, ip_length, ip))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
 
-            if (pos != std::string::npos)
-            {
-                SetPort(static_cast<uint16_t>(port));
-            }
+            SetIPv4(ip);
+            if (port_str != nullptr)
+                SetPort(port);
 
-            return error;
+            return Internals::MakeNoError();
         }
 
         void SetIPv4(uint32_t ip)
@@ -301,103 +289,101 @@ namespace IPv4 {
         }
     };
 
-    IPv4Addr::IPv4Addr(): _Impl(new IPv4AddrImpl)
-    {}
+    static_assert(sizeof(IPv4AddrImpl) <= sizeof(std::aligned_storage<16, 4>::type) && alignof(IPv4AddrImpl) <= 4, "IPv4Addr storage is too small.");
+    static_assert(std::is_trivially_copyable<IPv4AddrImpl>::value, "IPv4AddrImpl must be trivially copyable.");
 
-    IPv4Addr::IPv4Addr(IPv4Addr const& other):
-        _Impl(new IPv4AddrImpl(*other._Impl))
-    {}
-
-    IPv4Addr::IPv4Addr(IPv4Addr&& other) noexcept:
-        _Impl(other._Impl)
+    IPv4AddrImpl& IPv4Addr::_Impl()
     {
-        other._Impl = nullptr;
+        return *reinterpret_cast<IPv4AddrImpl*>(&_Storage);
     }
 
-    IPv4Addr& IPv4Addr::operator=(IPv4Addr const& other)
+    IPv4AddrImpl const& IPv4Addr::_Impl() const
     {
-        IPv4AddrImpl* tmp(new IPv4AddrImpl(*other._Impl));
-        delete _Impl;
-        _Impl = tmp;
-        return *this;
+        return *reinterpret_cast<IPv4AddrImpl const*>(&_Storage);
     }
 
-    IPv4Addr& IPv4Addr::operator=(IPv4Addr&& other) noexcept
+    IPv4Addr::IPv4Addr()
     {
-        IPv4AddrImpl* tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-        return *this;
+        new (&_Storage) IPv4AddrImpl;
     }
 
     IPv4Addr::~IPv4Addr()
+    {}
+
+    std::string IPv4Addr::ToString(bool with_port) const
     {
-        delete _Impl;
+        char buffer[MaxStringSize];
+        return std::string(buffer, _Impl().ToString(buffer, sizeof(buffer), with_port));
     }
 
-    std::string IPv4Addr::ToString(bool with_port) const
+    size_t IPv4Addr::ToString(char* buffer, size_t buffer_size, bool with_port) const
     {
-        return _Impl->ToString(with_port);
+        return _Impl().ToString(buffer, buffer_size, with_port);
     }
 
     int IPv4Addr::GetFamily() const
     {
-        return _Impl->GetFamily();
+        return _Impl().GetFamily();
     }
 
     void* IPv4Addr::GetAddr()
     {
-        return _Impl->GetAddr();
+        return _Impl().GetAddr();
     }
 
     const void* IPv4Addr::GetAddr() const
     {
-        return _Impl->GetAddr();
+        return _Impl().GetAddr();
     }
 
     size_t IPv4Addr::GetLength() const
     {
-        return _Impl->GetLength();
+        return _Impl().GetLength();
     }
 
-    NetworkLibrary::Error IPv4Addr::FromString(std::string str)
+    NetworkLibrary::Error IPv4Addr::FromString(std::string const& str)
     {
-        return _Impl->FromString(str);
+        return _Impl().FromString(str.c_str(), str.length());
+    }
+
+    NetworkLibrary::Error IPv4Addr::FromString(const char* str, size_t length)
+    {
+        return _Impl().FromString(str, length);
     }
 
     void IPv4Addr::SetIPv4(uint32_t ip)
     {
-        _Impl->SetIPv4(ip);
+        _Impl().SetIPv4(ip);
     }
 
     void IPv4Addr::SetPort(uint16_t port)
     {
-        _Impl->SetPort(port);
+        _Impl().SetPort(port);
     }
 
     uint32_t IPv4Addr::GetIPv4() const
     {
-        return _Impl->GetIPv4();
+        return _Impl().GetIPv4();
     }
 
     uint16_t IPv4Addr::GetPort() const
     {
-        return _Impl->GetPort();
+        return _Impl().GetPort();
     }
 
     void IPv4Addr::SetAnyAddr()
     {
-        _Impl->SetAnyAddr();
+        _Impl().SetAnyAddr();
     }
 
     void IPv4Addr::SetLoopbackAddr()
     {
-        _Impl->SetLoopbackAddr();
+        _Impl().SetLoopbackAddr();
     }
 
     void IPv4Addr::SetBroadcastAddr()
     {
-        _Impl->SetBroadcastAddr();
+        _Impl().SetBroadcastAddr();
     }
 
     /****************************************
@@ -405,82 +391,59 @@ namespace IPv4 {
      * TCP implementation
      *
      ****************************************/
-    TCP::TCP()
-    {}
-
-    TCP::TCP(TCP&& other) noexcept
-    {
-        _Impl = other._Impl;
-
-        other._Impl = nullptr;
-    }
-
-    TCP& TCP::operator=(TCP&& other) noexcept
-    {
-        auto tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-
-        return *this;
-    }
-
-    NetworkLibrary::Error TCP::CreateSocket()
+    struct TCPTraits::Native
     {
-        return _Impl->CreateSocket(
-            (Internals::AddressFamily)_AddressFamily,
-            (Internals::SocketTypes)_TypeTCP,
-            (Internals::SocketProtocols)_ProtoTCP);
-    }
+        static constexpr int Family = _AddressFamily;
+        static constexpr int Type   = _TypeTCP;
+        static constexpr int Proto  = _ProtoTCP;
+    };
 
-    NetworkLibrary::Error TCP::GetSockName(IPv4Addr& out_addr)
+    NetworkLibrary::Error TCP::GetTcpInfo(TcpInfo& out_info) const
     {
-        return Internals::getsockname(*_Impl, out_addr);
+        return Internals::gettcpinfo(_Impl(), out_info);
     }
 
-    int TCP::GetFamily() const { return _AddressFamily; }
-    int TCP::GetType  () const { return _TypeTCP; }
-    int TCP::GetProto () const { return _ProtoTCP; }
-
     /****************************************
      *
      * UDP implementation
      *
      ****************************************/
-    UDP::UDP()
-    {}
-
-    UDP::UDP(UDP&& other) noexcept
+    struct UDPTraits::Native
     {
-        _Impl = other._Impl;
+        static constexpr int Family = _AddressFamily;
+        static constexpr int Type   = _TypeUDP;
+        static constexpr int Proto  = _ProtoUDP;
+    };
 
-        other._Impl = nullptr;
+    NetworkLibrary::Error UDP::JoinGroup(IPv4Addr const& group, uint32_t iface_index)
+    {
+        return Internals::multicastmembership(_Impl(), group, nullptr, iface_index, true);
     }
 
-    UDP& UDP::operator=(UDP&& other) noexcept
+    NetworkLibrary::Error UDP::LeaveGroup(IPv4Addr const& group, uint32_t iface_index)
     {
-        auto tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-
-        return *this;
+        return Internals::multicastmembership(_Impl(), group, nullptr, iface_index, false);
     }
 
-    NetworkLibrary::Error UDP::CreateSocket()
+    NetworkLibrary::Error UDP::JoinSourceGroup(IPv4Addr const& group, IPv4Addr const& source, uint32_t iface_index)
     {
-        return _Impl->CreateSocket(
-            (Internals::AddressFamily)_AddressFamily,
-            (Internals::SocketTypes)_TypeUDP,
-            (Internals::SocketProtocols)_ProtoUDP);
+        return Internals::multicastmembership(_Impl(), group, &source, iface_index, true);
     }
 
-    NetworkLibrary::Error UDP::GetSockName(IPv4Addr& out_addr)
+    NetworkLibrary::Error UDP::LeaveSourceGroup(IPv4Addr const& group, IPv4Addr const& source, uint32_t iface_index)
     {
-        return Internals::getsockname(*_Impl, out_addr);
+        return Internals::multicastmembership(_Impl(), group, &source, iface_index, false);
     }
 
-    int UDP::GetFamily() const { return _AddressFamily; }
-    int UDP::GetType  () const { return _TypeUDP; }
-    int UDP::GetProto () const { return _ProtoUDP; }
+    NetworkLibrary::Error UDP::SetMulticastInterface(uint32_t iface_index)
+    {
+        return Internals::setmulticastiface(_Impl(), _AddressFamily, iface_index);
+    }
 }
 
-}
\ No newline at end of file
+template class SocketTemplateIO<IPv4::TCPTraits>;
+template class SocketTemplateIO<IPv4::UDPTraits>;
+template class SocketTemplate<IPv4::TCPTraits>;
+template class SocketTemplate<IPv4::UDPTraits>;
+
+}
@@ -17,6 +17,8 @@
 
 #include <NetworkLibrary/IPv6.h>
 #include "internals/internal_socket.h"
+#include "internals/socket_template.h"
+#include "internals/internal_address.h"
 
 namespace NetworkLibrary {
 namespace IPv6 {
@@ -77,6 +79,7 @@ namespace IPv6 {
                 {
                     IfaceInfos infos;
                     infos.IsUp = pAdapterAddress->OperStatus == IfOperStatusUp;
+                    infos.Index = pAdapterAddress->Ipv6IfIndex;
                     infos.Name = pAdapterAddress->AdapterName;
                     infos.FriendlyName = Internals::WCharToString(pAdapterAddress->FriendlyName);
                     infos.Description = Internals::WCharToString(pAdapterAddress->Description);
@@ -130,10 +133,12 @@ namespace IPv6 {
 
         for (pIface = ifaces_list; pIface != nullptr; pIface = pIface->ifa_next)
         {
-            if (pIface->ifa_addr->sa_family == _AddressFamily)
+            // Interfaces without an address (like tunnels that are down) have a null ifa_addr.
+            if (pIface->ifa_addr != nullptr && pIface->ifa_addr->sa_family == _AddressFamily)
             {
                 IfaceInfos infos;
                 infos.IsUp = (pIface->ifa_flags & IFF_UP) == IFF_UP;
+                infos.Index = if_nametoindex(pIface->ifa_name);
                 infos.Name = pIface->ifa_name;
                 infos.FriendlyName = pIface->ifa_name;
                 //infos.Description = ;
@@ -189,32 +194,31 @@ namespace IPv6 {
             _SockAddr.sin6_family = _AddressFamily;
         }
 
-        IPv6AddrImpl(IPv6AddrImpl const& other) :
-            _SockAddr()
+        size_t ToString(char* buffer, size_t buffer_size, bool with_port) const
         {
-            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
-        }
+            char text[IPv6Addr::MaxStringSize];
+            size_t length = 0;
 
-        IPv6AddrImpl& operator=(IPv6AddrImpl const& other)
-        {
-            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
-            return *this;
-        }
+            if (with_port)
+                text[length++] = '[';
 
-        IPv6AddrImpl(IPv6AddrImpl&& other) noexcept = delete;
-        IPv6AddrImpl& operator=(IPv6AddrImpl&& other) noexcept = delete;
+            length += Internals::FormatIPv6(reinterpret_cast<uint8_t const*>(&_SockAddr.sin6_addr), text + length);
+            if (_SockAddr.sin6_scope_id != 0)
+                length += Internals::FormatScopeId(_SockAddr.sin6_scope_id, text + length);
 
-        std::string ToString(bool with_port) const
-        {
-            std::string res;
-            NetworkLibrary::Internals::inet_ntop(reinterpret_cast<const sockaddr*>(&_SockAddr), res);
             if (with_port)
             {
-                res.insert(res.begin(), '[');
-                res += "]:" + std::to_string(Internals::Endian::NetSwap(_SockAddr.sin6_port));
+                text[length++] = ']';
+                text[length++] = ':';
+                length += Internals::FormatPort(GetPort(), text + length);
             }
 
-            return res;
+            if (buffer == nullptr || buffer_size <= length)
+                return 0;
+
+            memcpy(buffer, text, length);
+            buffer[length] = 0;
+            return length;
         }
 
         void* GetAddr()
@@ -237,64 +241,64 @@ namespace IPv6 {
             return sizeof(my_sockaddr_t);
         }
 
-        NetworkLibrary::Error FromString(std::string str)
+        NetworkLibrary::Error FromString(const char* str, size_t length)
         {
-            if (str.empty())
+            const char* str_end = str + length;
+            const char* port_str = nullptr;
+            size_t ip_length = length;
+            uint8_t ip[16];
+            uint32_t scope_id;
+            uint16_t port = 0;
+
+            if (str == nullptr || length == 0)
                 return Internals::MakeErrorFromSocketCode(Error::InVal);
 
-            size_t pos = std::string::npos;
-            uint32_t port;
-            char* ip = &str[0];
-
             if (str[0] == '[')
-            {
-                if ((pos = str.rfind(':')) == std::string::npos || str[pos - 1] != ']')
+            {// [ip%zone] or [ip%zone]:port
+                const char* end = reinterpret_cast<const char*>(memchr(str, ']', length));
+                if (end == nullptr)
                     return Internals::MakeErrorFromSocketCode(Error::InVal);
 
-                ++ip;
-                str[pos - 1] = '\0';
-                port = static_cast<uint32_t>(strtoul(&str[pos + 1], nullptr, 10));
-                if (port == 0 || port > 65535u)
+                ++str;
+                ip_length = static_cast<size_t>(end - str);
+                if (end + 1 != str_end)
                 {
-                    return Internals::MakeErrorFromSocketCode(Error::InVal);
+                    if (end[1] != ':')
+                        return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+                    port_str = end + 2;
                 }
             }
             else
-            {
+            {// ip:port is only accepted with the 8 groups written, it is ambiguous otherwise.
                 int count = 0;
-                for (int i = 0; i < str.length(); ++i)
+                for (size_t i = 0; i < length; ++i)
                 {
                     if (str[i] == ':')
                     {
-                        pos = i;
+                        ip_length = i;
                         ++count;
                     }
                 }
+
                 if (count == 8)
-                {
-                    str[pos] = '\0';
-                    port = static_cast<uint32_t>(strtoul(&str[pos + 1], nullptr, 10));
-                    if (port == 0 || port > 65535u)
-                    {
-                        return Internals::MakeErrorFromSocketCode(Error::InVal);
-                    }
-                }
+                    port_str = str + ip_length + 1;
                 else
-                {
-                    pos = std::string::npos;
-                }
+                    ip_length = length;
             }
 
-            NetworkLibrary::Error error = NetworkLibrary::Internals::inet_pton(ip, reinterpret_cast<sockaddr*>(&_SockAddr));
-            if (error.ErrorCode != NetworkLibrary::Error::NoError)
-                return error;
+            if (port_str != nullptr && !Internals::ParsePort(port_str, static_cast<size_t>(str_end - port_str), port))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
 
-            if (pos != std::string::npos)
-            {
-                SetPort(static_cast<uint16_t>(port));
-            }
+            if (!Internals::ParseIPv6(str, ip_length, ip, scope_id))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            memcpy(&_SockAddr.sin6_addr, ip, sizeof(ip));
+            _SockAddr.sin6_scope_id = scope_id;
+            if (port_str != nullptr)
+                SetPort(port);
 
-            return error;
+            return Internals::MakeNoError();
         }
 
         void SetIPv6(InAddr6 ip)
@@ -335,100 +339,96 @@ namespace IPv6 {
         }
     };
 
-    IPv6Addr::IPv6Addr():
-        _Impl(new IPv6AddrImpl)
-    {}
-
-    IPv6Addr::IPv6Addr(IPv6Addr const& other):
-        _Impl(new IPv6AddrImpl(*other._Impl))
-    {}
+    static_assert(sizeof(IPv6AddrImpl) <= sizeof(std::aligned_storage<28, 4>::type) && alignof(IPv6AddrImpl) <= 4, "IPv6Addr storage is too small.");
+    static_assert(std::is_trivially_copyable<IPv6AddrImpl>::value, "IPv6AddrImpl must be trivially copyable.");
 
-    IPv6Addr::IPv6Addr(IPv6Addr&& other) noexcept :
-        _Impl(nullptr)
+    IPv6AddrImpl& IPv6Addr::_Impl()
     {
-        _Impl = other._Impl;
-        other._Impl = nullptr;
+        return *reinterpret_cast<IPv6AddrImpl*>(&_Storage);
     }
 
-    IPv6Addr& IPv6Addr::operator=(IPv6Addr const& other)
+    IPv6AddrImpl const& IPv6Addr::_Impl() const
     {
-        IPv6AddrImpl* tmp = new IPv6AddrImpl(*other._Impl);
-        delete _Impl;
-        _Impl = tmp;
-        return *this;
+        return *reinterpret_cast<IPv6AddrImpl const*>(&_Storage);
     }
 
-    IPv6Addr& IPv6Addr::operator=(IPv6Addr&& other) noexcept
+    IPv6Addr::IPv6Addr()
     {
-        IPv6AddrImpl* tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-        return *this;
+        new (&_Storage) IPv6AddrImpl;
     }
 
     IPv6Addr::~IPv6Addr()
+    {}
+
+    std::string IPv6Addr::ToString(bool with_port) const
     {
-        delete _Impl;
+        char buffer[MaxStringSize];
+        return std::string(buffer, _Impl().ToString(buffer, sizeof(buffer), with_port));
     }
 
-    std::string IPv6Addr::ToString(bool with_port) const
+    size_t IPv6Addr::ToString(char* buffer, size_t buffer_size, bool with_port) const
     {
-        return _Impl->ToString(with_port);
+        return _Impl().ToString(buffer, buffer_size, with_port);
     }
 
     void* IPv6Addr::GetAddr()
     {
-        return _Impl->GetAddr();
+        return _Impl().GetAddr();
     }
 
     const void* IPv6Addr::GetAddr() const
     {
-        return _Impl->GetAddr();
+        return _Impl().GetAddr();
     }
 
     int IPv6Addr::GetFamily() const
     {
-        return _Impl->GetFamily();
+        return _Impl().GetFamily();
     }
 
     size_t IPv6Addr::GetLength() const
     {
-        return _Impl->GetLength();
+        return _Impl().GetLength();
     }
 
-    NetworkLibrary::Error IPv6Addr::FromString(std::string str)
+    NetworkLibrary::Error IPv6Addr::FromString(std::string const& str)
     {
-        return _Impl->FromString(str);
+        return _Impl().FromString(str.c_str(), str.length());
+    }
+
+    NetworkLibrary::Error IPv6Addr::FromString(const char* str, size_t length)
+    {
+        return _Impl().FromString(str, length);
     }
 
     void IPv6Addr::SetIPv6(InAddr6 ip)
     {
-        _Impl->SetIPv6(ip);
+        _Impl().SetIPv6(ip);
     }
 
     void IPv6Addr::SetPort(uint16_t port)
     {
-        _Impl->SetPort(port);
+        _Impl().SetPort(port);
     }
 
     InAddr6 IPv6Addr::GetIPv6() const
     {
-        return _Impl->GetIPv6();
+        return _Impl().GetIPv6();
     }
 
     uint16_t IPv6Addr::GetPort() const
     {
-        return _Impl->GetPort();
+        return _Impl().GetPort();
     }
 
     void IPv6Addr::SetAnyAddr()
     {
-        _Impl->SetAnyAddr();
+        _Impl().SetAnyAddr();
     }
 
     void IPv6Addr::SetLoopbackAddr()
     {
-        _Impl->SetLoopbackAddr();
+        _Impl().SetLoopbackAddr();
     }
 
     /****************************************
@@ -436,82 +436,59 @@ namespace IPv6 {
      * TCP implementation
      *
      ****************************************/
-    TCP::TCP()
-    {}
-
-    TCP::TCP(TCP&& other) noexcept
+    struct TCPTraits::Native
     {
-        _Impl = other._Impl;
-
-        other._Impl = nullptr;
-    }
-
-    TCP& TCP::operator=(TCP&& other) noexcept
-    {
-        auto tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-
-        return *this;
-    }
-
-    NetworkLibrary::Error TCP::CreateSocket()
-    {
-        return _Impl->CreateSocket(
-            (Internals::AddressFamily)_AddressFamily,
-            (Internals::SocketTypes)_TypeTCP,
-            (Internals::SocketProtocols)_ProtoTCP);
-    }
+        static constexpr int Family = _AddressFamily;
+        static constexpr int Type   = _TypeTCP;
+        static constexpr int Proto  = _ProtoTCP;
+    };
 
-    NetworkLibrary::Error TCP::GetSockName(IPv6Addr& out_addr)
+    NetworkLibrary::Error TCP::GetTcpInfo(TcpInfo& out_info) const
     {
-        return Internals::getsockname(*_Impl, out_addr);
+        return Internals::gettcpinfo(_Impl(), out_info);
     }
 
-    int TCP::GetFamily() const { return _AddressFamily; }
-    int TCP::GetType  () const { return _TypeTCP; }
-    int TCP::GetProto () const { return _ProtoTCP; }
-
     /****************************************
      *
      * UDP implementation
      *
      ****************************************/
-    UDP::UDP()
-    {}
-
-    UDP::UDP(UDP&& other) noexcept
+    struct UDPTraits::Native
     {
-        _Impl = other._Impl;
+        static constexpr int Family = _AddressFamily;
+        static constexpr int Type   = _TypeUDP;
+        static constexpr int Proto  = _ProtoUDP;
+    };
 
-        other._Impl = nullptr;
+    NetworkLibrary::Error UDP::JoinGroup(IPv6Addr const& group, uint32_t iface_index)
+    {
+        return Internals::multicastmembership(_Impl(), group, nullptr, iface_index, true);
     }
 
-    UDP& UDP::operator=(UDP&& other) noexcept
+    NetworkLibrary::Error UDP::LeaveGroup(IPv6Addr const& group, uint32_t iface_index)
     {
-        auto tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-
-        return *this;
+        return Internals::multicastmembership(_Impl(), group, nullptr, iface_index, false);
     }
 
-    NetworkLibrary::Error UDP::CreateSocket()
+    NetworkLibrary::Error UDP::JoinSourceGroup(IPv6Addr const& group, IPv6Addr const& source, uint32_t iface_index)
     {
-        return _Impl->CreateSocket(
-            (Internals::AddressFamily)_AddressFamily,
-            (Internals::SocketTypes)_TypeUDP,
-            (Internals::SocketProtocols)_ProtoUDP);
+        return Internals::multicastmembership(_Impl(), group, &source, iface_index, true);
     }
 
-    NetworkLibrary::Error UDP::GetSockName(IPv6Addr& out_addr)
+    NetworkLibrary::Error UDP::LeaveSourceGroup(IPv6Addr const& group, IPv6Addr const& source, uint32_t iface_index)
     {
-        return Internals::getsockname(*_Impl, out_addr);
+        return Internals::multicastmembership(_Impl(), group, &source, iface_index, false);
     }
 
-    int UDP::GetFamily() const { return _AddressFamily; }
-    int UDP::GetType  () const { return _TypeUDP; }
-    int UDP::GetProto () const { return _ProtoUDP; }
+    NetworkLibrary::Error UDP::SetMulticastInterface(uint32_t iface_index)
+    {
+        return Internals::setmulticastiface(_Impl(), _AddressFamily, iface_index);
+    }
 }
 
-}
\ No newline at end of file
+template class SocketTemplateIO<IPv6::TCPTraits>;
+template class SocketTemplateIO<IPv6::UDPTraits>;
+template class SocketTemplate<IPv6::TCPTraits>;
+template class SocketTemplate<IPv6::UDPTraits>;
+
+}
@@ -0,0 +1,385 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/InterfaceMonitor.h>
+#include "internals/internal_socket.h"
+
+#include <algorithm>
+
+#if defined(SOCKET_OS_LINUX)
+    #include <linux/netlink.h>
+    #include <linux/rtnetlink.h>
+#endif
+
+namespace NetworkLibrary {
+
+#if defined(SOCKET_OS_LINUX)
+    static constexpr int _FamilyNetlink = AF_NETLINK;
+    static constexpr int _TypeNetlink = SOCK_RAW;
+    static constexpr int _ProtoNetlink = NETLINK_ROUTE;
+#else
+    static constexpr int _FamilyNetlink = AF_UNSPEC;
+    static constexpr int _TypeNetlink = 0;
+    static constexpr int _ProtoNetlink = 0;
+#endif
+
+    // Only there to hand the netlink socket to a Poll.
+    SOCKET_HIDE_CLASS(class) NetlinkSocket final :
+        public BasicSocket
+    {
+    public:
+        virtual int GetFamily() const { return _FamilyNetlink; }
+        virtual int GetType  () const { return _TypeNetlink; }
+        virtual int GetProto () const { return _ProtoNetlink; }
+
+        Internals::NativeSocket& Native() { return _Impl(); }
+        Internals::NativeSocket const& Native() const { return _Impl(); }
+    };
+
+    SOCKET_HIDE_CLASS(class) InterfaceMonitorImpl
+    {
+        NetlinkSocket _Socket;
+        std::vector<InterfaceAddress> _Addresses;
+        // Netlink messages are read whole, a truncated one is lost.
+        std::vector<uint8_t> _Buffer;
+        InterfaceMonitor::Callback _Callback;
+        uint32_t _Sequence;
+
+        static bool _IsSame(InterfaceAddress const& a, InterfaceAddress const& b)
+        {
+            return a.Addr == b.Addr && a.IfaceIndex == b.IfaceIndex && a.PrefixLength == b.PrefixLength;
+        }
+
+        static bool _Contains(std::vector<InterfaceAddress> const& addresses, InterfaceAddress const& address)
+        {
+            return std::find_if(addresses.begin(), addresses.end(), [&address](InterfaceAddress const& item) { return _IsSame(item, address); }) != addresses.end();
+        }
+
+        void _Notify(InterfaceEvent::Type type, InterfaceAddress const& address)
+        {
+            if (_Callback)
+                _Callback(InterfaceEvent{ type, address });
+        }
+
+#if defined(SOCKET_OS_LINUX)
+        // Fills address from a RTM_NEWADDR/RTM_DELADDR message, false for the families we don't handle.
+        static bool _ParseAddress(nlmsghdr const* header, InterfaceAddress& address)
+        {
+            ifaddrmsg const* message = reinterpret_cast<ifaddrmsg const*>(NLMSG_DATA(header));
+            int attributes_length = static_cast<int>(IFA_PAYLOAD(header));
+            void const* local = nullptr;
+            void const* peer = nullptr;
+
+            if (header->nlmsg_len < NLMSG_LENGTH(sizeof(ifaddrmsg)) || (message->ifa_family != AF_INET && message->ifa_family != AF_INET6))
+                return false;
+
+            for (rtattr const* attribute = IFA_RTA(message); RTA_OK(attribute, attributes_length); attribute = RTA_NEXT(attribute, attributes_length))
+            {
+                size_t expected = message->ifa_family == AF_INET ? 4 : 16;
+                if (RTA_PAYLOAD(attribute) != expected)
+                    continue;
+
+                if (attribute->rta_type == IFA_LOCAL)
+                    local = RTA_DATA(attribute);
+                else if (attribute->rta_type == IFA_ADDRESS)
+                    peer = RTA_DATA(attribute);
+            }
+
+            // On point to point links IFA_ADDRESS is the remote end, IFA_LOCAL is ours.
+            if (local == nullptr && (local = peer) == nullptr)
+                return false;
+
+            if (message->ifa_family == AF_INET)
+            {
+                IPv4::IPv4Addr addr;
+                memcpy(&reinterpret_cast<sockaddr_in*>(addr.GetAddr())->sin_addr, local, 4);
+                address.Addr = EndpointKey(addr);
+            }
+            else
+            {
+                IPv6::IPv6Addr addr;
+                sockaddr_in6* native_addr = reinterpret_cast<sockaddr_in6*>(addr.GetAddr());
+                memcpy(&native_addr->sin6_addr, local, 16);
+                if (message->ifa_scope == RT_SCOPE_LINK)
+                    native_addr->sin6_scope_id = message->ifa_index;
+
+                address.Addr = EndpointKey(addr);
+            }
+
+            address.IfaceIndex = message->ifa_index;
+            address.PrefixLength = message->ifa_prefixlen;
+            return true;
+        }
+
+        // Reads the addresses with a RTM_GETADDR dump, on its own socket so it doesn't mix with the notifications.
+        NetworkLibrary::Error _Dump(std::vector<InterfaceAddress>& addresses)
+        {
+            Internals::NativeSocket dump_socket;
+            struct
+            {
+                nlmsghdr Header;
+                ifaddrmsg Message;
+            } request{};
+            const uint32_t sequence = ++_Sequence;
+
+            addresses.clear();
+            dump_socket.Socket = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+            if (!dump_socket.IsValid())
+                return Internals::LastError();
+
+            request.Header.nlmsg_len = NLMSG_LENGTH(sizeof(ifaddrmsg));
+            request.Header.nlmsg_type = RTM_GETADDR;
+            request.Header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+            request.Header.nlmsg_seq = sequence;
+            request.Message.ifa_family = AF_UNSPEC;
+            if (::send(dump_socket.Socket, &request, request.Header.nlmsg_len, 0) < 0)
+                return Internals::LastError();
+
+            while (true)
+            {
+                ssize_t length = ::recv(dump_socket.Socket, _Buffer.data(), _Buffer.size(), 0);
+                if (length < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    return Internals::LastError();
+                }
+
+                int remaining = static_cast<int>(length);
+                for (nlmsghdr const* header = reinterpret_cast<nlmsghdr const*>(_Buffer.data()); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining))
+                {
+                    if (header->nlmsg_seq != sequence)
+                        continue;
+
+                    if (header->nlmsg_type == NLMSG_DONE)
+                        return Internals::MakeNoError();
+
+                    if (header->nlmsg_type == NLMSG_ERROR)
+                        return Internals::MakeErrorFromNative(-reinterpret_cast<nlmsgerr const*>(NLMSG_DATA(header))->error);
+
+                    InterfaceAddress address;
+                    if (header->nlmsg_type == RTM_NEWADDR && _ParseAddress(header, address) && !_Contains(addresses, address))
+                        addresses.emplace_back(address);
+                }
+            }
+        }
+
+        // Takes the snapshot again and reports the differences, after the kernel dropped notifications.
+        size_t _Resync()
+        {
+            std::vector<InterfaceAddress> previous;
+            size_t changes = 0;
+
+            if (_Dump(previous).ErrorCode != Error::NoError)
+                return 0;
+
+            previous.swap(_Addresses);
+            for (auto const& address : previous)
+            {
+                if (!_Contains(_Addresses, address))
+                {
+                    _Notify(InterfaceEvent::AddressRemoved, address);
+                    ++changes;
+                }
+            }
+
+            for (auto const& address : _Addresses)
+            {
+                if (!_Contains(previous, address))
+                {
+                    _Notify(InterfaceEvent::AddressAdded, address);
+                    ++changes;
+                }
+            }
+
+            return changes;
+        }
+
+        size_t _Apply(nlmsghdr const* header)
+        {
+            InterfaceAddress address;
+
+            if ((header->nlmsg_type != RTM_NEWADDR && header->nlmsg_type != RTM_DELADDR) || !_ParseAddress(header, address))
+                return 0;
+
+            auto it = std::find_if(_Addresses.begin(), _Addresses.end(), [&address](InterfaceAddress const& item) { return _IsSame(item, address); });
+            if (header->nlmsg_type == RTM_NEWADDR)
+            {// Flags updates (like the end of IPv6 duplicate address detection) are sent as RTM_NEWADDR too.
+                if (it != _Addresses.end())
+                    return 0;
+
+                _Addresses.emplace_back(address);
+                _Notify(InterfaceEvent::AddressAdded, address);
+            }
+            else
+            {
+                if (it == _Addresses.end())
+                    return 0;
+
+                _Addresses.erase(it);
+                _Notify(InterfaceEvent::AddressRemoved, address);
+            }
+
+            return 1;
+        }
+#endif
+
+    public:
+        InterfaceMonitorImpl() :
+            _Sequence(0)
+        {}
+
+        NetworkLibrary::Error Open()
+        {
+#if defined(SOCKET_OS_LINUX)
+            Internals::NativeSocket& native = _Socket.Native();
+            sockaddr_nl addr{};
+            NetworkLibrary::Error error;
+
+            native.Close();
+            _Buffer.resize(32 * 1024);
+            native.Socket = ::socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+            if (!native.IsValid())
+                return Internals::LastError();
+
+            // Subscribed before the dump, so no change is missed in between.
+            addr.nl_family = AF_NETLINK;
+            addr.nl_groups = RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+            if (::bind(native.Socket, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) != 0)
+            {
+                error = Internals::LastError();
+                native.Close();
+                return error;
+            }
+
+            if ((error = _Dump(_Addresses)).ErrorCode != Error::NoError)
+                native.Close();
+
+            return error;
+#else
+            return Internals::MakeErrorFromSocketCode(Error::NotSupported);
+#endif
+        }
+
+        void SetCallback(InterfaceMonitor::Callback callback)
+        {
+            _Callback = std::move(callback);
+        }
+
+        size_t Process()
+        {
+            size_t changes = 0;
+
+#if defined(SOCKET_OS_LINUX)
+            Internals::NativeSocket& native = _Socket.Native();
+
+            while (native.IsValid())
+            {
+                sockaddr_nl sender{};
+                socklen_t sender_length = sizeof(sender);
+                ssize_t length = ::recvfrom(native.Socket, _Buffer.data(), _Buffer.size(), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&sender), &sender_length);
+                if (length < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    if (errno == ENOBUFS)
+                    {// The kernel dropped notifications.
+                        changes += _Resync();
+                        continue;
+                    }
+
+                    break;
+                }
+
+                // Only trust the kernel, other processes can send to our port id.
+                if (sender.nl_pid != 0)
+                    continue;
+
+                int remaining = static_cast<int>(length);
+                for (nlmsghdr const* header = reinterpret_cast<nlmsghdr const*>(_Buffer.data()); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining))
+                    changes += _Apply(header);
+            }
+#endif
+
+            return changes;
+        }
+
+        BasicSocket const& GetPollSocket() const
+        {
+            return _Socket;
+        }
+
+        std::vector<InterfaceAddress> const& GetAddresses() const
+        {
+            return _Addresses;
+        }
+    };
+
+    /****
+     * InterfaceMonitor implementation
+     ****/
+
+    InterfaceMonitor::InterfaceMonitor() :
+        _Impl(new InterfaceMonitorImpl)
+    {}
+
+    InterfaceMonitor::InterfaceMonitor(InterfaceMonitor&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    InterfaceMonitor& InterfaceMonitor::operator=(InterfaceMonitor&& other) noexcept
+    {
+        InterfaceMonitorImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    InterfaceMonitor::~InterfaceMonitor()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    NetworkLibrary::Error InterfaceMonitor::Open()
+    {
+        return _Impl->Open();
+    }
+
+    void InterfaceMonitor::SetCallback(Callback callback)
+    {
+        _Impl->SetCallback(std::move(callback));
+    }
+
+    size_t InterfaceMonitor::Process()
+    {
+        return _Impl->Process();
+    }
+
+    BasicSocket const& InterfaceMonitor::GetPollSocket() const
+    {
+        return _Impl->GetPollSocket();
+    }
+
+    std::vector<InterfaceAddress> const& InterfaceMonitor::GetAddresses() const
+    {
+        return _Impl->GetAddresses();
+    }
+}
@@ -0,0 +1,207 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/LatencyHistogram.h>
+#include "internals/internal_latency.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+    #include <intrin.h>
+#endif
+
+namespace NetworkLibrary {
+
+    static inline uint32_t HighestBit(uint64_t value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long bit;
+        _BitScanReverse64(&bit, value);
+        return static_cast<uint32_t>(bit);
+#else
+        uint32_t bit = 0;
+        while (value >>= 1)
+            ++bit;
+
+        return bit;
+#endif
+    }
+
+    LatencyHistogram::LatencyHistogram() :
+        _Buckets(BucketCount, 0),
+        _Count(0),
+        _Sum(0),
+        _Min(std::numeric_limits<uint64_t>::max()),
+        _Max(0)
+    {}
+
+    size_t LatencyHistogram::BucketIndex(uint64_t nanoseconds) noexcept
+    {
+        const uint64_t sub_bucket_count = uint64_t(1) << SubBucketBits;
+        if (nanoseconds < sub_bucket_count)
+            return static_cast<size_t>(nanoseconds);
+
+        if ((nanoseconds >> MaxValueBits) != 0)
+            return BucketCount - 1;
+
+        // The top SubBucketBits + 1 bits select the bucket, the lower ones are the bucket width.
+        uint32_t shift = HighestBit(nanoseconds) - SubBucketBits;
+        return (static_cast<size_t>(shift + 1) << SubBucketBits) + static_cast<size_t>((nanoseconds >> shift) - sub_bucket_count);
+    }
+
+    uint64_t LatencyHistogram::BucketLowerBound(size_t index) noexcept
+    {
+        const uint64_t sub_bucket_count = uint64_t(1) << SubBucketBits;
+        if (index < sub_bucket_count)
+            return index;
+
+        uint32_t shift = static_cast<uint32_t>(index >> SubBucketBits) - 1;
+        return (sub_bucket_count + (index & (sub_bucket_count - 1))) << shift;
+    }
+
+    uint64_t LatencyHistogram::BucketUpperBound(size_t index) noexcept
+    {
+        if (index < (size_t(1) << SubBucketBits))
+            return index;
+
+        uint32_t shift = static_cast<uint32_t>(index >> SubBucketBits) - 1;
+        return BucketLowerBound(index) + (uint64_t(1) << shift) - 1;
+    }
+
+    void LatencyHistogram::Record(std::chrono::nanoseconds duration)
+    {
+        uint64_t nanoseconds = duration.count() < 0 ? 0 : static_cast<uint64_t>(duration.count());
+
+        ++_Buckets[BucketIndex(nanoseconds)];
+        ++_Count;
+        _Sum += nanoseconds;
+        _Min = std::min(_Min, nanoseconds);
+        _Max = std::max(_Max, nanoseconds);
+    }
+
+    void LatencyHistogram::Merge(LatencyHistogram const& other)
+    {
+        AddRaw(other._Buckets.data(), other._Count, other._Sum, other._Min, other._Max);
+    }
+
+    void LatencyHistogram::AddRaw(uint64_t const* buckets, uint64_t count, uint64_t sum, uint64_t min, uint64_t max)
+    {
+        if (count == 0)
+            return;
+
+        for (size_t i = 0; i < BucketCount; ++i)
+            _Buckets[i] += buckets[i];
+
+        _Count += count;
+        _Sum += sum;
+        _Min = std::min(_Min, min);
+        _Max = std::max(_Max, max);
+    }
+
+    void LatencyHistogram::Reset()
+    {
+        std::fill(_Buckets.begin(), _Buckets.end(), 0);
+        _Count = 0;
+        _Sum = 0;
+        _Min = std::numeric_limits<uint64_t>::max();
+        _Max = 0;
+    }
+
+    uint64_t LatencyHistogram::GetCount() const
+    {
+        return _Count;
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::GetMin() const
+    {
+        return std::chrono::nanoseconds(_Count == 0 ? 0 : _Min);
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::GetMax() const
+    {
+        return std::chrono::nanoseconds(_Max);
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::GetMean() const
+    {
+        return std::chrono::nanoseconds(_Count == 0 ? 0 : _Sum / _Count);
+    }
+
+    std::chrono::nanoseconds LatencyHistogram::GetPercentile(double percentile) const
+    {
+        if (_Count == 0)
+            return std::chrono::nanoseconds(0);
+
+        // The rank is rounded, a ceil would turn 99.9% of 1000 (999.0000000000001) into the 1000th value.
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(_Count) + 0.5), 1);
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BucketCount; ++i)
+        {
+            seen += _Buckets[i];
+            if (seen >= rank)
+            {
+                // The last bucket also holds the durations above its range.
+                uint64_t value = i == BucketCount - 1 ? _Max : std::min(BucketUpperBound(i), _Max);
+                return std::chrono::nanoseconds(std::max(value, _Min));
+            }
+        }
+
+        return std::chrono::nanoseconds(_Max);
+    }
+
+    std::vector<LatencyHistogram::Bucket> LatencyHistogram::GetBuckets() const
+    {
+        std::vector<Bucket> buckets;
+        for (size_t i = 0; i < BucketCount; ++i)
+        {
+            if (_Buckets[i] != 0)
+                buckets.emplace_back(Bucket{ std::chrono::nanoseconds(BucketLowerBound(i)), std::chrono::nanoseconds(BucketUpperBound(i)), _Buckets[i] });
+        }
+
+        return buckets;
+    }
+
+    uint64_t const* LatencyHistogram::GetRawBuckets() const
+    {
+        return _Buckets.data();
+    }
+
+    LatencyHistogram GetProcessLatencyHistogram(int metric)
+    {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        return Internals::GetProcessLatencyHistogram(metric);
+#else
+        (void)metric;
+        return LatencyHistogram();
+#endif
+    }
+
+    LatencyHistogram GetThreadLatencyHistogram(int metric)
+    {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        return Internals::GetThreadLatencyHistogram(metric);
+#else
+        (void)metric;
+        return LatencyHistogram();
+#endif
+    }
+}
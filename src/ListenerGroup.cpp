@@ -0,0 +1,51 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/ListenerGroup.h>
+#include "internals/internal_socket.h"
+
+#if defined(SOCKET_OS_LINUX)
+    #include <linux/filter.h>
+#endif
+
+namespace NetworkLibrary {
+
+    NetworkLibrary::Error AttachReusePortCpuSteering(BasicSocket const& socket, uint32_t group_size)
+    {
+        if (group_size == 0)
+            return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::InVal);
+
+#if defined(SOCKET_OS_LINUX) && defined(SO_ATTACH_REUSEPORT_CBPF)
+        // A = current cpu; A = A % group_size; return A;
+        sock_filter code[] = {
+            { BPF_LD  | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+            { BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size },
+            { BPF_RET | BPF_A          , 0, 0, 0 },
+        };
+        sock_fprog program{ static_cast<unsigned short>(sizeof(code) / sizeof(*code)), code };
+
+        if (::setsockopt(static_cast<int>(socket.GetNativeFd()), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) != 0)
+            return Internals::LastError();
+
+        return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NoError);
+#else
+        (void)socket;
+        return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NotSupported);
+#endif
+    }
+
+}
@@ -0,0 +1,1471 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/Loopback.h>
+#include "internals/internal_socket.h"
+
+#if defined(SOCKET_OS_WINDOWS)
+    #error "Loopback sockets are not supported on Windows."
+#endif
+
+#include <fcntl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace NetworkLibrary {
+namespace Loopback {
+    static constexpr int _TypeLoopbackStream = (int)SOCK_STREAM;
+    static constexpr int _ProtoLoopbackStream = (int)0;
+
+    static constexpr int _TypeLoopbackDgram = (int)SOCK_DGRAM;
+    static constexpr int _ProtoLoopbackDgram = (int)0;
+
+    static constexpr size_t _CacheLineSize = 64;
+    static constexpr size_t _StreamRingSize = 128 * 1024;
+    static constexpr size_t _DgramQueueSize = 1024;
+    static constexpr size_t _MaxDatagramSize = 65507;
+    static constexpr uint32_t _EphemeralPortStart = 0x00010000;
+
+    struct LoopbackSockAddr
+    {
+        uint16_t Family;
+        uint16_t Reserved;
+        uint32_t Port;
+    };
+
+    /****************************************
+     *
+     * Loopback internals
+     *
+     ****************************************/
+
+    ////////////
+    /// @brief The waitable handle of a loopback socket, one end of a socket pair.
+    ///        It is readable while signaled: signaled when its queue goes from empty to non-empty,
+    ///        so a busy queue never touches the kernel.
+    ///        It is writable unless BlockWrites was called: its send direction is then filled up
+    ///        until the consumer frees space in the queue it writes to and calls UnblockWrites.
+    ////////////
+    SOCKET_HIDE_CLASS(class) LoopbackEvent
+    {
+        using socket_t = Internals::NativeSocket::socket_t;
+
+        socket_t _ReadFd;  // The end the socket polls.
+        socket_t _WriteFd; // Signals _ReadFd, receives the bytes filling _ReadFd send buffer.
+        std::atomic<bool> _Signaled;
+        std::atomic<bool> _WritesBlocked;
+
+        static void Drain(socket_t fd)
+        {
+            uint8_t buffer[4096];
+            while (::read(fd, buffer, sizeof(buffer)) > 0)
+            {}
+        }
+
+    public:
+        LoopbackEvent() :
+            _ReadFd(Internals::NativeSocket::invalid_socket),
+            _WriteFd(Internals::NativeSocket::invalid_socket),
+            _Signaled(false),
+            _WritesBlocked(false)
+        {}
+
+        LoopbackEvent(LoopbackEvent const&) = delete;
+        LoopbackEvent(LoopbackEvent&&) = delete;
+        LoopbackEvent& operator=(LoopbackEvent const&) = delete;
+        LoopbackEvent& operator=(LoopbackEvent&&) = delete;
+
+        ~LoopbackEvent()
+        {
+            if (_WriteFd != Internals::NativeSocket::invalid_socket)
+                ::close(_WriteFd);
+
+            if (_ReadFd != Internals::NativeSocket::invalid_socket)
+                ::close(_ReadFd);
+        }
+
+        NetworkLibrary::Error Create()
+        {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+                return Internals::LastError();
+
+            for (int fd : fds)
+            {
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+                ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+
+            // The smallest send buffer the system allows, BlockWrites fills it in a few writes.
+            int buffer_size = 1;
+            ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+            _ReadFd = fds[0];
+            _WriteFd = fds[1];
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        // The socket gets its own handle on the event, so closing it never closes the handle a peer is signaling.
+        NetworkLibrary::Error Duplicate(Internals::NativeSocket& out) const
+        {
+            out.Close();
+            out.Socket = ::fcntl(_ReadFd, F_DUPFD_CLOEXEC, 0);
+            return out.IsValid() ? Internals::MakeErrorFromSocketCode(Error::NoError) : Internals::LastError();
+        }
+
+        void Signal()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!_Signaled.exchange(true, std::memory_order_acq_rel))
+            {
+                uint8_t value = 1;
+                ssize_t written = ::write(_WriteFd, &value, sizeof(value));
+                (void)written;
+            }
+        }
+
+        // The caller must check its queue again after a reset, a producer might have pushed in-between.
+        void Reset()
+        {
+            Drain(_ReadFd);
+            _Signaled.store(false, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        void Wait(int timeout_ms)
+        {
+            pollfd fd{ _ReadFd, POLLIN, 0 };
+            Internals::poll(&fd, 1, timeout_ms);
+        }
+
+        // Called by the socket when the queue it writes to is full. It is filled every time: a concurrent
+        // UnblockWrites may have drained part of a previous fill. The caller must check the queue again after,
+        // the consumer might have freed space before seeing the block.
+        void BlockWrites()
+        {
+            static const uint8_t filler[4096] = {};
+            while (::write(_ReadFd, filler, sizeof(filler)) > 0)
+            {}
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            _WritesBlocked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        // Called by the consumer after freeing space or closing, it only costs a load when writes are not blocked.
+        void UnblockWrites()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_WritesBlocked.load(std::memory_order_relaxed) && _WritesBlocked.exchange(false, std::memory_order_acq_rel))
+                Drain(_WriteFd);
+        }
+    };
+
+    ////////////
+    /// @brief Where a blocking sender waits for the receiver to free space in a full queue.
+    ///        The receiver only takes the mutex when a sender is actually waiting.
+    ////////////
+    SOCKET_HIDE_CLASS(class) LoopbackSpaceWaiter
+    {
+        std::mutex _Mutex;
+        std::condition_variable _Condition;
+        std::atomic<uint32_t> _Waiters;
+
+    public:
+        LoopbackSpaceWaiter() :
+            _Waiters(0)
+        {}
+
+        // ready is checked under the mutex, after the waiter is counted: a Notify can't be missed.
+        template<typename Predicate>
+        void Wait(Predicate ready)
+        {
+            std::unique_lock<std::mutex> lk(_Mutex);
+            _Waiters.fetch_add(1, std::memory_order_seq_cst);
+            _Condition.wait(lk, ready);
+            _Waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Called after freeing space or closing.
+        void Notify()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_Waiters.load(std::memory_order_relaxed) != 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lk(_Mutex);
+                }
+                _Condition.notify_all();
+            }
+        }
+    };
+
+    ////////////
+    /// @brief Single producer, single consumer byte ring buffer.
+    ////////////
+    SOCKET_HIDE_CLASS(class) LoopbackByteRing
+    {
+        std::unique_ptr<uint8_t[]> _Buffer;
+        size_t _Size;
+        char _Pad0[_CacheLineSize];
+        std::atomic<size_t> _Head; // Consumer position
+        char _Pad1[_CacheLineSize - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> _Tail; // Producer position
+        char _Pad2[_CacheLineSize - sizeof(std::atomic<size_t>)];
+
+    public:
+        LoopbackByteRing() :
+            _Buffer(new uint8_t[_StreamRingSize]),
+            _Size(_StreamRingSize),
+            _Head(0),
+            _Tail(0)
+        {
+            static_assert((_StreamRingSize & (_StreamRingSize - 1)) == 0, "Ring size must be a power of 2.");
+        }
+
+        size_t Write(const void* datas, size_t len)
+        {
+            const size_t tail = _Tail.load(std::memory_order_relaxed);
+            const size_t head = _Head.load(std::memory_order_acquire);
+            const size_t count = std::min(len, _Size - (tail - head));
+            const size_t offset = tail & (_Size - 1);
+            const size_t first = std::min(count, _Size - offset);
+
+            memcpy(&_Buffer[offset], datas, first);
+            memcpy(&_Buffer[0], reinterpret_cast<const uint8_t*>(datas) + first, count - first);
+
+            _Tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        size_t Read(void* buffer, size_t len, bool peek)
+        {
+            const size_t head = _Head.load(std::memory_order_relaxed);
+            const size_t tail = _Tail.load(std::memory_order_acquire);
+            const size_t count = std::min(len, tail - head);
+            const size_t offset = head & (_Size - 1);
+            const size_t first = std::min(count, _Size - offset);
+
+            memcpy(buffer, &_Buffer[offset], first);
+            memcpy(reinterpret_cast<uint8_t*>(buffer) + first, &_Buffer[0], count - first);
+
+            if (!peek)
+                _Head.store(head + count, std::memory_order_release);
+
+            return count;
+        }
+
+        size_t Size() const
+        {
+            return _Tail.load(std::memory_order_acquire) - _Head.load(std::memory_order_acquire);
+        }
+
+        bool Full() const
+        {
+            return Size() == _Size;
+        }
+    };
+
+    ////////////
+    /// @brief Bounded multiple producers, single consumer datagram queue.
+    ////////////
+    SOCKET_HIDE_CLASS(class) LoopbackDatagramQueue
+    {
+        struct Cell
+        {
+            std::atomic<size_t> Sequence;
+            uint32_t FromPort;
+            std::vector<uint8_t> Datas; // Keeps its capacity, the queue stops allocating once warm.
+        };
+
+        std::unique_ptr<Cell[]> _Cells;
+        size_t _Mask;
+        char _Pad0[_CacheLineSize];
+        std::atomic<size_t> _EnqueuePos;
+        char _Pad1[_CacheLineSize - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> _DequeuePos;
+        char _Pad2[_CacheLineSize - sizeof(std::atomic<size_t>)];
+
+        Cell* Front() const
+        {
+            const size_t pos = _DequeuePos.load(std::memory_order_relaxed);
+            Cell* cell = &_Cells[pos & _Mask];
+            return cell->Sequence.load(std::memory_order_acquire) == pos + 1 ? cell : nullptr;
+        }
+
+    public:
+        LoopbackDatagramQueue() :
+            _Cells(new Cell[_DgramQueueSize]),
+            _Mask(_DgramQueueSize - 1),
+            _EnqueuePos(0),
+            _DequeuePos(0)
+        {
+            static_assert((_DgramQueueSize & (_DgramQueueSize - 1)) == 0, "Queue size must be a power of 2.");
+            for (size_t i = 0; i < _DgramQueueSize; ++i)
+                _Cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool Push(uint32_t from_port, const void* datas, size_t len)
+        {
+            Cell* cell;
+            size_t pos = _EnqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &_Cells[pos & _Mask];
+                const intptr_t diff = static_cast<intptr_t>(cell->Sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+                if (diff == 0)
+                {
+                    if (_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {// Queue is full
+                    return false;
+                }
+                else
+                {
+                    pos = _EnqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->FromPort = from_port;
+            cell->Datas.assign(reinterpret_cast<const uint8_t*>(datas), reinterpret_cast<const uint8_t*>(datas) + len);
+            cell->Sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(uint32_t& from_port, void* buffer, size_t& len, bool peek)
+        {
+            Cell* cell = Front();
+            if (cell == nullptr)
+                return false;
+
+            from_port = cell->FromPort;
+            len = std::min(len, cell->Datas.size());
+            memcpy(buffer, cell->Datas.data(), len);
+
+            if (!peek)
+            {
+                const size_t pos = _DequeuePos.load(std::memory_order_relaxed);
+                _DequeuePos.store(pos + 1, std::memory_order_relaxed);
+                cell->Sequence.store(pos + _Mask + 1, std::memory_order_release);
+            }
+
+            return true;
+        }
+
+        bool Empty() const
+        {
+            return Front() == nullptr;
+        }
+
+        bool Full() const
+        {
+            const size_t pos = _EnqueuePos.load(std::memory_order_relaxed);
+            Cell* cell = &_Cells[pos & _Mask];
+            return static_cast<intptr_t>(cell->Sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos) < 0;
+        }
+
+        size_t FrontSize() const
+        {
+            Cell* cell = Front();
+            return cell == nullptr ? 0 : cell->Datas.size();
+        }
+    };
+
+    SOCKET_HIDE_CLASS(struct) LoopbackConnection
+    {
+        // Index 0 is the connecting side, index 1 is the accepted side.
+        LoopbackByteRing Rings[2]; // Datas waiting to be read by each side.
+        LoopbackSpaceWaiter Space[2]; // Signaled when each side reads its ring or closes.
+        std::shared_ptr<LoopbackEvent> Events[2];
+        std::atomic<bool> Closed[2];
+        uint32_t Ports[2];
+
+        LoopbackConnection() :
+            Ports{}
+        {
+            Closed[0].store(false);
+            Closed[1].store(false);
+        }
+    };
+
+    SOCKET_HIDE_CLASS(struct) LoopbackListener
+    {
+        std::mutex Mutex;
+        std::deque<std::shared_ptr<LoopbackConnection>> Pending;
+        std::shared_ptr<LoopbackEvent> Event;
+        size_t Backlog;
+        bool Listening;
+        uint32_t Port;
+
+        LoopbackListener() :
+            Backlog(0),
+            Listening(false),
+            Port(0)
+        {}
+    };
+
+    SOCKET_HIDE_CLASS(struct) LoopbackDgramEndpoint
+    {
+        LoopbackDatagramQueue Queue;
+        LoopbackSpaceWaiter Space; // Signaled when the queue is read or closed.
+        std::shared_ptr<LoopbackEvent> Event;
+        std::atomic<bool> Closed;
+        uint32_t Port;
+        // The non-blocking senders that found the queue full, their writes are blocked until it is read.
+        std::mutex BlockedMutex;
+        std::vector<std::shared_ptr<LoopbackEvent>> BlockedSenders;
+        std::atomic<bool> HasBlockedSenders;
+
+        LoopbackDgramEndpoint() :
+            Closed(false),
+            Port(0),
+            HasBlockedSenders(false)
+        {}
+
+        void AddBlockedSender(std::shared_ptr<LoopbackEvent> const& sender)
+        {
+            std::lock_guard<std::mutex> lk(BlockedMutex);
+            if (std::find(BlockedSenders.begin(), BlockedSenders.end(), sender) == BlockedSenders.end())
+                BlockedSenders.emplace_back(sender);
+
+            HasBlockedSenders.store(true, std::memory_order_seq_cst);
+        }
+
+        // Called after reading the queue or closing, it only costs a load when no sender is blocked.
+        void UnblockSenders()
+        {
+            std::vector<std::shared_ptr<LoopbackEvent>> senders;
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!HasBlockedSenders.load(std::memory_order_relaxed))
+                return;
+
+            {
+                std::lock_guard<std::mutex> lk(BlockedMutex);
+                senders.swap(BlockedSenders);
+                HasBlockedSenders.store(false, std::memory_order_relaxed);
+            }
+
+            for (auto& sender : senders)
+                sender->UnblockWrites();
+        }
+    };
+
+    ////////////
+    /// @brief Process wide loopback ports. Only used on bind, connect and close, never on the data path.
+    ////////////
+    SOCKET_HIDE_CLASS(class) LoopbackRegistry
+    {
+        std::mutex _Mutex;
+        std::map<uint32_t, std::weak_ptr<LoopbackListener>> _Listeners;
+        std::map<uint32_t, std::weak_ptr<LoopbackDgramEndpoint>> _Endpoints;
+        uint32_t _NextEphemeralPort;
+        std::atomic<uint32_t> _NextClientPort;
+
+        LoopbackRegistry() :
+            _NextEphemeralPort(_EphemeralPortStart),
+            _NextClientPort(_EphemeralPortStart)
+        {}
+
+        template<typename T>
+        NetworkLibrary::Error Register(std::map<uint32_t, std::weak_ptr<T>>& ports, uint32_t& port, std::shared_ptr<T> const& item)
+        {
+            std::lock_guard<std::mutex> lk(_Mutex);
+            if (port == 0)
+            {
+                for (;;)
+                {
+                    port = _NextEphemeralPort++;
+                    if (_NextEphemeralPort == 0)
+                        _NextEphemeralPort = _EphemeralPortStart;
+
+                    auto it = ports.find(port);
+                    if (it == ports.end() || it->second.expired())
+                        break;
+                }
+            }
+            else
+            {
+                auto it = ports.find(port);
+                if (it != ports.end() && !it->second.expired())
+                    return Internals::MakeErrorFromSocketCode(Error::AddrInUse);
+            }
+
+            ports[port] = item;
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        template<typename T>
+        void Unregister(std::map<uint32_t, std::weak_ptr<T>>& ports, uint32_t port, T const* item)
+        {
+            std::lock_guard<std::mutex> lk(_Mutex);
+            auto it = ports.find(port);
+            if (it != ports.end())
+            {
+                auto registered = it->second.lock();
+                if (registered == nullptr || registered.get() == item)
+                    ports.erase(it);
+            }
+        }
+
+        template<typename T>
+        std::shared_ptr<T> Find(std::map<uint32_t, std::weak_ptr<T>>& ports, uint32_t port)
+        {
+            std::lock_guard<std::mutex> lk(_Mutex);
+            auto it = ports.find(port);
+            return it == ports.end() ? nullptr : it->second.lock();
+        }
+
+    public:
+        static LoopbackRegistry& Inst()
+        {
+            static LoopbackRegistry inst;
+            return inst;
+        }
+
+        NetworkLibrary::Error RegisterListener(uint32_t& port, std::shared_ptr<LoopbackListener> const& listener) { return Register(_Listeners, port, listener); }
+        void UnregisterListener(uint32_t port, LoopbackListener const* listener) { Unregister(_Listeners, port, listener); }
+        std::shared_ptr<LoopbackListener> FindListener(uint32_t port) { return Find(_Listeners, port); }
+
+        NetworkLibrary::Error RegisterEndpoint(uint32_t& port, std::shared_ptr<LoopbackDgramEndpoint> const& endpoint) { return Register(_Endpoints, port, endpoint); }
+        void UnregisterEndpoint(uint32_t port, LoopbackDgramEndpoint const* endpoint) { Unregister(_Endpoints, port, endpoint); }
+        std::shared_ptr<LoopbackDgramEndpoint> FindEndpoint(uint32_t port) { return Find(_Endpoints, port); }
+
+        // Connecting sockets don't reserve their port, like an unbound TCP client.
+        uint32_t NextClientPort()
+        {
+            uint32_t port;
+            while ((port = _NextClientPort.fetch_add(1, std::memory_order_relaxed)) < _EphemeralPortStart)
+            {}
+
+            return port;
+        }
+    };
+
+    /****************************************
+     *
+     * LoopbackAddr implementation
+     *
+     ****************************************/
+
+    SOCKET_HIDE_CLASS(class) LoopbackAddrImpl
+    {
+        using my_sockaddr_t = LoopbackSockAddr;
+        my_sockaddr_t _SockAddr;
+
+    public:
+        LoopbackAddrImpl() :
+            _SockAddr()
+        {
+            _SockAddr.Family = AddressFamily;
+        }
+
+        LoopbackAddrImpl(LoopbackAddrImpl const& other) :
+            _SockAddr()
+        {
+            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
+        }
+
+        LoopbackAddrImpl& operator=(LoopbackAddrImpl const& other)
+        {
+            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
+            return *this;
+        }
+
+        LoopbackAddrImpl(LoopbackAddrImpl&& other) noexcept = delete;
+        LoopbackAddrImpl& operator=(LoopbackAddrImpl&& other) noexcept = delete;
+
+        std::string ToString(bool with_port) const
+        {
+            std::string res("loopback");
+            if (with_port)
+            {
+                res.push_back(':');
+                res += std::to_string(_SockAddr.Port);
+            }
+
+            return res;
+        }
+
+        void* GetAddr()
+        {
+            return &_SockAddr;
+        }
+
+        const void* GetAddr() const
+        {
+            return &_SockAddr;
+        }
+
+        int GetFamily() const
+        {
+            return AddressFamily;
+        }
+
+        size_t GetLength() const
+        {
+            return sizeof(my_sockaddr_t);
+        }
+
+        NetworkLibrary::Error FromString(std::string const& str)
+        {
+            static constexpr char prefix[] = "loopback";
+            constexpr size_t prefix_len = sizeof(prefix) - 1;
+
+            if (str.empty())
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            size_t pos = 0;
+            if (str.compare(0, prefix_len, prefix) == 0)
+            {
+                pos = prefix_len;
+                if (pos < str.length())
+                {
+                    if (str[pos] != ':')
+                        return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+                    ++pos;
+                }
+            }
+
+            uint64_t port = 0;
+            for (; pos < str.length(); ++pos)
+            {
+                if (str[pos] < '0' || str[pos] > '9')
+                    return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+                port = port * 10 + (str[pos] - '0');
+                if (port > 0xffffffffull)
+                    return Internals::MakeErrorFromSocketCode(Error::InVal);
+            }
+
+            _SockAddr.Port = static_cast<uint32_t>(port);
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        void SetPort(uint32_t port)
+        {
+            _SockAddr.Port = port;
+        }
+
+        uint32_t GetPort() const
+        {
+            return _SockAddr.Port;
+        }
+    };
+
+    LoopbackAddr::LoopbackAddr() :
+        _Impl(new LoopbackAddrImpl)
+    {}
+
+    LoopbackAddr::LoopbackAddr(LoopbackAddr const& other) :
+        _Impl(new LoopbackAddrImpl(*other._Impl))
+    {}
+
+    LoopbackAddr::LoopbackAddr(LoopbackAddr&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    LoopbackAddr& LoopbackAddr::operator=(LoopbackAddr const& other)
+    {
+        LoopbackAddrImpl* tmp(new LoopbackAddrImpl(*other._Impl));
+        delete _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    LoopbackAddr& LoopbackAddr::operator=(LoopbackAddr&& other) noexcept
+    {
+        LoopbackAddrImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    LoopbackAddr::~LoopbackAddr()
+    {
+        delete _Impl;
+    }
+
+    std::string LoopbackAddr::ToString(bool with_port) const
+    {
+        return _Impl->ToString(with_port);
+    }
+
+    void* LoopbackAddr::GetAddr()
+    {
+        return _Impl->GetAddr();
+    }
+
+    const void* LoopbackAddr::GetAddr() const
+    {
+        return _Impl->GetAddr();
+    }
+
+    int LoopbackAddr::GetFamily() const
+    {
+        return _Impl->GetFamily();
+    }
+
+    size_t LoopbackAddr::GetLength() const
+    {
+        return _Impl->GetLength();
+    }
+
+    NetworkLibrary::Error LoopbackAddr::FromString(std::string str)
+    {
+        return _Impl->FromString(str);
+    }
+
+    void LoopbackAddr::SetPort(uint32_t port)
+    {
+        _Impl->SetPort(port);
+    }
+
+    uint32_t LoopbackAddr::GetPort() const
+    {
+        return _Impl->GetPort();
+    }
+
+    static inline uint32_t GetLoopbackPort(BasicAddr const& addr)
+    {
+        return reinterpret_cast<const LoopbackSockAddr*>(addr.GetAddr())->Port;
+    }
+
+    static inline void SetLoopbackPort(BasicAddr& addr, uint32_t port)
+    {
+        if (addr.GetFamily() == AddressFamily)
+            reinterpret_cast<LoopbackSockAddr*>(addr.GetAddr())->Port = port;
+    }
+
+    /****************************************
+     *
+     * LoopbackStream implementation
+     *
+     ****************************************/
+
+    SOCKET_HIDE_CLASS(class) LoopbackStreamImpl
+    {
+    public:
+        std::shared_ptr<LoopbackEvent> Event;
+        std::shared_ptr<LoopbackListener> Listener;
+        std::shared_ptr<LoopbackConnection> Connection;
+        int Side;
+        uint32_t LocalPort;
+        bool NonBlocking;
+
+        LoopbackStreamImpl() :
+            Side(0),
+            LocalPort(0),
+            NonBlocking(false)
+        {}
+
+        ~LoopbackStreamImpl()
+        {
+            Release();
+        }
+
+        void Release()
+        {
+            if (Connection != nullptr)
+            {
+                Connection->Closed[Side].store(true, std::memory_order_release);
+                Connection->Events[1 - Side]->Signal();
+                Connection->Events[1 - Side]->UnblockWrites();
+                Connection->Space[Side].Notify();
+                Connection.reset();
+            }
+
+            if (Listener != nullptr)
+            {
+                LoopbackRegistry::Inst().UnregisterListener(Listener->Port, Listener.get());
+
+                std::lock_guard<std::mutex> lk(Listener->Mutex);
+                Listener->Listening = false;
+                for (auto& connection : Listener->Pending)
+                {// Refuse the connections that were not accepted.
+                    connection->Closed[1].store(true, std::memory_order_release);
+                    connection->Events[0]->Signal();
+                    connection->Events[0]->UnblockWrites();
+                    connection->Space[1].Notify();
+                }
+                Listener->Pending.clear();
+                Listener.reset();
+            }
+
+            Event.reset();
+            Side = 0;
+            LocalPort = 0;
+        }
+    };
+
+    LoopbackStream::LoopbackStream() :
+        _LoopbackImpl(new LoopbackStreamImpl)
+    {}
+
+    LoopbackStream::LoopbackStream(LoopbackStream&& other) noexcept :
+        ConnectedSocket(std::move(other)),
+        _LoopbackImpl(nullptr)
+    {
+        _LoopbackImpl = other._LoopbackImpl;
+
+        // The moved-from socket stays usable, like a moved-from native socket.
+        other._LoopbackImpl = new LoopbackStreamImpl;
+    }
+
+    LoopbackStream& LoopbackStream::operator=(LoopbackStream&& other) noexcept
+    {
+        ConnectedSocket::operator=(std::move(other));
+
+        auto loopback_impl = other._LoopbackImpl;
+
+        other._LoopbackImpl = _LoopbackImpl;
+
+        _LoopbackImpl = loopback_impl;
+
+        return *this;
+    }
+
+    LoopbackStream::~LoopbackStream()
+    {
+        delete _LoopbackImpl; _LoopbackImpl = nullptr;
+    }
+
+    NetworkLibrary::Error LoopbackStream::CreateSocket()
+    {
+        Close();
+
+        auto event = std::make_shared<LoopbackEvent>();
+        NetworkLibrary::Error error = event->Create();
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        error = event->Duplicate(_Impl());
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        _LoopbackImpl->Event = std::move(event);
+        _LoopbackImpl->NonBlocking = false;
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackStream::GetSockName(LoopbackAddr& out_addr)
+    {
+        if (_LoopbackImpl->Event == nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        out_addr.SetPort(_LoopbackImpl->LocalPort);
+        return Internals::MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    int LoopbackStream::GetFamily() const { return AddressFamily; }
+    int LoopbackStream::GetType  () const { return _TypeLoopbackStream; }
+    int LoopbackStream::GetProto () const { return _ProtoLoopbackStream; }
+
+    NetworkLibrary::Error LoopbackStream::SetNonBlocking(bool non_blocking)
+    {
+        _LoopbackImpl->NonBlocking = non_blocking;
+        return Internals::MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    int32_t LoopbackStream::GetWaitingSize() const
+    {
+        auto& impl = *_LoopbackImpl;
+        return impl.Connection == nullptr ? 0 : static_cast<int32_t>(impl.Connection->Rings[impl.Side].Size());
+    }
+
+    void LoopbackStream::Close()
+    {
+        if (_LoopbackImpl != nullptr)
+            _LoopbackImpl->Release();
+
+        _Impl().Close();
+    }
+
+    NetworkLibrary::Error LoopbackStream::Bind(BasicAddr const& addr)
+    {
+        auto& impl = *_LoopbackImpl;
+
+        if (addr.GetFamily() != AddressFamily)
+            return Internals::MakeErrorFromSocketCode(Error::AfNotSupported);
+
+        if (impl.Event == nullptr || impl.Listener != nullptr || impl.Connection != nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        auto listener = std::make_shared<LoopbackListener>();
+        uint32_t port = GetLoopbackPort(addr);
+        NetworkLibrary::Error error = LoopbackRegistry::Inst().RegisterListener(port, listener);
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        listener->Event = impl.Event;
+        listener->Port = port;
+        impl.Listener = std::move(listener);
+        impl.LocalPort = port;
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackStream::Listen(int backlog)
+    {
+        auto& impl = *_LoopbackImpl;
+
+        if (impl.Event == nullptr || impl.Connection != nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        if (impl.Listener == nullptr)
+        {
+            LoopbackAddr any_addr;
+            NetworkLibrary::Error error = Bind(any_addr);
+            if (error.ErrorCode != Error::NoError)
+                return error;
+        }
+
+        std::lock_guard<std::mutex> lk(impl.Listener->Mutex);
+        impl.Listener->Backlog = backlog > 0 ? static_cast<size_t>(backlog) : 1;
+        impl.Listener->Listening = true;
+        return Internals::MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    NetworkLibrary::Error LoopbackStream::Accept(ConnectedSocket& new_client, BasicAddr& client_addr)
+    {
+        auto& impl = *_LoopbackImpl;
+        std::shared_ptr<LoopbackConnection> connection;
+
+        if (impl.Listener == nullptr || !impl.Listener->Listening || !IsSameType(new_client))
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lk(impl.Listener->Mutex);
+                if (!impl.Listener->Pending.empty())
+                {
+                    connection = std::move(impl.Listener->Pending.front());
+                    impl.Listener->Pending.pop_front();
+                    break;
+                }
+            }
+
+            impl.Event->Reset();
+            {
+                std::lock_guard<std::mutex> lk(impl.Listener->Mutex);
+                if (!impl.Listener->Pending.empty())
+                {
+                    impl.Event->Signal();
+                    continue;
+                }
+            }
+
+            if (impl.NonBlocking)
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+
+            impl.Event->Wait(-1);
+        }
+
+        LoopbackStream& client = static_cast<LoopbackStream&>(new_client);
+        client.Close();
+
+        NetworkLibrary::Error error = connection->Events[1]->Duplicate(client._Impl());
+        if (error.ErrorCode != Error::NoError)
+        {
+            connection->Closed[1].store(true, std::memory_order_release);
+            connection->Events[0]->Signal();
+            connection->Events[0]->UnblockWrites();
+            connection->Space[1].Notify();
+            return error;
+        }
+
+        client._LoopbackImpl->Event = connection->Events[1];
+        client._LoopbackImpl->Side = 1;
+        client._LoopbackImpl->LocalPort = connection->Ports[1];
+        client._LoopbackImpl->NonBlocking = false;
+        client._LoopbackImpl->Connection = std::move(connection);
+
+        SetLoopbackPort(client_addr, client._LoopbackImpl->Connection->Ports[0]);
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackStream::AcceptBatch(ConnectedSocket* const* new_clients, BasicAddr* const* client_addrs, size_t max_count, size_t& accepted_count)
+    {
+        auto& impl = *_LoopbackImpl;
+        NetworkLibrary::Error error = Internals::MakeErrorFromSocketCode(Error::NoError);
+        bool non_blocking = impl.NonBlocking;
+        LoopbackAddr unused_addr;
+
+        accepted_count = 0;
+        while (accepted_count < max_count)
+        {
+            error = Accept(*new_clients[accepted_count], client_addrs == nullptr ? unused_addr : *client_addrs[accepted_count]);
+            if (error.ErrorCode != Error::NoError)
+                break;
+
+            new_clients[accepted_count]->SetNonBlocking(true);
+            ++accepted_count;
+            // Only the first accept may wait, the others take what is already pending.
+            impl.NonBlocking = true;
+        }
+        impl.NonBlocking = non_blocking;
+
+        if (accepted_count > 0 && error.ErrorCode == Error::WouldBlock)
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackStream::Connect(BasicAddr const& addr)
+    {
+        auto& impl = *_LoopbackImpl;
+
+        if (addr.GetFamily() != AddressFamily)
+            return Internals::MakeErrorFromSocketCode(Error::AfNotSupported);
+
+        if (impl.Event == nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        if (impl.Connection != nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::IsConnected);
+
+        if (impl.Listener != nullptr && impl.Listener->Listening)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        auto listener = LoopbackRegistry::Inst().FindListener(GetLoopbackPort(addr));
+        if (listener == nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::ConnectionRefused);
+
+        auto connection = std::make_shared<LoopbackConnection>();
+        connection->Events[0] = impl.Event;
+        connection->Events[1] = std::make_shared<LoopbackEvent>();
+        NetworkLibrary::Error error = connection->Events[1]->Create();
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        connection->Ports[0] = impl.LocalPort != 0 ? impl.LocalPort : LoopbackRegistry::Inst().NextClientPort();
+        connection->Ports[1] = listener->Port;
+
+        {
+            std::lock_guard<std::mutex> lk(listener->Mutex);
+            if (!listener->Listening || listener->Pending.size() >= listener->Backlog)
+                return Internals::MakeErrorFromSocketCode(Error::ConnectionRefused);
+
+            listener->Pending.emplace_back(connection);
+        }
+        listener->Event->Signal();
+
+        impl.LocalPort = connection->Ports[0];
+        impl.Side = 0;
+        impl.Connection = std::move(connection);
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackStream::Send(NetBuffer& buffer, int32_t flags)
+    {
+        auto& impl = *_LoopbackImpl;
+        (void)flags;// No send flag applies to an in-process stream.
+
+        if (impl.Connection == nullptr)
+        {
+            buffer.BufferSize = 0;
+            return Internals::MakeErrorFromSocketCode(Error::NotConnected);
+        }
+
+        const int peer = 1 - impl.Side;
+        LoopbackByteRing& ring = impl.Connection->Rings[peer];
+        const uint8_t* datas = reinterpret_cast<const uint8_t*>(buffer.Buffer);
+        size_t sent = 0;
+
+        while (sent < buffer.BufferSize)
+        {
+            if (impl.Connection->Closed[peer].load(std::memory_order_acquire))
+            {
+                buffer.BufferSize = sent;
+                return Internals::MakeErrorFromSocketCode(Error::ConnectionReset);
+            }
+
+            const size_t written = ring.Write(datas + sent, buffer.BufferSize - sent);
+            if (written != 0)
+            {
+                sent += written;
+                impl.Connection->Events[peer]->Signal();
+                // Like a non-blocking native socket, return a short count instead of waiting.
+                if (impl.NonBlocking)
+                    break;
+            }
+            else if (impl.NonBlocking)
+            {// Poll won't report the socket writable before the peer reads.
+                impl.Event->BlockWrites();
+                if (!ring.Full() || impl.Connection->Closed[peer].load(std::memory_order_acquire))
+                {
+                    impl.Event->UnblockWrites();
+                    continue;
+                }
+
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+            }
+            else
+            {
+                std::shared_ptr<LoopbackConnection> const& connection = impl.Connection;
+                connection->Space[peer].Wait([&]()
+                {
+                    return !ring.Full() || connection->Closed[peer].load(std::memory_order_acquire);
+                });
+            }
+        }
+
+        buffer.BufferSize = sent;
+        return Internals::MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    NetworkLibrary::Error LoopbackStream::Receive(NetBuffer& buffer, int32_t flags)
+    {
+        auto& impl = *_LoopbackImpl;
+
+        if (impl.Connection == nullptr)
+        {
+            buffer.BufferSize = 0;
+            return Internals::MakeErrorFromSocketCode(Error::NotConnected);
+        }
+
+        if (buffer.BufferSize == 0)
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+
+        const bool peek = (flags & SocketFlags::peek) == SocketFlags::peek;
+        const int peer = 1 - impl.Side;
+        LoopbackByteRing& ring = impl.Connection->Rings[impl.Side];
+
+        for (;;)
+        {
+            size_t readed = ring.Read(buffer.Buffer, buffer.BufferSize, peek);
+            if (readed != 0)
+            {
+                if (!peek)
+                {
+                    impl.Connection->Events[peer]->UnblockWrites();
+                    impl.Connection->Space[impl.Side].Notify();
+                }
+
+                buffer.BufferSize = readed;
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            if (impl.Connection->Closed[peer].load(std::memory_order_acquire))
+            {// Datas sent before the peer closed are still readable, then it's the end of stream.
+                buffer.BufferSize = ring.Read(buffer.Buffer, buffer.BufferSize, peek);
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            impl.Event->Reset();
+            if (ring.Size() != 0 || impl.Connection->Closed[peer].load(std::memory_order_acquire))
+            {
+                impl.Event->Signal();
+                continue;
+            }
+
+            if (impl.NonBlocking)
+            {
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+            }
+
+            impl.Event->Wait(-1);
+        }
+    }
+
+    /****************************************
+     *
+     * LoopbackDgram implementation
+     *
+     ****************************************/
+
+    SOCKET_HIDE_CLASS(class) LoopbackDgramImpl
+    {
+    public:
+        std::shared_ptr<LoopbackEvent> Event;
+        std::shared_ptr<LoopbackDgramEndpoint> Endpoint;
+        // Last destination, so a steady flow doesn't look up the registry on every datagram.
+        std::shared_ptr<LoopbackDgramEndpoint> CachedDestination;
+        uint32_t CachedPort;
+        bool NonBlocking;
+
+        LoopbackDgramImpl() :
+            CachedPort(0),
+            NonBlocking(false)
+        {}
+
+        ~LoopbackDgramImpl()
+        {
+            Release();
+        }
+
+        void Release()
+        {
+            if (Endpoint != nullptr)
+            {
+                Endpoint->Closed.store(true, std::memory_order_release);
+                Endpoint->UnblockSenders();
+                Endpoint->Space.Notify();
+                LoopbackRegistry::Inst().UnregisterEndpoint(Endpoint->Port, Endpoint.get());
+                Endpoint.reset();
+            }
+
+            CachedDestination.reset();
+            CachedPort = 0;
+            Event.reset();
+        }
+
+        std::shared_ptr<LoopbackDgramEndpoint> const& FindDestination(uint32_t port)
+        {
+            if (CachedDestination == nullptr || CachedPort != port || CachedDestination->Closed.load(std::memory_order_acquire))
+            {
+                CachedDestination = LoopbackRegistry::Inst().FindEndpoint(port);
+                CachedPort = port;
+            }
+
+            return CachedDestination;
+        }
+    };
+
+    LoopbackDgram::LoopbackDgram() :
+        _LoopbackImpl(new LoopbackDgramImpl)
+    {}
+
+    LoopbackDgram::LoopbackDgram(LoopbackDgram&& other) noexcept :
+        UnconnectedSocket(std::move(other)),
+        _LoopbackImpl(nullptr)
+    {
+        _LoopbackImpl = other._LoopbackImpl;
+
+        // The moved-from socket stays usable, like a moved-from native socket.
+        other._LoopbackImpl = new LoopbackDgramImpl;
+    }
+
+    LoopbackDgram& LoopbackDgram::operator=(LoopbackDgram&& other) noexcept
+    {
+        UnconnectedSocket::operator=(std::move(other));
+
+        auto loopback_impl = other._LoopbackImpl;
+
+        other._LoopbackImpl = _LoopbackImpl;
+
+        _LoopbackImpl = loopback_impl;
+
+        return *this;
+    }
+
+    LoopbackDgram::~LoopbackDgram()
+    {
+        delete _LoopbackImpl; _LoopbackImpl = nullptr;
+    }
+
+    NetworkLibrary::Error LoopbackDgram::CreateSocket()
+    {
+        Close();
+
+        auto event = std::make_shared<LoopbackEvent>();
+        NetworkLibrary::Error error = event->Create();
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        error = event->Duplicate(_Impl());
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        _LoopbackImpl->Event = std::move(event);
+        _LoopbackImpl->NonBlocking = false;
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackDgram::GetSockName(LoopbackAddr& out_addr)
+    {
+        if (_LoopbackImpl->Event == nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        out_addr.SetPort(_LoopbackImpl->Endpoint == nullptr ? 0 : _LoopbackImpl->Endpoint->Port);
+        return Internals::MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    int LoopbackDgram::GetFamily() const { return AddressFamily; }
+    int LoopbackDgram::GetType  () const { return _TypeLoopbackDgram; }
+    int LoopbackDgram::GetProto () const { return _ProtoLoopbackDgram; }
+
+    NetworkLibrary::Error LoopbackDgram::SetNonBlocking(bool non_blocking)
+    {
+        _LoopbackImpl->NonBlocking = non_blocking;
+        return Internals::MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    int32_t LoopbackDgram::GetWaitingSize() const
+    {
+        auto& impl = *_LoopbackImpl;
+        return impl.Endpoint == nullptr ? 0 : static_cast<int32_t>(impl.Endpoint->Queue.FrontSize());
+    }
+
+    void LoopbackDgram::Close()
+    {
+        if (_LoopbackImpl != nullptr)
+            _LoopbackImpl->Release();
+
+        _Impl().Close();
+    }
+
+    NetworkLibrary::Error LoopbackDgram::Bind(BasicAddr const& addr)
+    {
+        auto& impl = *_LoopbackImpl;
+
+        if (addr.GetFamily() != AddressFamily)
+            return Internals::MakeErrorFromSocketCode(Error::AfNotSupported);
+
+        if (impl.Event == nullptr || impl.Endpoint != nullptr)
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+        auto endpoint = std::make_shared<LoopbackDgramEndpoint>();
+        uint32_t port = GetLoopbackPort(addr);
+        NetworkLibrary::Error error = LoopbackRegistry::Inst().RegisterEndpoint(port, endpoint);
+        if (error.ErrorCode != Error::NoError)
+            return error;
+
+        endpoint->Event = impl.Event;
+        endpoint->Port = port;
+        impl.Endpoint = std::move(endpoint);
+        return error;
+    }
+
+    NetworkLibrary::Error LoopbackDgram::SendTo(BasicAddr const& addr, NetBuffer& buffer, int32_t flags)
+    {
+        auto& impl = *_LoopbackImpl;
+        NetworkLibrary::Error error;
+        (void)flags;// No send flag applies to an in-process datagram.
+
+        if (addr.GetFamily() != AddressFamily)
+        {
+            buffer.BufferSize = 0;
+            return Internals::MakeErrorFromSocketCode(Error::AfNotSupported);
+        }
+
+        if (buffer.BufferSize > _MaxDatagramSize)
+        {
+            buffer.BufferSize = 0;
+            return Internals::MakeErrorFromSocketCode(Error::MessageSize);
+        }
+
+        if (impl.Endpoint == nullptr)
+        {// Like UDP, sending from an unbound socket binds it on an ephemeral port.
+            LoopbackAddr any_addr;
+            error = Bind(any_addr);
+            if (error.ErrorCode != Error::NoError)
+            {
+                buffer.BufferSize = 0;
+                return error;
+            }
+        }
+
+        std::shared_ptr<LoopbackDgramEndpoint> const& destination = impl.FindDestination(GetLoopbackPort(addr));
+        for (;;)
+        {
+            if (destination == nullptr || destination->Closed.load(std::memory_order_acquire))
+            {
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::ConnectionRefused);
+            }
+
+            if (destination->Queue.Push(impl.Endpoint->Port, buffer.Buffer, buffer.BufferSize))
+            {
+                destination->Event->Signal();
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            if (impl.NonBlocking)
+            {// Poll won't report the socket writable before the destination reads.
+                destination->AddBlockedSender(impl.Event);
+                impl.Event->BlockWrites();
+                if (!destination->Queue.Full() || destination->Closed.load(std::memory_order_acquire))
+                {
+                    impl.Event->UnblockWrites();
+                    continue;
+                }
+
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+            }
+
+            destination->Space.Wait([&]()
+            {
+                return !destination->Queue.Full() || destination->Closed.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    NetworkLibrary::Error LoopbackDgram::ReceiveFrom(BasicAddr& addr, NetBuffer& buffer, int32_t flags)
+    {
+        auto& impl = *_LoopbackImpl;
+
+        if (impl.Endpoint == nullptr)
+        {
+            buffer.BufferSize = 0;
+            return Internals::MakeErrorFromSocketCode(Error::InVal);
+        }
+
+        const bool peek = (flags & SocketFlags::peek) == SocketFlags::peek;
+        LoopbackDatagramQueue& queue = impl.Endpoint->Queue;
+        uint32_t from_port;
+
+        for (;;)
+        {
+            size_t len = buffer.BufferSize;
+            if (queue.Pop(from_port, buffer.Buffer, len, peek))
+            {
+                if (!peek)
+                {
+                    impl.Endpoint->UnblockSenders();
+                    impl.Endpoint->Space.Notify();
+                }
+
+                buffer.BufferSize = len;
+                SetLoopbackPort(addr, from_port);
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            impl.Event->Reset();
+            if (!queue.Empty())
+            {
+                impl.Event->Signal();
+                continue;
+            }
+
+            if (impl.NonBlocking)
+            {
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+            }
+
+            impl.Event->Wait(-1);
+        }
+    }
+}
+}
@@ -0,0 +1,218 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/Pacer.h>
+#include "internals/internal_socket.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace NetworkLibrary {
+
+    SOCKET_HIDE_CLASS(class) PacerImpl
+    {
+        using clock = std::chrono::steady_clock;
+
+        uint64_t _Rate;
+        double _Burst;
+        // Can go below 0 when a datagram bigger than the burst size is sent.
+        double _Tokens;
+        clock::time_point _LastRefill;
+        bool _KernelPaced;
+
+        bool _IsPaced() const
+        {
+            return _Rate != 0 && !_KernelPaced;
+        }
+
+        void _Refill()
+        {
+            clock::time_point now = clock::now();
+            double elapsed = std::chrono::duration<double>(now - _LastRefill).count();
+
+            _LastRefill = now;
+            _Tokens = std::min(_Burst, _Tokens + elapsed * static_cast<double>(_Rate));
+        }
+
+        // A send bigger than the bucket only waits for a full bucket, or it would never go through.
+        double _Needed(size_t size) const
+        {
+            return std::min(static_cast<double>(size), _Burst);
+        }
+
+    public:
+        PacerImpl() :
+            _Rate(0),
+            _Burst(0),
+            _Tokens(0),
+            _LastRefill(clock::now()),
+            _KernelPaced(false)
+        {}
+
+        void SetRate(uint64_t bytes_per_second, size_t burst_size)
+        {
+            _Rate = bytes_per_second;
+            _Burst = static_cast<double>(std::max<size_t>(burst_size, 1));
+            _Tokens = _Burst;
+            _LastRefill = clock::now();
+            _KernelPaced = false;
+        }
+
+        NetworkLibrary::Error Attach(BasicSocket& socket)
+        {
+            // ~0 is the kernel "unlimited" value.
+            uint32_t kernel_rate = _Rate == 0 ? ~uint32_t(0) : static_cast<uint32_t>(std::min<uint64_t>(_Rate, ~uint32_t(0) - 1));
+            NetworkLibrary::Error error = socket.SetOption<Options::MaxPacingRate>(kernel_rate);
+
+            // Without the fq qdisc the kernel only paces TCP, keep pacing the other sockets here.
+            _KernelPaced = error.ErrorCode == Error::NoError && socket.GetProto() == IPPROTO_TCP;
+            if (error.ErrorCode == Error::NotSupported || socket.GetProto() != IPPROTO_TCP)
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+
+            return error;
+        }
+
+        bool IsKernelPaced() const
+        {
+            return _KernelPaced;
+        }
+
+        std::chrono::microseconds GetDelay(size_t size)
+        {
+            if (!_IsPaced())
+                return std::chrono::microseconds(0);
+
+            _Refill();
+            double missing = _Needed(size) - _Tokens;
+            if (missing <= 0)
+                return std::chrono::microseconds(0);
+
+            return std::chrono::microseconds(static_cast<int64_t>(std::ceil(missing * 1000000.0 / static_cast<double>(_Rate))));
+        }
+
+        bool TryConsume(size_t size)
+        {
+            if (!_IsPaced())
+                return true;
+
+            _Refill();
+            if (_Tokens < _Needed(size))
+                return false;
+
+            _Tokens -= static_cast<double>(size);
+            return true;
+        }
+
+        NetworkLibrary::Error Send(ConnectedSocket& socket, NetBuffer& buffer, int32_t flags)
+        {
+            if (!_IsPaced())
+                return socket.Send(buffer, flags);
+
+            _Refill();
+            if (_Tokens < _Needed(buffer.BufferSize))
+            {
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+            }
+
+            // Streams can be cut, only send what the bucket holds.
+            NetBuffer paced{ buffer.Buffer, std::min(buffer.BufferSize, std::max(static_cast<size_t>(_Tokens), static_cast<size_t>(_Needed(buffer.BufferSize)))) };
+            NetworkLibrary::Error error = socket.Send(paced, flags);
+            _Tokens -= static_cast<double>(paced.BufferSize);
+            buffer.BufferSize = paced.BufferSize;
+            return error;
+        }
+
+        NetworkLibrary::Error SendTo(UnconnectedSocket& socket, BasicAddr const& addr, NetBuffer& buffer, int32_t flags)
+        {
+            if (!TryConsume(buffer.BufferSize))
+            {
+                buffer.BufferSize = 0;
+                return Internals::MakeErrorFromSocketCode(Error::WouldBlock);
+            }
+
+            size_t size = buffer.BufferSize;
+            NetworkLibrary::Error error = socket.SendTo(addr, buffer, flags);
+            if (error.ErrorCode != Error::NoError && _IsPaced())
+                _Tokens += static_cast<double>(size); // Nothing went out, give the tokens back.
+
+            return error;
+        }
+    };
+
+    /****
+     * Pacer implementation
+     ****/
+
+    Pacer::Pacer() :
+        _Impl(new PacerImpl)
+    {}
+
+    Pacer::Pacer(Pacer&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    Pacer& Pacer::operator=(Pacer&& other) noexcept
+    {
+        PacerImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    Pacer::~Pacer()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    void Pacer::SetRate(uint64_t bytes_per_second, size_t burst_size)
+    {
+        _Impl->SetRate(bytes_per_second, burst_size);
+    }
+
+    NetworkLibrary::Error Pacer::Attach(BasicSocket& socket)
+    {
+        return _Impl->Attach(socket);
+    }
+
+    bool Pacer::IsKernelPaced() const
+    {
+        return _Impl->IsKernelPaced();
+    }
+
+    std::chrono::microseconds Pacer::GetDelay(size_t size)
+    {
+        return _Impl->GetDelay(size);
+    }
+
+    bool Pacer::TryConsume(size_t size)
+    {
+        return _Impl->TryConsume(size);
+    }
+
+    NetworkLibrary::Error Pacer::Send(ConnectedSocket& socket, NetBuffer& buffer, int32_t flags)
+    {
+        return _Impl->Send(socket, buffer, flags);
+    }
+
+    NetworkLibrary::Error Pacer::SendTo(UnconnectedSocket& socket, BasicAddr const& addr, NetBuffer& buffer, int32_t flags)
+    {
+        return _Impl->SendTo(socket, addr, buffer, flags);
+    }
+}
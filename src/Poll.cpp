@@ -17,6 +17,9 @@
 
 #include <NetworkLibrary/Poll.h>
 #include "internals/internal_socket.h"
+#include "internals/internal_latency.h"
+
+#include <algorithm>
 
 namespace NetworkLibrary {
 
@@ -90,6 +93,27 @@ namespace NetworkLibrary {
             return NetworkLibrary::Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NoError);
         }
 
+        int16_t GetEvents(BasicSocket const& sock)
+        {
+            for (auto it = _PollFds.begin(); it != _PollFds.end(); ++it)
+            {
+                if (it->fd == sock.GetNativeFd())
+                {
+                    return it->events;
+                }
+            }
+
+            return PollFlags::none;
+        }
+
+        int16_t GetEvents(size_t index)
+        {
+            if (index >= _PollFds.size())
+                return PollFlags::none;
+
+            return (_PollFds.begin() + index)->events;
+        }
+
         int16_t GetRevents(BasicSocket const& sock)
         {
             for (auto it = _PollFds.begin(); it != _PollFds.end(); ++it)
@@ -111,11 +135,29 @@ namespace NetworkLibrary {
             return (_PollFds.begin() + index)->revents;
         }
 
+        size_t GetAllRevents(int16_t* out_revents, size_t count)
+        {
+            count = std::min(count, _PollFds.size());
+            Internals::NativeToPollFlags(_PollFds.data(), out_revents, count);
+            return count;
+        }
+
         int32_t DoPoll(std::chrono::milliseconds timeout)
         {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+            Internals::PollLatencyScope latency;
+#endif
             return Internals::poll(_PollFds.data(), _PollFds.size(), static_cast<int>(timeout.count()));
         }
 
+        int32_t DoPollPrecise(std::chrono::microseconds timeout)
+        {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+            Internals::PollLatencyScope latency;
+#endif
+            return Internals::ppoll(_PollFds.data(), _PollFds.size(), timeout);
+        }
+
         void Clear()
         {
             _PollFds.clear();
@@ -182,6 +224,16 @@ namespace NetworkLibrary {
         return _Impl->SetEvents(index, NetworkLibrary::Internals::PollFlagsToNative(flags));
     }
 
+    /* PollFlags */ int16_t Poll::GetEvents(BasicSocket const& sock)
+    {
+        return NetworkLibrary::Internals::NativeToPollFlags(_Impl->GetEvents(sock));
+    }
+
+    /* PollFlags */ int16_t Poll::GetEvents(size_t index)
+    {
+        return NetworkLibrary::Internals::NativeToPollFlags(_Impl->GetEvents(index));
+    }
+
     /* PollFlags */ int16_t Poll::GetRevents(BasicSocket const& sock)
     {
         return NetworkLibrary::Internals::NativeToPollFlags(_Impl->GetRevents(sock));
@@ -192,11 +244,21 @@ namespace NetworkLibrary {
         return NetworkLibrary::Internals::NativeToPollFlags(_Impl->GetRevents(index));
     }
 
+    size_t Poll::GetAllRevents(/* PollFlags */ int16_t* out_revents, size_t count)
+    {
+        return _Impl->GetAllRevents(out_revents, count);
+    }
+
     int32_t Poll::DoPoll(std::chrono::milliseconds timeout)
     {
         return _Impl->DoPoll(timeout);
     }
 
+    int32_t Poll::DoPollPrecise(std::chrono::microseconds timeout)
+    {
+        return _Impl->DoPollPrecise(timeout);
+    }
+
     void Poll::Clear()
     {
         _Impl->Clear();
@@ -0,0 +1,881 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/Resolver.h>
+#include "internals/internal_socket.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+namespace NetworkLibrary {
+    namespace Dns {
+        static constexpr uint16_t Port       = 53;
+        static constexpr size_t   HeaderSize = 12;
+        static constexpr size_t   MaxName    = 253;
+        static constexpr size_t   MaxLabel   = 63;
+
+        static constexpr uint16_t TypeA      = 1;
+        static constexpr uint16_t TypeSOA    = 6;
+        static constexpr uint16_t TypeAAAA   = 28;
+        static constexpr uint16_t ClassIN    = 1;
+
+        static constexpr uint16_t FlagQR     = 0x8000;
+        static constexpr uint16_t FlagTC     = 0x0200;
+        static constexpr uint16_t FlagRD     = 0x0100;
+
+        static constexpr int      RCodeNoError  = 0;
+        static constexpr int      RCodeNameError = 3;
+
+        static constexpr int      MaxRetries = 2;
+        // Max TTL kept in the cache, whatever the server says.
+        static constexpr uint32_t MaxTtl = 86400;
+        // Negative answers without SOA and system resolutions have no TTL.
+        static constexpr uint32_t DefaultNegativeTtl = 30;
+        static constexpr uint32_t SystemTtl = 60;
+
+        static inline uint16_t Read16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+        static inline uint32_t Read32(const uint8_t* p) { return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]); }
+        static inline void Write16(uint8_t* p, uint16_t v) { p[0] = static_cast<uint8_t>(v >> 8); p[1] = static_cast<uint8_t>(v); }
+
+        // Lowercases and validates a hostname, strips the trailing dot.
+        static bool NormalizeName(std::string const& name, std::string& out)
+        {
+            size_t label_size = 0;
+
+            out = name;
+            if (!out.empty() && out.back() == '.')
+                out.pop_back();
+
+            if (out.empty() || out.length() > MaxName)
+                return false;
+
+            for (char& c : out)
+            {
+                if (c == '.')
+                {
+                    if (label_size == 0)
+                        return false;
+
+                    label_size = 0;
+                    continue;
+                }
+
+                if (c >= 'A' && c <= 'Z')
+                    c = c - 'A' + 'a';
+                else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_'))
+                    return false;
+
+                if (++label_size > MaxLabel)
+                    return false;
+            }
+
+            return true;
+        }
+
+        static size_t BuildQuery(uint8_t* buffer, uint16_t id, std::string const& name, uint16_t type)
+        {
+            uint8_t* p = buffer;
+
+            Write16(p, id); p += 2;
+            Write16(p, FlagRD); p += 2;
+            Write16(p, 1); p += 2; // qdcount
+            Write16(p, 0); p += 2; // ancount
+            Write16(p, 0); p += 2; // nscount
+            Write16(p, 0); p += 2; // arcount
+
+            size_t start = 0;
+            while (start <= name.length())
+            {
+                size_t end = name.find('.', start);
+                if (end == std::string::npos)
+                    end = name.length();
+
+                *p++ = static_cast<uint8_t>(end - start);
+                memcpy(p, name.data() + start, end - start);
+                p += end - start;
+                start = end + 1;
+            }
+            *p++ = 0;
+
+            Write16(p, type); p += 2;
+            Write16(p, ClassIN); p += 2;
+
+            return static_cast<size_t>(p - buffer);
+        }
+
+        // Reads a possibly compressed name at offset, offset is moved after the name.
+        static bool ReadName(const uint8_t* data, size_t size, size_t& offset, std::string* out)
+        {
+            size_t pos = offset;
+            bool jumped = false;
+            int jumps = 0;
+
+            if (out != nullptr)
+                out->clear();
+
+            for (;;)
+            {
+                if (pos >= size)
+                    return false;
+
+                uint8_t length = data[pos];
+                if ((length & 0xC0) == 0xC0)
+                {
+                    if (pos + 1 >= size || ++jumps > 64)
+                        return false;
+
+                    if (!jumped)
+                        offset = pos + 2;
+
+                    jumped = true;
+                    pos = ((length & 0x3F) << 8) | data[pos + 1];
+                    continue;
+                }
+
+                if (length == 0)
+                {
+                    if (!jumped)
+                        offset = pos + 1;
+
+                    return true;
+                }
+
+                if (length > MaxLabel || pos + 1 + length > size)
+                    return false;
+
+                if (out != nullptr)
+                {
+                    if (!out->empty())
+                        out->push_back('.');
+
+                    for (size_t i = 0; i < length; ++i)
+                    {
+                        char c = static_cast<char>(data[pos + 1 + i]);
+                        out->push_back(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+                    }
+                }
+                pos += 1 + length;
+            }
+        }
+
+        struct Answer
+        {
+            int RCode;
+            bool Truncated;
+            uint32_t Ttl;
+        };
+
+        static bool ParseResponse(const uint8_t* data, size_t size, std::string const& name, uint16_t type, ResolveResult& result, Answer& answer)
+        {
+            std::string record_name;
+            size_t offset = HeaderSize;
+            bool has_ttl = false;
+
+            if (size < HeaderSize)
+                return false;
+
+            uint16_t flags = Read16(data + 2);
+            uint16_t qdcount = Read16(data + 4);
+            uint16_t ancount = Read16(data + 6);
+            uint16_t nscount = Read16(data + 8);
+
+            if (!(flags & FlagQR) || qdcount != 1)
+                return false;
+
+            answer.RCode = flags & 0x000F;
+            answer.Truncated = (flags & FlagTC) != 0;
+            answer.Ttl = DefaultNegativeTtl;
+
+            // The question must be ours.
+            if (!ReadName(data, size, offset, &record_name) || record_name != name || offset + 4 > size ||
+                Read16(data + offset) != type || Read16(data + offset + 2) != ClassIN)
+                return false;
+
+            offset += 4;
+
+            for (uint32_t i = 0; i < uint32_t(ancount) + nscount; ++i)
+            {
+                if (!ReadName(data, size, offset, nullptr) || offset + 10 > size)
+                    return false;
+
+                uint16_t record_type = Read16(data + offset);
+                uint16_t record_class = Read16(data + offset + 2);
+                uint32_t record_ttl = Read32(data + offset + 4);
+                uint16_t rdlength = Read16(data + offset + 8);
+                const uint8_t* rdata = data + offset + 10;
+
+                offset += 10 + rdlength;
+                if (offset > size)
+                    return false;
+
+                if (record_class != ClassIN)
+                    continue;
+
+                if (i < ancount)
+                {// CNAME chains are flattened by the server, take every address of the requested type.
+                    if (record_type != type)
+                        continue;
+
+                    if (type == TypeA && rdlength == 4)
+                    {
+                        IPv4::IPv4Addr addr;
+                        addr.SetIPv4(Read32(rdata));
+                        result.IPv4Addrs.emplace_back(std::move(addr));
+                    }
+                    else if (type == TypeAAAA && rdlength == 16)
+                    {
+                        IPv6::IPv6Addr addr;
+                        IPv6::InAddr6 ip;
+                        memcpy(ip.bytes, rdata, sizeof(ip.bytes));
+                        addr.SetIPv6(ip);
+                        result.IPv6Addrs.emplace_back(std::move(addr));
+                    }
+                    else
+                    {
+                        continue;
+                    }
+
+                    answer.Ttl = has_ttl ? std::min(answer.Ttl, record_ttl) : record_ttl;
+                    has_ttl = true;
+                }
+                else if (!has_ttl && record_type == TypeSOA && rdlength >= 20)
+                {// RFC 2308: negative answers are cached for min(SOA TTL, SOA MINIMUM).
+                    answer.Ttl = std::min(record_ttl, Read32(rdata + rdlength - 4));
+                }
+            }
+
+            answer.Ttl = std::min(answer.Ttl, MaxTtl);
+            return true;
+        }
+    }
+
+    SOCKET_HIDE_CLASS(class) ResolverImpl
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct CacheEntry
+        {
+            std::string Name;
+            NetworkLibrary::Error Error;
+            ResolveResult Result;
+            clock::time_point Expiry;
+        };
+
+        struct PendingName
+        {
+            std::vector<Resolver::Callback> Callbacks;
+            ResolveResult Result;
+            // Index 0 is the A query, 1 is the AAAA query.
+            uint16_t Ids[2];
+            bool Answered[2];
+            bool NameError;
+            uint32_t Ttl;
+            int Retries;
+            clock::time_point Deadline;
+            bool System;
+        };
+
+        struct Completion
+        {
+            std::string Name;
+            std::vector<Resolver::Callback> Callbacks;
+            NetworkLibrary::Error Error;
+            ResolveResult Result;
+        };
+
+        struct SystemResult
+        {
+            std::string Name;
+            NetworkLibrary::Error Error;
+            ResolveResult Result;
+        };
+
+        IPv4::UDP _Socket;
+        IPv4::IPv4Addr _WakeAddr;
+        IPv4::IPv4Addr _NameServer;
+        bool _HasNameServer;
+        std::chrono::milliseconds _QueryTimeout;
+
+        std::list<CacheEntry> _Cache;
+        std::unordered_map<std::string, std::list<CacheEntry>::iterator> _CacheIndex;
+        size_t _CacheCapacity;
+
+        std::unordered_map<std::string, PendingName> _Pending;
+        std::unordered_map<uint16_t, std::string> _Queries;
+        std::mt19937 _Random;
+
+        std::thread _Worker;
+        std::mutex _WorkerMutex;
+        std::condition_variable _WorkerCv;
+        std::deque<std::string> _WorkerQueue;
+        std::deque<SystemResult> _WorkerResults;
+        bool _WorkerStop;
+
+        void _CacheInsert(std::string const& name, NetworkLibrary::Error error, ResolveResult const& result, uint32_t ttl)
+        {
+            if (_CacheCapacity == 0 || ttl == 0)
+                return;
+
+            auto it = _CacheIndex.find(name);
+            if (it != _CacheIndex.end())
+            {
+                _Cache.erase(it->second);
+                _CacheIndex.erase(it);
+            }
+
+            while (_Cache.size() >= _CacheCapacity)
+            {
+                _CacheIndex.erase(_Cache.back().Name);
+                _Cache.pop_back();
+            }
+
+            _Cache.emplace_front(CacheEntry{ name, error, result, clock::now() + std::chrono::seconds(ttl) });
+            _CacheIndex.emplace(name, _Cache.begin());
+        }
+
+        bool _CacheLookup(std::string const& name, NetworkLibrary::Error& error, ResolveResult& result)
+        {
+            auto it = _CacheIndex.find(name);
+            if (it == _CacheIndex.end())
+                return false;
+
+            if (it->second->Expiry <= clock::now())
+            {
+                _Cache.erase(it->second);
+                _CacheIndex.erase(it);
+                return false;
+            }
+
+            // Most recently used goes first.
+            _Cache.splice(_Cache.begin(), _Cache, it->second);
+            error = it->second->Error;
+            result = it->second->Result;
+            return true;
+        }
+
+        uint16_t _NewQueryId()
+        {
+            uint16_t id;
+            do
+            {
+                id = static_cast<uint16_t>(_Random());
+            } while (_Queries.count(id) != 0);
+
+            return id;
+        }
+
+        bool _SendQuery(std::string const& name, uint16_t id, uint16_t type)
+        {
+            uint8_t buffer[Dns::HeaderSize + Dns::MaxName + 2 + 4];
+            NetBuffer net_buffer{ buffer, Dns::BuildQuery(buffer, id, name, type) };
+
+            return _Socket.SendTo(_NameServer, net_buffer).ErrorCode == Error::NoError;
+        }
+
+        void _SendQueries(std::string const& name, PendingName& pending)
+        {
+            static constexpr uint16_t types[2] = { Dns::TypeA, Dns::TypeAAAA };
+
+            for (int i = 0; i < 2; ++i)
+            {
+                if (!pending.Answered[i] && !_SendQuery(name, pending.Ids[i], types[i]))
+                {
+                    _StartSystem(name, pending);
+                    return;
+                }
+            }
+
+            pending.Deadline = clock::now() + _QueryTimeout;
+        }
+
+        void _ForgetQueries(std::string const& name, PendingName& pending)
+        {
+            // Answered ids may already be reused by another name.
+            for (int i = 0; i < 2; ++i)
+            {
+                auto it = _Queries.find(pending.Ids[i]);
+                if (it != _Queries.end() && it->second == name)
+                    _Queries.erase(it);
+            }
+        }
+
+        void _StartSystem(std::string const& name, PendingName& pending)
+        {
+            _ForgetQueries(name, pending);
+            pending.System = true;
+            pending.Result = ResolveResult{};
+
+            std::lock_guard<std::mutex> lk(_WorkerMutex);
+            if (!_Worker.joinable())
+                _Worker = std::thread(&ResolverImpl::_WorkerLoop, this);
+
+            _WorkerQueue.emplace_back(name);
+            _WorkerCv.notify_one();
+        }
+
+        void _Complete(std::string const& name, NetworkLibrary::Error error, uint32_t ttl, std::vector<Completion>& completions)
+        {
+            auto it = _Pending.find(name);
+            if (it == _Pending.end())
+                return;
+
+            _ForgetQueries(name, it->second);
+            _CacheInsert(name, error, it->second.Result, ttl);
+            completions.emplace_back(Completion{ name, std::move(it->second.Callbacks), error, std::move(it->second.Result) });
+            _Pending.erase(it);
+        }
+
+        void _OnResponse(const uint8_t* data, size_t size, std::vector<Completion>& completions)
+        {
+            auto query_it = _Queries.find(Dns::Read16(data));
+            if (query_it == _Queries.end())
+                return;
+
+            std::string name = query_it->second;
+            PendingName& pending = _Pending[name];
+            int index = pending.Ids[0] == query_it->first ? 0 : 1;
+            ResolveResult result;
+            Dns::Answer answer;
+
+            if (pending.Answered[index] ||
+                !Dns::ParseResponse(data, size, name, index == 0 ? Dns::TypeA : Dns::TypeAAAA, result, answer))
+                return;
+
+            if (answer.Truncated || (answer.RCode != Dns::RCodeNoError && answer.RCode != Dns::RCodeNameError))
+            {// No TCP fallback and the server is failing, let the system handle it.
+                _StartSystem(name, pending);
+                return;
+            }
+
+            for (auto& addr : result.IPv4Addrs)
+                pending.Result.IPv4Addrs.emplace_back(std::move(addr));
+
+            for (auto& addr : result.IPv6Addrs)
+                pending.Result.IPv6Addrs.emplace_back(std::move(addr));
+
+            pending.Answered[index] = true;
+            pending.NameError |= answer.RCode == Dns::RCodeNameError;
+            pending.Ttl = std::min(pending.Ttl, answer.Ttl);
+            _Queries.erase(query_it);
+
+            if (!pending.Answered[0] || !pending.Answered[1])
+                return;
+
+            bool found = !pending.NameError && (!pending.Result.IPv4Addrs.empty() || !pending.Result.IPv6Addrs.empty());
+            _Complete(name, Internals::MakeErrorFromSocketCode(found ? Error::NoError : Error::NotFound), pending.Ttl, completions);
+        }
+
+        void _WorkerLoop()
+        {
+            IPv4::UDP wake_socket;
+            uint8_t wake_byte = 0;
+
+            wake_socket.CreateSocket();
+
+            std::unique_lock<std::mutex> lk(_WorkerMutex);
+            for (;;)
+            {
+                _WorkerCv.wait(lk, [this]() { return _WorkerStop || !_WorkerQueue.empty(); });
+                if (_WorkerStop)
+                    return;
+
+                std::string name = std::move(_WorkerQueue.front());
+                _WorkerQueue.pop_front();
+                lk.unlock();
+
+                SystemResult result{ name, Internals::MakeErrorFromSocketCode(Error::NoError), ResolveResult{} };
+                addrinfo hints{};
+                addrinfo* infos = nullptr;
+
+                hints.ai_family = AF_UNSPEC;
+                hints.ai_socktype = SOCK_STREAM;
+                int res = Internals::getaddrinfo(name.c_str(), nullptr, &hints, &infos);
+                if (res == 0)
+                {
+                    for (addrinfo* info = infos; info != nullptr; info = info->ai_next)
+                    {
+                        if (info->ai_family == AF_INET)
+                        {
+                            IPv4::IPv4Addr addr;
+                            memcpy(addr.GetAddr(), info->ai_addr, std::min<size_t>(info->ai_addrlen, addr.GetLength()));
+                            addr.SetPort(0);
+                            result.Result.IPv4Addrs.emplace_back(std::move(addr));
+                        }
+                        else if (info->ai_family == AF_INET6)
+                        {
+                            IPv6::IPv6Addr addr;
+                            memcpy(addr.GetAddr(), info->ai_addr, std::min<size_t>(info->ai_addrlen, addr.GetLength()));
+                            addr.SetPort(0);
+                            result.Result.IPv6Addrs.emplace_back(std::move(addr));
+                        }
+                    }
+                    Internals::freeaddrinfo(infos);
+                }
+
+                if (result.Result.IPv4Addrs.empty() && result.Result.IPv6Addrs.empty())
+                    result.Error = Internals::MakeErrorFromSocketCode(res == EAI_AGAIN ? Error::TimedOut : Error::NotFound);
+
+                lk.lock();
+                _WorkerResults.emplace_back(std::move(result));
+
+                // Wake up the loop polling the resolver socket.
+                NetBuffer net_buffer{ &wake_byte, sizeof(wake_byte) };
+                wake_socket.SendTo(_WakeAddr, net_buffer);
+            }
+        }
+
+    public:
+        ResolverImpl() :
+            _HasNameServer(false),
+            _QueryTimeout(1000),
+            _CacheCapacity(1024),
+            _Random(std::random_device{}()),
+            _WorkerStop(false)
+        {}
+
+        ~ResolverImpl()
+        {
+            {
+                std::lock_guard<std::mutex> lk(_WorkerMutex);
+                _WorkerStop = true;
+                _WorkerCv.notify_one();
+            }
+            // Waits for a running getaddrinfo, it can't be cancelled.
+            if (_Worker.joinable())
+                _Worker.join();
+        }
+
+        NetworkLibrary::Error Open()
+        {
+            IPv4::IPv4Addr any_addr;
+            NetworkLibrary::Error error;
+
+            any_addr.SetAnyAddr();
+            if ((error = _Socket.CreateSocket()).ErrorCode != Error::NoError ||
+                (error = _Socket.Bind(any_addr)).ErrorCode != Error::NoError ||
+                (error = _Socket.SetNonBlocking(true)).ErrorCode != Error::NoError ||
+                (error = _Socket.GetSockName(any_addr)).ErrorCode != Error::NoError)
+            {
+                _Socket.Close();
+                return error;
+            }
+
+            _WakeAddr.SetLoopbackAddr();
+            _WakeAddr.SetPort(any_addr.GetPort());
+            return error;
+        }
+
+        void SetNameServer(IPv4::IPv4Addr const& server)
+        {
+            _NameServer = server;
+            if (_NameServer.GetPort() == 0)
+                _NameServer.SetPort(Dns::Port);
+
+            _HasNameServer = true;
+        }
+
+        NetworkLibrary::Error LoadSystemNameServer()
+        {
+            std::ifstream resolv_conf("/etc/resolv.conf");
+            std::string line;
+
+            while (std::getline(resolv_conf, line))
+            {
+                size_t pos = line.find("nameserver");
+                if (pos != 0)
+                    continue;
+
+                pos = line.find_first_not_of(" \t", 10);
+                if (pos == std::string::npos)
+                    continue;
+
+                IPv4::IPv4Addr server;
+                if (server.FromString(line.substr(pos, line.find_first_of(" \t\r", pos) - pos)).ErrorCode == Error::NoError)
+                {
+                    SetNameServer(server);
+                    return Internals::MakeErrorFromSocketCode(Error::NoError);
+                }
+            }
+
+            return Internals::MakeErrorFromSocketCode(Error::NotFound);
+        }
+
+        void SetQueryTimeout(std::chrono::milliseconds timeout)
+        {
+            _QueryTimeout = timeout;
+        }
+
+        void SetCacheCapacity(size_t capacity)
+        {
+            _CacheCapacity = capacity;
+            while (_Cache.size() > _CacheCapacity)
+            {
+                _CacheIndex.erase(_Cache.back().Name);
+                _Cache.pop_back();
+            }
+        }
+
+        void ClearCache()
+        {
+            _Cache.clear();
+            _CacheIndex.clear();
+        }
+
+        NetworkLibrary::Error Resolve(std::string const& name, Resolver::Callback& callback)
+        {
+            NetworkLibrary::Error error = Internals::MakeErrorFromSocketCode(Error::NoError);
+            ResolveResult result;
+            std::string normalized;
+
+            if (!_Socket.IsOpen())
+                return Internals::MakeErrorFromSocketCode(Error::NotConnected);
+
+            {// Literal addresses don't need a query.
+                IPv4::IPv4Addr ipv4_addr;
+                IPv6::IPv6Addr ipv6_addr;
+                if (name.find(':') == std::string::npos && ipv4_addr.FromString(name).ErrorCode == Error::NoError)
+                {
+                    result.IPv4Addrs.emplace_back(std::move(ipv4_addr));
+                    callback(name, error, result);
+                    return error;
+                }
+                if (ipv6_addr.FromString(name).ErrorCode == Error::NoError)
+                {
+                    ipv6_addr.SetPort(0);
+                    result.IPv6Addrs.emplace_back(std::move(ipv6_addr));
+                    callback(name, error, result);
+                    return error;
+                }
+            }
+
+            if (!Dns::NormalizeName(name, normalized))
+                return Internals::MakeErrorFromSocketCode(Error::InVal);
+
+            if (_CacheLookup(normalized, error, result))
+            {
+                callback(name, error, result);
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            auto it = _Pending.find(normalized);
+            if (it != _Pending.end())
+            {// Already in flight, share the answer.
+                it->second.Callbacks.emplace_back(std::move(callback));
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            PendingName& pending = _Pending[normalized];
+            pending.Callbacks.emplace_back(std::move(callback));
+            pending.Answered[0] = pending.Answered[1] = false;
+            pending.NameError = false;
+            pending.Ttl = Dns::MaxTtl;
+            pending.Retries = 0;
+            pending.System = false;
+
+            if (!_HasNameServer)
+            {
+                pending.Ids[0] = pending.Ids[1] = 0;
+                _StartSystem(normalized, pending);
+                return Internals::MakeErrorFromSocketCode(Error::NoError);
+            }
+
+            pending.Ids[0] = _NewQueryId();
+            _Queries.emplace(pending.Ids[0], normalized);
+            pending.Ids[1] = _NewQueryId();
+            _Queries.emplace(pending.Ids[1], normalized);
+
+            _SendQueries(normalized, pending);
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        size_t Process()
+        {
+            std::vector<Completion> completions;
+            uint8_t buffer[2048];
+            IPv4::IPv4Addr from;
+            clock::time_point now = clock::now();
+
+            for (;;)
+            {
+                NetBuffer net_buffer{ buffer, sizeof(buffer) };
+                if (_Socket.ReceiveFrom(from, net_buffer).ErrorCode != Error::NoError)
+                    break;
+
+                // Wake up packets and strays.
+                if (!_HasNameServer || from.GetIPv4() != _NameServer.GetIPv4() || from.GetPort() != _NameServer.GetPort() || net_buffer.BufferSize < Dns::HeaderSize)
+                    continue;
+
+                _OnResponse(buffer, net_buffer.BufferSize, completions);
+            }
+
+            for (auto& item : _Pending)
+            {
+                PendingName& pending = item.second;
+                if (pending.System || pending.Deadline > now)
+                    continue;
+
+                if (++pending.Retries > Dns::MaxRetries)
+                    _StartSystem(item.first, pending);
+                else
+                    _SendQueries(item.first, pending);
+            }
+
+            {
+                std::lock_guard<std::mutex> lk(_WorkerMutex);
+                while (!_WorkerResults.empty())
+                {
+                    SystemResult& result = _WorkerResults.front();
+                    auto it = _Pending.find(result.Name);
+                    if (it != _Pending.end())
+                    {
+                        it->second.Result = std::move(result.Result);
+                        _Complete(result.Name, result.Error, result.Error.ErrorCode == Error::NotFound ? Dns::DefaultNegativeTtl : (result.Error.ErrorCode == Error::NoError ? Dns::SystemTtl : 0), completions);
+                    }
+                    _WorkerResults.pop_front();
+                }
+            }
+
+            // Callbacks last, they may call Resolve.
+            for (auto& completion : completions)
+            {
+                for (auto& callback : completion.Callbacks)
+                    callback(completion.Name, completion.Error, completion.Result);
+            }
+
+            return completions.size();
+        }
+
+        BasicSocket const& GetPollSocket() const
+        {
+            return _Socket;
+        }
+
+        std::chrono::milliseconds GetNextTimeout() const
+        {
+            clock::time_point now = clock::now();
+            clock::time_point next = clock::time_point::max();
+
+            for (auto const& item : _Pending)
+            {
+                if (!item.second.System)
+                    next = std::min(next, item.second.Deadline);
+            }
+
+            if (next == clock::time_point::max())
+                return std::chrono::milliseconds(-1);
+
+            if (next <= now)
+                return std::chrono::milliseconds(0);
+
+            return std::chrono::duration_cast<std::chrono::milliseconds>(next - now) + std::chrono::milliseconds(1);
+        }
+
+        size_t GetPendingCount() const
+        {
+            return _Pending.size();
+        }
+    };
+
+    /****
+     * Resolver implementation
+     ****/
+
+    Resolver::Resolver() :
+        _Impl(new ResolverImpl)
+    {}
+
+    Resolver::Resolver(Resolver&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    Resolver& Resolver::operator=(Resolver&& other) noexcept
+    {
+        ResolverImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    Resolver::~Resolver()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    NetworkLibrary::Error Resolver::Open()
+    {
+        return _Impl->Open();
+    }
+
+    void Resolver::SetNameServer(IPv4::IPv4Addr const& server)
+    {
+        _Impl->SetNameServer(server);
+    }
+
+    NetworkLibrary::Error Resolver::LoadSystemNameServer()
+    {
+        return _Impl->LoadSystemNameServer();
+    }
+
+    void Resolver::SetQueryTimeout(std::chrono::milliseconds timeout)
+    {
+        _Impl->SetQueryTimeout(timeout);
+    }
+
+    void Resolver::SetCacheCapacity(size_t capacity)
+    {
+        _Impl->SetCacheCapacity(capacity);
+    }
+
+    void Resolver::ClearCache()
+    {
+        _Impl->ClearCache();
+    }
+
+    NetworkLibrary::Error Resolver::Resolve(std::string const& name, Callback callback)
+    {
+        return _Impl->Resolve(name, callback);
+    }
+
+    size_t Resolver::Process()
+    {
+        return _Impl->Process();
+    }
+
+    BasicSocket const& Resolver::GetPollSocket() const
+    {
+        return _Impl->GetPollSocket();
+    }
+
+    std::chrono::milliseconds Resolver::GetNextTimeout() const
+    {
+        return _Impl->GetNextTimeout();
+    }
+
+    size_t Resolver::GetPendingCount() const
+    {
+        return _Impl->GetPendingCount();
+    }
+}
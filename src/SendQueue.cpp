@@ -0,0 +1,322 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include <NetworkLibrary/SendQueue.h>
+#include "internals/internal_socket.h"
+
+#include <deque>
+
+namespace NetworkLibrary {
+
+    SOCKET_HIDE_CLASS(class) SendQueueImpl
+    {
+        struct Entry
+        {
+            uint8_t const* Data;
+            size_t Size;
+            size_t Offset;
+            // Only used by SendCopy, Data then points in it.
+            std::vector<uint8_t> Owned;
+            SendQueue::Completion OnSent;
+        };
+
+        ConnectedSocket* _Socket;
+        Poll* _Poll;
+        std::deque<Entry> _Entries;
+        size_t _QueuedSize;
+        bool _AboveHigh;
+
+        static void _Complete(SendQueue::Completion& on_sent, bool sent)
+        {
+            if (on_sent)
+                on_sent(sent);
+        }
+
+        // Sends from buffer until the socket is full, WouldBlock is reported as NoError.
+        NetworkLibrary::Error _SendSome(uint8_t const* buffer, size_t size, size_t& sent)
+        {
+            sent = 0;
+            while (sent < size)
+            {
+                NetBuffer net_buffer{ const_cast<uint8_t*>(buffer + sent), size - sent };
+                NetworkLibrary::Error error = _Socket->Send(net_buffer);
+                if (error.ErrorCode == Error::WouldBlock)
+                    break;
+
+                if (error.ErrorCode != Error::NoError)
+                    return error;
+
+                sent += net_buffer.BufferSize;
+            }
+
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        void _UpdatePollInterest()
+        {
+            if (_Poll == nullptr)
+                return;
+
+            int16_t events = _Poll->GetEvents(*_Socket);
+            int16_t wanted = _Entries.empty() ? (events & ~PollFlags::out) : (events | PollFlags::out);
+            if (wanted != events)
+                _Poll->SetEvents(*_Socket, wanted);
+        }
+
+        void _UpdateWatermarks()
+        {
+            if (!_AboveHigh && _QueuedSize >= High)
+            {
+                _AboveHigh = true;
+                if (OnHigh)
+                    OnHigh(_QueuedSize);
+            }
+            else if (_AboveHigh && _QueuedSize <= Low)
+            {
+                _AboveHigh = false;
+                if (OnLow)
+                    OnLow(_QueuedSize);
+            }
+        }
+
+        NetworkLibrary::Error _Enqueue(NetBuffer const& buffer, bool copy, SendQueue::Completion& on_sent)
+        {
+            uint8_t const* data = reinterpret_cast<uint8_t const*>(buffer.Buffer);
+            size_t sent = 0;
+
+            if (_Socket == nullptr)
+                return Internals::MakeErrorFromSocketCode(Error::NotConnected);
+
+            if (_Entries.empty())
+            {// Nothing is waiting, try to send right away.
+                NetworkLibrary::Error error = _SendSome(data, buffer.BufferSize, sent);
+                if (error.ErrorCode != Error::NoError)
+                {
+                    _Complete(on_sent, false);
+                    return error;
+                }
+
+                if (sent == buffer.BufferSize)
+                {
+                    _Complete(on_sent, true);
+                    return error;
+                }
+            }
+
+            _Entries.emplace_back(Entry{ data, buffer.BufferSize, sent, std::vector<uint8_t>(), std::move(on_sent) });
+            if (copy)
+            {
+                Entry& entry = _Entries.back();
+                entry.Owned.assign(data + sent, data + buffer.BufferSize);
+                entry.Data = entry.Owned.data();
+                entry.Size = entry.Owned.size();
+                entry.Offset = 0;
+            }
+
+            _QueuedSize += buffer.BufferSize - sent;
+            _UpdatePollInterest();
+            _UpdateWatermarks();
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+    public:
+        size_t Low;
+        size_t High;
+        SendQueue::WatermarkCallback OnHigh;
+        SendQueue::WatermarkCallback OnLow;
+
+        SendQueueImpl() :
+            _Socket(nullptr),
+            _Poll(nullptr),
+            _QueuedSize(0),
+            _AboveHigh(false),
+            Low(64 * 1024),
+            High(1024 * 1024)
+        {}
+
+        void Attach(ConnectedSocket& socket, Poll* poll)
+        {
+            _Socket = &socket;
+            _Poll = poll;
+            _UpdatePollInterest();
+        }
+
+        NetworkLibrary::Error Send(NetBuffer const& buffer, SendQueue::Completion on_sent)
+        {
+            return _Enqueue(buffer, false, on_sent);
+        }
+
+        NetworkLibrary::Error SendCopy(NetBuffer const& buffer)
+        {
+            SendQueue::Completion on_sent;
+            return _Enqueue(buffer, true, on_sent);
+        }
+
+        NetworkLibrary::Error Flush()
+        {
+            NetworkLibrary::Error error = Internals::MakeErrorFromSocketCode(Error::NoError);
+
+            if (_Socket == nullptr)
+                return Internals::MakeErrorFromSocketCode(Error::NotConnected);
+
+            while (!_Entries.empty())
+            {
+                Entry& entry = _Entries.front();
+                size_t sent;
+
+                error = _SendSome(entry.Data + entry.Offset, entry.Size - entry.Offset, sent);
+                entry.Offset += sent;
+                _QueuedSize -= sent;
+                if (error.ErrorCode != Error::NoError || entry.Offset != entry.Size)
+                    break;
+
+                // Pop before completing, the completion may queue more data.
+                SendQueue::Completion on_sent(std::move(entry.OnSent));
+                _Entries.pop_front();
+                _Complete(on_sent, true);
+            }
+
+            if (error.ErrorCode != Error::NoError)
+            {
+                Clear();
+                return error;
+            }
+
+            _UpdatePollInterest();
+            _UpdateWatermarks();
+            return error;
+        }
+
+        NetworkLibrary::Error OnPollEvents(int16_t revents)
+        {
+            if (revents & (PollFlags::err | PollFlags::nval))
+            {
+                NetworkLibrary::Error error = _Socket == nullptr ? Internals::MakeErrorFromSocketCode(Error::NotConnected) : _Socket->GetPendingError();
+                Clear();
+                return error;
+            }
+
+            if (revents & PollFlags::out)
+                return Flush();
+
+            return Internals::MakeErrorFromSocketCode(Error::NoError);
+        }
+
+        size_t GetQueuedSize() const
+        {
+            return _QueuedSize;
+        }
+
+        size_t GetQueuedCount() const
+        {
+            return _Entries.size();
+        }
+
+        void Clear()
+        {
+            std::deque<Entry> entries;
+
+            entries.swap(_Entries);
+            _QueuedSize = 0;
+            if (_Socket != nullptr)
+                _UpdatePollInterest();
+
+            _UpdateWatermarks();
+            for (auto& entry : entries)
+                _Complete(entry.OnSent, false);
+        }
+    };
+
+    /****
+     * SendQueue implementation
+     ****/
+
+    SendQueue::SendQueue() :
+        _Impl(new SendQueueImpl)
+    {}
+
+    SendQueue::SendQueue(SendQueue&& other) noexcept :
+        _Impl(other._Impl)
+    {
+        other._Impl = nullptr;
+    }
+
+    SendQueue& SendQueue::operator=(SendQueue&& other) noexcept
+    {
+        SendQueueImpl* tmp = other._Impl;
+        other._Impl = _Impl;
+        _Impl = tmp;
+        return *this;
+    }
+
+    SendQueue::~SendQueue()
+    {
+        delete _Impl; _Impl = nullptr;
+    }
+
+    void SendQueue::Attach(ConnectedSocket& socket, Poll* poll)
+    {
+        _Impl->Attach(socket, poll);
+    }
+
+    void SendQueue::SetWatermarks(size_t low, size_t high)
+    {
+        _Impl->High = high;
+        _Impl->Low = low < high ? low : high;
+    }
+
+    void SendQueue::SetWatermarkCallbacks(WatermarkCallback on_high, WatermarkCallback on_low)
+    {
+        _Impl->OnHigh = std::move(on_high);
+        _Impl->OnLow = std::move(on_low);
+    }
+
+    NetworkLibrary::Error SendQueue::Send(NetBuffer const& buffer, Completion on_sent)
+    {
+        return _Impl->Send(buffer, std::move(on_sent));
+    }
+
+    NetworkLibrary::Error SendQueue::SendCopy(NetBuffer const& buffer)
+    {
+        return _Impl->SendCopy(buffer);
+    }
+
+    NetworkLibrary::Error SendQueue::Flush()
+    {
+        return _Impl->Flush();
+    }
+
+    NetworkLibrary::Error SendQueue::OnPollEvents(int16_t revents)
+    {
+        return _Impl->OnPollEvents(revents);
+    }
+
+    size_t SendQueue::GetQueuedSize() const
+    {
+        return _Impl->GetQueuedSize();
+    }
+
+    size_t SendQueue::GetQueuedCount() const
+    {
+        return _Impl->GetQueuedCount();
+    }
+
+    void SendQueue::Clear()
+    {
+        _Impl->Clear();
+    }
+}
@@ -16,47 +16,146 @@
  */
 
 #include "internals/internal_socket.h"
+#include "internals/internal_io_counters.h"
 
 namespace NetworkLibrary {
+    // Indexed by the error code, from NoError to NotSupported.
+    static const char* const _ErrorMessages[] = {
+        "No error.",
+        "Error out of memory.",
+        "Error no access.",
+        "Error address in use.",
+        "Error address not available.",
+        "Error connection refused.",
+        "Error connection aborted.",
+        "Error connection reset.",
+        "Error fault.",
+        "Error is already connected.",
+        "Error is in progress.",
+        "Error in value.",
+        "Error not connected.",
+        "Error network unreachable.",
+        "Error would block.",
+        "Error address family not supported.",
+        "Error socket don't support type.",
+        "Error message size.",
+        "Error not found.",
+        "Error timed out.",
+        "Error host down.",
+        "Error host unreachable.",
+        "Error too many open files.",
+        "Error not supported.",
+    };
+
+    // Indexed by the error code - WsaNotInitialised.
+    static const char* const _WsaErrorMessages[] = {
+        "Error WinSock not initialized.",
+        "Error WinSock net down.",
+        "Error WinSock system not ready.",
+        "Error WinSock verison not supported.",
+        "Error WinSock pro clim.",
+    };
+
+    static_assert(sizeof(_ErrorMessages) / sizeof(*_ErrorMessages) == Error::NotSupported + 1, "An error code has no message.");
+    static_assert(sizeof(_WsaErrorMessages) / sizeof(*_WsaErrorMessages) == Error::WsaProClim - Error::WsaNotInitialised + 1, "A WinSock error code has no message.");
+
+    static const char* _FindErrorMessage(int error_code) noexcept
+    {
+        if (error_code >= Error::NoError && error_code <= Error::NotSupported)
+            return _ErrorMessages[error_code];
+
+        if (error_code >= Error::WsaNotInitialised && error_code <= Error::WsaProClim)
+            return _WsaErrorMessages[error_code - Error::WsaNotInitialised];
+
+        return nullptr;
+    }
+
     std::string Error::ToString()
     {
-        std::string message;
+        const char* message = _FindErrorMessage(ErrorCode);
+        if (message == nullptr)
+            return "Unknown error: " + std::to_string(NativeCode);
 
-        switch (ErrorCode)
+        return message;
+    }
+
+    const char* Error::Message() const noexcept
+    {
+        const char* message = _FindErrorMessage(ErrorCode);
+        return message == nullptr ? "Unknown error." : message;
+    }
+
+    std::error_code Error::ToErrorCode() const noexcept
+    {
+        return std::error_code(ErrorCode, ErrorCategory());
+    }
+
+    SOCKET_HIDE_CLASS(class) ErrorCategoryImpl :
+        public std::error_category
+    {
+    public:
+        virtual const char* name() const noexcept
         {
-            case ::NetworkLibrary::Error::NoError               : message = "No error."                           ; break;
-            case ::NetworkLibrary::Error::OutOfMemory           : message = "Error out of memory."                ; break;
-            case ::NetworkLibrary::Error::Access                : message = "Error no access."                    ; break;
-            case ::NetworkLibrary::Error::AddrInUse             : message = "Error address in use."               ; break;
-            case ::NetworkLibrary::Error::AddrNotAvailable      : message = "Error address not available."        ; break;
-            case ::NetworkLibrary::Error::ConnectionRefused     : message = "Error connection refused."           ; break;
-            case ::NetworkLibrary::Error::ConnectionAborted     : message = "Error connection aborted."           ; break;
-            case ::NetworkLibrary::Error::ConnectionReset       : message = "Error connection reset."             ; break;
-            case ::NetworkLibrary::Error::Fault                 : message = "Error fault."                        ; break;
-            case ::NetworkLibrary::Error::IsConnected           : message = "Error is already connected."         ; break;
-            case ::NetworkLibrary::Error::InProgress            : message = "Error is in progress."               ; break;
-            case ::NetworkLibrary::Error::InVal                 : message = "Error in value."                     ; break;
-            case ::NetworkLibrary::Error::NotConnected          : message = "Error not connected."                ; break;
-            case ::NetworkLibrary::Error::NetworkUnreachable    : message = "Error network unreachable."          ; break;
-            case ::NetworkLibrary::Error::WouldBlock            : message = "Error would block."                  ; break;
-            case ::NetworkLibrary::Error::AfNotSupported        : message = "Error address family not supported." ; break;
-            case ::NetworkLibrary::Error::SockTypeNotSupported  : message = "Error socket don't support type."    ; break;
-            case ::NetworkLibrary::Error::MessageSize           : message = "Error message size."                 ; break;
-            case ::NetworkLibrary::Error::NotFound              : message = "Error not found."                    ; break;
-            case ::NetworkLibrary::Error::TimedOut              : message = "Error timed out."                    ; break;
-            case ::NetworkLibrary::Error::HostDown              : message = "Error host down."                    ; break;
-            case ::NetworkLibrary::Error::HostUnreachable       : message = "Error host unreachable."             ; break;
-
-            case ::NetworkLibrary::Error::WsaNotInitialised     : message = "Error WinSock not initialized."      ; break;
-            case ::NetworkLibrary::Error::WsaNetDown            : message = "Error WinSock net down."             ; break;
-            case ::NetworkLibrary::Error::WsaSystemNotReady     : message = "Error WinSock system not ready."     ; break;
-            case ::NetworkLibrary::Error::WsaVersionNotSupported: message = "Error WinSock verison not supported."; break;
-            case ::NetworkLibrary::Error::WsaProClim            : message = "Error WinSock pro clim."             ; break;
-
-            default: message = "Unknown error: " + std::to_string(NativeCode);
+            return "NetworkLibrary";
         }
 
-        return message;
+        virtual std::string message(int error_code) const
+        {
+            return Error{ error_code, 0 }.Message();
+        }
+
+        virtual std::error_condition default_error_condition(int error_code) const noexcept
+        {
+            switch (error_code)
+            {
+                case Error::OutOfMemory         : return std::errc::not_enough_memory;
+                case Error::Access              : return std::errc::permission_denied;
+                case Error::AddrInUse           : return std::errc::address_in_use;
+                case Error::AddrNotAvailable    : return std::errc::address_not_available;
+                case Error::ConnectionRefused   : return std::errc::connection_refused;
+                case Error::ConnectionAborted   : return std::errc::connection_aborted;
+                case Error::ConnectionReset     : return std::errc::connection_reset;
+                case Error::Fault               : return std::errc::bad_address;
+                case Error::IsConnected         : return std::errc::already_connected;
+                case Error::InProgress          : return std::errc::operation_in_progress;
+                case Error::InVal               : return std::errc::invalid_argument;
+                case Error::NotConnected        : return std::errc::not_connected;
+                case Error::NetworkUnreachable  : return std::errc::network_unreachable;
+                case Error::WouldBlock          : return std::errc::operation_would_block;
+                case Error::AfNotSupported      : return std::errc::address_family_not_supported;
+                case Error::MessageSize         : return std::errc::message_size;
+                case Error::NotFound            : return std::errc::no_such_file_or_directory;
+                case Error::TimedOut            : return std::errc::timed_out;
+                case Error::HostUnreachable     : return std::errc::host_unreachable;
+                case Error::TooManyOpenFiles    : return std::errc::too_many_files_open;
+                case Error::NotSupported        : return std::errc::operation_not_supported;
+                default                         : return std::error_condition(error_code, *this);
+            }
+        }
+    };
+
+    std::error_category const& ErrorCategory() noexcept
+    {
+        static ErrorCategoryImpl category;
+        return category;
+    }
+
+    // IoCounters
+
+    IoCounters GetProcessIoCounters()
+    {
+#if defined(SOCKET_IO_COUNTERS)
+        return Internals::GetProcessIoCounters();
+#else
+        return IoCounters{};
+#endif
+    }
+
+    // Result
+
+    NetworkLibrary::Error Result::_MakeError() const noexcept
+    {
+        return Internals::MakeErrorFromNative(_NativeCode);
     }
 
     // BasicAddr
@@ -65,25 +164,45 @@ namespace NetworkLibrary {
 
     BasicAddr::~BasicAddr() {}
 
+    size_t BasicAddr::GetStorageSize() const
+    {
+        return GetLength();
+    }
+
     // BasicSocket
 
-    BasicSocket::BasicSocket():
-        _Impl(new Internals::NativeSocket)
-    {}
+    static_assert(sizeof(Internals::NativeSocket) <= sizeof(std::aligned_storage<(IoCounters::Enabled ? 2 : 1) * sizeof(void*), alignof(void*)>::type) &&
+        alignof(Internals::NativeSocket) <= alignof(void*), "BasicSocket storage is too small.");
+
+    BasicSocket::BasicSocket()
+    {
+        new (&_Storage) Internals::NativeSocket;
+    }
+
+    BasicSocket::BasicSocket(BasicSocket&& other) noexcept
+    {
+        new (&_Storage) Internals::NativeSocket(std::move(other._Impl()));
+    }
+
+    BasicSocket& BasicSocket::operator=(BasicSocket&& other) noexcept
+    {
+        _Impl().Swap(other._Impl());
+        return *this;
+    }
 
     BasicSocket::~BasicSocket()
     {
-        delete _Impl; _Impl = nullptr;
+        _Impl().~NativeSocket();
     }
 
     int64_t BasicSocket::GetNativeFd() const
     {
-        return static_cast<int64_t>(_Impl->Socket);
+        return static_cast<int64_t>(_Impl().Socket);
     }
 
     bool BasicSocket::IsOpen() const
     {
-        return _Impl->IsValid();
+        return _Impl().IsValid();
     }
 
     NetworkLibrary::Error BasicSocket::Swap(BasicSocket& other) noexcept
@@ -91,76 +210,158 @@ namespace NetworkLibrary {
         if (!IsSameType(other))
             return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::InVal);
 
-        auto tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
+        _Impl().Swap(other._Impl());
         return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NoError);
     }
 
     NetworkLibrary::Error BasicSocket::SetSockOption(int32_t option_name, const void* value, int optlen)
     {
-        return _Impl->SetSockOption(NetworkLibrary::Internals::OptionNameToNative(option_name), value, optlen);
+        return SetSockOption(OptionLevel::sol_socket, option_name, value, optlen);
+    }
+
+    NetworkLibrary::Error BasicSocket::SetSockOption(int32_t level, int32_t option_name, const void* value, int optlen)
+    {
+        int32_t native_level = NetworkLibrary::Internals::OptionLevelToNative(level);
+        int32_t native_option = NetworkLibrary::Internals::OptionNameToNative(option_name);
+        if (native_level == -1 || native_option == 0)
+            return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NotSupported);
+
+        return _Impl().SetSockOption(native_level, native_option, value, static_cast<socklen_t>(optlen));
+    }
+
+    NetworkLibrary::Error BasicSocket::GetSockOption(int32_t level, int32_t option_name, void* value, int& optlen) const
+    {
+        int32_t native_level = NetworkLibrary::Internals::OptionLevelToNative(level);
+        int32_t native_option = NetworkLibrary::Internals::OptionNameToNative(option_name);
+        socklen_t native_optlen = static_cast<socklen_t>(optlen);
+        if (native_level == -1 || native_option == 0)
+            return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NotSupported);
+
+        NetworkLibrary::Error error = _Impl().GetSockOption(native_level, native_option, value, &native_optlen);
+        optlen = static_cast<int>(native_optlen);
+        return error;
+    }
+
+    NetworkLibrary::Error BasicSocket::GetPendingError() const
+    {
+        int32_t native_error = 0;
+        socklen_t optlen = sizeof(native_error);
+        NetworkLibrary::Error error = Internals::getsockopt(_Impl(), SOL_SOCKET, SO_ERROR, &native_error, &optlen);
+        if (error.ErrorCode != NetworkLibrary::Error::NoError)
+            return error;
+
+        return Internals::MakeErrorFromNative(native_error);
     }
 
     NetworkLibrary::Error BasicSocket::SetNonBlocking(bool non_blocking)
     {
-        return _Impl->SetNonBlocking(non_blocking);
+        return _Impl().SetNonBlocking(non_blocking);
+    }
+
+    IoCounters BasicSocket::GetIoCounters() const
+    {
+#if defined(SOCKET_IO_COUNTERS)
+        return Internals::GetIoCounters(_Impl());
+#else
+        return IoCounters{};
+#endif
     }
 
     int32_t BasicSocket::GetWaitingSize() const
     {
-        return _Impl->GetWaitingSize();
+        return _Impl().GetWaitingSize();
     }
 
     void BasicSocket::Close()
     {
-        _Impl->Close();
+        _Impl().Close();
     }
 
     // Connected Socket
     NetworkLibrary::Error ConnectedSocket::Bind(BasicAddr const& addr)
     {
-        return Internals::bind(*_Impl, addr);
+        return Internals::bind(_Impl(), addr);
     }
 
     NetworkLibrary::Error ConnectedSocket::Listen(int backlog)
     {
-        return Internals::listen(*_Impl, backlog);
+        return Internals::listen(_Impl(), backlog);
     }
 
     NetworkLibrary::Error ConnectedSocket::Accept(ConnectedSocket& new_client, BasicAddr& client_addr)
     {
-        return Internals::accept(*_Impl, client_addr, *new_client._Impl);
+        return Internals::accept(_Impl(), client_addr, new_client._Impl());
+    }
+
+    NetworkLibrary::Error ConnectedSocket::AcceptBatch(ConnectedSocket* const* new_clients, BasicAddr* const* client_addrs, size_t max_count, size_t& accepted_count)
+    {
+        NetworkLibrary::Error error = Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NoError);
+        // A blocking listener would block on the first empty accept, only accept what is already pending after the first one.
+        bool non_blocking = Internals::is_non_blocking(_Impl());
+
+        accepted_count = 0;
+        while (accepted_count < max_count)
+        {
+            if (accepted_count > 0 && !non_blocking && !Internals::has_pending_input(_Impl()))
+                break;
+
+            error = Internals::accept4(_Impl(), client_addrs == nullptr ? nullptr : client_addrs[accepted_count], new_clients[accepted_count]->_Impl());
+            if (error.ErrorCode == NetworkLibrary::Error::NoError)
+            {
+                ++accepted_count;
+                continue;
+            }
+
+            // The client gave up before we accepted it, try the next one.
+            if (error.ErrorCode == NetworkLibrary::Error::ConnectionAborted)
+                continue;
+
+            // The accepted clients must be handled first, the error comes back on the next call.
+            if (accepted_count > 0)
+                break;
+
+            if (error.ErrorCode == NetworkLibrary::Error::TooManyOpenFiles)
+            {// Drop the pending connections, the listener would stay readable and spin the caller's loop otherwise.
+                Internals::shed_pending_connections(_Impl());
+            }
+
+            return error;
+        }
+
+        if (accepted_count > 0)
+            return Internals::MakeErrorFromSocketCode(NetworkLibrary::Error::NoError);
+
+        return error;
     }
 
     NetworkLibrary::Error ConnectedSocket::Connect(BasicAddr const& addr)
     {
-        return Internals::connect(*_Impl, addr);
+        return Internals::connect(_Impl(), addr);
     }
 
     NetworkLibrary::Error ConnectedSocket::Send(NetBuffer& buffer, int32_t flags)
     {
-        return Internals::send(*_Impl, buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags));
+        return Internals::send(_Impl(), buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags)).ToError();
     }
 
     NetworkLibrary::Error ConnectedSocket::Receive(NetBuffer& buffer, int32_t flags)
     {
-        return Internals::recv(*_Impl, buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags));
+        return Internals::recv(_Impl(), buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags)).ToError();
     }
 
     // Unconnected Socket
     NetworkLibrary::Error UnconnectedSocket::Bind(BasicAddr const& addr)
     {
-        return Internals::bind(*_Impl, addr);
+        return Internals::bind(_Impl(), addr);
     }
 
     NetworkLibrary::Error UnconnectedSocket::SendTo(BasicAddr const& addr, NetBuffer& buffer, int32_t flags)
     {
-        return Internals::sendto(*_Impl, addr, buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags));
+        return Internals::sendto(_Impl(), addr, buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags)).ToError();
     }
 
     NetworkLibrary::Error UnconnectedSocket::ReceiveFrom(BasicAddr& addr, NetBuffer& buffer, int32_t flags)
     {
-        return Internals::recvfrom(*_Impl, addr, buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags));
+        return Internals::recvfrom(_Impl(), addr, buffer.Buffer, buffer.BufferSize, NetworkLibrary::Internals::SocketFlagsToNative(flags)).ToError();
     }
 }
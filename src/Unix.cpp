@@ -17,6 +17,7 @@
 
 #include <NetworkLibrary/Unix.h>
 #include "internals/internal_socket.h"
+#include "internals/socket_template.h"
 
 #if defined(SOCKET_OS_WINDOWS)
     #include <afunix.h>
@@ -54,24 +55,17 @@ namespace Unix {
             _SockAddr.sun_family = _AddressFamily;
         }
 
-        UnixAddrImpl(UnixAddrImpl const& other) :
-            _SockAddr()
-        {
-            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
-        }
-
-        UnixAddrImpl& operator=(UnixAddrImpl const& other)
+        size_t ToString(char* buffer, size_t buffer_size, bool with_port) const
         {
-            memcpy(&_SockAddr, &other._SockAddr, sizeof(my_sockaddr_t));
-            return *this;
-        }
+            const char* path_end = reinterpret_cast<const char*>(memchr(_SockAddr.sun_path, 0, sizeof(_SockAddr.sun_path)));
+            size_t length = path_end == nullptr ? sizeof(_SockAddr.sun_path) : static_cast<size_t>(path_end - _SockAddr.sun_path);
 
-        UnixAddrImpl(UnixAddr&& other) noexcept = delete;
-        UnixAddrImpl& operator=(UnixAddr&& other) noexcept = delete;
+            if (buffer == nullptr || buffer_size <= length)
+                return 0;
 
-        std::string ToString(bool with_port) const
-        {
-            return _SockAddr.sun_path;
+            memcpy(buffer, _SockAddr.sun_path, length);
+            buffer[length] = 0;
+            return length;
         }
 
         void* GetAddr()
@@ -94,82 +88,80 @@ namespace Unix {
             return sizeof(my_sockaddr_t);
         }
 
-        NetworkLibrary::Error FromString(std::string str)
+        NetworkLibrary::Error FromString(const char* str, size_t length)
         {
-            if (str.empty() || str.length() >= UNIX_PATH_MAX)
+            if (str == nullptr || length == 0 || length >= UNIX_PATH_MAX)
             {
                 return Internals::MakeErrorFromSocketCode(Error::InVal);
             }
 
-            memcpy(_SockAddr.sun_path, str.c_str(), str.length()+1);
+            memcpy(_SockAddr.sun_path, str, length);
+            _SockAddr.sun_path[length] = 0;
 
             return Internals::MakeErrorFromSocketCode(Error::NoError);
         }
     };
 
-    UnixAddr::UnixAddr() :
-        _Impl(new UnixAddrImpl)
-    {}
+    static_assert(sizeof(UnixAddrImpl) <= sizeof(std::aligned_storage<112, 4>::type) && alignof(UnixAddrImpl) <= 4, "UnixAddr storage is too small.");
+    static_assert(std::is_trivially_copyable<UnixAddrImpl>::value, "UnixAddrImpl must be trivially copyable.");
 
-    UnixAddr::UnixAddr(UnixAddr const& other) :
-        _Impl(new UnixAddrImpl(*other._Impl))
-    {}
-
-    UnixAddr::UnixAddr(UnixAddr&& other) noexcept:
-        _Impl(other._Impl)
+    UnixAddrImpl& UnixAddr::_Impl()
     {
-        other._Impl = nullptr;
+        return *reinterpret_cast<UnixAddrImpl*>(&_Storage);
     }
 
-    UnixAddr& UnixAddr::operator=(UnixAddr const& other)
+    UnixAddrImpl const& UnixAddr::_Impl() const
     {
-        UnixAddrImpl* tmp(new UnixAddrImpl(*other._Impl));
-        delete _Impl;
-        _Impl = tmp;
-        return *this;
+        return *reinterpret_cast<UnixAddrImpl const*>(&_Storage);
     }
 
-    UnixAddr& UnixAddr::operator=(UnixAddr&& other) noexcept
+    UnixAddr::UnixAddr()
     {
-        UnixAddrImpl* tmp = other._Impl;
-        other._Impl = _Impl;
-        _Impl = tmp;
-        return *this;
+        new (&_Storage) UnixAddrImpl;
     }
 
     UnixAddr::~UnixAddr()
+    {}
+
+    std::string UnixAddr::ToString(bool with_port) const
     {
-        delete _Impl;
+        char buffer[UNIX_PATH_MAX + 1];
+        return std::string(buffer, _Impl().ToString(buffer, sizeof(buffer), with_port));
     }
 
-    std::string UnixAddr::ToString(bool with_port) const
+    size_t UnixAddr::ToString(char* buffer, size_t buffer_size, bool with_port) const
     {
-        return _Impl->ToString(with_port);
+        return _Impl().ToString(buffer, buffer_size, with_port);
     }
 
     void* UnixAddr::GetAddr()
     {
-        return _Impl->GetAddr();
+        return _Impl().GetAddr();
     }
 
     const void* UnixAddr::GetAddr() const
     {
-        return _Impl->GetAddr();
+        return _Impl().GetAddr();
     }
 
     int UnixAddr::GetFamily() const
     {
-        return _Impl->GetFamily();
+        return _Impl().GetFamily();
     }
 
     size_t UnixAddr::GetLength() const
     {
-        return _Impl->GetLength();
+        return _Impl().GetLength();
     }
 
-    NetworkLibrary::Error UnixAddr::FromString(std::string str)
+    NetworkLibrary::Error UnixAddr::FromString(std::string const& str)
     {
-        return _Impl->FromString(str);
+        return _Impl().FromString(str.c_str(), str.length());
+    }
+
+    NetworkLibrary::Error UnixAddr::FromString(const char* str, size_t length)
+    {
+        return _Impl().FromString(str, length);
     }
 
     /****************************************
@@ -177,29 +169,39 @@ namespace Unix {
      * UnixDgram implementation
      *
      ****************************************/
+    struct UnixDgramTraits::Native
+    {
+        static constexpr int Family = _AddressFamily;
+        static constexpr int Type   = _TypeUnixDgram;
+        static constexpr int Proto  = _ProtoUnixDgram;
+
+        static void OnBind(SocketTemplate<UnixDgramTraits>& socket, BasicAddr const& addr)
+        {
+            static_cast<UnixDgram&>(socket).UnixBound(addr);
+        }
+    };
+
     UnixDgram::UnixDgram() :
         _BoundAddress(nullptr)
     {}
 
     UnixDgram::UnixDgram(UnixDgram&& other) noexcept :
+        SocketTemplate<UnixDgramTraits>(std::move(other)),
         _BoundAddress(nullptr)
     {
-        _Impl = other._Impl;
         _BoundAddress = other._BoundAddress;
 
-        other._Impl = nullptr;
         other._BoundAddress = nullptr;
     }
 
     UnixDgram& UnixDgram::operator=(UnixDgram&& other) noexcept
     {
-        auto impl = other._Impl;
+        SocketTemplate<UnixDgramTraits>::operator=(std::move(other));
+
         auto bound = other._BoundAddress;
 
-        other._Impl = _Impl;
         other._BoundAddress = _BoundAddress;
 
-        _Impl = impl;
         _BoundAddress = bound;
 
         return *this;
@@ -229,10 +231,7 @@ namespace Unix {
 
     NetworkLibrary::Error UnixDgram::CreateSocket()
     {
-        NetworkLibrary::Error error = _Impl->CreateSocket(
-            (Internals::AddressFamily)_AddressFamily,
-            (Internals::SocketTypes)_TypeUnixDgram,
-            (Internals::SocketProtocols)_ProtoUnixDgram);
+        NetworkLibrary::Error error = SocketTemplate<UnixDgramTraits>::CreateSocket();
 
         if (error.ErrorCode == Error::NoError)
         {
@@ -242,26 +241,10 @@ namespace Unix {
         return error;
     }
 
-    NetworkLibrary::Error UnixDgram::GetSockName(UnixAddr& out_addr)
-    {
-        return Internals::getsockname(*_Impl, out_addr);
-    }
-
-    int UnixDgram::GetFamily() const { return _AddressFamily; }
-    int UnixDgram::GetType  () const { return _TypeUnixDgram; }
-    int UnixDgram::GetProto () const { return _ProtoUnixDgram; }
-
-    NetworkLibrary::Error UnixDgram::Bind(BasicAddr const& addr)
+    void UnixDgram::UnixBound(BasicAddr const& addr)
     {
-        NetworkLibrary::Error error = Internals::bind(*_Impl, addr);
-
-        if (error.ErrorCode == Error::NoError)
-        {
-            UnixCleanup();
-            _BoundAddress = new std::string(reinterpret_cast<const sockaddr_un*>(addr.GetAddr())->sun_path);
-        }
-
-        return error;
+        UnixCleanup();
+        _BoundAddress = new std::string(reinterpret_cast<const sockaddr_un*>(addr.GetAddr())->sun_path);
     }
 
     /****************************************
@@ -269,29 +252,39 @@ namespace Unix {
      * UnixStream implementation
      *
      ****************************************/
+    struct UnixStreamTraits::Native
+    {
+        static constexpr int Family = _AddressFamily;
+        static constexpr int Type   = _TypeUnixStream;
+        static constexpr int Proto  = _ProtoUnixStream;
+
+        static void OnBind(SocketTemplate<UnixStreamTraits>& socket, BasicAddr const& addr)
+        {
+            static_cast<UnixStream&>(socket).UnixBound(addr);
+        }
+    };
+
     UnixStream::UnixStream():
         _BoundAddress(nullptr)
     {}
 
     UnixStream::UnixStream(UnixStream&& other) noexcept:
+        SocketTemplate<UnixStreamTraits>(std::move(other)),
         _BoundAddress(nullptr)
     {
-        _Impl = other._Impl;
         _BoundAddress = other._BoundAddress;
 
-        other._Impl = nullptr;
         other._BoundAddress = nullptr;
     }
 
     UnixStream& UnixStream::operator=(UnixStream&& other) noexcept
     {
-        auto impl = other._Impl;
+        SocketTemplate<UnixStreamTraits>::operator=(std::move(other));
+
         auto bound = other._BoundAddress;
 
-        other._Impl = _Impl;
         other._BoundAddress = _BoundAddress;
 
-        _Impl = impl;
         _BoundAddress = bound;
 
         return *this;
@@ -321,10 +314,7 @@ namespace Unix {
 
     NetworkLibrary::Error UnixStream::CreateSocket()
     {
-        NetworkLibrary::Error error = _Impl->CreateSocket(
-            (Internals::AddressFamily)_AddressFamily,
-            (Internals::SocketTypes)_TypeUnixStream,
-            (Internals::SocketProtocols)_ProtoUnixStream);
+        NetworkLibrary::Error error = SocketTemplate<UnixStreamTraits>::CreateSocket();
 
         if (error.ErrorCode == Error::NoError)
         {
@@ -334,27 +324,16 @@ namespace Unix {
         return error;
     }
 
-    NetworkLibrary::Error UnixStream::GetSockName(UnixAddr& out_addr)
+    void UnixStream::UnixBound(BasicAddr const& addr)
     {
-        return Internals::getsockname(*_Impl, out_addr);
-    }
-
-    int UnixStream::GetFamily() const { return _AddressFamily; }
-    int UnixStream::GetType  () const { return _TypeUnixStream; }
-    int UnixStream::GetProto () const { return _ProtoUnixStream; }
-
-    NetworkLibrary::Error UnixStream::Bind(BasicAddr const& addr)
-    {
-        NetworkLibrary::Error error = Internals::bind(*_Impl, addr);
-
-        if (error.ErrorCode == Error::NoError)
-        {
-            UnixCleanup();
-            _BoundAddress = new std::string(reinterpret_cast<const sockaddr_un*>(addr.GetAddr())->sun_path);
-        }
-
-        return error;
+        UnixCleanup();
+        _BoundAddress = new std::string(reinterpret_cast<const sockaddr_un*>(addr.GetAddr())->sun_path);
     }
 }
 
+template class SocketTemplateIO<Unix::UnixDgramTraits>;
+template class SocketTemplateIO<Unix::UnixStreamTraits>;
+template class SocketTemplate<Unix::UnixDgramTraits>;
+template class SocketTemplate<Unix::UnixStreamTraits>;
+
 }
\ No newline at end of file
@@ -0,0 +1,481 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "internal_address.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #define SOCKET_SSE2_PARSE
+    #include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace NetworkLibrary {
+namespace Internals {
+
+    // "0" to "255", Chars[0] is the length: formatting an octet is a 3 bytes copy.
+    struct OctetStrings
+    {
+        char Chars[256][4];
+
+        constexpr OctetStrings() :
+            Chars()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                int length = i >= 100 ? 3 : (i >= 10 ? 2 : 1);
+                int value = i;
+
+                Chars[i][0] = static_cast<char>(length);
+                for (int j = length; j > 0; --j, value /= 10)
+                    Chars[i][j] = static_cast<char>('0' + value % 10);
+            }
+        }
+    };
+
+    static constexpr OctetStrings _OctetStrings;
+
+    static inline int _HexValue(char c)
+    {
+        uint32_t digit = static_cast<uint8_t>(c) - static_cast<uint32_t>('0');
+        if (digit < 10)
+            return static_cast<int>(digit);
+
+        uint32_t letter = (static_cast<uint8_t>(c) | 0x20u) - static_cast<uint32_t>('a');
+        return letter < 6 ? static_cast<int>(letter + 10) : -1;
+    }
+
+    static inline uint32_t _LowestBit(uint32_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    static bool _ParseIPv4Scalar(const char* str, size_t length, uint32_t& out_ip)
+    {
+        uint32_t ip = 0;
+        uint32_t octet = 0;
+        size_t digits = 0;
+        int dots = 0;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint32_t digit = static_cast<uint8_t>(str[i]) - static_cast<uint32_t>('0');
+            if (digit < 10)
+            {
+                if (digits == 1 && octet == 0)
+                    return false;
+
+                octet = octet * 10 + digit;
+                if (++digits > 3 || octet > 255)
+                    return false;
+            }
+            else if (str[i] == '.')
+            {
+                if (digits == 0 || ++dots > 3)
+                    return false;
+
+                ip = (ip << 8) | octet;
+                octet = 0;
+                digits = 0;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if (digits == 0 || dots != 3)
+            return false;
+
+        out_ip = (ip << 8) | octet;
+        return true;
+    }
+
+#if defined(SOCKET_SSE2_PARSE)
+    // Classifies the 16 chars at once: the digit and dot masks give the octets bounds, no per char branch.
+    static bool _ParseIPv4Sse2(const char* str, size_t length, uint32_t& out_ip)
+    {
+        static const uint32_t multipliers[4][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 10, 1, 0 }, { 100, 10, 1 } };
+        alignas(16) char chars[16] = {};
+        // 2 more bytes, the octets multiplications always read 3 digits.
+        alignas(16) uint8_t values[18] = {};
+
+        memcpy(chars, str, length);
+        __m128i text = _mm_load_si128(reinterpret_cast<__m128i const*>(chars));
+        __m128i digits = _mm_sub_epi8(text, _mm_set1_epi8('0'));
+        __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+        __m128i is_dot = _mm_cmpeq_epi8(text, _mm_set1_epi8('.'));
+        _mm_store_si128(reinterpret_cast<__m128i*>(values), digits);
+
+        uint32_t used_mask = (1u << length) - 1;
+        uint32_t digit_mask = static_cast<uint32_t>(_mm_movemask_epi8(is_digit)) & used_mask;
+        uint32_t dot_mask = static_cast<uint32_t>(_mm_movemask_epi8(is_dot)) & used_mask;
+        if ((digit_mask | dot_mask) != used_mask)
+            return false;
+
+        uint32_t ip = 0;
+        size_t start = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            size_t end = length;
+            if (i < 3)
+            {
+                if (dot_mask == 0)
+                    return false;
+
+                end = _LowestBit(dot_mask);
+                dot_mask &= dot_mask - 1;
+            }
+
+            size_t count = end - start;
+            if (count - 1 > 2 || (count > 1 && values[start] == 0))
+                return false;
+
+            uint32_t const* multiplier = multipliers[count];
+            uint32_t octet = values[start] * multiplier[0] + values[start + 1] * multiplier[1] + values[start + 2] * multiplier[2];
+            if (octet > 255)
+                return false;
+
+            ip = (ip << 8) | octet;
+            start = end + 1;
+        }
+
+        if (dot_mask != 0)
+            return false;
+
+        out_ip = ip;
+        return true;
+    }
+#endif
+
+    static bool _ParseScopeId(const char* str, size_t length, uint32_t& out_scope_id)
+    {
+        uint64_t scope_id = 0;
+        size_t i = 0;
+
+        if (length == 0)
+            return false;
+
+        for (; i < length; ++i)
+        {
+            uint32_t digit = static_cast<uint8_t>(str[i]) - static_cast<uint32_t>('0');
+            if (digit >= 10)
+                break;
+
+            scope_id = scope_id * 10 + digit;
+            if (scope_id > 0xffffffffu)
+                return false;
+        }
+
+        if (i == length)
+        {
+            out_scope_id = static_cast<uint32_t>(scope_id);
+            return true;
+        }
+
+        // An interface name, copied to be null terminated.
+        char name[64];
+        if (length >= sizeof(name))
+            return false;
+
+        memcpy(name, str, length);
+        name[length] = '\0';
+        out_scope_id = ::if_nametoindex(name);
+        return out_scope_id != 0;
+    }
+
+    SOCKET_HIDE_SYMBOLS(bool) ParsePort(const char* str, size_t length, uint16_t& out_port)
+    {
+        uint32_t port = 0;
+
+        if (length == 0 || length > PortMaxLength)
+            return false;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint32_t digit = static_cast<uint8_t>(str[i]) - static_cast<uint32_t>('0');
+            if (digit >= 10)
+                return false;
+
+            port = port * 10 + digit;
+        }
+
+        if (port == 0 || port > 65535u)
+            return false;
+
+        out_port = static_cast<uint16_t>(port);
+        return true;
+    }
+
+    SOCKET_HIDE_SYMBOLS(bool) ParseIPv4(const char* str, size_t length, uint32_t& out_ip)
+    {
+        if (length < 7 || length > IPv4MaxLength)
+            return false;
+
+#if defined(SOCKET_SSE2_PARSE)
+        return _ParseIPv4Sse2(str, length, out_ip);
+#else
+        return _ParseIPv4Scalar(str, length, out_ip);
+#endif
+    }
+
+    SOCKET_HIDE_SYMBOLS(bool) ParseIPv6(const char* str, size_t length, uint8_t* out_ip, uint32_t& out_scope_id)
+    {
+        uint8_t ip[16] = {};
+        uint32_t scope_id = 0;
+        size_t pos = 0;
+        // Where "::" was found, if has_gap.
+        size_t gap = 0;
+        bool has_gap = false;
+        size_t group_start = 0;
+        uint32_t value = 0;
+        size_t digits = 0;
+        size_t i = 0;
+
+        const char* zone = static_cast<const char*>(memchr(str, '%', length));
+        if (zone != nullptr)
+        {
+            size_t zone_pos = static_cast<size_t>(zone - str);
+            if (!_ParseScopeId(zone + 1, length - zone_pos - 1, scope_id))
+                return false;
+
+            length = zone_pos;
+        }
+
+        if (length == 0 || length > IPv6MaxLength)
+            return false;
+
+        // A leading "::", the loop only sees its second ':'.
+        if (str[0] == ':')
+        {
+            if (length < 2 || str[1] != ':')
+                return false;
+
+            i = group_start = 1;
+        }
+
+        while (i < length)
+        {
+            char c = str[i++];
+            int hex = _HexValue(c);
+            if (hex >= 0)
+            {
+                if (++digits > 4)
+                    return false;
+
+                value = (value << 4) | static_cast<uint32_t>(hex);
+            }
+            else if (c == ':')
+            {
+                group_start = i;
+                if (digits == 0)
+                {
+                    if (has_gap)
+                        return false;
+
+                    gap = pos;
+                    has_gap = true;
+                    continue;
+                }
+
+                if (i == length || pos + 2 > 16)
+                    return false;
+
+                ip[pos++] = static_cast<uint8_t>(value >> 8);
+                ip[pos++] = static_cast<uint8_t>(value);
+                value = 0;
+                digits = 0;
+            }
+            else if (c == '.' && pos + 4 <= 16)
+            {
+                uint32_t ipv4;
+                if (!_ParseIPv4Scalar(str + group_start, length - group_start, ipv4))
+                    return false;
+
+                ip[pos++] = static_cast<uint8_t>(ipv4 >> 24);
+                ip[pos++] = static_cast<uint8_t>(ipv4 >> 16);
+                ip[pos++] = static_cast<uint8_t>(ipv4 >> 8);
+                ip[pos++] = static_cast<uint8_t>(ipv4);
+                digits = 0;
+                break;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if (digits != 0)
+        {
+            if (pos + 2 > 16)
+                return false;
+
+            ip[pos++] = static_cast<uint8_t>(value >> 8);
+            ip[pos++] = static_cast<uint8_t>(value);
+        }
+
+        if (has_gap)
+        {
+            // "::" stands for one group at least.
+            if (pos == 16)
+                return false;
+
+            size_t moved = pos - gap;
+            memmove(ip + 16 - moved, ip + gap, moved);
+            memset(ip + gap, 0, 16 - moved - gap);
+        }
+        else if (pos != 16)
+        {
+            return false;
+        }
+
+        memcpy(out_ip, ip, sizeof(ip));
+        out_scope_id = scope_id;
+        return true;
+    }
+
+    SOCKET_HIDE_SYMBOLS(size_t) FormatPort(uint16_t port, char* out)
+    {
+        char digits[PortMaxLength];
+        size_t length = 0;
+
+        do
+        {
+            digits[length++] = static_cast<char>('0' + port % 10);
+            port /= 10;
+        } while (port != 0);
+
+        for (size_t i = 0; i < length; ++i)
+            out[i] = digits[length - i - 1];
+
+        return length;
+    }
+
+    SOCKET_HIDE_SYMBOLS(size_t) FormatIPv4(uint32_t ip, char* out)
+    {
+        char* p = out;
+
+        // Always copies 3 chars, the next octet overwrites the extra ones.
+        for (int shift = 24; shift > 0; shift -= 8)
+        {
+            char const* octet = _OctetStrings.Chars[(ip >> shift) & 0xff];
+            memcpy(p, octet + 1, 3);
+            p += octet[0];
+            *p++ = '.';
+        }
+
+        char const* octet = _OctetStrings.Chars[ip & 0xff];
+        memcpy(p, octet + 1, 3);
+        return static_cast<size_t>(p - out) + static_cast<size_t>(octet[0]);
+    }
+
+    SOCKET_HIDE_SYMBOLS(size_t) FormatIPv6(uint8_t const* ip, char* out)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+        uint16_t words[8];
+        int best_base = -1, best_length = 0;
+        int current_base = -1, current_length = 0;
+        char* p = out;
+
+        for (int i = 0; i < 8; ++i)
+            words[i] = static_cast<uint16_t>((ip[i * 2] << 8) | ip[i * 2 + 1]);
+
+        // The longest run of zero groups is replaced by "::", the first one on ties.
+        for (int i = 0; i <= 8; ++i)
+        {
+            if (i < 8 && words[i] == 0)
+            {
+                if (current_base == -1)
+                    current_base = i;
+
+                ++current_length;
+            }
+            else if (current_base != -1)
+            {
+                if (current_length > best_length)
+                {
+                    best_base = current_base;
+                    best_length = current_length;
+                }
+
+                current_base = -1;
+                current_length = 0;
+            }
+        }
+
+        if (best_length < 2)
+            best_base = -1;
+
+        for (int i = 0; i < 8; ++i)
+        {
+            if (best_base != -1 && i >= best_base && i < best_base + best_length)
+            {
+                if (i == best_base)
+                    *p++ = ':';
+
+                continue;
+            }
+
+            if (i != 0)
+                *p++ = ':';
+
+            if (i == 6 && best_base == 0 && (best_length == 6 || (best_length == 7 && words[7] != 0x0001) || (best_length == 5 && words[5] == 0xffff)))
+            {
+                p += FormatIPv4((uint32_t(ip[12]) << 24) | (uint32_t(ip[13]) << 16) | (uint32_t(ip[14]) << 8) | uint32_t(ip[15]), p);
+                return static_cast<size_t>(p - out);
+            }
+
+            int shift = words[i] >= 0x1000 ? 12 : (words[i] >= 0x100 ? 8 : (words[i] >= 0x10 ? 4 : 0));
+            for (; shift >= 0; shift -= 4)
+                *p++ = hex_digits[(words[i] >> shift) & 0xf];
+        }
+
+        if (best_base != -1 && best_base + best_length == 8)
+            *p++ = ':';
+
+        return static_cast<size_t>(p - out);
+    }
+
+    SOCKET_HIDE_SYMBOLS(size_t) FormatScopeId(uint32_t scope_id, char* out)
+    {
+        char digits[ScopeIdMaxLength];
+        size_t length = 0;
+
+        do
+        {
+            digits[length++] = static_cast<char>('0' + scope_id % 10);
+            scope_id /= 10;
+        } while (scope_id != 0);
+
+        out[0] = '%';
+        for (size_t i = 0; i < length; ++i)
+            out[i + 1] = digits[length - i - 1];
+
+        return length + 1;
+    }
+}
+}
@@ -0,0 +1,47 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "internal_socket.h"
+
+namespace NetworkLibrary {
+namespace Internals {
+    // Allocation free address parsing and formatting. The strings don't need to be null terminated.
+    // The parsers are as strict as inet_pton: no leading zero in IPv4 octets, at most 4 hex digits per IPv6 group.
+
+    // The Format functions don't write the terminating 0, out must hold at least the max length.
+    static constexpr size_t PortMaxLength    = 5;  // 65535
+    static constexpr size_t IPv4MaxLength    = 15; // 255.255.255.255
+    static constexpr size_t IPv6MaxLength    = 45; // ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255
+    static constexpr size_t ScopeIdMaxLength = 11; // %4294967295
+
+    // 1 to 65535, digits only.
+    SOCKET_HIDE_SYMBOLS(bool) ParsePort(const char* str, size_t length, uint16_t& out_port);
+    // Dotted quad, out_ip is host ordered.
+    SOCKET_HIDE_SYMBOLS(bool) ParseIPv4(const char* str, size_t length, uint32_t& out_ip);
+    // IPv6 text with an optional trailing dotted quad and %zone (interface name or index), out_ip is 16 bytes.
+    SOCKET_HIDE_SYMBOLS(bool) ParseIPv6(const char* str, size_t length, uint8_t* out_ip, uint32_t& out_scope_id);
+
+    SOCKET_HIDE_SYMBOLS(size_t) FormatPort(uint16_t port, char* out);
+    SOCKET_HIDE_SYMBOLS(size_t) FormatIPv4(uint32_t ip, char* out);
+    // RFC 5952 text, IPv4 mapped and compatible addresses end with a dotted quad like inet_ntop.
+    SOCKET_HIDE_SYMBOLS(size_t) FormatIPv6(uint8_t const* ip, char* out);
+    // Writes %scope_id.
+    SOCKET_HIDE_SYMBOLS(size_t) FormatScopeId(uint32_t scope_id, char* out);
+}
+}
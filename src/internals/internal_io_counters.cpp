@@ -0,0 +1,245 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "internal_io_counters.h"
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+namespace NetworkLibrary {
+namespace Internals {
+
+    // A thread shard counter has a single writer, a plain load and store is enough and doesn't lock the cache line.
+    // A socket can be used by several threads at once (a UDP socket sent to from a pool), its counters need a locked add.
+    template<bool SingleWriter>
+    static inline void Bump(std::atomic<uint64_t>& counter, uint64_t value = 1)
+    {
+        if (SingleWriter)
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        else
+            counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static inline size_t ErrorSlot(int error_code)
+    {
+        return error_code > 0 && error_code < static_cast<int>(IoCounters::ErrorSlots) ? static_cast<size_t>(error_code) : 0;
+    }
+
+    static inline int GetNativeError()
+    {
+#if defined(SOCKET_OS_WINDOWS)
+        return WSAGetLastError();
+#elif defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+        return errno;
+#endif
+    }
+
+    // The caller reads the error after the counters, they must not change it.
+    static inline void RestoreNativeError(int native_error)
+    {
+#if defined(SOCKET_OS_WINDOWS)
+        WSASetLastError(native_error);
+#elif defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+        errno = native_error;
+#endif
+    }
+
+    void IoCounterBlock::Reset()
+    {
+        Send.Bytes.store(0, std::memory_order_relaxed);
+        Send.Calls.store(0, std::memory_order_relaxed);
+        Send.WouldBlock.store(0, std::memory_order_relaxed);
+        Send.ShortWrites.store(0, std::memory_order_relaxed);
+        Receive.Bytes.store(0, std::memory_order_relaxed);
+        Receive.Calls.store(0, std::memory_order_relaxed);
+        Receive.WouldBlock.store(0, std::memory_order_relaxed);
+        for (auto& error : Errors)
+            error.store(0, std::memory_order_relaxed);
+    }
+
+    void IoCounterBlock::AddTo(IoCounters& counters) const
+    {
+        counters.BytesSent     += Send.Bytes.load(std::memory_order_relaxed);
+        counters.BytesReceived += Receive.Bytes.load(std::memory_order_relaxed);
+        counters.SendCalls     += Send.Calls.load(std::memory_order_relaxed);
+        counters.ReceiveCalls  += Receive.Calls.load(std::memory_order_relaxed);
+        counters.WouldBlock    += Send.WouldBlock.load(std::memory_order_relaxed) + Receive.WouldBlock.load(std::memory_order_relaxed);
+        counters.ShortWrites   += Send.ShortWrites.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < IoCounters::ErrorSlots; ++i)
+            counters.Errors[i] += Errors[i].load(std::memory_order_relaxed);
+    }
+
+    template<bool SingleWriter>
+    static void Count(IoCounterBlock& block, bool is_send, size_t requested, int result, size_t error_slot, bool would_block)
+    {
+        if (is_send)
+        {
+            Bump<SingleWriter>(block.Send.Calls);
+            if (result >= 0)
+            {
+                Bump<SingleWriter>(block.Send.Bytes, static_cast<uint64_t>(result));
+                if (static_cast<size_t>(result) < requested)
+                    Bump<SingleWriter>(block.Send.ShortWrites);
+            }
+            else if (would_block)
+            {
+                Bump<SingleWriter>(block.Send.WouldBlock);
+            }
+        }
+        else
+        {
+            Bump<SingleWriter>(block.Receive.Calls);
+            if (result >= 0)
+                Bump<SingleWriter>(block.Receive.Bytes, static_cast<uint64_t>(result));
+            else if (would_block)
+                Bump<SingleWriter>(block.Receive.WouldBlock);
+        }
+
+        // The sending and the receiving threads can both fail, errors are rare enough for a locked add.
+        if (result < 0 && !would_block)
+            block.Errors[error_slot].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**** Process counters ****/
+
+    // The counters of the threads that exited are added to Retired, the live ones are read in place.
+    SOCKET_HIDE_CLASS(class) IoCountersRegistry
+    {
+    public:
+        std::mutex Mutex;
+        std::vector<IoCounterBlock const*> Shards;
+        IoCounters Retired{};
+
+        static IoCountersRegistry& Inst()
+        {
+            static IoCountersRegistry inst;
+            return inst;
+        }
+    };
+
+    SOCKET_HIDE_CLASS(struct) IoCountersShard
+    {
+        IoCounterBlock Counters;
+
+        IoCountersShard()
+        {
+            Counters.Reset();
+            IoCountersRegistry& registry = IoCountersRegistry::Inst();
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+            registry.Shards.emplace_back(&Counters);
+        }
+
+        ~IoCountersShard()
+        {
+            IoCountersRegistry& registry = IoCountersRegistry::Inst();
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+            Counters.AddTo(registry.Retired);
+            registry.Shards.erase(std::find(registry.Shards.begin(), registry.Shards.end(), &Counters));
+        }
+    };
+
+    static IoCounterBlock& ThreadCounters()
+    {
+        static thread_local IoCountersShard shard;
+        return shard.Counters;
+    }
+
+    static void Count(Internals::NativeSocket const& s, bool is_send, size_t requested, int result)
+    {
+        int native_error = 0;
+        size_t error_slot = 0;
+        bool would_block = false;
+
+        if (result < 0)
+        {
+            native_error = GetNativeError();
+            int error_code = MakeErrorFromNative(native_error).ErrorCode;
+            error_slot = ErrorSlot(error_code);
+            would_block = error_code == Error::WouldBlock;
+        }
+
+        if (s.Counters != nullptr)
+            Count<false>(*s.Counters, is_send, requested, result, error_slot, would_block);
+
+        Count<true>(ThreadCounters(), is_send, requested, result, error_slot, would_block);
+
+        if (result < 0)
+            RestoreNativeError(native_error);
+    }
+
+    SOCKET_HIDE_SYMBOLS(void) CountSend(Internals::NativeSocket const& s, size_t requested, int result)
+    {
+        Count(s, true, requested, result);
+    }
+
+    SOCKET_HIDE_SYMBOLS(void) CountReceive(Internals::NativeSocket const& s, int result)
+    {
+        Count(s, false, 0, result);
+    }
+
+    /**** Socket counters ****/
+
+    // The block is over-aligned and C++14 new doesn't align, the allocation pointer is kept just before the block.
+    SOCKET_HIDE_SYMBOLS(void) AttachIoCounters(Internals::NativeSocket& s)
+    {
+        if (s.Counters == nullptr)
+        {
+            void* memory = ::operator new(sizeof(IoCounterBlock) + sizeof(void*) + CacheLineSize, std::nothrow);
+            if (memory == nullptr)
+                return;// Only the process counters will count this socket.
+
+            uintptr_t aligned = (reinterpret_cast<uintptr_t>(memory) + sizeof(void*) + CacheLineSize - 1) & ~static_cast<uintptr_t>(CacheLineSize - 1);
+            reinterpret_cast<void**>(aligned)[-1] = memory;
+            s.Counters = new (reinterpret_cast<void*>(aligned)) IoCounterBlock;
+        }
+
+        s.Counters->Reset();
+    }
+
+    SOCKET_HIDE_SYMBOLS(void) ReleaseIoCounters(Internals::NativeSocket& s)
+    {
+        if (s.Counters == nullptr)
+            return;
+
+        void* memory = reinterpret_cast<void**>(s.Counters)[-1];
+        s.Counters->~IoCounterBlock();
+        ::operator delete(memory);
+        s.Counters = nullptr;
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::IoCounters) GetIoCounters(Internals::NativeSocket const& s)
+    {
+        ::NetworkLibrary::IoCounters counters{};
+        if (s.Counters != nullptr)
+            s.Counters->AddTo(counters);
+
+        return counters;
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::IoCounters) GetProcessIoCounters()
+    {
+        IoCountersRegistry& registry = IoCountersRegistry::Inst();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+        ::NetworkLibrary::IoCounters counters = registry.Retired;
+        for (auto shard : registry.Shards)
+            shard->AddTo(counters);
+
+        return counters;
+    }
+}
+}
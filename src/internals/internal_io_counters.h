@@ -0,0 +1,72 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "internal_socket.h"
+
+#if defined(SOCKET_IO_COUNTERS)
+
+#include <atomic>
+
+namespace NetworkLibrary {
+namespace Internals {
+    // Only built with SOCKET_IO_COUNTERS, the I/O functions call these right after their syscall.
+    // A thread shard counter has a single writer and is bumped with a relaxed load and store instead of a locked add,
+    // a socket counter block can be written by several threads and uses relaxed fetch_add. Snapshots read both from any thread.
+
+    static constexpr size_t CacheLineSize = 64;
+
+    SOCKET_HIDE_CLASS(struct) IoCounterBlock
+    {
+        // Sending and receiving are often done from different threads, each side has its own cache line.
+        struct alignas(CacheLineSize) SendSide
+        {
+            std::atomic<uint64_t> Bytes;
+            std::atomic<uint64_t> Calls;
+            std::atomic<uint64_t> WouldBlock;
+            std::atomic<uint64_t> ShortWrites;
+        } Send;
+
+        struct alignas(CacheLineSize) ReceiveSide
+        {
+            std::atomic<uint64_t> Bytes;
+            std::atomic<uint64_t> Calls;
+            std::atomic<uint64_t> WouldBlock;
+        } Receive;
+
+        // Errors are rare, both sides share them.
+        alignas(CacheLineSize) std::atomic<uint64_t> Errors[IoCounters::ErrorSlots];
+
+        void Reset();
+        void AddTo(IoCounters& counters) const;
+    };
+
+    // Gives s a zeroed counter block, the previous one is reused. Called when s gets a new socket (socket, accept).
+    SOCKET_HIDE_SYMBOLS(void) AttachIoCounters(Internals::NativeSocket& s);
+    SOCKET_HIDE_SYMBOLS(void) ReleaseIoCounters(Internals::NativeSocket& s);
+
+    // result is the syscall return value, -1 on error.
+    SOCKET_HIDE_SYMBOLS(void) CountSend(Internals::NativeSocket const& s, size_t requested, int result);
+    SOCKET_HIDE_SYMBOLS(void) CountReceive(Internals::NativeSocket const& s, int result);
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::IoCounters) GetIoCounters(Internals::NativeSocket const& s);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::IoCounters) GetProcessIoCounters();
+}
+}
+
+#endif
@@ -0,0 +1,189 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "internal_latency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace NetworkLibrary {
+namespace Internals {
+
+    static inline void Store(std::atomic<uint64_t>& value, uint64_t new_value)
+    {
+        value.store(new_value, std::memory_order_relaxed);
+    }
+
+    static inline uint64_t Load(std::atomic<uint64_t> const& value)
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    // One metric of one thread.
+    SOCKET_HIDE_CLASS(struct) LatencyRecorder
+    {
+        std::atomic<uint64_t> Sum;
+        std::atomic<uint64_t> Min;
+        std::atomic<uint64_t> Max;
+        std::atomic<uint64_t> Buckets[LatencyHistogram::BucketCount];
+
+        LatencyRecorder()
+        {
+            Store(Sum, 0);
+            Store(Min, std::numeric_limits<uint64_t>::max());
+            Store(Max, 0);
+            for (auto& bucket : Buckets)
+                Store(bucket, 0);
+        }
+
+        void Record(uint64_t nanoseconds)
+        {
+            std::atomic<uint64_t>& bucket = Buckets[LatencyHistogram::BucketIndex(nanoseconds)];
+            Store(bucket, Load(bucket) + 1);
+            Store(Sum, Load(Sum) + nanoseconds);
+            if (nanoseconds < Load(Min))
+                Store(Min, nanoseconds);
+            if (nanoseconds > Load(Max))
+                Store(Max, nanoseconds);
+        }
+
+        void AddTo(LatencyHistogram& histogram) const
+        {
+            std::vector<uint64_t> buckets(LatencyHistogram::BucketCount);
+            uint64_t count = 0;
+
+            // The count is taken from the copied buckets, so the percentiles stay consistent with them.
+            for (size_t i = 0; i < LatencyHistogram::BucketCount; ++i)
+            {
+                buckets[i] = Load(Buckets[i]);
+                count += buckets[i];
+            }
+
+            histogram.AddRaw(buckets.data(), count, Load(Sum), Load(Min), Load(Max));
+        }
+    };
+
+    SOCKET_HIDE_CLASS(struct) LatencyShard
+    {
+        std::unique_ptr<LatencyRecorder[]> Recorders;
+        // Only used by the owning thread.
+        latency_clock::time_point LastPollReturn;
+        bool HasPolled;
+
+        LatencyShard();
+        ~LatencyShard();
+    };
+
+    /**** Process histograms ****/
+
+    // The histograms of the threads that exited are merged in Retired, the live ones are read in place.
+    SOCKET_HIDE_CLASS(class) LatencyRegistry
+    {
+    public:
+        std::mutex Mutex;
+        std::vector<LatencyShard const*> Shards;
+        LatencyHistogram Retired[LatencyMetric::Count];
+
+        static LatencyRegistry& Inst()
+        {
+            static LatencyRegistry inst;
+            return inst;
+        }
+    };
+
+    LatencyShard::LatencyShard() :
+        Recorders(new LatencyRecorder[LatencyMetric::Count]),
+        HasPolled(false)
+    {
+        LatencyRegistry& registry = LatencyRegistry::Inst();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+        registry.Shards.emplace_back(this);
+    }
+
+    LatencyShard::~LatencyShard()
+    {
+        LatencyRegistry& registry = LatencyRegistry::Inst();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+        for (int metric = 0; metric < LatencyMetric::Count; ++metric)
+            Recorders[metric].AddTo(registry.Retired[metric]);
+
+        registry.Shards.erase(std::find(registry.Shards.begin(), registry.Shards.end(), this));
+    }
+
+    static LatencyShard& ThreadShard()
+    {
+        static thread_local LatencyShard shard;
+        return shard;
+    }
+
+    static inline uint64_t ToNanoseconds(latency_clock::duration duration)
+    {
+        int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        return nanoseconds < 0 ? 0 : static_cast<uint64_t>(nanoseconds);
+    }
+
+    SOCKET_HIDE_SYMBOLS(void) RecordLatency(int metric, latency_clock::duration duration)
+    {
+        ThreadShard().Recorders[metric].Record(ToNanoseconds(duration));
+    }
+
+    PollLatencyScope::PollLatencyScope()
+    {
+        LatencyShard& shard = ThreadShard();
+
+        _Start = latency_clock::now();
+        if (shard.HasPolled)
+            shard.Recorders[LatencyMetric::PollHandler].Record(ToNanoseconds(_Start - shard.LastPollReturn));
+    }
+
+    PollLatencyScope::~PollLatencyScope()
+    {
+        LatencyShard& shard = ThreadShard();
+        latency_clock::time_point now = latency_clock::now();
+
+        shard.Recorders[LatencyMetric::PollWait].Record(ToNanoseconds(now - _Start));
+        shard.LastPollReturn = now;
+        shard.HasPolled = true;
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::LatencyHistogram) GetProcessLatencyHistogram(int metric)
+    {
+        ::NetworkLibrary::LatencyHistogram histogram;
+        if (metric < 0 || metric >= LatencyMetric::Count)
+            return histogram;
+
+        LatencyRegistry& registry = LatencyRegistry::Inst();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+        histogram.Merge(registry.Retired[metric]);
+        for (auto shard : registry.Shards)
+            shard->Recorders[metric].AddTo(histogram);
+
+        return histogram;
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::LatencyHistogram) GetThreadLatencyHistogram(int metric)
+    {
+        ::NetworkLibrary::LatencyHistogram histogram;
+        if (metric >= 0 && metric < LatencyMetric::Count)
+            ThreadShard().Recorders[metric].AddTo(histogram);
+
+        return histogram;
+    }
+}
+}
@@ -0,0 +1,67 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include "internal_socket.h"
+#include <NetworkLibrary/LatencyHistogram.h>
+
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+
+namespace NetworkLibrary {
+namespace Internals {
+    // Only built with SOCKET_LATENCY_HISTOGRAMS. Each thread records in its own histograms, without locking:
+    // a bucket has a single writer and is bumped with a relaxed load and store, the snapshots read it from any thread.
+
+    using latency_clock = std::chrono::steady_clock;
+
+    SOCKET_HIDE_SYMBOLS(void) RecordLatency(int metric, latency_clock::duration duration);
+
+    // Records the time until the end of the scope, the syscall wrappers declare it before the syscall.
+    SOCKET_HIDE_CLASS(class) LatencyScope
+    {
+        int _Metric;
+        latency_clock::time_point _Start;
+
+    public:
+        explicit LatencyScope(int metric) :
+            _Metric(metric),
+            _Start(latency_clock::now())
+        {}
+
+        ~LatencyScope()
+        {
+            RecordLatency(_Metric, latency_clock::now() - _Start);
+        }
+    };
+
+    // Records the time since this thread previous poll returned (PollHandler), then the time blocked in this one (PollWait).
+    SOCKET_HIDE_CLASS(class) PollLatencyScope
+    {
+        latency_clock::time_point _Start;
+
+    public:
+        PollLatencyScope();
+        ~PollLatencyScope();
+    };
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::LatencyHistogram) GetProcessLatencyHistogram(int metric);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::LatencyHistogram) GetThreadLatencyHistogram(int metric);
+}
+}
+
+#endif
@@ -16,6 +16,13 @@
  */
 
 #include "internal_socket.h"
+#include "internal_io_counters.h"
+#include "internal_latency.h"
+
+#if !defined(SOCKET_OS_WINDOWS) && (defined(__SSE2__) || defined(_M_X64))
+    #define SOCKET_SSE2_REVENTS
+    #include <emmintrin.h>
+#endif
 
 namespace NetworkLibrary {
 namespace Internals {
@@ -36,19 +43,32 @@ namespace Internals {
 
     NativeSocket::NativeSocket() :
         Socket(invalid_socket)
+#if defined(SOCKET_IO_COUNTERS)
+        , Counters(nullptr)
+#endif
     {}
 
-    NativeSocket::NativeSocket(NativeSocket&& other) :
+    NativeSocket::NativeSocket(NativeSocket&& other) noexcept :
         Socket(other.Socket)
+#if defined(SOCKET_IO_COUNTERS)
+        , Counters(other.Counters)
+#endif
     {
         other.Socket = invalid_socket;
+#if defined(SOCKET_IO_COUNTERS)
+        other.Counters = nullptr;
+#endif
     }
 
-    NativeSocket& NativeSocket::operator=(NativeSocket&& other)
+    NativeSocket& NativeSocket::operator=(NativeSocket&& other) noexcept
     {
         socket_t tmp = other.Socket;
         other.Socket = invalid_socket;
         Socket = tmp;
+#if defined(SOCKET_IO_COUNTERS)
+        // The blocks are swapped, other releases this one.
+        std::swap(Counters, other.Counters);
+#endif
 
         return *this;
     }
@@ -56,6 +76,17 @@ namespace Internals {
     NativeSocket::~NativeSocket()
     {
         Close();
+#if defined(SOCKET_IO_COUNTERS)
+        ReleaseIoCounters(*this);
+#endif
+    }
+
+    void NativeSocket::Swap(NativeSocket& other) noexcept
+    {
+        std::swap(Socket, other.Socket);
+#if defined(SOCKET_IO_COUNTERS)
+        std::swap(Counters, other.Counters);
+#endif
     }
 
     NetworkLibrary::Error NativeSocket::CreateSocket(Internals::AddressFamily af, Internals::SocketTypes type, Internals::SocketProtocols proto)
@@ -64,9 +95,14 @@ namespace Internals {
         return socket(af, type, proto, *this);
     }
 
-    NetworkLibrary::Error NativeSocket::SetSockOption(int32_t option_name, const void* value, socklen_t optlen)
+    NetworkLibrary::Error NativeSocket::SetSockOption(int32_t level, int32_t option_name, const void* value, socklen_t optlen)
     {
-        return Internals::setsockopt(*this, option_name, value, optlen);
+        return Internals::setsockopt(*this, level, option_name, value, optlen);
+    }
+
+    NetworkLibrary::Error NativeSocket::GetSockOption(int32_t level, int32_t option_name, void* value, socklen_t* optlen) const
+    {
+        return Internals::getsockopt(*this, level, option_name, value, optlen);
     }
 
     NetworkLibrary::Error NativeSocket::SetNonBlocking(bool non_blocking)
@@ -91,6 +127,59 @@ namespace Internals {
         }
     }
 
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+    // AcceptReserve
+
+    AcceptReserve& AcceptReserve::Inst() noexcept
+    {
+        static AcceptReserve inst;
+        return inst;
+    }
+
+    AcceptReserve::AcceptReserve() :
+        _Fd(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    {}
+
+    AcceptReserve::~AcceptReserve()
+    {
+        if (_Fd != -1)
+            ::close(_Fd);
+    }
+
+    size_t AcceptReserve::Shed(NativeSocket const& s)
+    {
+        std::lock_guard<std::mutex> lk(_Mutex);
+        size_t shed_count = 0;
+
+        if (_Fd == -1)
+        {// The reserve couldn't be restored last time, try again now.
+            _Fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (_Fd == -1)
+                return 0;
+        }
+
+        ::close(_Fd);
+        // The listener might be blocking, only accept what is already pending.
+        while (has_pending_input(s))
+        {
+            int fd = ::accept(s.Socket, nullptr, nullptr);
+            if (fd == -1)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+
+                break;
+            }
+
+            ::close(fd);
+            ++shed_count;
+        }
+        _Fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+        return shed_count;
+    }
+#endif
+
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) MakeUnknownError(int native_error)
     {
         ::NetworkLibrary::Error error;
@@ -131,6 +220,8 @@ namespace Internals {
             case ::NetworkLibrary::Error::TimedOut              : error.NativeCode = WSAETIMEDOUT      ; break;
             case ::NetworkLibrary::Error::HostDown              : error.NativeCode = WSAEHOSTDOWN      ; break;
             case ::NetworkLibrary::Error::HostUnreachable       : error.NativeCode = WSAEHOSTUNREACH   ; break;
+            case ::NetworkLibrary::Error::TooManyOpenFiles      : error.NativeCode = WSAEMFILE         ; break;
+            case ::NetworkLibrary::Error::NotSupported          : error.NativeCode = WSAEOPNOTSUPP     ; break;
 
             case ::NetworkLibrary::Error::WsaNotInitialised     : error.NativeCode = WSANOTINITIALISED ; break;
             case ::NetworkLibrary::Error::WsaNetDown            : error.NativeCode = WSAENETDOWN       ; break;
@@ -158,6 +249,8 @@ namespace Internals {
             case ::NetworkLibrary::Error::TimedOut              : error.NativeCode = ETIMEDOUT      ; break;
             case ::NetworkLibrary::Error::HostDown              : error.NativeCode = EHOSTDOWN      ; break;
             case ::NetworkLibrary::Error::HostUnreachable       : error.NativeCode = EHOSTUNREACH   ; break;
+            case ::NetworkLibrary::Error::TooManyOpenFiles      : error.NativeCode = EMFILE         ; break;
+            case ::NetworkLibrary::Error::NotSupported          : error.NativeCode = EOPNOTSUPP     ; break;
 #endif
         }
 
@@ -192,6 +285,9 @@ namespace Internals {
             case WSAETIMEDOUT      : error.ErrorCode = ::NetworkLibrary::Error::TimedOut             ; break;
             case WSAEHOSTDOWN      : error.ErrorCode = ::NetworkLibrary::Error::HostDown             ; break;
             case WSAEHOSTUNREACH   : error.ErrorCode = ::NetworkLibrary::Error::HostUnreachable      ; break;
+            case WSAEMFILE         : error.ErrorCode = ::NetworkLibrary::Error::TooManyOpenFiles     ; break;
+            case WSAEOPNOTSUPP     :
+            case WSAENOPROTOOPT    : error.ErrorCode = ::NetworkLibrary::Error::NotSupported         ; break;
 
             case WSANOTINITIALISED : error.ErrorCode = ::NetworkLibrary::Error::WsaNotInitialised     ; break;
             case WSAENETDOWN       : error.ErrorCode = ::NetworkLibrary::Error::WsaNetDown            ; break;
@@ -219,6 +315,10 @@ namespace Internals {
             case ETIMEDOUT      : error.ErrorCode = ::NetworkLibrary::Error::TimedOut            ; break;
             case EHOSTDOWN      : error.ErrorCode = ::NetworkLibrary::Error::HostDown            ; break;
             case EHOSTUNREACH   : error.ErrorCode = ::NetworkLibrary::Error::HostUnreachable     ; break;
+            case EMFILE         :
+            case ENFILE         : error.ErrorCode = ::NetworkLibrary::Error::TooManyOpenFiles    ; break;
+            case EOPNOTSUPP     :
+            case ENOPROTOOPT    : error.ErrorCode = ::NetworkLibrary::Error::NotSupported        ; break;
 #endif
             case 0              : error.ErrorCode = ::NetworkLibrary::Error::NoError; break;
             default             : error.ErrorCode = ::NetworkLibrary::Error::UnknownError;
@@ -236,12 +336,93 @@ namespace Internals {
 #endif
     }
 
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) LastResult()
+    {
+#if defined(SOCKET_OS_WINDOWS)
+        return ::NetworkLibrary::Result(WSAGetLastError());
+#elif defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+        return ::NetworkLibrary::Result(errno);
+#endif
+    }
+
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) accept(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr, Internals::NativeSocket& out)
     {
         sockaddr* native_addr = (sockaddr*)addr.GetAddr();
-        socklen_t addr_length = static_cast<socklen_t>(addr.GetLength());
+        socklen_t addr_length = static_cast<socklen_t>(addr.GetStorageSize());
         out.Socket = ::accept(s.Socket, native_addr, &addr_length);
-        return out.IsValid() ? MakeErrorFromSocketCode(Error::NoError) : LastError();
+        if (!out.IsValid())
+            return LastError();
+
+#if defined(SOCKET_IO_COUNTERS)
+        AttachIoCounters(out);
+#endif
+        return MakeErrorFromSocketCode(Error::NoError);
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) accept4(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr* addr, Internals::NativeSocket& out)
+    {
+        sockaddr* native_addr = addr == nullptr ? nullptr : (sockaddr*)addr->GetAddr();
+        socklen_t addr_length = addr == nullptr ? 0 : static_cast<socklen_t>(addr->GetStorageSize());
+        socklen_t* p_addr_length = addr == nullptr ? nullptr : &addr_length;
+
+        out.Close();
+#if defined(SOCKET_OS_LINUX)
+        // Non-blocking and close-on-exec in the same syscall.
+        do
+        {
+            out.Socket = ::accept4(s.Socket, native_addr, p_addr_length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        } while (!out.IsValid() && errno == EINTR);
+
+        if (!out.IsValid())
+            return LastError();
+
+    #if defined(SOCKET_IO_COUNTERS)
+        AttachIoCounters(out);
+    #endif
+        return MakeErrorFromSocketCode(Error::NoError);
+#else
+        out.Socket = ::accept(s.Socket, native_addr, p_addr_length);
+        if (!out.IsValid())
+            return LastError();
+
+    #if defined(SOCKET_IO_COUNTERS)
+        AttachIoCounters(out);
+    #endif
+
+    #if defined(SOCKET_OS_APPLE)
+        ::fcntl(out.Socket, F_SETFD, FD_CLOEXEC);
+    #endif
+        return out.SetNonBlocking(true);
+#endif
+    }
+
+    SOCKET_HIDE_SYMBOLS(size_t) shed_pending_connections(Internals::NativeSocket const& s)
+    {
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+        return AcceptReserve::Inst().Shed(s);
+#else
+        // Sockets don't use file descriptors slots on Windows, nothing to release.
+        return 0;
+#endif
+    }
+
+    SOCKET_HIDE_SYMBOLS(bool) is_non_blocking(Internals::NativeSocket const& s)
+    {
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+        int flags = ::fcntl(s.Socket, F_GETFL);
+        return flags != -1 && (flags & O_NONBLOCK) != 0;
+#else
+        // Windows can't query the blocking mode, assume the worst.
+        return false;
+#endif
+    }
+
+    SOCKET_HIDE_SYMBOLS(bool) has_pending_input(Internals::NativeSocket const& s)
+    {
+        pollfd fd{};
+        fd.fd = s.Socket;
+        fd.events = POLLIN;
+        return Internals::poll(&fd, 1, 0) == 1 && (fd.revents & POLLIN) != 0;
     }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) bind(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr)
@@ -264,7 +445,7 @@ namespace Internals {
     {
         sockaddr const* native_addr = (sockaddr const*)addr.GetAddr();
         socklen_t addr_length = static_cast<socklen_t>(addr.GetLength());
-        return ::connect(s.Socket, native_addr, addr_length) != -1 ? MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError) : LastError();
+        return ::connect(s.Socket, native_addr, addr_length) != -1 ? MakeNoError() : LastError();
     }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) ioctlsocket(Internals::NativeSocket const& s, Internals::CmdName cmd, unsigned long* arg)
@@ -281,111 +462,326 @@ namespace Internals {
         return error;
     }
 
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) setsockopt(Internals::NativeSocket const& s, int optname, const void* optval, socklen_t optlen)
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) setsockopt(Internals::NativeSocket const& s, int level, int optname, const void* optval, socklen_t optlen)
     {
-        ::NetworkLibrary::Error error;
+        int result;
 
 #if defined(SOCKET_OS_WINDOWS)
-        error.NativeCode = ::setsockopt(s.Socket, SOL_SOCKET, static_cast<int>(optname), reinterpret_cast<const char*>(optval), optlen);
+        result = ::setsockopt(s.Socket, level, static_cast<int>(optname), reinterpret_cast<const char*>(optval), optlen);
 #elif defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
-        error.NativeCode = ::setsockopt(s.Socket, SOL_SOCKET, static_cast<int>(optname), optval, static_cast<socklen_t>(optlen));
+        result = ::setsockopt(s.Socket, level, static_cast<int>(optname), optval, static_cast<socklen_t>(optlen));
 #endif
-        error.ErrorCode = error.NativeCode == 0 ? ::NetworkLibrary::Error::NoError : ::NetworkLibrary::Error::UnknownError;
-        return error;
+        return result == 0 ? MakeNoError() : LastError();
     }
 
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) getsockopt(Internals::NativeSocket const& s, int optname, void* optval, socklen_t* optlen)
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) getsockopt(Internals::NativeSocket const& s, int level, int optname, void* optval, socklen_t* optlen)
     {
-        ::NetworkLibrary::Error error;
+        int result;
 
 #if defined(SOCKET_OS_WINDOWS)
-        error.NativeCode = ::getsockopt(s.Socket, SOL_SOCKET, optname, reinterpret_cast<char*>(optval), optlen);
+        result = ::getsockopt(s.Socket, level, optname, reinterpret_cast<char*>(optval), optlen);
 #elif defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
-        error.NativeCode = ::getsockopt(s.Socket, SOL_SOCKET, optname, optval, optlen);
+        result = ::getsockopt(s.Socket, level, optname, optval, optlen);
+#endif
+        return result == 0 ? MakeNoError() : LastError();
+    }
+
+#if defined(SOCKET_OS_LINUX)
+    // Copy of the kernel tcp_info layout up to tcpi_delivery_rate, the libc one lags behind the kernel.
+    // The kernel copies min(optlen, its size), older kernels return a shorter struct.
+    struct LinuxTcpInfo
+    {
+        uint8_t  tcpi_state;
+        uint8_t  tcpi_ca_state;
+        uint8_t  tcpi_retransmits;
+        uint8_t  tcpi_probes;
+        uint8_t  tcpi_backoff;
+        uint8_t  tcpi_options;
+        uint8_t  tcpi_wscale;
+        uint8_t  tcpi_flags;
+
+        uint32_t tcpi_rto;
+        uint32_t tcpi_ato;
+        uint32_t tcpi_snd_mss;
+        uint32_t tcpi_rcv_mss;
+
+        uint32_t tcpi_unacked;
+        uint32_t tcpi_sacked;
+        uint32_t tcpi_lost;
+        uint32_t tcpi_retrans;
+        uint32_t tcpi_fackets;
+
+        uint32_t tcpi_last_data_sent;
+        uint32_t tcpi_last_ack_sent;
+        uint32_t tcpi_last_data_recv;
+        uint32_t tcpi_last_ack_recv;
+
+        uint32_t tcpi_pmtu;
+        uint32_t tcpi_rcv_ssthresh;
+        uint32_t tcpi_rtt;
+        uint32_t tcpi_rttvar;
+        uint32_t tcpi_snd_ssthresh;
+        uint32_t tcpi_snd_cwnd;
+        uint32_t tcpi_advmss;
+        uint32_t tcpi_reordering;
+
+        uint32_t tcpi_rcv_rtt;
+        uint32_t tcpi_rcv_space;
+
+        uint32_t tcpi_total_retrans;
+
+        uint64_t tcpi_pacing_rate;
+        uint64_t tcpi_max_pacing_rate;
+        uint64_t tcpi_bytes_acked;
+        uint64_t tcpi_bytes_received;
+        uint32_t tcpi_segs_out;
+        uint32_t tcpi_segs_in;
+
+        uint32_t tcpi_notsent_bytes;
+        uint32_t tcpi_min_rtt;
+        uint32_t tcpi_data_segs_in;
+        uint32_t tcpi_data_segs_out;
+
+        uint64_t tcpi_delivery_rate;
+
+        uint64_t tcpi_busy_time;
+        uint64_t tcpi_rwnd_limited;
+        uint64_t tcpi_sndbuf_limited;
+
+        uint32_t tcpi_delivered;
+        uint32_t tcpi_delivered_ce;
+
+        uint64_t tcpi_bytes_sent;
+    };
+#endif
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) gettcpinfo(Internals::NativeSocket const& s, NetworkLibrary::TcpInfo& info)
+    {
+        info = NetworkLibrary::TcpInfo{};
+
+#if defined(SOCKET_OS_LINUX)
+        LinuxTcpInfo native_info{};
+        socklen_t length = sizeof(native_info);
+        if (::getsockopt(s.Socket, IPPROTO_TCP, TCP_INFO, &native_info, &length) != 0)
+            return LastError();
+
+        info.Established = native_info.tcpi_state == TCP_ESTABLISHED;
+        info.Rtt         = std::chrono::microseconds(native_info.tcpi_rtt);
+        info.RttVar      = std::chrono::microseconds(native_info.tcpi_rttvar);
+        info.SendCwnd    = native_info.tcpi_snd_cwnd;
+        info.SendMss     = native_info.tcpi_snd_mss;
+        info.Retransmits = native_info.tcpi_total_retrans;
+        info.Unacked     = native_info.tcpi_unacked;
+        info.BytesAcked  = native_info.tcpi_bytes_acked;
+        // Same estimation as the kernel: packets_out - (sacked_out + lost_out) + retrans_out
+        uint32_t left_network = native_info.tcpi_sacked + native_info.tcpi_lost;
+        if (native_info.tcpi_unacked > left_network)
+            info.BytesInFlight = (native_info.tcpi_unacked - left_network + native_info.tcpi_retrans) * native_info.tcpi_snd_mss;
+        else
+            info.BytesInFlight = native_info.tcpi_retrans * native_info.tcpi_snd_mss;
+
+        if (length >= offsetof(LinuxTcpInfo, tcpi_delivery_rate) + sizeof(native_info.tcpi_delivery_rate))
+            info.DeliveryRate = native_info.tcpi_delivery_rate;
+
+        if (length >= offsetof(LinuxTcpInfo, tcpi_bytes_sent) + sizeof(native_info.tcpi_bytes_sent))
+            info.BytesSent = native_info.tcpi_bytes_sent;
+
+        return MakeNoError();
+#elif defined(SOCKET_OS_APPLE) && defined(TCP_CONNECTION_INFO)
+        tcp_connection_info native_info{};
+        socklen_t length = sizeof(native_info);
+        if (::getsockopt(s.Socket, IPPROTO_TCP, TCP_CONNECTION_INFO, &native_info, &length) != 0)
+            return LastError();
+
+        info.Established   = native_info.tcpi_state == TCPS_ESTABLISHED;
+        info.Rtt           = std::chrono::milliseconds(native_info.tcpi_srtt);
+        info.RttVar        = std::chrono::milliseconds(native_info.tcpi_rttvar);
+        info.SendMss       = native_info.tcpi_maxseg;
+        info.SendCwnd      = native_info.tcpi_maxseg == 0 ? 0 : native_info.tcpi_snd_cwnd / native_info.tcpi_maxseg;
+        info.Retransmits   = static_cast<uint32_t>(native_info.tcpi_txretransmitpackets);
+        info.BytesSent     = native_info.tcpi_txbytes;
+        // Closest available value, it also counts the bytes not sent yet.
+        info.BytesInFlight = native_info.tcpi_snd_sbbytes;
+
+        return MakeNoError();
+#else
+        (void)s;
+        return MakeErrorFromSocketCode(::NetworkLibrary::Error::NotSupported);
 #endif
-        error.ErrorCode = error.NativeCode == 0 ? ::NetworkLibrary::Error::NoError : ::NetworkLibrary::Error::UnknownError;
-        return error;
+    }
+
+    static bool _CopyMulticastAddr(sockaddr_storage& out, NetworkLibrary::BasicAddr const& addr)
+    {
+        if (addr.GetLength() > sizeof(out))
+            return false;
+
+        memcpy(&out, addr.GetAddr(), addr.GetLength());
+#if defined(SOCKET_OS_APPLE)
+        reinterpret_cast<sockaddr*>(&out)->sa_len = static_cast<uint8_t>(addr.GetLength());
+#endif
+        return true;
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) multicastmembership(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& group, NetworkLibrary::BasicAddr const* source, uint32_t iface_index, bool join)
+    {
+        const int level = group.GetFamily() == AF_INET6 ? IPPROTO_IPV6 : IPPROTO_IP;
+        int result;
+
+        if (source == nullptr)
+        {
+            group_req request{};
+            request.gr_interface = iface_index;
+            if (!_CopyMulticastAddr(request.gr_group, group))
+                return MakeErrorFromSocketCode(Error::InVal);
+
+            result = ::setsockopt(s.Socket, level, join ? MCAST_JOIN_GROUP : MCAST_LEAVE_GROUP, reinterpret_cast<const char*>(&request), sizeof(request));
+        }
+        else
+        {
+            group_source_req request{};
+            request.gsr_interface = iface_index;
+            if (!_CopyMulticastAddr(request.gsr_group, group) || !_CopyMulticastAddr(request.gsr_source, *source))
+                return MakeErrorFromSocketCode(Error::InVal);
+
+            result = ::setsockopt(s.Socket, level, join ? MCAST_JOIN_SOURCE_GROUP : MCAST_LEAVE_SOURCE_GROUP, reinterpret_cast<const char*>(&request), sizeof(request));
+        }
+
+        return result == 0 ? MakeNoError() : LastError();
+    }
+
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) setmulticastiface(Internals::NativeSocket const& s, int family, uint32_t iface_index)
+    {
+        int result;
+
+        if (family == AF_INET6)
+        {
+            result = ::setsockopt(s.Socket, IPPROTO_IPV6, IPV6_MULTICAST_IF, reinterpret_cast<const char*>(&iface_index), sizeof(iface_index));
+        }
+        else
+        {
+#if defined(SOCKET_OS_WINDOWS)
+            // An index in network order is taken instead of an address, in the 0.0.0.0/8 range.
+            DWORD index = htonl(iface_index);
+            result = ::setsockopt(s.Socket, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&index), sizeof(index));
+#elif defined(SOCKET_OS_APPLE)
+            result = ::setsockopt(s.Socket, IPPROTO_IP, IP_MULTICAST_IFINDEX, &iface_index, sizeof(iface_index));
+#else
+            ip_mreqn request{};
+            request.imr_ifindex = static_cast<int>(iface_index);
+            result = ::setsockopt(s.Socket, IPPROTO_IP, IP_MULTICAST_IF, &request, sizeof(request));
+#endif
+        }
+
+        return result == 0 ? MakeNoError() : LastError();
     }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) getsockname(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr)
     {
-        socklen_t sock_len = addr.GetLength();
+        socklen_t sock_len = static_cast<socklen_t>(addr.GetStorageSize());
         return MakeErrorFromNative(::getsockname(s.Socket, reinterpret_cast<sockaddr*>(addr.GetAddr()), &sock_len));
     }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) listen(Internals::NativeSocket const& s, int waiting_connection)
     {
-        return ::listen(s.Socket, waiting_connection) != -1 ? MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError) : LastError();
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+        // The spare descriptor must be taken before the process runs out of them.
+        AcceptReserve::Inst();
+#endif
+        return ::listen(s.Socket, waiting_connection) != -1 ? MakeNoError() : LastError();
     }
 
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) recv(Internals::NativeSocket const& s, void* buffer, size_t& len, int32_t flags)
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) recv(Internals::NativeSocket const& s, void* buffer, size_t& len, int32_t flags)
     {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        LatencyScope latency(LatencyMetric::Receive);
+#endif
         int result = ::recv(s.Socket, reinterpret_cast<char*>(buffer), len, flags);
+#if defined(SOCKET_IO_COUNTERS)
+        CountReceive(s, result);
+#endif
         if (result == -1)
         {
             len = 0;
-            return LastError();
+            return LastResult();
         }
 
         len = result;
-        return MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError);
+        return ::NetworkLibrary::Result();
     }
 
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) send(Internals::NativeSocket const& s, const void* buffer, size_t& len, int32_t flags)
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) send(Internals::NativeSocket const& s, const void* buffer, size_t& len, int32_t flags)
     {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        LatencyScope latency(LatencyMetric::Send);
+#endif
         int result = ::send(s.Socket, reinterpret_cast<char const*>(buffer), len, flags);
+#if defined(SOCKET_IO_COUNTERS)
+        CountSend(s, len, result);
+#endif
 
         if (result == -1)
         {
             len = 0;
-            return LastError();
+            return LastResult();
         }
 
         len = result;
-        return MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError);
+        return ::NetworkLibrary::Result();
     }
 
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) recvfrom(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr, void* buffer, size_t& len, int32_t flags)
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) recvfrom(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr, void* buffer, size_t& len, int32_t flags)
     {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        LatencyScope latency(LatencyMetric::Receive);
+#endif
         sockaddr* native_addr = (sockaddr*)addr.GetAddr();
-        socklen_t sock_len = (socklen_t)addr.GetLength();
+        socklen_t sock_len = (socklen_t)addr.GetStorageSize();
         int result = ::recvfrom(s.Socket, reinterpret_cast<char*>(buffer), len, flags, native_addr, &sock_len);
+#if defined(SOCKET_IO_COUNTERS)
+        CountReceive(s, result);
+#endif
 
         if (result == -1)
         {
             len = 0;
-            return LastError();
+            return LastResult();
         }
 
         len = result;
-        return MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError);
+        return ::NetworkLibrary::Result();
     }
 
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) sendto(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr, const void* buffer, size_t& len, int32_t flags)
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) sendto(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr, const void* buffer, size_t& len, int32_t flags)
     {
+#if defined(SOCKET_LATENCY_HISTOGRAMS)
+        LatencyScope latency(LatencyMetric::Send);
+#endif
         sockaddr const* native_addr = (sockaddr const*)addr.GetAddr();
         socklen_t sock_len = (socklen_t)addr.GetLength();
         int result = ::sendto(s.Socket, reinterpret_cast<const char*>(buffer), len, flags, native_addr, sock_len);
+#if defined(SOCKET_IO_COUNTERS)
+        CountSend(s, len, result);
+#endif
 
         if (result == -1)
         {
             len = 0;
-            return LastError();
+            return LastResult();
         }
 
         len = result;
-        return MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError);
+        return ::NetworkLibrary::Result();
     }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) shutdown(Internals::NativeSocket const& s, Internals::ShutdownFlags how)
     {
-        return ::shutdown(s.Socket, static_cast<int32_t>(how)) == -1 ? MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError) : LastError();
+        return ::shutdown(s.Socket, static_cast<int32_t>(how)) == -1 ? MakeNoError() : LastError();
     }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) socket(Internals::AddressFamily af, Internals::SocketTypes type, Internals::SocketProtocols proto, Internals::NativeSocket& s)
     {
         s.Socket = ::socket(static_cast<int>(af), static_cast<int>(type), static_cast<int>(proto));
-        ::NetworkLibrary::Error error = s.IsValid() ? MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError) : LastError();
+        ::NetworkLibrary::Error error = s.IsValid() ? MakeNoError() : LastError();
 #if defined(SOCKET_OS_WINDOWS)
         if (error.NativeCode == WSANOTINITIALISED)
         {
@@ -393,9 +789,13 @@ namespace Internals {
             if (error.ErrorCode == ::NetworkLibrary::Error::NoError)
             {// Retry after WinSock initialization.
                 s.Socket = ::socket(static_cast<int>(af), static_cast<int>(type), static_cast<int>(proto));
-                error = s.IsValid() ? MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError) : LastError();
+                error = s.IsValid() ? MakeNoError() : LastError();
             }
         }
+#endif
+#if defined(SOCKET_IO_COUNTERS)
+        if (s.IsValid())
+            AttachIoCounters(s);
 #endif
         return error;
     }
@@ -437,7 +837,7 @@ namespace Internals {
         {
             case -1: return MakeErrorFromSocketCode(::NetworkLibrary::Error::AfNotSupported);
             case  0: return MakeErrorFromSocketCode(::NetworkLibrary::Error::InVal);
-            case  1: return MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError);
+            case  1: return MakeNoError();
             default: return MakeErrorFromSocketCode(::NetworkLibrary::Error::UnknownError);
         }
     }
@@ -470,7 +870,7 @@ namespace Internals {
         }
         str_addr = buff;
 
-        return MakeErrorFromSocketCode(::NetworkLibrary::Error::NoError);
+        return MakeNoError();
     }
 
     SOCKET_HIDE_SYMBOLS(int) select(int nfds, fd_set* readfd, fd_set* writefd, fd_set* exceptfd, timeval* timeout)
@@ -486,5 +886,49 @@ namespace Internals {
         return ::poll(fds, nfds, timeout);
 #endif
     }
+
+    SOCKET_HIDE_SYMBOLS(int) ppoll(pollfd* fds, size_t nfds, std::chrono::microseconds timeout)
+    {
+#if defined(SOCKET_OS_LINUX)
+        if (timeout.count() < 0)
+            return ::ppoll(fds, nfds, nullptr, nullptr);
+
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+        ts.tv_nsec = static_cast<long>((timeout.count() % 1000000) * 1000);
+        return ::ppoll(fds, nfds, &ts, nullptr);
+#else
+        // No sub-millisecond wait, round up so a pacing delay isn't turned into a busy loop.
+        int timeout_ms = timeout.count() < 0 ? -1 : static_cast<int>((timeout.count() + 999) / 1000);
+        return poll(fds, nfds, timeout_ms);
+#endif
+    }
+
+    SOCKET_HIDE_SYMBOLS(void) NativeToPollFlags(pollfd const* fds, int16_t* out_flags, size_t count)
+    {
+        size_t i = 0;
+
+#if defined(SOCKET_SSE2_REVENTS)
+        static_assert(sizeof(pollfd) == 8 && offsetof(pollfd, revents) == 6, "The SSE2 revents path expects a 8 bytes pollfd.");
+
+        if (_PollFlagsIdentity)
+        {
+            const __m128i mask = _mm_set1_epi32(_PollFlagsMask);
+            // 4 pollfds per loop: moves each revents to the bottom of its pollfd, then packs them next to each other.
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128i first  = _mm_srli_epi64(_mm_loadu_si128(reinterpret_cast<__m128i const*>(fds + i)), 48);
+                __m128i second = _mm_srli_epi64(_mm_loadu_si128(reinterpret_cast<__m128i const*>(fds + i + 2)), 48);
+                // Masked first, the 32 bits lanes are below 0x8000 and the signed packs never saturate.
+                __m128i packed = _mm_packs_epi32(_mm_and_si128(first, mask), _mm_and_si128(second, mask));
+                packed = _mm_packs_epi32(packed, packed);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out_flags + i), packed);
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
+            out_flags[i] = NativeToPollFlags(fds[i].revents);
+    }
 }
 }
\ No newline at end of file
@@ -43,13 +43,16 @@
     #include <sys/poll.h>
 
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <net/if.h>
 
     #include <ifaddrs.h>// getifaddrs
+    #include <fcntl.h>
 #elif defined(SOCKET_OS_APPLE)
     #include <unistd.h>
     #include <netdb.h>
     #include <errno.h>
+    #include <fcntl.h>
 
     #include <arpa/inet.h>
 
@@ -63,6 +66,8 @@
     #include <sys/filio.h>
 
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <netinet/tcp_fsm.h>// TCPS_ESTABLISHED
     #include <net/if.h>
 
     #include <ifaddrs.h>// getifaddrs
@@ -71,122 +76,234 @@
 #define SOCKET_HIDE_SYMBOLS(return_type) SOCKET_HIDE_API(return_type, SOCKET_CALL_DEFAULT)
 
 #include <cassert>
+#include <cstddef>
 #include <limits>
+#include <mutex>
 
 namespace NetworkLibrary {
 namespace Internals {
-    static int32_t SocketFlagsToNative(int32_t flags)
+    // Flag translation tables, built at compile time from the (library, native) pairs below.
+    // When every native value is the library one shifted right by the same amount the translation is a mask and a shift,
+    // otherwise it goes through the tables.
+    template<typename T>
+    struct FlagPair
     {
-        int32_t native = 0;
+        T Flag;
+        T Native;
+    };
 
-        if (flags & SocketFlags::oob)
-            native |= MSG_OOB;
+    template<typename T, size_t N>
+    constexpr bool FlagsAreIdentity(FlagPair<T> const (&pairs)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            if (pairs[i].Flag != pairs[i].Native)
+                return false;
+        }
 
-        if (flags & SocketFlags::peek)
-            native |= MSG_PEEK;
+        return true;
+    }
 
-        if (flags & SocketFlags::dontroute)
-            native |= MSG_DONTROUTE;
+    // The right shift turning every library value in its native value, -1 if there is none.
+    template<typename T, size_t N>
+    constexpr int FlagsShift(FlagPair<T> const (&pairs)[N])
+    {
+        for (int shift = 0; shift < 16; ++shift)
+        {
+            size_t i = 0;
+            while (i < N && (pairs[i].Flag >> shift) == pairs[i].Native && (pairs[i].Native << shift) == pairs[i].Flag)
+                ++i;
 
-        return native;
+            if (i == N)
+                return shift;
+        }
+
+        return -1;
     }
 
-    static int16_t PollFlagsToNative(int16_t flags)
+    template<typename T, size_t N>
+    constexpr T FlagsMask(FlagPair<T> const (&pairs)[N])
     {
-        int16_t native = 0;
-
-        if(flags & PollFlags::in)
-            native |= POLLIN;
+        T mask = 0;
+        for (size_t i = 0; i < N; ++i)
+            mask = static_cast<T>(mask | pairs[i].Flag);
 
-        if (flags & PollFlags::pri)
-            native |= POLLPRI;
+        return mask;
+    }
 
-        if (flags & PollFlags::out)
-            native |= POLLOUT;
+    // Translates a 16 bits bitfield with 2 lookups, one per byte.
+    template<typename T>
+    struct FlagTable
+    {
+        T Low[256];
+        T High[256];
 
-        if (flags & PollFlags::err)
-            native |= POLLERR;
+        template<size_t N>
+        constexpr FlagTable(FlagPair<T> const (&pairs)[N], bool to_native) :
+            Low(),
+            High()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                for (size_t j = 0; j < N; ++j)
+                {
+                    uint32_t from = static_cast<uint16_t>(to_native ? pairs[j].Flag : pairs[j].Native);
+                    T to = to_native ? pairs[j].Native : pairs[j].Flag;
 
-        if (flags & PollFlags::hup)
-            native |= POLLHUP;
+                    if (from & i)
+                        Low[i] = static_cast<T>(Low[i] | to);
 
-        if (flags & PollFlags::nval)
-            native |= POLLNVAL;
+                    if (from & (i << 8))
+                        High[i] = static_cast<T>(High[i] | to);
+                }
+            }
+        }
 
-        if (flags & PollFlags::rdnorm)
-            native |= POLLRDNORM;
+        constexpr T operator()(T flags) const
+        {
+            return static_cast<T>(Low[static_cast<uint16_t>(flags) & 0xff] | High[static_cast<uint16_t>(flags) >> 8]);
+        }
+    };
 
-        if (flags & PollFlags::rdband)
-            native |= POLLRDBAND;
+    // Maps small library values (option names, levels) to their native value.
+    template<size_t Size>
+    struct ValueTable
+    {
+        int32_t Values[Size];
 
-        if (flags & PollFlags::wrnorm)
-            native |= POLLWRNORM;
+        template<size_t N>
+        constexpr ValueTable(FlagPair<int32_t> const (&pairs)[N], int32_t missing) :
+            Values()
+        {
+            for (size_t i = 0; i < Size; ++i)
+                Values[i] = missing;
 
-        if (flags & PollFlags::wrband)
-            native |= POLLWRBAND;
+            for (size_t i = 0; i < N; ++i)
+                Values[pairs[i].Flag] = pairs[i].Native;
+        }
 
-        return native;
-    }
+        constexpr int32_t operator()(int32_t value, int32_t missing) const
+        {
+            return static_cast<uint32_t>(value) < Size ? Values[value] : missing;
+        }
+    };
 
-    static int16_t NativeToPollFlags(int16_t native)
-    {
-        int16_t flags = 0;
+    static constexpr FlagPair<int32_t> _SocketFlagsPairs[] = {
+        { SocketFlags::oob      , MSG_OOB       },
+        { SocketFlags::peek     , MSG_PEEK      },
+        { SocketFlags::dontroute, MSG_DONTROUTE },
+    };
 
-        if (native & POLLIN)
-            flags |= PollFlags::in;
+    static constexpr FlagPair<int16_t> _PollFlagsPairs[] = {
+        { PollFlags::in    , POLLIN     },
+        { PollFlags::pri   , POLLPRI    },
+        { PollFlags::out   , POLLOUT    },
+        { PollFlags::err   , POLLERR    },
+        { PollFlags::hup   , POLLHUP    },
+        { PollFlags::nval  , POLLNVAL   },
+        { PollFlags::rdnorm, POLLRDNORM },
+        { PollFlags::rdband, POLLRDBAND },
+        { PollFlags::wrnorm, POLLWRNORM },
+        { PollFlags::wrband, POLLWRBAND },
+    };
 
-        if (native & POLLPRI)
-            flags |= PollFlags::pri;
+    static constexpr FlagPair<int32_t> _OptionNamePairs[] = {
+        { OptionName::so_debug    , SO_DEBUG     },
+        { OptionName::so_reuseaddr, SO_REUSEADDR },
+        { OptionName::so_keepalive, SO_KEEPALIVE },
+        { OptionName::so_dontroute, SO_DONTROUTE },
+        { OptionName::so_broadcast, SO_BROADCAST },
+        { OptionName::so_linger   , SO_LINGER    },
+        { OptionName::so_oobinline, SO_OOBINLINE },
+        { OptionName::so_sndbuf   , SO_SNDBUF    },
+        { OptionName::so_rcvbuf   , SO_RCVBUF    },
+        { OptionName::so_sndlowat , SO_SNDLOWAT  },
+        { OptionName::so_rcvlowat , SO_RCVLOWAT  },
+        { OptionName::so_sndtimeo , SO_SNDTIMEO  },
+        { OptionName::so_rcvtimeo , SO_RCVTIMEO  },
+        { OptionName::so_error    , SO_ERROR     },
+        { OptionName::so_type     , SO_TYPE      },
+#if defined(SO_REUSEPORT)
+        { OptionName::so_reuseport, SO_REUSEPORT },
+#endif
+#if defined(SO_MAX_PACING_RATE)
+        { OptionName::so_max_pacing_rate, SO_MAX_PACING_RATE },
+#endif
 
-        if (native & POLLOUT)
-            flags |= PollFlags::out;
+        { OptionName::tcp_nodelay      , TCP_NODELAY       },
+#if defined(TCP_QUICKACK)
+        { OptionName::tcp_quickack     , TCP_QUICKACK      },
+#endif
+#if defined(TCP_NOTSENT_LOWAT)
+        { OptionName::tcp_notsent_lowat, TCP_NOTSENT_LOWAT },
+#endif
+#if defined(TCP_USER_TIMEOUT)
+        { OptionName::tcp_user_timeout , TCP_USER_TIMEOUT  },
+#endif
+#if defined(TCP_DEFER_ACCEPT)
+        { OptionName::tcp_defer_accept , TCP_DEFER_ACCEPT  },
+#endif
+        { OptionName::ip_tos           , IP_TOS            },
+        { OptionName::ip_multicast_ttl , IP_MULTICAST_TTL  },
+        { OptionName::ip_multicast_loop, IP_MULTICAST_LOOP },
+        { OptionName::ipv6_v6only        , IPV6_V6ONLY         },
+        { OptionName::ipv6_multicast_hops, IPV6_MULTICAST_HOPS },
+        { OptionName::ipv6_multicast_loop, IPV6_MULTICAST_LOOP },
+    };
 
-        if (native & POLLERR)
-            flags |= PollFlags::err;
+    static constexpr FlagPair<int32_t> _OptionLevelPairs[] = {
+        { OptionLevel::sol_socket, SOL_SOCKET   },
+        { OptionLevel::tcp       , IPPROTO_TCP  },
+        { OptionLevel::ip        , IPPROTO_IP   },
+        { OptionLevel::ipv6      , IPPROTO_IPV6 },
+    };
 
-        if (native & POLLHUP)
-            flags |= PollFlags::hup;
+    static constexpr int _SocketFlagsShift = FlagsShift(_SocketFlagsPairs);
+    static constexpr int32_t _SocketFlagsMask = FlagsMask(_SocketFlagsPairs);
+    static constexpr FlagTable<int32_t> _SocketFlagsToNative(_SocketFlagsPairs, true);
 
-        if (native & POLLNVAL)
-            flags |= PollFlags::nval;
+    static constexpr bool _PollFlagsIdentity = FlagsAreIdentity(_PollFlagsPairs);
+    static constexpr int16_t _PollFlagsMask = FlagsMask(_PollFlagsPairs);
+    static constexpr FlagTable<int16_t> _PollFlagsToNative(_PollFlagsPairs, true);
+    static constexpr FlagTable<int16_t> _NativeToPollFlags(_PollFlagsPairs, false);
 
-        if (native & POLLRDNORM)
-            flags |= PollFlags::rdnorm;
+    static constexpr ValueTable<OptionName::ipv6_multicast_loop + 1> _OptionNames(_OptionNamePairs, 0);
+    static constexpr ValueTable<OptionLevel::ipv6 + 1> _OptionLevels(_OptionLevelPairs, -1);
 
-        if (native & POLLRDBAND)
-            flags |= PollFlags::rdband;
+#if defined(SOCKET_OS_LINUX)
+    // SocketFlags::normal takes the bit 0 so the others are the native MSG_* shifted by one, PollFlags are the Linux values.
+    static_assert(_SocketFlagsShift == 1, "SocketFlags must be the native MSG_* values shifted by one.");
+    static_assert(_PollFlagsIdentity, "PollFlags must match the native POLL* values.");
+#endif
+    static_assert(_SocketFlagsToNative(SocketFlags::peek | SocketFlags::oob) == (MSG_PEEK | MSG_OOB) && _SocketFlagsToNative(SocketFlags::normal) == 0, "Broken socket flags table.");
+    static_assert(_PollFlagsToNative(PollFlags::in | PollFlags::out) == (POLLIN | POLLOUT), "Broken poll flags table.");
+    static_assert((_NativeToPollFlags(POLLIN | POLLERR) & (PollFlags::in | PollFlags::err)) == (PollFlags::in | PollFlags::err), "Broken poll flags table.");
+    static_assert(_OptionNames(OptionName::tcp_nodelay, 0) == TCP_NODELAY && _OptionNames(OptionName::ipv6_v6only, 0) == IPV6_V6ONLY, "Broken option names table.");
+    static_assert(_OptionLevels(OptionLevel::tcp, -1) == IPPROTO_TCP && _OptionLevels(0, -1) == -1, "Broken option levels table.");
 
-        if (native & POLLWRNORM)
-            flags |= PollFlags::wrnorm;
+    inline int32_t SocketFlagsToNative(int32_t flags)
+    {
+        return _SocketFlagsShift >= 0 ? (flags & _SocketFlagsMask) >> (_SocketFlagsShift & 15) : _SocketFlagsToNative(flags);
+    }
 
-        if (native & POLLWRBAND)
-            flags |= PollFlags::wrband;
+    inline int16_t PollFlagsToNative(int16_t flags)
+    {
+        return _PollFlagsIdentity ? static_cast<int16_t>(flags & _PollFlagsMask) : _PollFlagsToNative(flags);
+    }
 
-        return flags;
+    inline int16_t NativeToPollFlags(int16_t native)
+    {
+        return _PollFlagsIdentity ? static_cast<int16_t>(native & _PollFlagsMask) : _NativeToPollFlags(native);
     }
 
-    static int32_t OptionNameToNative(int32_t option)
+    inline int32_t OptionNameToNative(int32_t option)
     {
-        switch (option)
-        {
-            case OptionName::so_debug    : return SO_DEBUG;
-            case OptionName::so_reuseaddr: return SO_REUSEADDR;
-            case OptionName::so_keepalive: return SO_KEEPALIVE;
-            case OptionName::so_dontroute: return SO_DONTROUTE;
-            case OptionName::so_broadcast: return SO_BROADCAST;
-            case OptionName::so_linger   : return SO_LINGER;
-            case OptionName::so_oobinline: return SO_OOBINLINE;
-            case OptionName::so_sndbuf   : return SO_SNDBUF;
-            case OptionName::so_rcvbuf   : return SO_RCVBUF;
-            case OptionName::so_sndlowat : return SO_SNDLOWAT;
-            case OptionName::so_rcvlowat : return SO_RCVLOWAT;
-            case OptionName::so_sndtimeo : return SO_SNDTIMEO;
-            case OptionName::so_rcvtimeo : return SO_RCVTIMEO;
-            case OptionName::so_error    : return SO_ERROR;
-            case OptionName::so_type     : return SO_TYPE;
-        }
+        return _OptionNames(option, 0);
+    }
 
-        return 0;
+    inline int32_t OptionLevelToNative(int32_t level)
+    {
+        return _OptionLevels(level, -1);
     }
 
     enum class AddressFamily : int
@@ -264,6 +381,10 @@ namespace Internals {
     };
 #endif
 
+#if defined(SOCKET_IO_COUNTERS)
+    SOCKET_HIDE_CLASS(struct) IoCounterBlock;
+#endif
+
     SOCKET_HIDE_CLASS(class) NativeSocket
     {
     public:
@@ -275,23 +396,47 @@ namespace Internals {
         static constexpr socket_t invalid_socket = ((socket_t)(-1));
 
         socket_t Socket;
+#if defined(SOCKET_IO_COUNTERS)
+        // Owned, see internal_io_counters.h. null for the sockets not created by socket() or accept().
+        IoCounterBlock* Counters;
+#endif
 
-        constexpr bool IsValid() { return Socket != invalid_socket; }
+        constexpr bool IsValid() const { return Socket != invalid_socket; }
 
         NativeSocket();
         NativeSocket(NativeSocket const&) = delete;
-        NativeSocket(NativeSocket&& other);
+        NativeSocket(NativeSocket&& other) noexcept;
         NativeSocket& operator=(NativeSocket const& other) = delete;
-        NativeSocket& operator=(NativeSocket&& other);
+        NativeSocket& operator=(NativeSocket&& other) noexcept;
         ~NativeSocket();
 
+        // Swaps the handles, and the counters with them.
+        void Swap(NativeSocket& other) noexcept;
         NetworkLibrary::Error CreateSocket(Internals::AddressFamily af, Internals::SocketTypes type, Internals::SocketProtocols proto);
-        NetworkLibrary::Error SetSockOption(int32_t option_name, const void* value, socklen_t optlen);
+        NetworkLibrary::Error SetSockOption(int32_t level, int32_t option_name, const void* value, socklen_t optlen);
+        NetworkLibrary::Error GetSockOption(int32_t level, int32_t option_name, void* value, socklen_t* optlen) const;
         NetworkLibrary::Error SetNonBlocking(bool non_blocking);
         int32_t GetWaitingSize() const;
         void Close();
     };
 
+#if defined(SOCKET_OS_LINUX) || defined(SOCKET_OS_APPLE)
+    // Keeps a spare file descriptor around, when accept fails with EMFILE/ENFILE it is released
+    // so the pending connections can be accepted and closed instead of leaving the listener readable.
+    SOCKET_HIDE_CLASS(class) AcceptReserve
+    {
+        std::mutex _Mutex;
+        int _Fd;
+
+        AcceptReserve();
+    public:
+        ~AcceptReserve();
+
+        static AcceptReserve& Inst() noexcept;
+        size_t Shed(NativeSocket const& s);
+    };
+#endif
+
     namespace Endian
     {
         static constexpr uint32_t _EndianMagic = 0x01020304;
@@ -383,20 +528,32 @@ namespace Internals {
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) MakeErrorFromSocketCode(int socket_error);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) MakeErrorFromNative(int native_error);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) LastError();
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) LastResult();
+
+    // Same as MakeErrorFromSocketCode(Error::NoError), without the lookup.
+    inline ::NetworkLibrary::Error MakeNoError() { return ::NetworkLibrary::Error{ ::NetworkLibrary::Error::NoError, 0 }; }
 
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) accept(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr, Internals::NativeSocket& out);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) accept4(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr* addr, Internals::NativeSocket& out);
+    SOCKET_HIDE_SYMBOLS(size_t) shed_pending_connections(Internals::NativeSocket const& s);
+    SOCKET_HIDE_SYMBOLS(bool) is_non_blocking(Internals::NativeSocket const& s);
+    SOCKET_HIDE_SYMBOLS(bool) has_pending_input(Internals::NativeSocket const& s);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) bind(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr);
     SOCKET_HIDE_SYMBOLS(void) closeSocket(Internals::NativeSocket& s);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) connect(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) ioctlsocket(Internals::NativeSocket const& s, Internals::CmdName cmd, unsigned long* arg);
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) setsockopt(Internals::NativeSocket const& s, int optname, const void* optval, socklen_t optlen);
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) getsockopt(Internals::NativeSocket const& s, int optname, void* optval, socklen_t* optlen);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) setsockopt(Internals::NativeSocket const& s, int level, int optname, const void* optval, socklen_t optlen);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) getsockopt(Internals::NativeSocket const& s, int level, int optname, void* optval, socklen_t* optlen);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) gettcpinfo(Internals::NativeSocket const& s, NetworkLibrary::TcpInfo& info);
+    // Joins or leaves a multicast group with the protocol independent MCAST_* options, source-specific if source isn't null.
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) multicastmembership(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& group, NetworkLibrary::BasicAddr const* source, uint32_t iface_index, bool join);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) setmulticastiface(Internals::NativeSocket const& s, int family, uint32_t iface_index);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) getsockname(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) listen(Internals::NativeSocket const& s, int waiting_connection = 5);
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) recv(Internals::NativeSocket const& s, void* buffer, size_t& len, int32_t flags);
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) send(Internals::NativeSocket const& s, const void* buffer, size_t& len, int32_t flags);
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) recvfrom(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr, void* buffer, size_t& len, int32_t flags);
-    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) sendto(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr, const void* buffer, size_t& len, int32_t flags);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) recv(Internals::NativeSocket const& s, void* buffer, size_t& len, int32_t flags);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) send(Internals::NativeSocket const& s, const void* buffer, size_t& len, int32_t flags);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) recvfrom(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr& addr, void* buffer, size_t& len, int32_t flags);
+    SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Result) sendto(Internals::NativeSocket const& s, NetworkLibrary::BasicAddr const& addr, const void* buffer, size_t& len, int32_t flags);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) shutdown(Internals::NativeSocket const& s, Internals::ShutdownFlags how);
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) socket(Internals::AddressFamily af, Internals::SocketTypes type, Internals::SocketProtocols proto, Internals::NativeSocket& s);
     SOCKET_HIDE_SYMBOLS(int) getaddrinfo(const char* node, const char* service, const addrinfo* hints, addrinfo** res);
@@ -406,5 +563,8 @@ namespace Internals {
     SOCKET_HIDE_SYMBOLS(::NetworkLibrary::Error) inet_ntop(const sockaddr* sockaddr, std::string& str_addr);
     SOCKET_HIDE_SYMBOLS(int) select(int nfds, fd_set* readfd, fd_set* writefd, fd_set* exceptfd, timeval* timeout);
     SOCKET_HIDE_SYMBOLS(int) poll(pollfd* fds, size_t nfds, int timeout);
+    SOCKET_HIDE_SYMBOLS(int) ppoll(pollfd* fds, size_t nfds, std::chrono::microseconds timeout);
+    // Translates the revents of count pollfds at once.
+    SOCKET_HIDE_SYMBOLS(void) NativeToPollFlags(pollfd const* fds, int16_t* out_flags, size_t count);
 }
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+/* Copyright (C) Nemirtingas
+ * This file is part of Socket.
+ *
+ * Socket is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Socket is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Socket.  If not, see <https://www.gnu.org/licenses/>
+ */
+
+#pragma once
+
+#include <NetworkLibrary/details/SocketTemplate.h>
+#include "internal_socket.h"
+
+#include <type_traits>
+
+// SocketTemplate members, only included by the sources that explicitly instantiate it once Traits::Native is defined.
+namespace NetworkLibrary {
+namespace Internals {
+    // Traits::Native can define a static OnBind(SocketTemplate<Traits>&, BasicAddr const&), called after a successful Bind.
+    template<typename Native, typename = void>
+    struct HasOnBind : std::false_type {};
+
+    template<typename Native>
+    struct HasOnBind<Native, decltype(void(&Native::OnBind))> : std::true_type {};
+
+    template<typename Traits>
+    inline void OnBind(SocketTemplate<Traits>&, BasicAddr const&, std::false_type)
+    {}
+
+    template<typename Traits>
+    inline void OnBind(SocketTemplate<Traits>& socket, BasicAddr const& addr, std::true_type)
+    {
+        Traits::Native::OnBind(socket, addr);
+    }
+}
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplateIO<Traits, ConnectedSocket>::Send(NetBuffer& buffer, int32_t flags)
+    {
+        return Internals::send(this->_Impl(), buffer.Buffer, buffer.BufferSize, Internals::SocketFlagsToNative(flags)).ToError();
+    }
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplateIO<Traits, ConnectedSocket>::Receive(NetBuffer& buffer, int32_t flags)
+    {
+        return Internals::recv(this->_Impl(), buffer.Buffer, buffer.BufferSize, Internals::SocketFlagsToNative(flags)).ToError();
+    }
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplateIO<Traits, UnconnectedSocket>::SendTo(BasicAddr const& addr, NetBuffer& buffer, int32_t flags)
+    {
+        return Internals::sendto(this->_Impl(), addr, buffer.Buffer, buffer.BufferSize, Internals::SocketFlagsToNative(flags)).ToError();
+    }
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplateIO<Traits, UnconnectedSocket>::ReceiveFrom(BasicAddr& addr, NetBuffer& buffer, int32_t flags)
+    {
+        return Internals::recvfrom(this->_Impl(), addr, buffer.Buffer, buffer.BufferSize, Internals::SocketFlagsToNative(flags)).ToError();
+    }
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplate<Traits>::CreateSocket()
+    {
+        return this->_Impl().CreateSocket(
+            (Internals::AddressFamily)Traits::Native::Family,
+            (Internals::SocketTypes)Traits::Native::Type,
+            (Internals::SocketProtocols)Traits::Native::Proto);
+    }
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplate<Traits>::GetSockName(addr_type& out_addr)
+    {
+        return Internals::getsockname(this->_Impl(), out_addr);
+    }
+
+    template<typename Traits>
+    NetworkLibrary::Error SocketTemplate<Traits>::Bind(BasicAddr const& addr)
+    {
+        NetworkLibrary::Error error = Internals::bind(this->_Impl(), addr);
+        if (error.ErrorCode == Error::NoError)
+            Internals::OnBind(*this, addr, Internals::HasOnBind<typename Traits::Native>());
+
+        return error;
+    }
+
+    template<typename Traits>
+    int SocketTemplate<Traits>::GetFamily() const { return Traits::Native::Family; }
+
+    template<typename Traits>
+    int SocketTemplate<Traits>::GetType  () const { return Traits::Native::Type; }
+
+    template<typename Traits>
+    int SocketTemplate<Traits>::GetProto () const { return Traits::Native::Proto; }
+}
@@ -9,18 +9,38 @@
 #include <random>
 #include <future>
 #include <list>
+#include <atomic>
+#include <cstring>
 
 #include <NetworkLibrary/Poll.h>
 #include <NetworkLibrary/IPv4.h>
 #include <NetworkLibrary/IPv6.h>
+#include <NetworkLibrary/AnyAddr.h>
+#include <NetworkLibrary/ListenerGroup.h>
+#include <NetworkLibrary/HappyEyeballs.h>
+#include <NetworkLibrary/Resolver.h>
+#include <NetworkLibrary/ConnectionPool.h>
+#include <NetworkLibrary/SendQueue.h>
+#include <NetworkLibrary/Pacer.h>
+#include <NetworkLibrary/SessionTable.h>
+#include <NetworkLibrary/InterfaceMonitor.h>
+#include <NetworkLibrary/Discovery.h>
+#include <NetworkLibrary/LatencyHistogram.h>
 #ifdef UNIX_TESTS
 #include <NetworkLibrary/Unix.h>
 #endif
 #ifdef BLUETOOTH_TESTS
 #include <NetworkLibrary/Bluetooth.h>
 #endif
+#ifdef LOOPBACK_TESTS
+#include <NetworkLibrary/Loopback.h>
+#endif
 
 #include <string.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 
 using namespace std::chrono_literals;
 
@@ -42,6 +62,28 @@ void TestIPv4()
         std::cout << std::endl;
     }
 
+    NetworkLibrary::IPv4::IPv4Addr addr, copy;
+    addr.FromString("192.168.1.2:1234");
+    copy = addr;
+    NetworkLibrary::IPv4::IPv4Addr moved(std::move(addr));
+    if (copy.ToString(true) != "192.168.1.2:1234" || moved.ToString(true) != "192.168.1.2:1234" || addr.GetPort() != 1234)
+    {
+        std::cout << "IPv4 address copies don't hold the same value." << std::endl;
+        return;
+    }
+
+    char text[NetworkLibrary::IPv4::IPv4Addr::MaxStringSize];
+    if ((int)addr.FromString("255.255.255.255:65535") != NetworkLibrary::Error::NoError ||
+        addr.ToString(text, sizeof(text), true) != sizeof(text) - 1 || strcmp(text, "255.255.255.255:65535") != 0 ||
+        addr.ToString(text, 8) != 0 ||
+        (int)addr.FromString("01.2.3.4") == NetworkLibrary::Error::NoError ||
+        (int)addr.FromString("1.2.3.4:0") == NetworkLibrary::Error::NoError ||
+        (int)addr.FromString("1.2.3.4:80", 7) != NetworkLibrary::Error::NoError || addr.GetIPv4() != 0x01020304)
+    {
+        std::cout << "IPv4 address parsing or formatting failed." << std::endl;
+        return;
+    }
+
     std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
 }
 
@@ -251,6 +293,304 @@ void TestIPv4TCP()
     tcp1.GetSockName(ipv4_addr);
     std::cout << "Received datas from server " << ipv4_addr.ToString(true) << " : " << buffer << "." << std::endl;
 
+    NetworkLibrary::TcpInfo tcp_info;
+    error = tcp2.GetTcpInfo(tcp_info);
+    if ((int)error != NetworkLibrary::Error::NoError && (int)error != NetworkLibrary::Error::NotSupported)
+    {
+        std::cout << "Failed to get IPv4 TCP infos: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "TCP infos: rtt " << tcp_info.Rtt.count() << "us, rttvar " << tcp_info.RttVar.count() << "us, cwnd " << tcp_info.SendCwnd
+        << ", retransmits " << tcp_info.Retransmits << ", in flight " << tcp_info.BytesInFlight << ", delivery rate " << tcp_info.DeliveryRate << "B/s"
+        << ", sent " << tcp_info.BytesSent << "B, acked " << tcp_info.BytesAcked << "B." << std::endl;
+
+    // The client wrote 23 bytes, the server reply acknowledged them.
+    if ((int)error == NetworkLibrary::Error::NoError &&
+        (!tcp_info.Established || tcp_info.Rtt.count() <= 0 || tcp_info.SendMss == 0 || tcp_info.BytesInFlight != 0
+#if defined(__linux__)
+        || tcp_info.BytesAcked < 23 || (tcp_info.BytesSent != 0 && tcp_info.BytesSent < 23)
+#endif
+        ))
+    {
+        std::cout << "Unexpected TCP infos." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestIPv4TCPMove()
+{
+    std::vector<NetworkLibrary::IPv4::TCP> sockets;
+    std::vector<int64_t> fds;
+    NetworkLibrary::Error error;
+
+    // The I/O calls of the concrete sockets are the final SocketTemplateIO overrides, they bind without the vtable.
+    static_assert(std::is_same<decltype(&NetworkLibrary::IPv4::TCP::Send),
+        NetworkLibrary::Error (NetworkLibrary::SocketTemplateIO<NetworkLibrary::IPv4::TCPTraits>::*)(NetworkLibrary::NetBuffer&, int32_t)>::value, "IPv4::TCP::Send must bind statically.");
+    static_assert(std::is_same<decltype(&NetworkLibrary::IPv4::UDP::SendTo),
+        NetworkLibrary::Error (NetworkLibrary::SocketTemplateIO<NetworkLibrary::IPv4::UDPTraits>::*)(NetworkLibrary::BasicAddr const&, NetworkLibrary::NetBuffer&, int32_t)>::value, "IPv4::UDP::SendTo must bind statically.");
+    static_assert(std::is_same<decltype(&NetworkLibrary::IPv4::UDP::Bind),
+        NetworkLibrary::Error (NetworkLibrary::SocketTemplate<NetworkLibrary::IPv4::UDPTraits>::*)(NetworkLibrary::BasicAddr const&)>::value, "IPv4::UDP::Bind must bind statically.");
+    static_assert(std::is_nothrow_move_constructible<NetworkLibrary::IPv4::TCP>::value, "Socket moves must be noexcept.");
+    static_assert(std::is_nothrow_move_assignable<NetworkLibrary::IPv4::UDP>::value, "Socket moves must be noexcept.");
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    std::cout << "Growing a vector of opened sockets..." << std::endl;
+    for (int i = 0; i < 16; ++i)
+    {
+        NetworkLibrary::IPv4::TCP socket;
+        if ((int)(error = socket.CreateSocket()) != NetworkLibrary::Error::NoError)
+        {
+            std::cout << "Failed to create IPv4 TCP socket: " << error.ToString() << std::endl;
+            return;
+        }
+
+        fds.emplace_back(socket.GetNativeFd());
+        sockets.emplace_back(std::move(socket));
+        if (socket.IsOpen())
+        {
+            std::cout << "Moved-from socket is still open." << std::endl;
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < sockets.size(); ++i)
+    {
+        if (!sockets[i].IsOpen() || sockets[i].GetNativeFd() != fds[i])
+        {
+            std::cout << "Socket " << i << " lost its handle while the vector grew." << std::endl;
+            return;
+        }
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestIPv4TCPAcceptBatch()
+{
+    NetworkLibrary::IPv4::TCP listener, clients[3], accepted[4];
+    NetworkLibrary::IPv4::IPv4Addr ipv4_addr, accepted_addrs[4];
+    NetworkLibrary::ConnectedSocket* new_clients[4] = { &accepted[0], &accepted[1], &accepted[2], &accepted[3] };
+    NetworkLibrary::BasicAddr* client_addrs[4] = { &accepted_addrs[0], &accepted_addrs[1], &accepted_addrs[2], &accepted_addrs[3] };
+    NetworkLibrary::Error error;
+    size_t accepted_count = 0;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    error = ipv4_addr.FromString("127.0.0.1:9998");
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to parse IPv4(127.0.0.1:9998) address: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Listening IPv4 TCP on " << ipv4_addr.ToString(true) << "..." << std::endl;
+    if ((int)(error = listener.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Bind(ipv4_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Listen()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.SetNonBlocking(true)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to listen IPv4 TCP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    error = listener.AcceptBatch(new_clients, client_addrs, 4, accepted_count);
+    if ((int)error != NetworkLibrary::Error::WouldBlock || accepted_count != 0)
+    {
+        std::cout << "Empty batch accept didn't return WouldBlock: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Connecting 3 TCP clients..." << std::endl;
+    for (auto& client : clients)
+    {
+        if ((int)(error = client.CreateSocket()) != NetworkLibrary::Error::NoError ||
+            (int)(error = client.Connect(ipv4_addr)) != NetworkLibrary::Error::NoError)
+        {
+            std::cout << "Failed to connect to " << ipv4_addr.ToString(true) << " : " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "Batch accepting TCP clients..." << std::endl;
+    error = listener.AcceptBatch(new_clients, client_addrs, 4, accepted_count);
+    if ((int)error != NetworkLibrary::Error::NoError || accepted_count != 3)
+    {
+        std::cout << "Failed to batch accept (" << accepted_count << " accepted): " << error.ToString() << std::endl;
+        return;
+    }
+
+    for (size_t i = 0; i < accepted_count; ++i)
+        std::cout << "Accepted client " << accepted_addrs[i].ToString(true) << "." << std::endl;
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestIPv4TCPAcceptBatchEmfile()
+{
+#if defined(__linux__) || defined(__APPLE__)
+    NetworkLibrary::IPv4::TCP listener, clients[4], accepted[4];
+    NetworkLibrary::IPv4::IPv4Addr ipv4_addr;
+    NetworkLibrary::ConnectedSocket* new_clients[4] = { &accepted[0], &accepted[1], &accepted[2], &accepted[3] };
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    NetworkLibrary::Error batch_error;
+    size_t accepted_count = 0;
+    size_t shed_count = 0;
+    rlimit old_limit;
+    rlimit low_limit;
+    char buffer[16];
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    ipv4_addr.FromString("127.0.0.1:9987");
+    if ((int)(error = listener.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Bind(ipv4_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Listen()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.SetNonBlocking(true)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to listen IPv4 TCP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Connecting 4 TCP clients..." << std::endl;
+    for (auto& client : clients)
+    {
+        if ((int)(error = client.CreateSocket()) != NetworkLibrary::Error::NoError ||
+            (int)(error = client.Connect(ipv4_addr)) != NetworkLibrary::Error::NoError)
+        {
+            std::cout << "Failed to connect to " << ipv4_addr.ToString(true) << " : " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    // The lowest free descriptor is the first one above all the used ones: leave room for 2 more.
+    int next_fd = ::dup(0);
+    ::close(next_fd);
+    ::getrlimit(RLIMIT_NOFILE, &old_limit);
+    low_limit = old_limit;
+    low_limit.rlim_cur = static_cast<rlim_t>(next_fd + 2);
+    if (::setrlimit(RLIMIT_NOFILE, &low_limit) != 0)
+    {
+        std::cout << "Failed to lower RLIMIT_NOFILE." << std::endl;
+        return;
+    }
+
+    std::cout << "Batch accepting with 2 free descriptors..." << std::endl;
+    batch_error = listener.AcceptBatch(new_clients, nullptr, 4, accepted_count);
+    error = listener.AcceptBatch(new_clients + 2, nullptr, 2, shed_count);
+    ::setrlimit(RLIMIT_NOFILE, &old_limit);
+
+    if ((int)batch_error != NetworkLibrary::Error::NoError || accepted_count != 2)
+    {
+        std::cout << "The partial batch didn't return its " << accepted_count << " clients: " << batch_error.ToString() << std::endl;
+        return;
+    }
+
+    if ((int)error != NetworkLibrary::Error::TooManyOpenFiles || shed_count != 0)
+    {
+        std::cout << "The next batch didn't report TooManyOpenFiles: " << error.ToString() << std::endl;
+        return;
+    }
+
+    poll.AddSocket(listener, NetworkLibrary::PollFlags::in);
+    if (poll.DoPoll(std::chrono::milliseconds(0)) != 0)
+    {
+        std::cout << "The listener is still readable, the pending connections were not shed." << std::endl;
+        return;
+    }
+
+    // The shed clients were accepted and closed: they read the end of stream.
+    for (size_t i = 2; i < 4; ++i)
+    {
+        NetworkLibrary::NetBuffer net_buffer{ buffer, sizeof(buffer) };
+        error = clients[i].Receive(net_buffer);
+        if (((int)error != NetworkLibrary::Error::NoError || net_buffer.BufferSize != 0) && (int)error != NetworkLibrary::Error::ConnectionReset)
+        {
+            std::cout << "A shed client is still connected: " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+#endif
+}
+
+void TestIPv4TCPListenerGroup()
+{
+    NetworkLibrary::ListenerGroup<NetworkLibrary::IPv4::TCP> group;
+    NetworkLibrary::IPv4::TCP client, accepted;
+    NetworkLibrary::IPv4::IPv4Addr ipv4_addr;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    ipv4_addr.FromString("127.0.0.1");
+
+    std::cout << "Opening IPv4 TCP listener group of 4..." << std::endl;
+    error = group.Open(ipv4_addr, 4, true);
+    if ((int)error == NetworkLibrary::Error::NotSupported)
+    {
+        std::cout << "IPv4 TCP listener group not supported, skipping." << std::endl << std::endl;
+        return;
+    }
+    if ((int)error != NetworkLibrary::Error::NoError || group.GetSocketCount() != 4)
+    {
+        std::cout << "Failed to open IPv4 TCP listener group: " << error.ToString() << std::endl;
+        return;
+    }
+
+    group.GetSocket(3).GetSockName(ipv4_addr);
+    std::cout << "Listener group bound on " << ipv4_addr.ToString(true) << "." << std::endl;
+
+    for (size_t i = 0; i < group.GetSocketCount(); ++i)
+        poll.AddSocket(group.GetSocket(i), NetworkLibrary::PollFlags::in);
+
+    if ((int)(error = client.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = client.Connect(ipv4_addr)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to connect to " << ipv4_addr.ToString(true) << " : " << error.ToString() << std::endl;
+        return;
+    }
+
+    if (poll.DoPoll(std::chrono::milliseconds(1000)) != 1)
+    {
+        std::cout << "Connection didn't land on exactly one listener." << std::endl;
+        return;
+    }
+
+    int16_t revents[4];
+    if (poll.GetAllRevents(revents, 4) != 4)
+    {
+        std::cout << "Failed to get the listeners revents." << std::endl;
+        return;
+    }
+
+    for (size_t i = 0; i < group.GetSocketCount(); ++i)
+    {
+        if (revents[i] != poll.GetRevents(i))
+        {
+            std::cout << "Listener " << i << " bulk revents don't match." << std::endl;
+            return;
+        }
+
+        if (revents[i] & NetworkLibrary::PollFlags::in)
+        {
+            error = group.GetSocket(i).Accept(accepted, ipv4_addr);
+            if ((int)error != NetworkLibrary::Error::NoError)
+            {
+                std::cout << "Failed to accept: " << error.ToString() << std::endl;
+                return;
+            }
+
+            std::cout << "Listener " << i << " accepted client " << ipv4_addr.ToString(true) << "." << std::endl;
+        }
+    }
+
     std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
 }
 
@@ -272,6 +612,38 @@ void TestIPv6()
         std::cout << std::endl;
     }
 
+    NetworkLibrary::IPv6::IPv6Addr addr;
+    const char* const round_trips[] = { "::", "::1", "::ffff:1.2.3.4", "2001:db8::1:0:0:1", "[fe80::1%1]:80" };
+    for (const char* str : round_trips)
+    {
+        if ((int)addr.FromString(str) != NetworkLibrary::Error::NoError || addr.ToString(str[0] == '[') != str)
+        {
+            std::cout << "IPv6 address " << str << " doesn't round trip: " << addr.ToString(true) << std::endl;
+            return;
+        }
+    }
+
+    if ((int)addr.FromString("2001:0db8:0000:0000:0000:0000:0000:0001") != NetworkLibrary::Error::NoError || addr.ToString() != "2001:db8::1" ||
+        (int)addr.FromString("1:2:3:4:5:6:7:8:9999") != NetworkLibrary::Error::NoError || addr.GetPort() != 9999 ||
+        (int)addr.FromString("1::2::3") == NetworkLibrary::Error::NoError ||
+        (int)addr.FromString("12345::") == NetworkLibrary::Error::NoError ||
+        (int)addr.FromString("[1:2:3:4:5:6:7::]") != NetworkLibrary::Error::NoError || addr.ToString() != "1:2:3:4:5:6:7:0")
+    {
+        std::cout << "IPv6 address parsing failed." << std::endl;
+        return;
+    }
+
+    // "::" stands for one group at least, it can't come with the 8 groups.
+    const char* const too_many_groups[] = { "1:2:3:4:5:6:7:8::", "[1:2:3:4:5:6:7:8::]:80", "::1:2:3:4:5:6:7:8", "[1:2:3:4::5:6:7:8]", "[1:2:3:4:5:6:7::8]", "1:2:3:4:5:6::1.2.3.4" };
+    for (const char* str : too_many_groups)
+    {
+        if ((int)addr.FromString(str) == NetworkLibrary::Error::NoError)
+        {
+            std::cout << "IPv6 address " << str << " was accepted." << std::endl;
+            return;
+        }
+    }
+
     std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
 }
 
@@ -634,124 +1006,461 @@ void TestUnixStream(const char* unix_sock_path)
     std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
 }
 #endif
-#ifdef BLUETOOTH_TESTS
-void TestBluetooth()
-{
-    auto ifaces = NetworkLibrary::Bluetooth::GetIfacesAddresses();
-    if ((int)ifaces.first != NetworkLibrary::Error::NoError)
-    {
-        std::cout << "Failed to get Bluetooth adapters: " << ifaces.first.ToString() << std::endl;
-        return;
-    }
-    for (auto& iface : ifaces.second)
-    {
-        std::cout << iface.Name << ' ' << iface.FriendlyName << ' ' << iface.IsUp << std::endl;
-        for (auto& ip : iface.Addresses)
-        {
-            std::cout << "    " << ip.Addr << std::endl;
-        }
-        std::cout << std::endl;
-    }
-
-    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
-}
-
-void TestBluetoothRFCOMMClient(const char* server_address, const char* bluetooth_service_uuid)
+#ifdef LOOPBACK_TESTS
+void TestLoopbackStream()
 {
-    std::string error_str;
-    std::string addr_string;
     char buffer[1024];
-    NetworkLibrary::Bluetooth::RFCOMM rfcomm1;
-    NetworkLibrary::Bluetooth::BluetoothAddr bth_addr;
-    NetworkLibrary::Bluetooth::UUID uuid;
+    NetworkLibrary::Loopback::LoopbackStream stream1, stream2, stream3;
+    NetworkLibrary::Loopback::LoopbackAddr loopback_addr;
+    NetworkLibrary::Poll poll;
     NetworkLibrary::Error error;
     NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
-    uint8_t channel;
 
     std::cout << __FUNCTION__ << std::endl;
 
-    std::cout << "Parsing Bluetooth service uuid..." << std::endl;
-    error = uuid.FromString(bluetooth_service_uuid);
+    std::cout << "Parsing Loopback loopback:9999..." << std::endl;
+    error = loopback_addr.FromString("loopback:9999");
     if ((int)error != NetworkLibrary::Error::NoError)
     {
-        std::cout << "Failed to parse UUID: " << error.ToString() << std::endl;
+        std::cout << "Failed to parse Loopback(loopback:9999) address: " << error.ToString() << std::endl;
         return;
     }
 
-    std::cout << "Parsing Bluetooth server address..." << std::endl;
-    error = bth_addr.FromString(server_address);
-    if ((int)error != NetworkLibrary::Error::NoError)
+    std::cout << "Creating Loopback sockets..." << std::endl;
+    if ((int)(error = stream1.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = stream2.CreateSocket()) != NetworkLibrary::Error::NoError)
     {
-        std::cout << "Failed to parse Bluetooth address: " << error.ToString() << std::endl;
+        std::cout << "Failed to create Loopback socket: " << error.ToString() << std::endl;
         return;
     }
 
-    std::cout << "Querying SDP for RFCOMM channel from UUID..." << std::endl;
-    error = NetworkLibrary::Bluetooth::GetChannelFromServiceUUID(uuid, bth_addr, channel);
-    if ((int)error != NetworkLibrary::Error::NoError)
+    std::cout << "Binding and listening Loopback socket on " << loopback_addr.ToString(true) << "..." << std::endl;
+    if ((int)(error = stream1.Bind(loopback_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = stream1.Listen()) != NetworkLibrary::Error::NoError)
     {
-        std::cout << "Failed to get channel at " << bth_addr.ToString() << " from uuid " << uuid.ToString() << ": " << error.ToString() << std::endl;
+        std::cout << "Failed to listen Loopback socket: " << error.ToString() << std::endl;
         return;
     }
 
-    std::cout << "Creating Bluetooth client socket..." << std::endl;
-    error = rfcomm1.CreateSocket();
-    if ((int)error != NetworkLibrary::Error::NoError)
+    poll.AddSocket(stream1, NetworkLibrary::PollFlags::in);
+    if (poll.DoPoll(std::chrono::milliseconds(0)) != 0)
     {
-        std::cout << "Failed to create Bluetooth socket: " << error.ToString() << std::endl;
+        std::cout << "Loopback listener is readable without pending connection." << std::endl;
         return;
     }
 
-    bth_addr.SetChannel(channel);
-
-    std::cout << "Connecting to Bluetooth: " << bth_addr.ToString() << std::endl;
-
-    error = rfcomm1.Connect(bth_addr);
+    std::cout << "Loopback client connecting to " << loopback_addr.ToString(true) << "..." << std::endl;
+    error = stream2.Connect(loopback_addr);
     if ((int)error != NetworkLibrary::Error::NoError)
     {
-        std::cout << "Failed to connected to " << bth_addr.ToString(true) << ": " << error.ToString() << std::endl;
+        std::cout << "Failed to connect to " << loopback_addr.ToString(true) << " : " << error.ToString() << std::endl;
         return;
     }
 
-    std::cout << "Sending datas to server..." << std::endl;
+    if (poll.DoPoll(std::chrono::milliseconds(100)) != 1 || (poll.GetRevents(stream1) & NetworkLibrary::PollFlags::in) == 0)
+    {
+        std::cout << "Loopback listener was not woken up by the connection." << std::endl;
+        return;
+    }
 
-    memcpy(buffer, "Hi from test client.", 21);
-    net_buff.BufferSize = 21;
-    error = rfcomm1.Send(net_buff);
+    std::cout << "Accepting Loopback client..." << std::endl;
+    error = stream1.Accept(stream3, loopback_addr);
     if ((int)error != NetworkLibrary::Error::NoError)
     {
-        std::cout << "Failed to send datas : " << error.ToString() << std::endl;
+        std::cout << "Failed to accept: " << error.ToString() << std::endl;
         return;
     }
 
-    std::cout << "Datas sent, waiting for reply..." << std::endl;
+    std::cout << "Accepted client " << loopback_addr.ToString(true) << "." << std::endl;
 
-    net_buff.BufferSize = 1024;
-    error = rfcomm1.Receive(net_buff);
-    if ((int)error != NetworkLibrary::Error::NoError)
+    stream3.SetNonBlocking(true);
+    net_buff.BufferSize = sizeof(buffer);
+    error = stream3.Receive(net_buff);
+    if ((int)error != NetworkLibrary::Error::WouldBlock)
     {
-        std::cout << "Failed to receive datas : " << error.ToString() << std::endl;
+        std::cout << "Loopback non-blocking receive didn't return WouldBlock: " << error.ToString() << std::endl;
         return;
     }
 
-    std::cout << "Datas received: " << buffer << std::endl;
+    poll.Clear();
+    poll.AddSocket(stream3, NetworkLibrary::PollFlags::in);
 
-    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
-}
+    memcpy(net_buff.Buffer, "Hello from Loopback client.", 28);
+    net_buff.BufferSize = 28;
 
-void TestBluetoothRFCOMMServer(const char* bluetooth_service_uuid)
-{
-    std::string error_str;
-    char buffer[1024];
-    NetworkLibrary::Bluetooth::RFCOMM rfcomm1, rfcomm2;
-    NetworkLibrary::Bluetooth::BluetoothAddr bth_addr;
-    NetworkLibrary::Bluetooth::SDPService sdp_service;
-    NetworkLibrary::Bluetooth::UUID service_uuid;
-    NetworkLibrary::Error error;
-    NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
+    std::cout << "Sending " << buffer << "..." << std::endl;
+    error = stream2.Send(net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError || net_buff.BufferSize != 28)
+    {
+        std::cout << "Failed to send Loopback datas: " << error.ToString() << std::endl;
+        return;
+    }
 
-    bth_addr.SetAnyAddr();
-    bth_addr.SetChannel(6);
+    if (poll.DoPoll(std::chrono::milliseconds(100)) != 1)
+    {
+        std::cout << "Loopback socket was not woken up by the datas." << std::endl;
+        return;
+    }
+
+    memset(net_buff.Buffer, 0, 1024);
+    net_buff.BufferSize = 1024;
+
+    std::cout << "Receiving datas from Loopback client..." << std::endl;
+    error = stream3.Receive(net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError || net_buff.BufferSize != 28)
+    {
+        std::cout << "Failed to received Loopback datas: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Received datas from client " << loopback_addr.ToString(true) << ": " << buffer << "." << std::endl;
+
+    std::cout << "Sending more than the Loopback ring holds..." << std::endl;
+    {
+        std::vector<char> big_datas(512 * 1024, 'x');
+        NetworkLibrary::NetBuffer big_buff{ big_datas.data(), big_datas.size() };
+        NetworkLibrary::Error send_error;
+        size_t total_received = 0;
+
+        // The blocking send waits for the receiver to free space.
+        std::thread sender([&]() { send_error = stream2.Send(big_buff); });
+        while (total_received < big_datas.size())
+        {
+            net_buff.BufferSize = sizeof(buffer);
+            error = stream3.Receive(net_buff);
+            if ((int)error == NetworkLibrary::Error::WouldBlock)
+                poll.DoPoll(std::chrono::milliseconds(100));
+            else if ((int)error != NetworkLibrary::Error::NoError || net_buff.BufferSize == 0)
+                break;
+            else
+                total_received += net_buff.BufferSize;
+        }
+        sender.join();
+
+        if ((int)send_error != NetworkLibrary::Error::NoError || big_buff.BufferSize != big_datas.size() || total_received != big_datas.size())
+        {
+            std::cout << "Failed the Loopback blocking send: " << send_error.ToString() << ", received " << total_received << " bytes." << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "Polling the writability of a full Loopback ring..." << std::endl;
+    {
+        NetworkLibrary::Poll write_poll;
+        char datas[4096] = {};
+        NetworkLibrary::NetBuffer datas_buff{ datas, sizeof(datas) };
+
+        stream2.SetNonBlocking(true);
+        write_poll.AddSocket(stream2, NetworkLibrary::PollFlags::out);
+        if (write_poll.DoPoll(std::chrono::milliseconds(0)) != 1)
+        {
+            std::cout << "Loopback socket is not writable with an empty ring." << std::endl;
+            return;
+        }
+
+        do
+        {
+            datas_buff.BufferSize = sizeof(datas);
+            error = stream2.Send(datas_buff);
+        } while ((int)error == NetworkLibrary::Error::NoError);
+
+        if ((int)error != NetworkLibrary::Error::WouldBlock || write_poll.DoPoll(std::chrono::milliseconds(0)) != 0)
+        {
+            std::cout << "Loopback socket is writable with a full ring: " << error.ToString() << std::endl;
+            return;
+        }
+
+        net_buff.BufferSize = sizeof(buffer);
+        error = stream3.Receive(net_buff);
+        if ((int)error != NetworkLibrary::Error::NoError || write_poll.DoPoll(std::chrono::milliseconds(100)) != 1 ||
+            (write_poll.GetRevents(stream2) & NetworkLibrary::PollFlags::out) == 0)
+        {
+            std::cout << "Loopback socket was not woken up by the freed space: " << error.ToString() << std::endl;
+            return;
+        }
+
+        do
+        {
+            net_buff.BufferSize = sizeof(buffer);
+            error = stream3.Receive(net_buff);
+        } while ((int)error == NetworkLibrary::Error::NoError);
+    }
+
+    stream2.Close();
+    net_buff.BufferSize = 1024;
+    error = stream3.Receive(net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError || net_buff.BufferSize != 0)
+    {
+        std::cout << "Loopback receive didn't report end of stream: " << error.ToString() << std::endl;
+        return;
+    }
+
+    {
+        NetworkLibrary::Loopback::LoopbackStream moved(std::move(stream3));
+        if ((int)(error = stream3.CreateSocket()) != NetworkLibrary::Error::NoError ||
+            (int)(error = stream3.SetNonBlocking(true)) != NetworkLibrary::Error::NoError)
+        {
+            std::cout << "Moved-from Loopback socket is not reusable: " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestLoopbackDgram()
+{
+    char buffer[1024];
+    NetworkLibrary::Loopback::LoopbackDgram dgram1, dgram2;
+    NetworkLibrary::Loopback::LoopbackAddr loopback_addr;
+    NetworkLibrary::Error error;
+    NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    error = loopback_addr.FromString("9999");
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to parse Loopback(9999) address: " << error.ToString() << std::endl;
+        return;
+    }
+
+    if ((int)(error = dgram1.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = dgram2.CreateSocket()) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create Loopback socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Binding Loopback dgram socket on " << loopback_addr.ToString(true) << "..." << std::endl;
+    error = dgram1.Bind(loopback_addr);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to bind Loopback dgram socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    memcpy(net_buff.Buffer, "Hello from Loopback dgram.", 27);
+    net_buff.BufferSize = 27;
+
+    std::cout << "Sending data to peer " << loopback_addr.ToString(true) << ": " << buffer << "..." << std::endl;
+    error = dgram2.SendTo(loopback_addr, net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to send Loopback dgram datas: " << error.ToString() << std::endl;
+        return;
+    }
+
+    memset(net_buff.Buffer, 0, 1024);
+    net_buff.BufferSize = 1024;
+
+    std::cout << "Receiving datas from peer..." << std::endl;
+    error = dgram1.ReceiveFrom(loopback_addr, net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError || net_buff.BufferSize != 27)
+    {
+        std::cout << "Failed to received Loopback dgram datas: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Received datas from peer " << loopback_addr.ToString(true) << ": " << buffer << "..." << std::endl;
+
+    std::cout << "Sending more datagrams than the Loopback queue holds..." << std::endl;
+    {
+        const int datagram_count = 4096;
+        NetworkLibrary::Loopback::LoopbackAddr destination_addr;
+        NetworkLibrary::Error send_error;
+        int received_count = 0;
+
+        destination_addr.FromString("9999");
+        // The blocking sends wait for the receiver to free queue cells.
+        std::thread sender([&]()
+        {
+            char datas[64] = {};
+            for (int i = 0; i < datagram_count; ++i)
+            {
+                NetworkLibrary::NetBuffer datagram{ datas, sizeof(datas) };
+                if ((int)(send_error = dgram2.SendTo(destination_addr, datagram)) != NetworkLibrary::Error::NoError)
+                    return;
+            }
+        });
+
+        for (; received_count < datagram_count; ++received_count)
+        {
+            net_buff.BufferSize = sizeof(buffer);
+            if ((int)(error = dgram1.ReceiveFrom(loopback_addr, net_buff)) != NetworkLibrary::Error::NoError || net_buff.BufferSize != 64)
+                break;
+        }
+        sender.join();
+
+        if ((int)send_error != NetworkLibrary::Error::NoError || received_count != datagram_count)
+        {
+            std::cout << "Failed the Loopback blocking sends: " << send_error.ToString() << ", received " << received_count << " datagrams." << std::endl;
+            return;
+        }
+    }
+
+    std::cout << "Polling the writability of a full Loopback queue..." << std::endl;
+    {
+        NetworkLibrary::Poll write_poll;
+        char datas[64] = {};
+        NetworkLibrary::NetBuffer datagram{ datas, sizeof(datas) };
+
+        loopback_addr.FromString("9999");
+        dgram2.SetNonBlocking(true);
+        write_poll.AddSocket(dgram2, NetworkLibrary::PollFlags::out);
+        do
+        {
+            datagram.BufferSize = sizeof(datas);
+            error = dgram2.SendTo(loopback_addr, datagram);
+        } while ((int)error == NetworkLibrary::Error::NoError);
+
+        if ((int)error != NetworkLibrary::Error::WouldBlock || write_poll.DoPoll(std::chrono::milliseconds(0)) != 0)
+        {
+            std::cout << "Loopback dgram socket is writable with a full queue: " << error.ToString() << std::endl;
+            return;
+        }
+
+        net_buff.BufferSize = sizeof(buffer);
+        error = dgram1.ReceiveFrom(loopback_addr, net_buff);
+        if ((int)error != NetworkLibrary::Error::NoError || write_poll.DoPoll(std::chrono::milliseconds(100)) != 1 ||
+            (write_poll.GetRevents(dgram2) & NetworkLibrary::PollFlags::out) == 0)
+        {
+            std::cout << "Loopback dgram socket was not woken up by the freed space: " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    {
+        NetworkLibrary::Loopback::LoopbackDgram moved(std::move(dgram2));
+        if ((int)(error = dgram2.CreateSocket()) != NetworkLibrary::Error::NoError ||
+            (int)(error = dgram2.Bind(loopback_addr)) != NetworkLibrary::Error::AddrInUse)
+        {
+            std::cout << "Moved-from Loopback dgram socket is not reusable: " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+#endif
+#ifdef BLUETOOTH_TESTS
+void TestBluetooth()
+{
+    auto ifaces = NetworkLibrary::Bluetooth::GetIfacesAddresses();
+    if ((int)ifaces.first != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to get Bluetooth adapters: " << ifaces.first.ToString() << std::endl;
+        return;
+    }
+    for (auto& iface : ifaces.second)
+    {
+        std::cout << iface.Name << ' ' << iface.FriendlyName << ' ' << iface.IsUp << std::endl;
+        for (auto& ip : iface.Addresses)
+        {
+            std::cout << "    " << ip.Addr << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestBluetoothRFCOMMClient(const char* server_address, const char* bluetooth_service_uuid)
+{
+    std::string error_str;
+    std::string addr_string;
+    char buffer[1024];
+    NetworkLibrary::Bluetooth::RFCOMM rfcomm1;
+    NetworkLibrary::Bluetooth::BluetoothAddr bth_addr;
+    NetworkLibrary::Bluetooth::UUID uuid;
+    NetworkLibrary::Error error;
+    NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
+    uint8_t channel;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    std::cout << "Parsing Bluetooth service uuid..." << std::endl;
+    error = uuid.FromString(bluetooth_service_uuid);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to parse UUID: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Parsing Bluetooth server address..." << std::endl;
+    error = bth_addr.FromString(server_address);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to parse Bluetooth address: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Querying SDP for RFCOMM channel from UUID..." << std::endl;
+    error = NetworkLibrary::Bluetooth::GetChannelFromServiceUUID(uuid, bth_addr, channel);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to get channel at " << bth_addr.ToString() << " from uuid " << uuid.ToString() << ": " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Creating Bluetooth client socket..." << std::endl;
+    error = rfcomm1.CreateSocket();
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create Bluetooth socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    bth_addr.SetChannel(channel);
+
+    std::cout << "Connecting to Bluetooth: " << bth_addr.ToString() << std::endl;
+
+    error = rfcomm1.Connect(bth_addr);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to connected to " << bth_addr.ToString(true) << ": " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Sending datas to server..." << std::endl;
+
+    memcpy(buffer, "Hi from test client.", 21);
+    net_buff.BufferSize = 21;
+    error = rfcomm1.Send(net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to send datas : " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Datas sent, waiting for reply..." << std::endl;
+
+    net_buff.BufferSize = 1024;
+    error = rfcomm1.Receive(net_buff);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to receive datas : " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Datas received: " << buffer << std::endl;
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestBluetoothRFCOMMServer(const char* bluetooth_service_uuid)
+{
+    std::string error_str;
+    char buffer[1024];
+    NetworkLibrary::Bluetooth::RFCOMM rfcomm1, rfcomm2;
+    NetworkLibrary::Bluetooth::BluetoothAddr bth_addr;
+    NetworkLibrary::Bluetooth::SDPService sdp_service;
+    NetworkLibrary::Bluetooth::UUID service_uuid;
+    NetworkLibrary::Error error;
+    NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
+
+    bth_addr.SetAnyAddr();
+    bth_addr.SetChannel(6);
 
     std::cout << __FUNCTION__ << std::endl;
 
@@ -832,21 +1541,1127 @@ void TestBluetoothRFCOMMServer(const char* bluetooth_service_uuid)
 }
 #endif
 
-int main()
+void TestDualStackUDP()
 {
-    const char bth_uuid[] = "00000000-0000-0000-0000-000000000000";
-    const char bth_server[] = "00:00:00:00:00:00";
+    char buffer[64];
+    NetworkLibrary::IPv6::UDP server;
+    NetworkLibrary::IPv4::UDP client;
+    NetworkLibrary::IPv6::IPv6Addr server_addr;
+    NetworkLibrary::IPv4::IPv4Addr client_addr, from_ipv4;
+    NetworkLibrary::AnyAddr from;
+    NetworkLibrary::Error error;
+    NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
 
-    TestIPv4();
-    TestIPv4UDP();
-    TestIPv4TCP();
+    std::cout << __FUNCTION__ << std::endl;
 
-    TestIPv6();
-    TestIPv6UDP();
-    TestIPv6TCP();
+    server_addr.FromString("[::]:9992");
+    client_addr.FromString("127.0.0.1:9992");
+    if ((int)(error = server.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = server.SetOption<NetworkLibrary::Options::Ipv6V6Only>(false)) != NetworkLibrary::Error::NoError ||
+        (int)(error = server.Bind(server_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = client.CreateSocket()) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create the dual-stack socket: " << error.ToString() << std::endl;
+        return;
+    }
 
-#ifdef UNIX_TESTS
-    TestUnixStream("unix1.sock");
+    memcpy(buffer, "ping", 4);
+    net_buff.BufferSize = 4;
+    client.SendTo(client_addr, net_buff);
+    net_buff.BufferSize = sizeof(buffer);
+    if ((int)(error = server.ReceiveFrom(from, net_buff)) != NetworkLibrary::Error::NoError || net_buff.BufferSize != 4)
+    {
+        std::cout << "Failed to receive IPv4 traffic on the dual-stack socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Received from " << from.ToString(true) << std::endl;
+    if (from.GetFamily() != server_addr.GetFamily() || !from.IsIPv4Mapped() || !from.Normalize() ||
+        from.GetFamily() != client_addr.GetFamily() || from.GetLength() != client_addr.GetLength() ||
+        (int)from.ToAddr(from_ipv4) != NetworkLibrary::Error::NoError || from_ipv4.GetIPv4() != 0x7f000001 || from_ipv4.GetPort() != from.GetPort())
+    {
+        std::cout << "Failed to normalize the IPv4 mapped address " << from.ToString(true) << std::endl;
+        return;
+    }
+
+    // Answer through the dual-stack socket, with the mapped address for portability.
+    from.MapToIPv6();
+    memcpy(buffer, "pong", 4);
+    net_buff.BufferSize = 4;
+    if ((int)(error = server.SendTo(from, net_buff)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to answer the IPv4 peer: " << error.ToString() << std::endl;
+        return;
+    }
+
+    net_buff.BufferSize = sizeof(buffer);
+    if ((int)(error = client.ReceiveFrom(from, net_buff)) != NetworkLibrary::Error::NoError || net_buff.BufferSize != 4 || memcmp(buffer, "pong", 4) != 0 ||
+        from.ToString(true) != "127.0.0.1:9992")
+    {
+        std::cout << "Failed to receive the answer: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestIPv4Multicast()
+{
+    char buffer[64];
+    NetworkLibrary::IPv4::UDP receiver, sender;
+    NetworkLibrary::IPv4::IPv4Addr bind_addr, group, ssm_group, source, from;
+    NetworkLibrary::Error error;
+    NetworkLibrary::NetBuffer net_buff{ buffer, 0 };
+    NetworkLibrary::Poll poll;
+    uint32_t loopback_index = 0;
+    uint8_t ttl = 0;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    // Everything stays on the loopback interface, picked from the interfaces list.
+    auto ifaces = NetworkLibrary::IPv4::GetIfacesAddresses();
+    for (auto& iface : ifaces.second)
+    {
+        for (auto& addr : iface.Addresses)
+        {
+            if (addr.Addr == "127.0.0.1")
+                loopback_index = iface.Index;
+        }
+    }
+
+    bind_addr.FromString("0.0.0.0:9991");
+    group.FromString("239.255.42.1:9991");
+    ssm_group.FromString("232.1.42.1:9991");
+    source.SetLoopbackAddr();
+    if (loopback_index == 0 ||
+        (int)(error = receiver.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.SetOption<NetworkLibrary::Options::ReuseAddr>(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.Bind(bind_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.JoinGroup(group, loopback_index)) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.JoinSourceGroup(ssm_group, source, loopback_index)) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.SetNonBlocking(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = sender.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        // Bound on the source the source-specific group expects, the system could pick another address.
+        (int)(error = sender.Bind(source)) != NetworkLibrary::Error::NoError ||
+        (int)(error = sender.SetMulticastInterface(loopback_index)) != NetworkLibrary::Error::NoError ||
+        (int)(error = sender.SetOption<NetworkLibrary::Options::IpMulticastTtl>(1)) != NetworkLibrary::Error::NoError ||
+        (int)(error = sender.SetOption<NetworkLibrary::Options::IpMulticastLoop>(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = sender.GetOption<NetworkLibrary::Options::IpMulticastTtl>(ttl)) != NetworkLibrary::Error::NoError || ttl != 1)
+    {
+        std::cout << "Failed to set up the multicast sockets: " << error.ToString() << std::endl;
+        return;
+    }
+
+    poll.AddSocket(receiver, NetworkLibrary::PollFlags::in);
+    for (auto* destination : { &group, &ssm_group })
+    {
+        memcpy(buffer, "tick", 4);
+        net_buff.BufferSize = 4;
+        sender.SendTo(*destination, net_buff);
+
+        net_buff.BufferSize = sizeof(buffer);
+        if (poll.DoPoll(std::chrono::milliseconds(1000)) != 1 ||
+            (int)(error = receiver.ReceiveFrom(from, net_buff)) != NetworkLibrary::Error::NoError || net_buff.BufferSize != 4)
+        {
+            std::cout << "Failed to receive from multicast group " << destination->ToString() << ": " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    // Once left, the group datagrams aren't delivered anymore.
+    receiver.LeaveGroup(group, loopback_index);
+    net_buff.BufferSize = 4;
+    sender.SendTo(group, net_buff);
+    if (poll.DoPoll(std::chrono::milliseconds(100)) != 0)
+    {
+        std::cout << "Received from a multicast group after leaving it." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestSocketOptions()
+{
+    NetworkLibrary::IPv4::TCP tcp;
+    NetworkLibrary::IPv6::TCP tcp6;
+    NetworkLibrary::Error error;
+    bool no_delay = false;
+    bool v6_only = false;
+    uint8_t tos = 0;
+    std::chrono::milliseconds user_timeout(0);
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    if ((int)(error = tcp.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = tcp6.CreateSocket()) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create TCP sockets: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Setting TCP_NODELAY..." << std::endl;
+    if ((int)(error = tcp.SetOption<NetworkLibrary::Options::TcpNoDelay>(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = tcp.GetOption<NetworkLibrary::Options::TcpNoDelay>(no_delay)) != NetworkLibrary::Error::NoError ||
+        !no_delay)
+    {
+        std::cout << "Failed to set TCP_NODELAY: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Setting IP_TOS..." << std::endl;
+    if ((int)(error = tcp.SetOption<NetworkLibrary::Options::IpTos>(0x10)) != NetworkLibrary::Error::NoError ||
+        (int)(error = tcp.GetOption<NetworkLibrary::Options::IpTos>(tos)) != NetworkLibrary::Error::NoError ||
+        tos != 0x10)
+    {
+        std::cout << "Failed to set IP_TOS: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Setting IPV6_V6ONLY..." << std::endl;
+    if ((int)(error = tcp6.SetOption<NetworkLibrary::Options::Ipv6V6Only>(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = tcp6.GetOption<NetworkLibrary::Options::Ipv6V6Only>(v6_only)) != NetworkLibrary::Error::NoError ||
+        !v6_only)
+    {
+        std::cout << "Failed to set IPV6_V6ONLY: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Setting TCP_USER_TIMEOUT..." << std::endl;
+    error = tcp.SetOption<NetworkLibrary::Options::TcpUserTimeout>(std::chrono::milliseconds(5000));
+    if ((int)error == NetworkLibrary::Error::NotSupported)
+    {
+        std::cout << "TCP_USER_TIMEOUT not supported, skipping." << std::endl;
+    }
+    else if ((int)error != NetworkLibrary::Error::NoError ||
+        (int)(error = tcp.GetOption<NetworkLibrary::Options::TcpUserTimeout>(user_timeout)) != NetworkLibrary::Error::NoError ||
+        user_timeout != std::chrono::milliseconds(5000))
+    {
+        std::cout << "Failed to set TCP_USER_TIMEOUT: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestErrors()
+{
+    NetworkLibrary::IPv4::UDP udp;
+    NetworkLibrary::IPv4::IPv4Addr addr;
+    NetworkLibrary::Error error;
+    char buffer[16];
+    NetworkLibrary::NetBuffer net_buffer{ buffer, sizeof(buffer) };
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    static_assert(sizeof(NetworkLibrary::Result) == sizeof(int), "Result must stay register sized.");
+    if (!NetworkLibrary::Result().IsOk() || (int)NetworkLibrary::Result().ToError() != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Default Result is not a success." << std::endl;
+        return;
+    }
+
+    addr.FromString("127.0.0.1");
+    if ((int)(error = udp.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = udp.Bind(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = udp.SetNonBlocking(true)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create IPv4 UDP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Receiving on an empty socket..." << std::endl;
+    error = udp.ReceiveFrom(addr, net_buffer);
+    if ((int)error != NetworkLibrary::Error::WouldBlock ||
+        error.ToErrorCode() != std::errc::operation_would_block ||
+        error.ToErrorCode().category() != NetworkLibrary::ErrorCategory() ||
+        std::strcmp(error.Message(), "Error would block.") != 0 ||
+        error.ToErrorCode().message() != error.Message())
+    {
+        std::cout << "Unexpected error: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestIoCounters()
+{
+    NetworkLibrary::IPv4::UDP udp;
+    NetworkLibrary::IPv4::IPv4Addr addr;
+    NetworkLibrary::IPv4::IPv4Addr from_addr;
+    NetworkLibrary::IoCounters counters;
+    NetworkLibrary::IoCounters process_counters;
+    NetworkLibrary::Error error;
+    char message[] = "Hello";
+    char buffer[16];
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    addr.FromString("127.0.0.1:9989");
+    if ((int)(error = udp.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = udp.Bind(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = udp.SetNonBlocking(true)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create IPv4 UDP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Sending to ourself..." << std::endl;
+    NetworkLibrary::NetBuffer send_buffer{ message, sizeof(message) };
+    if ((int)(error = udp.SendTo(addr, send_buffer)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to send: " << error.ToString() << std::endl;
+        return;
+    }
+
+    NetworkLibrary::NetBuffer receive_buffer{ buffer, sizeof(buffer) };
+    for (int i = 0; i < 100 && (int)(error = udp.ReceiveFrom(from_addr, receive_buffer)) == NetworkLibrary::Error::WouldBlock; ++i)
+    {
+        receive_buffer.BufferSize = sizeof(buffer);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if ((int)error != NetworkLibrary::Error::NoError || receive_buffer.BufferSize != sizeof(message))
+    {
+        std::cout << "Failed to receive: " << error.ToString() << std::endl;
+        return;
+    }
+
+    receive_buffer.BufferSize = sizeof(buffer);
+    udp.ReceiveFrom(from_addr, receive_buffer);
+
+    counters = udp.GetIoCounters();
+    process_counters = NetworkLibrary::GetProcessIoCounters();
+    if (!NetworkLibrary::IoCounters::Enabled)
+    {
+        std::cout << "I/O counters are compiled out." << std::endl;
+        if (counters.SendCalls != 0 || process_counters.SendCalls != 0)
+        {
+            std::cout << "Compiled out counters are not 0." << std::endl;
+            return;
+        }
+    }
+    else if (counters.SendCalls != 1 || counters.BytesSent != sizeof(message) || counters.ShortWrites != 0 ||
+        counters.ReceiveCalls < 2 || counters.BytesReceived != sizeof(message) || counters.WouldBlock != counters.ReceiveCalls - 1 ||
+        counters.Errors[0] != 0 || counters.Errors[NetworkLibrary::Error::WouldBlock] != 0 ||
+        process_counters.SendCalls < counters.SendCalls || process_counters.BytesReceived < counters.BytesReceived ||
+        process_counters.WouldBlock < counters.WouldBlock)
+    {
+        std::cout << "Unexpected I/O counters." << std::endl;
+        return;
+    }
+
+    std::cout << "Sending from 4 threads on the same socket..." << std::endl;
+    std::vector<std::thread> senders;
+    for (int i = 0; i < 4; ++i)
+    {
+        senders.emplace_back([&udp, &addr, &message]()
+        {
+            for (int j = 0; j < 1000; ++j)
+            {
+                NetworkLibrary::NetBuffer net_buffer{ message, sizeof(message) };
+                udp.SendTo(addr, net_buffer);
+            }
+        });
+    }
+    for (auto& sender : senders)
+        sender.join();
+
+    if (NetworkLibrary::IoCounters::Enabled && udp.GetIoCounters().SendCalls != counters.SendCalls + 4000)
+    {
+        std::cout << "Concurrent sends were lost: " << udp.GetIoCounters().SendCalls - counters.SendCalls << " counted." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestLatencyHistogram()
+{
+    NetworkLibrary::LatencyHistogram histogram;
+    NetworkLibrary::LatencyHistogram other;
+    NetworkLibrary::IPv4::UDP udp;
+    NetworkLibrary::IPv4::IPv4Addr addr;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    char message[] = "Hello";
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    std::cout << "Checking the buckets..." << std::endl;
+    for (uint64_t value : { 0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, (1ull << 40) - 1 })
+    {
+        size_t index = NetworkLibrary::LatencyHistogram::BucketIndex(value);
+        if (index >= NetworkLibrary::LatencyHistogram::BucketCount ||
+            NetworkLibrary::LatencyHistogram::BucketLowerBound(index) > value ||
+            NetworkLibrary::LatencyHistogram::BucketUpperBound(index) < value ||
+            (value >= 32 && NetworkLibrary::LatencyHistogram::BucketUpperBound(index) - NetworkLibrary::LatencyHistogram::BucketLowerBound(index) + 1 > value / 32))
+        {
+            std::cout << "Wrong bucket for " << value << "." << std::endl;
+            return;
+        }
+    }
+
+    // 999 fast values and one stall: the stall is above p99.9 only.
+    for (int i = 0; i < 999; ++i)
+        histogram.Record(std::chrono::microseconds(10));
+    other.Record(std::chrono::milliseconds(50));
+    histogram.Merge(other);
+
+    std::vector<NetworkLibrary::LatencyHistogram::Bucket> buckets = histogram.GetBuckets();
+    if (histogram.GetCount() != 1000 || histogram.GetMin() != std::chrono::microseconds(10) || histogram.GetMax() != std::chrono::milliseconds(50) ||
+        histogram.GetPercentile(50) < std::chrono::microseconds(10) || histogram.GetPercentile(50) > std::chrono::microseconds(11) ||
+        histogram.GetPercentile(99.9) > std::chrono::microseconds(11) || histogram.GetPercentile(100) != std::chrono::milliseconds(50) ||
+        buckets.size() != 2 || buckets[0].Count != 999 || buckets[1].Count != 1)
+    {
+        std::cout << "Unexpected histogram, p50 " << histogram.GetPercentile(50).count() << "ns, p99.9 " << histogram.GetPercentile(99.9).count() << "ns." << std::endl;
+        return;
+    }
+
+    addr.FromString("127.0.0.1:9988");
+    if ((int)(error = udp.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = udp.Bind(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = poll.AddSocket(udp, NetworkLibrary::PollFlags::in)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create IPv4 UDP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Polling..." << std::endl;
+    NetworkLibrary::NetBuffer send_buffer{ message, sizeof(message) };
+    udp.SendTo(addr, send_buffer);
+    poll.DoPoll(std::chrono::milliseconds(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    poll.DoPoll(std::chrono::milliseconds(0));
+
+    NetworkLibrary::LatencyHistogram handler = NetworkLibrary::GetThreadLatencyHistogram(NetworkLibrary::LatencyMetric::PollHandler);
+    NetworkLibrary::LatencyHistogram process_send = NetworkLibrary::GetProcessLatencyHistogram(NetworkLibrary::LatencyMetric::Send);
+    if (!NetworkLibrary::LatencyMetric::Enabled)
+    {
+        std::cout << "Latency histograms are compiled out." << std::endl;
+        if (handler.GetCount() != 0 || process_send.GetCount() != 0)
+        {
+            std::cout << "Compiled out histograms are not empty." << std::endl;
+            return;
+        }
+    }
+    else if (NetworkLibrary::GetThreadLatencyHistogram(NetworkLibrary::LatencyMetric::PollWait).GetCount() < 2 ||
+        handler.GetCount() < 1 || handler.GetMax() < std::chrono::milliseconds(5) ||
+        process_send.GetCount() < 1)
+    {
+        std::cout << "Unexpected latency histograms." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestHappyEyeballs()
+{
+    NetworkLibrary::HappyEyeballs happy_eyeballs;
+    NetworkLibrary::IPv4::TCP listener, client_ipv4, accepted;
+    NetworkLibrary::IPv6::TCP client_ipv6;
+    NetworkLibrary::IPv4::IPv4Addr ipv4_addr;
+    NetworkLibrary::IPv6::IPv6Addr ipv6_addr;
+    NetworkLibrary::Error error;
+    size_t winner = 0;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    ipv4_addr.FromString("127.0.0.1:9994");
+    // Nothing listens there, the attempt must fail and let the IPv4 one win.
+    ipv6_addr.FromString("[::1]:9994");
+
+    if ((int)(error = listener.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Bind(ipv4_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Listen()) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to listen IPv4 TCP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    happy_eyeballs.AddCandidate(ipv4_addr);
+    happy_eyeballs.AddCandidate(ipv6_addr);
+
+    std::cout << "Racing " << ipv6_addr.ToString(true) << " and " << ipv4_addr.ToString(true) << "..." << std::endl;
+    error = happy_eyeballs.Connect(std::chrono::milliseconds(2000), client_ipv4, client_ipv6, winner);
+    if ((int)error != NetworkLibrary::Error::NoError || winner != 0 || !client_ipv4.IsOpen() || client_ipv6.IsOpen())
+    {
+        std::cout << "Failed to connect: " << error.ToString() << std::endl;
+        return;
+    }
+
+    error = listener.Accept(accepted, ipv4_addr);
+    if ((int)error != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to accept: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Candidate " << winner << " won, accepted client " << ipv4_addr.ToString(true) << "." << std::endl;
+
+    std::cout << "Racing them again from a poll loop..." << std::endl;
+    NetworkLibrary::Poll poll;
+    client_ipv4.Close();
+    winner = 2;
+    error = happy_eyeballs.Start(std::chrono::milliseconds(2000));
+    while ((int)error == NetworkLibrary::Error::NoError || (int)error == NetworkLibrary::Error::InProgress)
+    {
+        error = happy_eyeballs.Process(client_ipv4, client_ipv6, winner);
+        if ((int)error != NetworkLibrary::Error::InProgress)
+            break;
+
+        poll.Clear();
+        for (auto socket : happy_eyeballs.GetPollSockets())
+            poll.AddSocket(*socket, NetworkLibrary::PollFlags::out);
+
+        poll.DoPoll(happy_eyeballs.GetNextTimeout());
+    }
+    if ((int)error != NetworkLibrary::Error::NoError || winner != 0 || !client_ipv4.IsOpen() || client_ipv6.IsOpen() || happy_eyeballs.IsRunning() ||
+        happy_eyeballs.GetNextTimeout().count() != -1 || (int)(error = listener.Accept(accepted, ipv4_addr)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to connect from the poll loop: " << error.ToString() << std::endl;
+        return;
+    }
+
+    happy_eyeballs.ClearCandidates();
+    happy_eyeballs.AddCandidate(ipv6_addr);
+    error = happy_eyeballs.Connect(std::chrono::milliseconds(2000), client_ipv4, client_ipv6, winner);
+    if ((int)error == NetworkLibrary::Error::NoError || client_ipv4.IsOpen() || client_ipv6.IsOpen())
+    {
+        std::cout << "Connecting to a closed port didn't fail." << std::endl;
+        return;
+    }
+
+    std::cout << "Connecting to a closed port failed: " << error.ToString() << std::endl;
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestConnectionPool()
+{
+    NetworkLibrary::ConnectionPool pool;
+    NetworkLibrary::IPv4::TCP listener, clients[4];
+    std::list<NetworkLibrary::IPv4::TCP> accepted;
+    NetworkLibrary::IPv4::IPv4Addr addr, client_addr;
+    NetworkLibrary::Error error;
+    size_t opened = 0;
+    bool reused = false;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    addr.FromString("127.0.0.1");
+    if ((int)(error = listener.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Bind(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Listen()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.GetSockName(addr)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to listen IPv4 TCP socket: " << error.ToString() << std::endl;
+        return;
+    }
+
+    auto accept_one = [&]()
+    {
+        accepted.emplace_back();
+        return (int)listener.Accept(accepted.back(), client_addr) == NetworkLibrary::Error::NoError;
+    };
+
+    pool.SetLimits(2, 3);
+    std::cout << "Warming up " << addr.ToString(true) << "..." << std::endl;
+    error = pool.WarmUp(addr, 5, std::chrono::milliseconds(2000), opened);
+    if ((int)error != NetworkLibrary::Error::NoError || opened != 2 || pool.GetIdleCount(addr) != 2 || !accept_one() || !accept_one())
+    {
+        std::cout << "Failed to warm up: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Acquiring up to the total limit..." << std::endl;
+    for (int i = 0; i < 3; ++i)
+    {
+        error = pool.Acquire(addr, clients[i], reused);
+        if ((int)error != NetworkLibrary::Error::NoError || reused != (i < 2))
+        {
+            std::cout << "Failed to acquire connection " << i << ": " << error.ToString() << std::endl;
+            return;
+        }
+    }
+    if (!accept_one() || pool.GetTotalCount(addr) != 3 || (int)pool.Acquire(addr, clients[3], reused) != NetworkLibrary::Error::WouldBlock)
+    {
+        std::cout << "The total limit wasn't enforced." << std::endl;
+        return;
+    }
+
+    std::cout << "Releasing past the idle limit..." << std::endl;
+    for (int i = 0; i < 3; ++i)
+        pool.Release(addr, clients[i]);
+
+    if (pool.GetIdleCount(addr) != 2 || pool.GetTotalCount(addr) != 2 || clients[0].IsOpen())
+    {
+        std::cout << "The idle limit wasn't enforced." << std::endl;
+        return;
+    }
+
+    std::cout << "Dropping connections closed by the peer..." << std::endl;
+    accepted.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    error = pool.Acquire(addr, clients[0], reused);
+    if ((int)error != NetworkLibrary::Error::NoError || reused || pool.GetTotalCount(addr) != 1 || !accept_one())
+    {
+        std::cout << "Closed connections were handed out: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Evicting idle connections..." << std::endl;
+    pool.Release(addr, clients[0]);
+    pool.SetIdleTimeout(std::chrono::milliseconds(0));
+    if (pool.GetNextEvictionTimeout().count() != 0 || pool.EvictIdle() != 1 || pool.GetTotalCount(addr) != 0 ||
+        pool.GetNextEvictionTimeout().count() != -1)
+    {
+        std::cout << "Failed to evict idle connections." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestSendQueue()
+{
+    NetworkLibrary::SendQueue queue;
+    NetworkLibrary::IPv4::TCP listener, client, server;
+    NetworkLibrary::IPv4::IPv4Addr addr, client_addr;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    std::vector<uint8_t> payload(64 * 1024);
+    uint8_t receive_buffer[16 * 1024];
+    size_t pushed = 0, received = 0, completed = 0;
+    int high_count = 0, low_count = 0;
+    bool paused = false;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    for (size_t i = 0; i < payload.size(); ++i)
+        payload[i] = static_cast<uint8_t>(i);
+
+    addr.FromString("127.0.0.1");
+    if ((int)(error = listener.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Bind(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Listen()) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.GetSockName(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = client.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = client.SetOption<NetworkLibrary::Options::SendBuffer>(16 * 1024)) != NetworkLibrary::Error::NoError ||
+        (int)(error = client.Connect(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = listener.Accept(server, client_addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = client.SetNonBlocking(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = server.SetNonBlocking(true)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to connect IPv4 TCP sockets: " << error.ToString() << std::endl;
+        return;
+    }
+
+    poll.AddSocket(client, NetworkLibrary::PollFlags::in);
+    queue.Attach(client, &poll);
+    queue.SetWatermarks(128 * 1024, 512 * 1024);
+    queue.SetWatermarkCallbacks(
+        [&](size_t) { ++high_count; paused = true; },
+        [&](size_t) { ++low_count; paused = false; });
+
+    std::cout << "Sending until the high watermark..." << std::endl;
+    while (!paused && pushed < 64 * payload.size())
+    {
+        NetworkLibrary::NetBuffer buffer{ payload.data(), payload.size() };
+        if ((int)(error = queue.Send(buffer, [&](bool sent) { completed += sent ? 1 : 0; })) != NetworkLibrary::Error::NoError)
+        {
+            std::cout << "Failed to send: " << error.ToString() << std::endl;
+            return;
+        }
+        pushed += payload.size();
+    }
+
+    if (high_count != 1 || queue.GetQueuedSize() < 512 * 1024 || !(poll.GetEvents(client) & NetworkLibrary::PollFlags::out))
+    {
+        std::cout << "The high watermark wasn't reached." << std::endl;
+        return;
+    }
+
+    std::cout << "Draining " << queue.GetQueuedSize() << " queued bytes..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    while (received < pushed && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        NetworkLibrary::NetBuffer buffer{ receive_buffer, sizeof(receive_buffer) };
+        if ((int)server.Receive(buffer) == NetworkLibrary::Error::NoError)
+        {
+            for (size_t i = 0; i < buffer.BufferSize; ++i, ++received)
+            {
+                if (receive_buffer[i] != static_cast<uint8_t>(received % payload.size()))
+                {
+                    std::cout << "Received corrupted data at " << received << "." << std::endl;
+                    return;
+                }
+            }
+        }
+
+        poll.DoPoll(std::chrono::milliseconds(0));
+        if ((int)(error = queue.OnPollEvents(poll.GetRevents(client))) != NetworkLibrary::Error::NoError)
+        {
+            std::cout << "Failed to flush: " << error.ToString() << std::endl;
+            return;
+        }
+    }
+
+    if (received != pushed || low_count != 1 || paused || queue.GetQueuedCount() != 0 || completed != pushed / payload.size() ||
+        (poll.GetEvents(client) & NetworkLibrary::PollFlags::out))
+    {
+        std::cout << "Failed to drain the queue, received " << received << "/" << pushed << "." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestPacer()
+{
+    NetworkLibrary::Pacer pacer;
+    NetworkLibrary::IPv4::UDP sender, receiver;
+    NetworkLibrary::IPv4::TCP tcp;
+    NetworkLibrary::IPv4::IPv4Addr addr, from_addr;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    uint8_t datagram[1000] = {};
+    uint8_t receive_buffer[2048];
+    size_t sent = 0, received = 0;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    addr.FromString("127.0.0.1");
+    if ((int)(error = receiver.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.Bind(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.GetSockName(addr)) != NetworkLibrary::Error::NoError ||
+        (int)(error = receiver.SetNonBlocking(true)) != NetworkLibrary::Error::NoError ||
+        (int)(error = sender.CreateSocket()) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to create IPv4 UDP sockets: " << error.ToString() << std::endl;
+        return;
+    }
+
+    // 1MB/s with a 10KB burst: the 10 first datagrams go right away, the 50 others take ~50ms.
+    pacer.SetRate(1000 * 1000, 10 * 1000);
+    if ((int)(error = pacer.Attach(sender)) != NetworkLibrary::Error::NoError || pacer.IsKernelPaced())
+    {
+        std::cout << "Failed to attach the pacer: " << error.ToString() << std::endl;
+        return;
+    }
+
+    std::cout << "Pacing 60 datagrams to " << addr.ToString(true) << "..." << std::endl;
+    poll.AddSocket(receiver, NetworkLibrary::PollFlags::in);
+    auto start = std::chrono::steady_clock::now();
+    while (sent < 60)
+    {
+        NetworkLibrary::NetBuffer buffer{ datagram, sizeof(datagram) };
+        error = pacer.SendTo(sender, addr, buffer);
+        if ((int)error == NetworkLibrary::Error::NoError)
+            ++sent;
+        else if ((int)error != NetworkLibrary::Error::WouldBlock)
+            break;
+
+        poll.DoPollPrecise(pacer.GetDelay(sizeof(datagram)));
+        for (NetworkLibrary::NetBuffer in{ receive_buffer, sizeof(receive_buffer) };
+            (int)receiver.ReceiveFrom(from_addr, in) == NetworkLibrary::Error::NoError;
+            in.BufferSize = sizeof(receive_buffer))
+        {
+            ++received;
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    if (sent != 60 || elapsed < std::chrono::milliseconds(40) || elapsed > std::chrono::milliseconds(1000))
+    {
+        std::cout << "Pacing failed, sent " << sent << " datagrams in " << elapsed.count() << "ms: " << error.ToString() << std::endl;
+        return;
+    }
+    std::cout << "Sent " << sent << " datagrams in " << elapsed.count() << "ms, " << received << " received on the way." << std::endl;
+
+    if ((int)(error = tcp.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = pacer.Attach(tcp)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to attach the pacer to a TCP socket: " << error.ToString() << std::endl;
+        return;
+    }
+    std::cout << "TCP socket kernel paced: " << (pacer.IsKernelPaced() ? "yes" : "no") << std::endl;
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestSessionTable()
+{
+    NetworkLibrary::SessionTable<std::string> sessions;
+    NetworkLibrary::IPv4::IPv4Addr ipv4_addr, ipv4_back;
+    NetworkLibrary::IPv6::IPv6Addr ipv6_addr, ipv6_back;
+    NetworkLibrary::EndpointKey key;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    ipv4_addr.FromString("10.0.0.1:5000");
+    ipv6_addr.FromString("[::ffff:10.0.0.1]:5000");
+    key.FromAddr(static_cast<NetworkLibrary::BasicAddr const&>(ipv4_addr));
+    if (key != NetworkLibrary::EndpointKey(ipv4_addr) || key == NetworkLibrary::EndpointKey(ipv6_addr) ||
+        (int)key.ToAddr(ipv6_back) == NetworkLibrary::Error::NoError ||
+        (int)key.ToAddr(ipv4_back) != NetworkLibrary::Error::NoError || ipv4_back.ToString(true) != "10.0.0.1:5000")
+    {
+        std::cout << "EndpointKey doesn't match its address." << std::endl;
+        return;
+    }
+
+    // Enough endpoints to rehash a few times, IPv4 and IPv6 mixed.
+    for (uint16_t port = 1; port <= 5000; ++port)
+    {
+        ipv4_addr.SetPort(port);
+        ipv6_addr.SetPort(port);
+        if (!sessions.Insert(NetworkLibrary::EndpointKey(ipv4_addr), ipv4_addr.ToString(true)).second ||
+            !sessions.Insert(NetworkLibrary::EndpointKey(ipv6_addr), ipv6_addr.ToString(true)).second)
+        {
+            std::cout << "Failed to insert session " << port << std::endl;
+            return;
+        }
+    }
+
+    ipv6_addr.SetPort(42);
+    if (sessions.Insert(NetworkLibrary::EndpointKey(ipv6_addr), "duplicate").second || *sessions.Find(NetworkLibrary::EndpointKey(ipv6_addr)) != "[::ffff:10.0.0.1]:42")
+    {
+        std::cout << "Session inserted twice." << std::endl;
+        return;
+    }
+
+    // Drop the even IPv4 ports and all the IPv6 endpoints, then check every lookup.
+    const int ipv4_family = ipv4_addr.GetFamily();
+    size_t erased = sessions.EraseIf([ipv4_family](NetworkLibrary::EndpointKey const& key, std::string&) { return key.Family != ipv4_family || key.Port % 2 == 0; });
+    for (uint16_t port = 1; port <= 5000; ++port)
+    {
+        ipv4_addr.SetPort(port);
+        ipv6_addr.SetPort(port);
+        std::string* session = sessions.Find(NetworkLibrary::EndpointKey(ipv4_addr));
+        if ((port % 2 == 0) != (session == nullptr) || (session != nullptr && *session != ipv4_addr.ToString(true)) ||
+            sessions.Find(NetworkLibrary::EndpointKey(ipv6_addr)) != nullptr)
+        {
+            std::cout << "Wrong session for port " << port << std::endl;
+            return;
+        }
+    }
+
+    ipv4_addr.SetPort(1);
+    if (erased != 7500 || sessions.GetSize() != 2500 || !sessions.Erase(NetworkLibrary::EndpointKey(ipv4_addr)) || sessions.Erase(NetworkLibrary::EndpointKey(ipv4_addr)))
+    {
+        std::cout << "Failed to erase sessions." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestInterfaceMonitor()
+{
+    NetworkLibrary::InterfaceMonitor monitor;
+    NetworkLibrary::IPv4::IPv4Addr loopback, addr;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    size_t events = 0;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    monitor.SetCallback([&events](NetworkLibrary::InterfaceEvent const&) { ++events; });
+    if ((int)(error = monitor.Open()) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to open the interface monitor: " << error.ToString() << std::endl;
+        return;
+    }
+
+    loopback.SetLoopbackAddr();
+    bool has_loopback = false;
+    for (auto const& address : monitor.GetAddresses())
+    {
+        std::string addr_string;
+        NetworkLibrary::IPv6::IPv6Addr ipv6_addr;
+        if ((int)address.Addr.ToAddr(addr) == NetworkLibrary::Error::NoError)
+            addr_string = addr.ToString();
+        else if ((int)address.Addr.ToAddr(ipv6_addr) == NetworkLibrary::Error::NoError)
+            addr_string = ipv6_addr.ToString();
+
+        std::cout << "    " << address.IfaceIndex << ": " << addr_string << '/' << (int)address.PrefixLength << std::endl;
+        has_loopback |= address.Addr == NetworkLibrary::EndpointKey(loopback);
+    }
+
+    // The snapshot doesn't produce events, nothing changed since.
+    poll.AddSocket(monitor.GetPollSocket(), NetworkLibrary::PollFlags::in);
+    if (!has_loopback || poll.DoPoll(std::chrono::milliseconds(0)) != 0 || monitor.Process() != 0 || events != 0)
+    {
+        std::cout << "Wrong interface monitor snapshot." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+void TestDiscovery()
+{
+    NetworkLibrary::DiscoveryService first, second;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    size_t first_found = 0, second_found = 0, first_lost = 0;
+    std::string first_payload;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    first.SetAnnouncement(1234, "first", 5);
+    second.SetAnnouncement(5678, "second", 6);
+    first.SetReplyDelay(std::chrono::milliseconds(10));
+    second.SetReplyDelay(std::chrono::milliseconds(10));
+    first.SetCallback([&](NetworkLibrary::DiscoveryEvent const& event)
+    {
+        if (event.EventType == NetworkLibrary::DiscoveryEvent::PeerFound && event.Peer.Addr.GetPort() == 5678)
+        {
+            ++first_found;
+            first_payload.assign(event.Peer.Payload.begin(), event.Peer.Payload.end());
+        }
+        else if (event.EventType == NetworkLibrary::DiscoveryEvent::PeerLost)
+        {
+            ++first_lost;
+        }
+    });
+    second.SetCallback([&](NetworkLibrary::DiscoveryEvent const& event)
+    {
+        if (event.EventType == NetworkLibrary::DiscoveryEvent::PeerFound && event.Peer.Addr.GetPort() == 1234)
+            ++second_found;
+    });
+
+    // Both services share the discovery port, like two hosts would.
+    if ((int)(error = first.Open(9990)) != NetworkLibrary::Error::NoError ||
+        (int)(error = second.Open(9990)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to open the discovery services: " << error.ToString() << std::endl;
+        return;
+    }
+
+    poll.AddSocket(first.GetPollSocket(), NetworkLibrary::PollFlags::in);
+    poll.AddSocket(second.GetPollSocket(), NetworkLibrary::PollFlags::in);
+
+    // The second one queries at Open, the first one answers after its reply delay.
+    // The beacons come from every interface, the peer must still be found only once.
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        poll.DoPoll(std::min(first.GetNextTimeout(), std::chrono::milliseconds(10)));
+        first.Process();
+        second.Process();
+    }
+
+    if (first_found != 1 || second_found != 1 || first_payload != "second" || first.GetPeers().size() != 1 || second.GetPeers().size() != 1)
+    {
+        std::cout << "Failed to discover the peers: " << first_found << ", " << second_found << std::endl;
+        return;
+    }
+
+    // The goodbye removes the peer without waiting for its timeout.
+    second.Close();
+    end = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (first_lost == 0 && std::chrono::steady_clock::now() < end)
+    {
+        poll.DoPoll(std::chrono::milliseconds(10));
+        first.Process();
+    }
+
+    if (first_lost != 1 || !first.GetPeers().empty())
+    {
+        std::cout << "The peer goodbye was missed." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+// Answers A stub.test with 10.0.0.1, AAAA stub.test with nothing and anything else with NXDOMAIN.
+void StubDnsServer(NetworkLibrary::IPv4::UDP& server, std::atomic<bool>& stop, std::atomic<int>& a_queries)
+{
+    uint8_t buffer[512];
+    NetworkLibrary::IPv4::IPv4Addr client_addr;
+    NetworkLibrary::Poll poll;
+
+    poll.AddSocket(server, NetworkLibrary::PollFlags::in);
+    while (!stop)
+    {
+        if (poll.DoPoll(std::chrono::milliseconds(50)) <= 0)
+            continue;
+
+        NetworkLibrary::NetBuffer net_buff{ buffer, sizeof(buffer) };
+        if ((int)server.ReceiveFrom(client_addr, net_buff) != NetworkLibrary::Error::NoError || net_buff.BufferSize < 12)
+            continue;
+
+        static const uint8_t stub_name[] = "\x04stub\x04test";
+        size_t size = net_buff.BufferSize;
+        bool is_stub = size >= 12 + sizeof(stub_name) + 4 && memcmp(buffer + 12, stub_name, sizeof(stub_name)) == 0;
+        uint16_t qtype = (buffer[size - 4] << 8) | buffer[size - 3];
+
+        buffer[2] = 0x81;
+        buffer[3] = is_stub ? 0x80 : 0x83;
+        if (is_stub && qtype == 1)
+        {
+            static const uint8_t answer[] = { 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 10, 0, 0, 1 };
+            buffer[7] = 1;
+            memcpy(buffer + size, answer, sizeof(answer));
+            size += sizeof(answer);
+            ++a_queries;
+        }
+
+        net_buff.BufferSize = size;
+        server.SendTo(client_addr, net_buff);
+    }
+}
+
+void TestResolver()
+{
+    NetworkLibrary::IPv4::UDP server;
+    NetworkLibrary::IPv4::IPv4Addr server_addr;
+    NetworkLibrary::Resolver resolver;
+    NetworkLibrary::Poll poll;
+    NetworkLibrary::Error error;
+    std::atomic<bool> stop(false);
+    std::atomic<int> a_queries(0);
+    int done = 0;
+    bool found = false;
+
+    std::cout << __FUNCTION__ << std::endl;
+
+    server_addr.FromString("127.0.0.1:9993");
+    if ((int)(error = server.CreateSocket()) != NetworkLibrary::Error::NoError ||
+        (int)(error = server.Bind(server_addr)) != NetworkLibrary::Error::NoError)
+    {
+        std::cout << "Failed to start stub DNS server: " << error.ToString() << std::endl;
+        return;
+    }
+    std::thread server_thread(StubDnsServer, std::ref(server), std::ref(stop), std::ref(a_queries));
+
+    auto run_resolver = [&](int expected)
+    {
+        auto start = std::chrono::steady_clock::now();
+        while (done < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+        {
+            poll.DoPoll(std::chrono::milliseconds(50));
+            resolver.Process();
+        }
+        return done == expected;
+    };
+
+    auto on_stub = [&](std::string const& name, NetworkLibrary::Error error, NetworkLibrary::ResolveResult const& result)
+    {
+        found = (int)error == NetworkLibrary::Error::NoError && result.IPv4Addrs.size() == 1 && result.IPv4Addrs[0].ToString(false) == "10.0.0.1";
+        std::cout << "Resolved " << name << ": " << error.ToString() << " " << (result.IPv4Addrs.empty() ? "" : result.IPv4Addrs[0].ToString(false)) << std::endl;
+        ++done;
+    };
+
+    resolver.Open();
+    resolver.SetNameServer(server_addr);
+    poll.AddSocket(resolver.GetPollSocket(), NetworkLibrary::PollFlags::in);
+
+    std::cout << "Resolving stub.test twice..." << std::endl;
+    resolver.Resolve("Stub.Test", on_stub);
+    resolver.Resolve("stub.test.", on_stub);
+    if (!run_resolver(2) || !found || a_queries != 1)
+    {
+        std::cout << "Failed to resolve stub.test (" << a_queries << " queries)." << std::endl;
+        stop = true; server_thread.join();
+        return;
+    }
+
+    std::cout << "Resolving stub.test from cache..." << std::endl;
+    found = false;
+    resolver.Resolve("stub.test", on_stub);
+    if (done != 3 || !found || a_queries != 1)
+    {
+        std::cout << "Failed to resolve stub.test from cache." << std::endl;
+        stop = true; server_thread.join();
+        return;
+    }
+
+    std::cout << "Resolving missing.test..." << std::endl;
+    resolver.Resolve("missing.test", [&](std::string const&, NetworkLibrary::Error error, NetworkLibrary::ResolveResult const&)
+    {
+        found = (int)error == NetworkLibrary::Error::NotFound;
+        ++done;
+    });
+    if (!run_resolver(4) || !found)
+    {
+        std::cout << "missing.test wasn't reported as not found." << std::endl;
+        stop = true; server_thread.join();
+        return;
+    }
+
+    stop = true;
+    server_thread.join();
+
+    std::cout << "Resolving localhost through the system..." << std::endl;
+    NetworkLibrary::Resolver system_resolver;
+    system_resolver.Open();
+    poll.Clear();
+    poll.AddSocket(system_resolver.GetPollSocket(), NetworkLibrary::PollFlags::in);
+    found = false;
+    system_resolver.Resolve("localhost", [&](std::string const&, NetworkLibrary::Error error, NetworkLibrary::ResolveResult const& result)
+    {
+        found = (int)error == NetworkLibrary::Error::NoError && (!result.IPv4Addrs.empty() || !result.IPv6Addrs.empty());
+        ++done;
+    });
+    auto start = std::chrono::steady_clock::now();
+    while (done < 5 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        poll.DoPoll(std::chrono::milliseconds(1000));
+        system_resolver.Process();
+    }
+    if (!found)
+    {
+        std::cout << "Failed to resolve localhost." << std::endl;
+        return;
+    }
+
+    std::cout << __FUNCTION__ << " done !" << std::endl << std::endl;
+}
+
+int main()
+{
+    const char bth_uuid[] = "00000000-0000-0000-0000-000000000000";
+    const char bth_server[] = "00:00:00:00:00:00";
+
+    TestIPv4();
+    TestIPv4UDP();
+    TestIPv4TCP();
+    TestIPv4TCPMove();
+    TestIPv4TCPAcceptBatch();
+    TestIPv4TCPAcceptBatchEmfile();
+    TestIPv4TCPListenerGroup();
+
+    TestIPv6();
+    TestIPv6UDP();
+    TestIPv6TCP();
+    TestDualStackUDP();
+    TestIPv4Multicast();
+
+    TestSocketOptions();
+    TestErrors();
+    TestIoCounters();
+    TestLatencyHistogram();
+    TestHappyEyeballs();
+    TestResolver();
+    TestConnectionPool();
+    TestSendQueue();
+    TestPacer();
+    TestSessionTable();
+    TestInterfaceMonitor();
+    TestDiscovery();
+
+#ifdef UNIX_TESTS
+    TestUnixStream("unix1.sock");
+#endif
+
+#ifdef LOOPBACK_TESTS
+    TestLoopbackStream();
+    TestLoopbackDgram();
 #endif
 
 #ifdef BLUETOOTH_TESTS